@@ -0,0 +1,417 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include <omp.h>
+
+#include "benchmark.hpp"
+#include "configraw.hpp"
+#include "util/util.hpp"
+
+//-----------------------------------------------------------------------------
+// internal helpers
+//-----------------------------------------------------------------------------
+namespace
+{
+    constexpr unsigned int NUM_REPETITIONS = 3;
+
+    /**
+     * \brief runs a function several times and returns the fastest run in ms
+     *
+     * \param func function to measure
+     * \param prepare function that is called before each run and not measured
+     */
+    double measure(
+        const std::function<void()> &func,
+        const std::function<void()> &prepare)
+    {
+        double best = -1.0;
+
+        for (unsigned int i = 0; i < NUM_REPETITIONS; ++i)
+        {
+            prepare();
+
+            auto start = std::chrono::steady_clock::now();
+            func();
+            auto end = std::chrono::steady_clock::now();
+
+            double ms =
+                std::chrono::duration<double, std::milli>(end - start).count();
+            if ((best < 0.0) || (ms < best))
+                best = ms;
+        }
+
+        return best;
+    }
+
+    void printResult(
+        const std::string &label, double ms, size_t bytes)
+    {
+        std::cout << std::left << std::setw(36) << label <<
+            std::right << std::fixed << std::setprecision(2) <<
+            std::setw(12) << ms << " ms" <<
+            std::setw(12) << (static_cast<double>(bytes) / (1 << 20)) /
+                (ms / 1000.0) << " MiB/s" << std::endl;
+    }
+
+    template<typename T>
+    int benchmarkSubsetLoadingT(
+        const std::string &path,
+        std::array<size_t, 3> origDim,
+        std::array<size_t, 3> subsetMin,
+        std::array<size_t, 3> subsetMax)
+    {
+        size_t count =
+            (subsetMax[0] - subsetMin[0] + 1) *
+            (subsetMax[1] - subsetMin[1] + 1) *
+            (subsetMax[2] - subsetMin[2] + 1);
+        std::vector<T> rowwise(count), coalesced(count);
+        double ms = 0.0;
+
+        auto loadRowwise = [&]() {
+            cr::loadSubset3dCuboid<T>(
+                path, rowwise.data(), origDim, subsetMin, subsetMax); };
+        auto loadCoalesced = [&]() {
+            cr::readSubset3dCuboid<T>(
+                path, coalesced.data(), origDim, subsetMin, subsetMax); };
+        auto coldCache = [&]() { util::io::dropFromPageCache(path); };
+        auto warmCache = [&]() {};
+
+        std::cout << "subset (" <<
+            subsetMin[0] << ", " << subsetMin[1] << ", " << subsetMin[2] <<
+            ") - (" <<
+            subsetMax[0] << ", " << subsetMax[1] << ", " << subsetMax[2] <<
+            ") of (" <<
+            origDim[0] << ", " << origDim[1] << ", " << origDim[2] <<
+            "), " << count * sizeof(T) / 1024 << " KiB" << std::endl;
+
+        ms = measure(loadRowwise, coldCache);
+        printResult("row-wise reads, cold cache", ms, count * sizeof(T));
+        ms = measure(loadCoalesced, coldCache);
+        printResult("coalesced reads, cold cache", ms, count * sizeof(T));
+
+        loadRowwise();
+        ms = measure(loadRowwise, warmCache);
+        printResult("row-wise reads, warm cache", ms, count * sizeof(T));
+        ms = measure(loadCoalesced, warmCache);
+        printResult("coalesced reads, warm cache", ms, count * sizeof(T));
+
+        if (0 != std::memcmp(
+                rowwise.data(), coalesced.data(), count * sizeof(T)))
+        {
+            std::cerr << "Error: subset readers returned different data!" <<
+                std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * \brief compares the row-wise and the coalesced subset reader
+     *
+     * Uses the subset of the volume description or, if it does not define
+     * one, the centered cuboid with half the extent of the volume.
+     */
+    int benchmarkSubsetLoading(const cr::VolumeConfig &volumeConfig)
+    {
+        std::array<size_t, 3> origDim = volumeConfig.getOrigVolumeDim();
+        std::array<size_t, 3> subsetMin = volumeConfig.getSubsetMin();
+        std::array<size_t, 3> subsetMax = volumeConfig.getSubsetMax();
+        std::string path = volumeConfig.getTimestepFile(0);
+
+        if (!volumeConfig.getSubset())
+        {
+            for (size_t i = 0; i < 3; ++i)
+            {
+                subsetMin[i] = origDim[i] / 4;
+                subsetMax[i] = std::max(
+                    subsetMin[i], subsetMin[i] + origDim[i] / 2 - 1);
+            }
+        }
+
+        // the readers only depend on the size of the values
+        switch(volumeConfig.getVoxelSizeOf())
+        {
+            case 1:
+                return benchmarkSubsetLoadingT<unsigned_byte_t>(
+                    path, origDim, subsetMin, subsetMax);
+
+            case 2:
+                return benchmarkSubsetLoadingT<unsigned_halfword_t>(
+                    path, origDim, subsetMin, subsetMax);
+
+            case 4:
+                return benchmarkSubsetLoadingT<unsigned_word_t>(
+                    path, origDim, subsetMin, subsetMax);
+
+            case 8:
+                return benchmarkSubsetLoadingT<unsigned_longword_t>(
+                    path, origDim, subsetMin, subsetMax);
+
+            default:
+                std::cerr << "Error: unsupported voxel size!" << std::endl;
+                return EXIT_FAILURE;
+        }
+    }
+}
+
+namespace
+{
+    constexpr size_t HISTOGRAM_BENCHMARK_BINS = 256;
+
+    /**
+     * \brief reference binning with a shared atomic counter per bin
+     *
+     * The way util::binData counted before the histogram engine, kept for
+     * comparison.
+     */
+    template<typename T>
+    std::vector<uint64_t> binDataAtomic(
+        size_t numBins, T min, T max, const T *values, size_t numValues)
+    {
+        std::vector<uint64_t> counts(numBins, 0);
+        double binSize =
+            (static_cast<double>(max) - static_cast<double>(min) + 1.0) /
+            static_cast<double>(numBins);
+
+        #pragma omp parallel for
+        for (size_t i = 0; i < numValues; ++i)
+        {
+            T val = values[i];
+            if ((min <= val) && (val <= max))
+            {
+                size_t idx = std::min(
+                    static_cast<size_t>(std::round(
+                        (static_cast<double>(val) - static_cast<double>(min)) /
+                        binSize)),
+                    numBins - 1);
+                #pragma omp atomic
+                ++counts[idx];
+            }
+        }
+
+        return counts;
+    }
+
+    template<typename T>
+    int benchmarkHistogramT(const cr::VolumeDataBase &volumeData)
+    {
+        const T *values = reinterpret_cast<const T*>(volumeData.getRawData());
+        const size_t count = volumeData.getVolumeConfig().getVoxelCount();
+        const int maxThreads = omp_get_max_threads();
+        std::tuple<float, float> limits = cr::getLimitsVolumeData(volumeData);
+        T min = static_cast<T>(std::get<0>(limits));
+        T max = static_cast<T>(std::get<1>(limits));
+        std::vector<uint64_t> reference;
+        util::Histogram histogram;
+        double ms = 0.0;
+
+        auto binAtomic = [&]() {
+            reference = binDataAtomic<T>(
+                HISTOGRAM_BENCHMARK_BINS, min, max, values, count); };
+        auto binPrivate = [&]() {
+            histogram = util::binData<T>(
+                HISTOGRAM_BENCHMARK_BINS, min, max, values, count); };
+        auto nothing = [&]() {};
+
+        std::cout << "histogram with " << HISTOGRAM_BENCHMARK_BINS <<
+            " bins of " << count << " values, " <<
+            count * sizeof(T) / 1024 << " KiB" << std::endl;
+
+        // thread counts 1, 2, 4, ... up to the number of available threads
+        for (int threads = 1; threads <= maxThreads;
+                threads = (threads == maxThreads) ?
+                    maxThreads + 1 : std::min(2 * threads, maxThreads))
+        {
+            omp_set_num_threads(threads);
+
+            ms = measure(binAtomic, nothing);
+            printResult("atomic counters, " + std::to_string(threads) +
+                " threads", ms, count * sizeof(T));
+            ms = measure(binPrivate, nothing);
+            printResult("private counters, " + std::to_string(threads) +
+                " threads", ms, count * sizeof(T));
+
+            if (reference != histogram.counts)
+            {
+                std::cerr << "Error: histograms differ!" << std::endl;
+                omp_set_num_threads(maxThreads);
+                return EXIT_FAILURE;
+            }
+        }
+        omp_set_num_threads(maxThreads);
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * \brief compares atomic and privatised binning from 1 to N threads
+     *
+     * Bins the first timestep over its value range.
+     */
+    int benchmarkHistogram(const cr::VolumeConfig &volumeConfig)
+    {
+        std::unique_ptr<cr::VolumeDataBase> volumeData =
+            cr::loadScalarVolumeTimestep(volumeConfig, 0, false);
+
+        if (!volumeData || (nullptr == volumeData->getRawData()))
+        {
+            std::cerr << "Error: the histogram benchmark needs the volume " <<
+                "in memory." << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        switch(volumeConfig.getVoxelType())
+        {
+            case cr::Datatype::unsigned_byte:
+                return benchmarkHistogramT<unsigned_byte_t>(*volumeData);
+
+            case cr::Datatype::signed_byte:
+                return benchmarkHistogramT<signed_byte_t>(*volumeData);
+
+            case cr::Datatype::unsigned_halfword:
+                return benchmarkHistogramT<unsigned_halfword_t>(*volumeData);
+
+            case cr::Datatype::signed_halfword:
+                return benchmarkHistogramT<signed_halfword_t>(*volumeData);
+
+            case cr::Datatype::unsigned_word:
+                return benchmarkHistogramT<unsigned_word_t>(*volumeData);
+
+            case cr::Datatype::signed_word:
+                return benchmarkHistogramT<signed_word_t>(*volumeData);
+
+            case cr::Datatype::unsigned_longword:
+                return benchmarkHistogramT<unsigned_longword_t>(*volumeData);
+
+            case cr::Datatype::signed_longword:
+                return benchmarkHistogramT<signed_longword_t>(*volumeData);
+
+            case cr::Datatype::single_precision_float:
+                return benchmarkHistogramT<single_precision_float_t>(
+                    *volumeData);
+
+            case cr::Datatype::double_precision_float:
+                return benchmarkHistogramT<double_precision_float_t>(
+                    *volumeData);
+
+            default:
+                std::cerr << "Error: unsupported voxel type!" << std::endl;
+                return EXIT_FAILURE;
+        }
+    }
+}
+
+namespace
+{
+    template<typename T>
+    void swapEach(std::vector<uint8_t> &bytes)
+    {
+        T *values = reinterpret_cast<T*>(bytes.data());
+
+        for (size_t i = 0; i < bytes.size() / sizeof(T); ++i)
+            values[i] = cr::swapByteOrder(values[i]);
+    }
+
+    /**
+     * \brief compares swapping single values with the vectorised kernel
+     *
+     * Swaps the bytes of the first timestep file as 2, 4 and 8 byte values.
+     */
+    int benchmarkByteSwap(const cr::VolumeConfig &volumeConfig)
+    {
+        std::string path = volumeConfig.getTimestepFile(0);
+        size_t size = util::io::getFileSize(path) & ~size_t(7);
+        std::vector<uint8_t> bytes(size), reference(size);
+        util::io::File file(path);
+        double ms = 0.0;
+
+        if (!file.isValid() || !file.readAt(bytes.data(), size, 0))
+        {
+            std::cerr << "Error: cannot read " << path << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::cout << "byte swapping of " << size / 1024 << " KiB, " <<
+            util::byteorder::getImplementation() << " kernel" << std::endl;
+
+        for (size_t valueSize : {2, 4, 8})
+        {
+            auto scalar = [&]() {
+                switch(valueSize)
+                {
+                    case 2: swapEach<uint16_t>(reference); break;
+                    case 4: swapEach<uint32_t>(reference); break;
+                    default: swapEach<uint64_t>(reference); break;
+                }
+            };
+            auto vectorised = [&]() {
+                util::byteorder::swap(
+                    bytes.data(), size / valueSize, valueSize); };
+            auto nothing = [&]() {};
+
+            // an odd number of runs leaves both buffers swapped once
+            reference = bytes;
+            ms = measure(scalar, nothing);
+            printResult("swapByteOrder, " + std::to_string(valueSize) +
+                " byte values", ms, size);
+            ms = measure(vectorised, nothing);
+            printResult("byteorder::swap, " + std::to_string(valueSize) +
+                " byte values", ms, size);
+
+            if (reference != bytes)
+            {
+                std::cerr << "Error: swapped data differs!" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        return EXIT_SUCCESS;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// benchmark selection
+//-----------------------------------------------------------------------------
+/**
+ * \brief runs the benchmark with the given name on a volume dataset
+ *
+ * \param name name of the benchmark
+ * \param volumeFile path to the volume description file
+ * \return EXIT_SUCCESS or EXIT_FAILURE
+ *
+ * Available benchmarks:
+ *  - subset: row-wise vs. coalesced subset reader on cold and warm caches
+ *  - histogram: atomic vs. privatised binning from 1 to N threads
+ *  - bswap: scalar vs. vectorised byte swapping
+ */
+int bench::runBenchmark(const std::string &name, const std::string &volumeFile)
+{
+    cr::VolumeConfig volumeConfig(volumeFile);
+
+    if (!volumeConfig.isValid())
+    {
+        std::cerr << "Error: invalid volume description file " <<
+            volumeFile << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if ("subset" == name)
+        return benchmarkSubsetLoading(volumeConfig);
+    if ("histogram" == name)
+        return benchmarkHistogram(volumeConfig);
+    if ("bswap" == name)
+        return benchmarkByteSwap(volumeConfig);
+
+    std::cerr << "Error: unknown benchmark " << name << std::endl;
+    return EXIT_FAILURE;
+}
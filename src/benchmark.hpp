@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+namespace bench
+{
+    // ------------------------------------------------------------------------
+    // function declarations
+    // ------------------------------------------------------------------------
+    int runBenchmark(const std::string &name, const std::string &volumeFile);
+}
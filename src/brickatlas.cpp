@@ -0,0 +1,342 @@
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+#include "brickatlas.hpp"
+#include "paged.hpp"
+
+//-----------------------------------------------------------------------------
+// internal helpers
+//-----------------------------------------------------------------------------
+namespace
+{
+    /**
+     * \brief number of bricks that are converted at once before they are
+     *        uploaded into the atlas
+     */
+    constexpr size_t ATLAS_UPLOAD_BATCH = 64;
+}
+
+//-----------------------------------------------------------------------------
+// BrickAtlas Class Implementations
+//-----------------------------------------------------------------------------
+cr::BrickAtlas::BrickAtlas() :
+    m_format(TextureFormat::native),
+    m_valueScale(1.f),
+    m_valueOffset(0.f),
+    m_texelSize(1),
+    m_brickSize(DEFAULT_ATLAS_BRICK_SIZE),
+    m_volumeDim{ {0, 0, 0} },
+    m_brickCount{ {0, 0, 0} },
+    m_slotCount{ {0, 0, 0} },
+    m_numResident(0),
+    m_atlasTex(),
+    m_pageTableTex()
+{
+}
+
+cr::BrickAtlas cr::BrickAtlas::create(
+    const VolumeDataBase &volumeData,
+    TextureFormat format,
+    std::tuple<float, float> window,
+    size_t brickSize)
+{
+    BrickAtlas atlas;
+    Datatype type = volumeData.getVolumeConfig().getVoxelType();
+    GLenum internalFormat = GL_R8;
+    GLenum glType = GL_UNSIGNED_BYTE;
+    GLint maxTextureSize = 0;
+    std::vector<uint8_t> resident;
+
+    atlas.m_format = getEffectiveTextureFormat(format, type);
+    if (!getGlTextureFormat(atlas.m_format, type, internalFormat, glType))
+    {
+        std::cerr << "Error: unsupported volume datatype." << std::endl;
+        return atlas;
+    }
+
+    if (TextureFormat::native == atlas.m_format)
+    {
+        atlas.m_valueScale = getNativeValueScale(type);
+        atlas.m_valueOffset = 0.f;
+    }
+    else
+    {
+        atlas.m_valueScale = std::get<1>(window) - std::get<0>(window);
+        atlas.m_valueOffset = std::get<0>(window);
+    }
+    atlas.m_texelSize = getTexelSize(atlas.m_format, type);
+    atlas.m_brickSize = std::max(brickSize, size_t(2));
+
+    if (!atlas.findBricks(volumeData, window, resident))
+        return atlas;
+
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxTextureSize);
+    atlas.upload(
+        volumeData, window, resident, internalFormat, glType, maxTextureSize);
+
+    return atlas;
+}
+
+size_t cr::BrickAtlas::getMemorySize() const
+{
+    size_t brickVoxels = m_brickSize * m_brickSize * m_brickSize;
+
+    return m_slotCount[0] * m_slotCount[1] * m_slotCount[2] * brickVoxels *
+        m_texelSize + getNumBricks() * 4 * sizeof(uint16_t);
+}
+
+/**
+ * Brick (i, j, k) starts at voxel (i, j, k) * (brickSize - 1). Voxels beyond
+ * the volume are clamped to its border like GL_CLAMP_TO_EDGE would do. Paged
+ * data is read region by region through the brick cache.
+ */
+bool cr::BrickAtlas::convertBrick(
+    const VolumeDataBase &volumeData,
+    std::tuple<float, float> window,
+    size_t id,
+    std::vector<uint8_t> &texels) const
+{
+    Datatype type = volumeData.getVolumeConfig().getVoxelType();
+    const uint8_t *src = static_cast<const uint8_t*>(volumeData.getRawData());
+    size_t voxelSize = datatypeSize(type);
+    size_t inner = m_brickSize - 1;
+    size_t brickVoxels = m_brickSize * m_brickSize * m_brickSize;
+    std::array<size_t, 3> origin, extent, srcDim, srcOrigin;
+    std::vector<uint8_t> region, raw(brickVoxels * voxelSize);
+
+    origin[0] = (id % m_brickCount[0]) * inner;
+    origin[1] = ((id / m_brickCount[0]) % m_brickCount[1]) * inner;
+    origin[2] = (id / (m_brickCount[0] * m_brickCount[1])) * inner;
+    for (size_t i = 0; i < 3; ++i)
+        extent[i] = std::min(m_brickSize, m_volumeDim[i] - origin[i]);
+
+    srcDim = m_volumeDim;
+    srcOrigin = origin;
+    if (volumeData.isPaged())
+    {
+        region.resize(extent[0] * extent[1] * extent[2] * voxelSize);
+        if (!static_cast<const PagedVolumeData&>(volumeData).readRegion(
+                origin,
+                {{origin[0] + extent[0] - 1,
+                    origin[1] + extent[1] - 1,
+                    origin[2] + extent[2] - 1}},
+                region.data()))
+            return false;
+        src = region.data();
+        srcDim = extent;
+        srcOrigin = {{0, 0, 0}};
+    }
+
+    for (size_t z = 0; z < m_brickSize; ++z)
+    for (size_t y = 0; y < m_brickSize; ++y)
+    {
+        size_t sy = srcOrigin[1] + std::min(y, extent[1] - 1);
+        size_t sz = srcOrigin[2] + std::min(z, extent[2] - 1);
+        const uint8_t *row = src +
+            (srcOrigin[0] + (sy + sz * srcDim[1]) * srcDim[0]) * voxelSize;
+        uint8_t *dst = raw.data() +
+            (y + z * m_brickSize) * m_brickSize * voxelSize;
+
+        std::memcpy(dst, row, extent[0] * voxelSize);
+        for (size_t x = extent[0]; x < m_brickSize; ++x)
+            std::memcpy(dst + x * voxelSize,
+                row + (extent[0] - 1) * voxelSize, voxelSize);
+    }
+
+    if (TextureFormat::native == m_format)
+        texels.swap(raw);
+    else
+    {
+        texels.resize(brickVoxels * m_texelSize);
+        quantizeValues(
+            raw.data(), type, brickVoxels, m_format, window, texels.data());
+    }
+
+    if (std::none_of(texels.begin(), texels.end(),
+            [](uint8_t b) { return 0 != b; }))
+        texels.clear();
+
+    return true;
+}
+
+/**
+ * The bricks are converted once to count the non-empty ones, so that the
+ * atlas can be allocated before the first brick is uploaded; only a single
+ * brick per thread is held in memory. Paged data is converted in order since
+ * the reads go to the same file.
+ */
+bool cr::BrickAtlas::findBricks(
+    const VolumeDataBase &volumeData,
+    std::tuple<float, float> window,
+    std::vector<uint8_t> &resident)
+{
+    bool paged = volumeData.isPaged();
+    bool success = true;
+    size_t inner = m_brickSize - 1;
+
+    if (!paged && (nullptr == volumeData.getRawData()))
+        return false;
+
+    m_volumeDim = volumeData.getVolumeConfig().getVolumeDim();
+    for (size_t i = 0; i < 3; ++i)
+        m_brickCount[i] = (std::max(m_volumeDim[i], size_t(1)) - 1) / inner + 1;
+    resident.assign(getNumBricks(), 0);
+
+    #pragma omp parallel for schedule(dynamic) if(!paged)
+    for (size_t id = 0; id < resident.size(); ++id)
+    {
+        std::vector<uint8_t> texels;
+
+        if (!convertBrick(volumeData, window, id, texels))
+        {
+            success = false;
+            continue;
+        }
+        resident[id] = texels.empty() ? 0 : 1;
+    }
+
+    if (!success)
+        std::cerr << "Error: could not read the bricks of the volume." <<
+            std::endl;
+
+    return success;
+}
+
+/**
+ * The slots are arranged in a grid that is about as wide as deep and high,
+ * so that no axis of the atlas runs into the texture size limit early.
+ * The non-empty bricks are converted again in batches of
+ * ATLAS_UPLOAD_BATCH and each batch is uploaded before the next one is
+ * converted, which bounds the memory for the texels independent of the
+ * volume size.
+ */
+bool cr::BrickAtlas::upload(
+    const VolumeDataBase &volumeData,
+    std::tuple<float, float> window,
+    const std::vector<uint8_t> &resident,
+    GLenum internalFormat,
+    GLenum glType,
+    GLint maxTextureSize)
+{
+    size_t maxSlots = std::max(
+        static_cast<size_t>(std::max(maxTextureSize, 0)) / m_brickSize,
+        size_t(1));
+    bool paged = volumeData.isPaged();
+    bool success = true;
+    std::vector<size_t> ids;
+    std::vector<std::vector<uint8_t>> batch(ATLAS_UPLOAD_BATCH);
+    std::vector<uint16_t> pages(resident.size() * 4, 0);
+
+    for (size_t id = 0; id < resident.size(); ++id)
+        if (0 != resident[id])
+            ids.push_back(id);
+    m_numResident = ids.size();
+
+    // at least one slot, so that an empty volume has a valid atlas
+    size_t n = std::max(m_numResident, size_t(1));
+    m_slotCount = {{1, 1, 1}};
+    while ((m_slotCount[0] * m_slotCount[0] * m_slotCount[0] < n) &&
+            (m_slotCount[0] < maxSlots))
+        ++m_slotCount[0];
+    while ((m_slotCount[0] * m_slotCount[1] * m_slotCount[1] < n) &&
+            (m_slotCount[1] < maxSlots))
+        ++m_slotCount[1];
+    m_slotCount[2] = (n + m_slotCount[0] * m_slotCount[1] - 1) /
+        (m_slotCount[0] * m_slotCount[1]);
+    if (m_slotCount[2] > maxSlots)
+    {
+        std::cerr << "Error: " << m_numResident << " non-empty bricks " <<
+            "exceed the 3D texture size limit of " << maxTextureSize <<
+            "." << std::endl;
+        m_slotCount = {{0, 0, 0}};
+        return false;
+    }
+
+    // allocation failures are only reported through the error state
+    while (GL_NO_ERROR != glGetError()) {}
+    m_atlasTex = util::texture::Texture3D(
+        internalFormat,
+        GL_RED,
+        0,
+        glType,
+        GL_LINEAR,
+        GL_CLAMP_TO_EDGE,
+        m_slotCount[0] * m_brickSize,
+        m_slotCount[1] * m_brickSize,
+        m_slotCount[2] * m_brickSize);
+    if (GL_OUT_OF_MEMORY == glGetError())
+    {
+        std::cerr << "Error: out of GPU memory for the brick atlas (" <<
+            (getMemorySize() >> 20) << " MiB)." << std::endl;
+        m_atlasTex = util::texture::Texture3D();
+        return false;
+    }
+
+    m_atlasTex.bind();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t first = 0; first < ids.size(); first += batch.size())
+    {
+        size_t count = std::min(batch.size(), ids.size() - first);
+
+        #pragma omp parallel for schedule(dynamic) if(!paged)
+        for (size_t i = 0; i < count; ++i)
+            if (!convertBrick(volumeData, window, ids[first + i], batch[i]))
+                success = false;
+
+        if (!success)
+            break;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t slot = first + i;
+            std::array<size_t, 3> s = {{
+                slot % m_slotCount[0],
+                (slot / m_slotCount[0]) % m_slotCount[1],
+                slot / (m_slotCount[0] * m_slotCount[1])}};
+
+            // a brick that turned out empty keeps its slot, which is zeroed
+            batch[i].resize(
+                m_brickSize * m_brickSize * m_brickSize * m_texelSize, 0);
+            glTexSubImage3D(
+                GL_TEXTURE_3D,
+                0,
+                s[0] * m_brickSize,
+                s[1] * m_brickSize,
+                s[2] * m_brickSize,
+                m_brickSize,
+                m_brickSize,
+                m_brickSize,
+                GL_RED,
+                glType,
+                batch[i].data());
+
+            for (size_t j = 0; j < 3; ++j)
+                pages[4 * ids[slot] + j] = static_cast<uint16_t>(s[j]);
+            pages[4 * ids[slot] + 3] = 1;
+        }
+    }
+    m_atlasTex.unbind();
+
+    if (!success)
+    {
+        std::cerr << "Error: could not read the bricks of the volume." <<
+            std::endl;
+        m_atlasTex = util::texture::Texture3D();
+        return false;
+    }
+
+    m_pageTableTex = util::texture::Texture3D(
+        GL_RGBA16UI,
+        GL_RGBA_INTEGER,
+        0,
+        GL_UNSIGNED_SHORT,
+        GL_NEAREST,
+        GL_CLAMP_TO_EDGE,
+        m_brickCount[0],
+        m_brickCount[1],
+        m_brickCount[2],
+        pages.data());
+
+    return true;
+}
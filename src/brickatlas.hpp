@@ -0,0 +1,133 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <tuple>
+#include <cstdint>
+
+#include "configraw.hpp"
+#include "quantize.hpp"
+
+namespace cr
+{
+    // ------------------------------------------------------------------------
+    // constants
+    // ------------------------------------------------------------------------
+    constexpr size_t DEFAULT_ATLAS_BRICK_SIZE = 32;
+
+    // ------------------------------------------------------------------------
+    // class declarations
+    // ------------------------------------------------------------------------
+    /**
+     * \brief volume texture that only stores the non-empty bricks of a volume
+     *
+     * The volume is split into bricks of brickSize - 1 voxels per axis. Each
+     * brick additionally stores the first voxel of its upper neighbours, so
+     * that linear interpolation inside a brick never needs another brick.
+     * The bricks are packed into the slots of an atlas texture, which only
+     * has to hold the bricks that contain a texel other than 0 and is limited
+     * by GL_MAX_3D_TEXTURE_SIZE per axis instead of the whole volume.
+     *
+     * The page table has one RGBA16UI texel per brick: the atlas slot of the
+     * brick in rgb and 1 in a, or 0 in a for empty bricks, which sample as 0.
+     * Since empty bricks only contain texels 0 the atlas is lossless.
+     */
+    class BrickAtlas
+    {
+        public:
+        BrickAtlas();
+
+        /**
+         * \brief converts the volume data and uploads the non-empty bricks
+         *
+         * \param volumeData volume dataset representative class object,
+         *        paged data is read brick by brick
+         * \param format format of the texels (see createVolumeTex)
+         * \param window values that are mapped to 0 and 1 by the conversion
+         * \param brickSize edge length of the bricks in the atlas
+         *
+         * \return an invalid atlas if the data could not be read or the
+         *         non-empty bricks do not fit into a 3D texture
+         */
+        static BrickAtlas create(
+            const VolumeDataBase &volumeData,
+            TextureFormat format,
+            std::tuple<float, float> window,
+            size_t brickSize = DEFAULT_ATLAS_BRICK_SIZE);
+
+        bool isValid() const { return 0 != m_atlasTex.getID(); }
+        const util::texture::Texture3D& getAtlasTexture() const
+        {
+            return m_atlasTex;
+        }
+        const util::texture::Texture3D& getPageTable() const
+        {
+            return m_pageTableTex;
+        }
+
+        TextureFormat getFormat() const { return m_format; }
+        float getValueScale() const { return m_valueScale; }
+        float getValueOffset() const { return m_valueOffset; }
+        size_t getBrickSize() const { return m_brickSize; }
+        std::array<size_t, 3> getVolumeDim() const { return m_volumeDim; }
+        std::array<size_t, 3> getBrickCount() const { return m_brickCount; }
+        size_t getNumBricks() const
+        {
+            return m_brickCount[0] * m_brickCount[1] * m_brickCount[2];
+        }
+        size_t getNumResidentBricks() const { return m_numResident; }
+
+        /**
+         * \brief memory of the atlas and the page table on the GPU in byte
+         */
+        size_t getMemorySize() const;
+
+        private:
+        /**
+         * \brief converts a brick into texels
+         *
+         * \param texels receives the texels of the brick, empty if the brick
+         *        has no texel other than 0
+         * \return false if the brick could not be read
+         */
+        bool convertBrick(
+            const VolumeDataBase &volumeData,
+            std::tuple<float, float> window,
+            size_t id,
+            std::vector<uint8_t> &texels) const;
+
+        /**
+         * \brief finds the bricks with texels other than 0
+         *
+         * \param resident receives 1 for each non-empty brick, 0 otherwise
+         */
+        bool findBricks(
+            const VolumeDataBase &volumeData,
+            std::tuple<float, float> window,
+            std::vector<uint8_t> &resident);
+
+        /**
+         * \brief packs the non-empty bricks into the atlas and creates the
+         *        page table
+         */
+        bool upload(
+            const VolumeDataBase &volumeData,
+            std::tuple<float, float> window,
+            const std::vector<uint8_t> &resident,
+            GLenum internalFormat,
+            GLenum glType,
+            GLint maxTextureSize);
+
+        TextureFormat m_format;
+        float m_valueScale;
+        float m_valueOffset;
+        size_t m_texelSize;
+        size_t m_brickSize;
+        std::array<size_t, 3> m_volumeDim;
+        std::array<size_t, 3> m_brickCount;
+        std::array<size_t, 3> m_slotCount;      //!< brick slots of the atlas
+        size_t m_numResident;
+        util::texture::Texture3D m_atlasTex;
+        util::texture::Texture3D m_pageTableTex;
+    };
+}
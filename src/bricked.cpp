@@ -0,0 +1,498 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <array>
+#include <tuple>
+#include <limits>
+#include <algorithm>
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+namespace bfs = boost::filesystem;
+
+#include <json.hpp>
+using json = nlohmann::json;
+
+#include "bricked.hpp"
+
+//-----------------------------------------------------------------------------
+// internal helpers
+//-----------------------------------------------------------------------------
+namespace
+{
+    // magic, version, datatype, 3 dimensions, brick size, padding, count
+    constexpr size_t HEADER_SIZE = 8 + 4 + 4 + 3 * 8 + 4 + 4 + 8;
+    // offset, min, max, mean
+    constexpr size_t BRICK_INFO_SIZE = 8 + 3 * 8;
+
+    template<typename V>
+    void writeValue(std::ofstream &fs, V value)
+    {
+        fs.write(reinterpret_cast<const char*>(&value), sizeof(V));
+    }
+
+    template<typename V>
+    bool readValue(std::ifstream &fs, V &value)
+    {
+        fs.read(reinterpret_cast<char*>(&value), sizeof(V));
+        return fs.good();
+    }
+
+    template<typename T>
+    int writeBrickedVolumeT(
+        const T *volume,
+        cr::Datatype type,
+        std::array<size_t, 3> volumeDim,
+        const std::string &path,
+        unsigned int brickSize)
+    {
+        std::ofstream fs(path.c_str(), std::ios::out | std::ios::binary);
+        std::array<size_t, 3> brickCount;
+        std::vector<cr::BrickInfo> bricks;
+        std::vector<T> brick(brickSize * brickSize * brickSize);
+        uint64_t offset = 0;
+
+        if (!fs.is_open())
+        {
+            std::cerr << "Error while writing bricked data: cannot open " <<
+                path << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        for (size_t i = 0; i < 3; ++i)
+            brickCount[i] = (volumeDim[i] + brickSize - 1) / brickSize;
+        bricks.resize(brickCount[0] * brickCount[1] * brickCount[2]);
+
+        // header, the brick index is written after the bricks are known
+        fs.write(cr::BRICKED_MAGIC, sizeof(cr::BRICKED_MAGIC));
+        writeValue<uint32_t>(fs, cr::BRICKED_VERSION);
+        writeValue<uint32_t>(fs, static_cast<uint32_t>(type));
+        for (size_t i = 0; i < 3; ++i)
+            writeValue<uint64_t>(fs, volumeDim[i]);
+        writeValue<uint32_t>(fs, brickSize);
+        writeValue<uint32_t>(fs, 0);
+        writeValue<uint64_t>(fs, bricks.size());
+
+        offset = HEADER_SIZE + bricks.size() * BRICK_INFO_SIZE;
+        fs.seekp(offset);
+
+        size_t id = 0;
+        for (size_t bz = 0; bz < brickCount[2]; ++bz)
+        for (size_t by = 0; by < brickCount[1]; ++by)
+        for (size_t bx = 0; bx < brickCount[0]; ++bx, ++id)
+        {
+            std::array<size_t, 3> origin = {
+                bx * brickSize, by * brickSize, bz * brickSize};
+            std::array<size_t, 3> extent;
+            double min = std::numeric_limits<double>::max();
+            double max = std::numeric_limits<double>::lowest();
+            double sum = 0.0;
+            size_t count = 0;
+
+            for (size_t i = 0; i < 3; ++i)
+                extent[i] = std::min(
+                    static_cast<size_t>(brickSize), volumeDim[i] - origin[i]);
+
+            for (size_t z = 0; z < extent[2]; ++z)
+            for (size_t y = 0; y < extent[1]; ++y)
+            for (size_t x = 0; x < extent[0]; ++x)
+            {
+                T value = volume[
+                    (origin[0] + x) +
+                    (origin[1] + y) * volumeDim[0] +
+                    (origin[2] + z) * volumeDim[0] * volumeDim[1]];
+
+                brick[count++] = value;
+                min = std::min(min, static_cast<double>(value));
+                max = std::max(max, static_cast<double>(value));
+                sum += static_cast<double>(value);
+            }
+
+            bricks[id].offset = offset;
+            bricks[id].min = min;
+            bricks[id].max = max;
+            bricks[id].mean = sum / static_cast<double>(count);
+
+            fs.write(
+                reinterpret_cast<const char*>(brick.data()),
+                count * sizeof(T));
+            offset += count * sizeof(T);
+        }
+
+        fs.seekp(HEADER_SIZE);
+        for (const cr::BrickInfo &info : bricks)
+        {
+            writeValue<uint64_t>(fs, info.offset);
+            writeValue<double>(fs, info.min);
+            writeValue<double>(fs, info.max);
+            writeValue<double>(fs, info.mean);
+        }
+
+        if (!fs.good())
+        {
+            std::cerr << "Error while writing bricked data to " << path <<
+                std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// BrickIndex Class Implementations
+//-----------------------------------------------------------------------------
+cr::BrickIndex::BrickIndex() :
+    m_voxelType(Datatype::none),
+    m_volumeDim{ {0, 0, 0} },
+    m_brickSize(0),
+    m_brickCount{ {0, 0, 0} },
+    m_bricks(),
+    m_valid(false)
+{
+}
+
+/**
+ * \brief reads header and brick index of a bricked volume file
+ *
+ * Note: check isValid() if the file could be read
+ */
+cr::BrickIndex::BrickIndex(const std::string &path) :
+    BrickIndex()
+{
+    std::ifstream fs(path.c_str(), std::ios::in | std::ios::binary);
+    char magic[sizeof(BRICKED_MAGIC)] = {};
+    uint32_t version = 0, type = 0, brickSize = 0, padding = 0;
+    uint64_t dim = 0, numBricks = 0;
+
+    if (!fs.is_open())
+    {
+        std::cerr << "Error while reading brick index: cannot open " <<
+            path << std::endl;
+        return;
+    }
+
+    fs.read(magic, sizeof(magic));
+    if (!fs.good() ||
+            (0 != std::memcmp(magic, BRICKED_MAGIC, sizeof(BRICKED_MAGIC))))
+    {
+        std::cerr << "Error while reading brick index: " << path <<
+            " is no bricked volume file" << std::endl;
+        return;
+    }
+
+    readValue(fs, version);
+    readValue(fs, type);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        readValue(fs, dim);
+        m_volumeDim[i] = static_cast<size_t>(dim);
+    }
+    readValue(fs, brickSize);
+    readValue(fs, padding);
+    readValue(fs, numBricks);
+
+    if (!fs.good() || (BRICKED_VERSION != version) || (0 == brickSize))
+    {
+        std::cerr << "Error while reading brick index: unsupported header " <<
+            "in " << path << std::endl;
+        return;
+    }
+
+    m_voxelType = static_cast<Datatype>(type);
+    m_brickSize = brickSize;
+    for (size_t i = 0; i < 3; ++i)
+        m_brickCount[i] = (m_volumeDim[i] + m_brickSize - 1) / m_brickSize;
+
+    if (numBricks != m_brickCount[0] * m_brickCount[1] * m_brickCount[2])
+    {
+        std::cerr << "Error while reading brick index: inconsistent " <<
+            "number of bricks in " << path << std::endl;
+        return;
+    }
+
+    m_bricks.resize(numBricks);
+    for (BrickInfo &info : m_bricks)
+    {
+        readValue(fs, info.offset);
+        readValue(fs, info.min);
+        readValue(fs, info.max);
+        readValue(fs, info.mean);
+    }
+
+    if (!fs.good())
+    {
+        std::cerr << "Error while reading brick index: unexpected end of " <<
+            path << std::endl;
+        m_bricks.clear();
+        return;
+    }
+
+    m_valid = true;
+}
+
+std::array<size_t, 3> cr::BrickIndex::getBrickOrigin(size_t id) const
+{
+    return {{
+        (id % m_brickCount[0]) * m_brickSize,
+        ((id / m_brickCount[0]) % m_brickCount[1]) * m_brickSize,
+        (id / (m_brickCount[0] * m_brickCount[1])) * m_brickSize}};
+}
+
+std::array<size_t, 3> cr::BrickIndex::getBrickExtent(size_t id) const
+{
+    std::array<size_t, 3> origin = getBrickOrigin(id);
+
+    return {{
+        std::min(m_brickSize, m_volumeDim[0] - origin[0]),
+        std::min(m_brickSize, m_volumeDim[1] - origin[1]),
+        std::min(m_brickSize, m_volumeDim[2] - origin[2])}};
+}
+
+/**
+ * \brief limits of the whole volume derived from the brick ranges
+ *
+ * Like getLimitsVolumeData the interval always contains [0, 1].
+ */
+std::tuple<float, float> cr::BrickIndex::getLimits() const
+{
+    double min = 0.0, max = 1.0;
+
+    for (const BrickInfo &info : m_bricks)
+    {
+        min = std::min(min, info.min);
+        max = std::max(max, info.max);
+    }
+
+    return std::tuple<float, float>(
+        static_cast<float>(min), static_cast<float>(max));
+}
+
+//-----------------------------------------------------------------------------
+// convenience functions
+//-----------------------------------------------------------------------------
+/**
+ * \brief writes volume data into a bricked volume file
+ *
+ * \param volumeData volume dataset representative class object
+ * \param path path of the created file
+ * \param brickSize edge length of the bricks in voxels
+ *
+ * \return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int cr::writeBrickedVolume(
+    const VolumeDataBase &volumeData,
+    const std::string &path,
+    unsigned int brickSize)
+{
+    const VolumeConfig &volumeConfig = volumeData.getVolumeConfig();
+    void *values = volumeData.getRawData();
+    Datatype type = volumeConfig.getVoxelType();
+    std::array<size_t, 3> dim = volumeConfig.getVolumeDim();
+
+    if ((nullptr == values) || (0 == brickSize))
+        return EXIT_FAILURE;
+
+    switch(type)
+    {
+        case Datatype::unsigned_byte:
+            return writeBrickedVolumeT(
+                static_cast<unsigned_byte_t*>(values), type, dim, path,
+                brickSize);
+
+        case Datatype::signed_byte:
+            return writeBrickedVolumeT(
+                static_cast<signed_byte_t*>(values), type, dim, path,
+                brickSize);
+
+        case Datatype::unsigned_halfword:
+            return writeBrickedVolumeT(
+                static_cast<unsigned_halfword_t*>(values), type, dim, path,
+                brickSize);
+
+        case Datatype::signed_halfword:
+            return writeBrickedVolumeT(
+                static_cast<signed_halfword_t*>(values), type, dim, path,
+                brickSize);
+
+        case Datatype::unsigned_word:
+            return writeBrickedVolumeT(
+                static_cast<unsigned_word_t*>(values), type, dim, path,
+                brickSize);
+
+        case Datatype::signed_word:
+            return writeBrickedVolumeT(
+                static_cast<signed_word_t*>(values), type, dim, path,
+                brickSize);
+
+        case Datatype::unsigned_longword:
+            return writeBrickedVolumeT(
+                static_cast<unsigned_longword_t*>(values), type, dim, path,
+                brickSize);
+
+        case Datatype::signed_longword:
+            return writeBrickedVolumeT(
+                static_cast<signed_longword_t*>(values), type, dim, path,
+                brickSize);
+
+        case Datatype::single_precision_float:
+            return writeBrickedVolumeT(
+                static_cast<single_precision_float_t*>(values), type, dim,
+                path, brickSize);
+
+        case Datatype::double_precision_float:
+            return writeBrickedVolumeT(
+                static_cast<double_precision_float_t*>(values), type, dim,
+                path, brickSize);
+
+        default:
+            break;
+    }
+
+    return EXIT_FAILURE;
+}
+
+/**
+ * \brief converts all timesteps of a volume dataset into bricked files
+ *
+ * \param volumeFile path to the volume description file
+ * \param outputDir directory for the bricked files
+ * \param brickSize edge length of the bricks in voxels
+ *
+ * \return EXIT_SUCCESS or EXIT_FAILURE
+ *
+ * Each timestep is written as <raw file name>.brk. A volume description
+ * file <name>_bricked.json for the converted dataset is placed next to them.
+ * If the description selects a subset, only the subset is converted.
+ */
+int cr::convertToBricked(
+    const std::string &volumeFile,
+    const std::string &outputDir,
+    unsigned int brickSize)
+{
+    VolumeConfig volumeConfig(volumeFile);
+    bfs::path outPath(outputDir);
+    json description;
+
+    if (!volumeConfig.isValid())
+        return EXIT_FAILURE;
+
+    try
+    {
+        bfs::create_directories(outPath);
+
+        for (unsigned int t = 0; t < volumeConfig.getNumTimesteps(); ++t)
+        {
+            bfs::path rawFile(volumeConfig.getTimestepFile(t));
+            bfs::path brickedFile =
+                outPath / (rawFile.filename().string() + ".brk");
+            std::unique_ptr<VolumeDataBase> volumeData =
+                loadScalarVolumeTimestep(volumeConfig, t, false);
+
+            std::cout << "Converting " << rawFile.string() << " -> " <<
+                brickedFile.string() << std::endl;
+
+            if ((nullptr == volumeData) || (EXIT_SUCCESS != writeBrickedVolume(
+                    *volumeData, brickedFile.string(), brickSize)))
+                return EXIT_FAILURE;
+        }
+
+        description["VOLUME_FILE_DIR"] = ".";
+        description["VOLUME_FILE_REGEX"] =
+            "(" + volumeConfig.getRawFileExp() + ")\\.brk";
+        description["VOLUME_DIM"] = volumeConfig.getVolumeDim();
+        description["VOLUME_DATA_TYPE"] = volumeConfig.getVoxelType();
+        description["VOXEL_SIZE"] = volumeConfig.getVoxelDim();
+        description["VOLUME_NUM_TIMESTEPS"] = volumeConfig.getNumTimesteps();
+        description["VOLUME_FORMAT"] = FileFormat::bricked;
+
+        std::ofstream ofs((outPath / (bfs::path(volumeFile).stem().string() +
+            "_bricked.json")).string());
+        ofs << std::setw(4) << description << std::endl;
+    }
+    catch(std::exception &e)
+    {
+        std::cerr << "Error while converting " << volumeFile << ": " <<
+            e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * \brief loads the n-th timestep of a bricked volume dataset
+ *
+ * \param volumeConfig configuration object of the volume dataset
+ * \param n number of the requested timestep (starting from 0)
+ * \param buffer memory for the voxels of the (subset of the) volume
+ * \param swap flag if the byte order of the data shall be swapped
+ * \param limits Out: value limits derived from the brick ranges (optional)
+ *
+ * \return true if the data could be loaded
+ */
+bool cr::loadBrickedTimestep(
+    const VolumeConfig &volumeConfig,
+    unsigned int n,
+    void *buffer,
+    bool swap,
+    std::tuple<float, float> *limits)
+{
+    std::string path = volumeConfig.getTimestepFile(n);
+    BrickIndex index(path);
+    bool success = false;
+
+    if (!index.isValid())
+        return false;
+
+    if ((index.getVolumeDim() != volumeConfig.getOrigVolumeDim()) ||
+        (index.getVoxelType() != volumeConfig.getVoxelType()))
+    {
+        std::cerr << "Error while loading bricked data: " << path <<
+            " does not match the volume description" << std::endl;
+        return false;
+    }
+
+    // copying and swapping only depend on the size of the values
+    switch(volumeConfig.getVoxelSizeOf())
+    {
+        case 1:
+            success = loadBricked3dCuboid(
+                index, path, static_cast<unsigned_byte_t*>(buffer),
+                volumeConfig.getSubsetMin(), volumeConfig.getSubsetMax(),
+                swap);
+            break;
+
+        case 2:
+            success = loadBricked3dCuboid(
+                index, path, static_cast<unsigned_halfword_t*>(buffer),
+                volumeConfig.getSubsetMin(), volumeConfig.getSubsetMax(),
+                swap);
+            break;
+
+        case 4:
+            success = loadBricked3dCuboid(
+                index, path, static_cast<unsigned_word_t*>(buffer),
+                volumeConfig.getSubsetMin(), volumeConfig.getSubsetMax(),
+                swap);
+            break;
+
+        case 8:
+            success = loadBricked3dCuboid(
+                index, path, static_cast<unsigned_longword_t*>(buffer),
+                volumeConfig.getSubsetMin(), volumeConfig.getSubsetMax(),
+                swap);
+            break;
+
+        default:
+            break;
+    }
+
+    // the brick statistics refer to the values as stored in the file
+    if (success && (nullptr != limits) && !swap)
+        *limits = index.getLimits();
+
+    return success;
+}
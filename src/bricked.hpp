@@ -0,0 +1,212 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "util/util.hpp"
+#include "configraw.hpp"
+
+namespace cr
+{
+    // ------------------------------------------------------------------------
+    // constants
+    // ------------------------------------------------------------------------
+    constexpr char BRICKED_MAGIC[8] = {'M', 'V', 'R', 'B', 'R', 'I', 'C', 'K'};
+    constexpr uint32_t BRICKED_VERSION = 1;
+    constexpr unsigned int DEFAULT_BRICK_SIZE = 32;
+
+    // ------------------------------------------------------------------------
+    // type definitions
+    // ------------------------------------------------------------------------
+    /**
+     * \brief index entry and value statistics of a single brick
+     */
+    struct BrickInfo
+    {
+        uint64_t offset;    //!< position of the brick data in the file
+        double min;         //!< lowest value inside the brick
+        double max;         //!< highest value inside the brick
+        double mean;        //!< average value of the brick
+    };
+
+    /**
+     * \brief header and brick index of a bricked volume file
+     *
+     * File layout (native byte order):
+     *  - magic "MVRBRICK", version (uint32), datatype (uint32)
+     *  - volume dimensions (3 x uint64), brick size (uint32), padding (uint32)
+     *  - number of bricks (uint64)
+     *  - one BrickInfo (offset, min, max, mean) per brick
+     *  - brick data
+     * Bricks are cubes of brick size voxels along each axis, bricks at the
+     * upper borders of the volume are cropped to the volume. The bricks and
+     * the voxels inside each brick are stored with x running fastest.
+     */
+    class BrickIndex
+    {
+        public:
+        BrickIndex();
+        BrickIndex(const std::string &path);
+
+        bool isValid() const { return m_valid; }
+
+        Datatype getVoxelType() const { return m_voxelType; }
+        std::array<size_t, 3> getVolumeDim() const { return m_volumeDim; }
+        size_t getBrickSize() const { return m_brickSize; }
+        std::array<size_t, 3> getBrickCount() const { return m_brickCount; }
+        const std::vector<BrickInfo>& getBricks() const { return m_bricks; }
+
+        size_t getBrickId(size_t bx, size_t by, size_t bz) const
+        {
+            return bx + m_brickCount[0] * (by + m_brickCount[1] * bz);
+        }
+        std::array<size_t, 3> getBrickOrigin(size_t id) const;
+        std::array<size_t, 3> getBrickExtent(size_t id) const;
+
+        std::tuple<float, float> getLimits() const;
+
+        private:
+        Datatype m_voxelType;
+        std::array<size_t, 3> m_volumeDim;
+        size_t m_brickSize;
+        std::array<size_t, 3> m_brickCount;
+        std::vector<BrickInfo> m_bricks;
+        bool m_valid;
+    };
+
+    // ------------------------------------------------------------------------
+    // function declarations
+    // ------------------------------------------------------------------------
+    int writeBrickedVolume(
+        const VolumeDataBase &volumeData,
+        const std::string &path,
+        unsigned int brickSize = DEFAULT_BRICK_SIZE);
+    int convertToBricked(
+        const std::string &volumeFile,
+        const std::string &outputDir,
+        unsigned int brickSize = DEFAULT_BRICK_SIZE);
+
+    // ------------------------------------------------------------------------
+    // templated utility functions
+    // ------------------------------------------------------------------------
+    /**
+     * \brief loads a cuboid region of a bricked volume file
+     * \param index brick index of the file
+     * \param path Destination of the file to be read
+     * \param buffer Pointer to an array where the read values are stored
+     * \param subsetMin index of the lower left voxel of the loaded cuboid
+     * \param subsetMax index of the upper right voxel of the loaded cuboid
+     * \param swap True if the byte order of the read values shall be swapped
+     * \return true if all intersected bricks could be read
+     *
+     * Only the bricks that intersect the region are read. The bricks are
+     * distributed over several threads.
+    */
+    template<typename T>
+    bool loadBricked3dCuboid(
+        const BrickIndex &index,
+        const std::string &path,
+        T *buffer,
+        std::array<size_t, 3> subsetMin,
+        std::array<size_t, 3> subsetMax,
+        bool swap = false)
+    {
+        util::io::File file(path);
+        std::array<size_t, 3> volumeDim = index.getVolumeDim();
+        std::array<size_t, 3> brickMin, brickMax;
+        std::vector<size_t> ids;
+        bool success = true;
+
+        if (!index.isValid() || !file.isValid() ||
+                (datatypeSize(index.getVoxelType()) != sizeof(T)))
+        {
+            std::cerr << "Error while loading bricked data: invalid file!\n";
+            return false;
+        }
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+            if ((subsetMax[i] < subsetMin[i]) || (subsetMax[i] >= volumeDim[i]))
+            {
+                std::cerr <<
+                    "Error while loading bricked data: invalid region!\n";
+                return false;
+            }
+            brickMin[i] = subsetMin[i] / index.getBrickSize();
+            brickMax[i] = subsetMax[i] / index.getBrickSize();
+        }
+
+        for (size_t bz = brickMin[2]; bz <= brickMax[2]; ++bz)
+        for (size_t by = brickMin[1]; by <= brickMax[1]; ++by)
+        for (size_t bx = brickMin[0]; bx <= brickMax[0]; ++bx)
+            ids.push_back(index.getBrickId(bx, by, bz));
+
+        const size_t dimX = subsetMax[0] - subsetMin[0] + 1;
+        const size_t dimY = subsetMax[1] - subsetMin[1] + 1;
+
+        #pragma omp parallel
+        {
+            std::vector<T> brick(
+                index.getBrickSize() *
+                index.getBrickSize() *
+                index.getBrickSize());
+
+            #pragma omp for schedule(dynamic) reduction(&&:success)
+            for (size_t i = 0; i < ids.size(); ++i)
+            {
+                const BrickInfo &info = index.getBricks()[ids[i]];
+                std::array<size_t, 3> origin = index.getBrickOrigin(ids[i]);
+                std::array<size_t, 3> extent = index.getBrickExtent(ids[i]);
+                std::array<size_t, 3> lo, hi;
+
+                if (!file.readAt(
+                        brick.data(),
+                        sizeof(T) * extent[0] * extent[1] * extent[2],
+                        info.offset))
+                {
+                    success = false;
+                    continue;
+                }
+
+                // swapped while the brick is still in the cache
+                if (swap)
+                    util::byteorder::swap(
+                        brick.data(),
+                        extent[0] * extent[1] * extent[2],
+                        sizeof(T));
+
+                // intersection of brick and region in volume coordinates
+                for (size_t j = 0; j < 3; ++j)
+                {
+                    lo[j] = std::max(origin[j], subsetMin[j]);
+                    hi[j] = std::min(origin[j] + extent[j] - 1, subsetMax[j]);
+                }
+
+                for (size_t z = lo[2]; z <= hi[2]; ++z)
+                for (size_t y = lo[1]; y <= hi[1]; ++y)
+                {
+                    const T *src = brick.data() +
+                        (lo[0] - origin[0]) +
+                        (y - origin[1]) * extent[0] +
+                        (z - origin[2]) * extent[0] * extent[1];
+                    T *dst = buffer +
+                        (lo[0] - subsetMin[0]) +
+                        (y - subsetMin[1]) * dimX +
+                        (z - subsetMin[2]) * dimX * dimY;
+
+                    std::copy(src, src + (hi[0] - lo[0] + 1), dst);
+                }
+            }
+        }
+
+        if (!success)
+            std::cerr << "Error while loading bricked data: "
+                "unexpected end of file!\n";
+
+        return success;
+    }
+}
@@ -0,0 +1,895 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <array>
+#include <tuple>
+#include <limits>
+#include <algorithm>
+#include <cstring>
+
+#include <zlib.h>
+
+#include <boost/filesystem.hpp>
+namespace bfs = boost::filesystem;
+
+#include <json.hpp>
+using json = nlohmann::json;
+
+#include "compressed.hpp"
+
+//-----------------------------------------------------------------------------
+// internal helpers
+//-----------------------------------------------------------------------------
+namespace
+{
+    // magic, version, datatype, 3 dimensions, slab depth, codec, count
+    constexpr size_t HEADER_SIZE = 8 + 4 + 4 + 3 * 8 + 4 + 4 + 8;
+    // offset, size
+    constexpr size_t BLOCK_INFO_SIZE = 2 * 8;
+
+    template<typename V>
+    void writeValue(std::ofstream &fs, V value)
+    {
+        fs.write(reinterpret_cast<const char*>(&value), sizeof(V));
+    }
+
+    template<typename V>
+    bool readValue(std::ifstream &fs, V &value)
+    {
+        fs.read(reinterpret_cast<char*>(&value), sizeof(V));
+        return fs.good();
+    }
+
+    /**
+     * \brief decompresses a block into count values
+     *
+     * The output is produced in chunks of RAW_CHUNK_SIZE byte. If process is
+     * set, each chunk is swapped and checked for its limits right after it
+     * was written while it is still in the cache.
+     */
+    template<typename T>
+    bool inflateBlock(
+        const uint8_t *src,
+        size_t srcSize,
+        T *dst,
+        size_t count,
+        bool process,
+        bool swap,
+        T &minimum,
+        T &maximum,
+        size_t &invalid)
+    {
+        const size_t totalBytes = count * sizeof(T);
+        size_t doneBytes = 0, processed = 0;
+        z_stream stream;
+        int ret = Z_OK;
+
+        if (srcSize > std::numeric_limits<uInt>::max())
+            return false;
+
+        std::memset(&stream, 0, sizeof(stream));
+        if (Z_OK != inflateInit(&stream))
+            return false;
+
+        stream.next_in = const_cast<Bytef*>(src);
+        stream.avail_in = static_cast<uInt>(srcSize);
+
+        while ((doneBytes < totalBytes) && (Z_OK == ret))
+        {
+            size_t length =
+                std::min(cr::RAW_CHUNK_SIZE, totalBytes - doneBytes);
+
+            stream.next_out = reinterpret_cast<Bytef*>(dst) + doneBytes;
+            stream.avail_out = static_cast<uInt>(length);
+            ret = inflate(&stream, Z_NO_FLUSH);
+            doneBytes += length - stream.avail_out;
+
+            // only complete values are processed
+            if (process)
+            {
+                size_t complete = doneBytes / sizeof(T);
+                cr::processChunk(
+                    dst + processed,
+                    complete - processed,
+                    swap,
+                    minimum,
+                    maximum,
+                    invalid);
+                processed = complete;
+            }
+        }
+
+        inflateEnd(&stream);
+
+        return (doneBytes == totalBytes) &&
+            ((Z_STREAM_END == ret) || (Z_OK == ret));
+    }
+
+    /**
+     * \brief loads a cuboid region of a compressed volume file
+     *
+     * Only the slabs that intersect the region are read and decompressed,
+     * the slabs are distributed over several threads. Slabs that are needed
+     * as a whole are decompressed directly into the buffer, all others into
+     * a temporary slab from which the rows of the region are copied. The
+     * limits of the loaded values are determined on the way.
+     */
+    template<typename T>
+    bool loadCompressed3dCuboid(
+        const cr::CompressedIndex &index,
+        const std::string &path,
+        T *buffer,
+        std::array<size_t, 3> subsetMin,
+        std::array<size_t, 3> subsetMax,
+        bool swap,
+        std::tuple<float, float> &limits)
+    {
+        util::io::File file(path);
+        std::array<size_t, 3> volumeDim = index.getVolumeDim();
+        const size_t depth = index.getSlabDepth();
+        const size_t sliceSize = volumeDim[0] * volumeDim[1];
+        T minimum = static_cast<T>(0.0);
+        T maximum = static_cast<T>(1.0);
+        size_t invalid = 0;
+        bool success = true;
+
+        if (!index.isValid() || !file.isValid() ||
+                (cr::datatypeSize(index.getVoxelType()) != sizeof(T)))
+        {
+            std::cerr << "Error while loading compressed data: invalid file!\n";
+            return false;
+        }
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+            if ((subsetMax[i] < subsetMin[i]) || (subsetMax[i] >= volumeDim[i]))
+            {
+                std::cerr <<
+                    "Error while loading compressed data: invalid region!\n";
+                return false;
+            }
+        }
+
+        const size_t dimX = subsetMax[0] - subsetMin[0] + 1;
+        const size_t dimY = subsetMax[1] - subsetMin[1] + 1;
+        const bool fullSlices =
+            (dimX == volumeDim[0]) && (dimY == volumeDim[1]);
+        const size_t firstBlock = subsetMin[2] / depth;
+        const size_t lastBlock = subsetMax[2] / depth;
+
+        #pragma omp parallel
+        {
+            std::vector<uint8_t> compressed;
+            std::vector<T> slab;
+
+            #pragma omp for schedule(dynamic) \
+                reduction(&&: success) \
+                reduction(min: minimum) \
+                reduction(max: maximum) \
+                reduction(+: invalid)
+            for (size_t b = firstBlock; b <= lastBlock; ++b)
+            {
+                const cr::CompressedBlock &block = index.getBlocks()[b];
+                const size_t z0 = b * depth;
+                const size_t slices = std::min(depth, volumeDim[2] - z0);
+                const size_t lo = std::max(z0, subsetMin[2]);
+                const size_t hi = std::min(z0 + slices - 1, subsetMax[2]);
+                const bool direct =
+                    fullSlices && (lo == z0) && (hi == z0 + slices - 1);
+                T *target = nullptr;
+
+                compressed.resize(block.size);
+                if (!file.readAt(compressed.data(), block.size, block.offset))
+                {
+                    success = false;
+                    continue;
+                }
+
+                if (direct)
+                {
+                    target = buffer + (z0 - subsetMin[2]) * sliceSize;
+                }
+                else
+                {
+                    slab.resize(slices * sliceSize);
+                    target = slab.data();
+                }
+
+                if (!inflateBlock(
+                        compressed.data(),
+                        compressed.size(),
+                        target,
+                        slices * sliceSize,
+                        direct,
+                        swap,
+                        minimum,
+                        maximum,
+                        invalid))
+                {
+                    success = false;
+                    continue;
+                }
+
+                if (direct)
+                    continue;
+
+                for (size_t z = lo; z <= hi; ++z)
+                for (size_t y = subsetMin[1]; y <= subsetMax[1]; ++y)
+                {
+                    const T *src = target +
+                        subsetMin[0] +
+                        y * volumeDim[0] +
+                        (z - z0) * sliceSize;
+                    T *dst = buffer +
+                        (y - subsetMin[1]) * dimX +
+                        (z - subsetMin[2]) * dimX * dimY;
+
+                    std::copy(src, src + dimX, dst);
+                    cr::processChunk(
+                        dst, dimX, swap, minimum, maximum, invalid);
+                }
+            }
+        }
+
+        if (!success)
+        {
+            std::cerr << "Error while loading compressed data: corrupt " <<
+                "or truncated file " << path << std::endl;
+            return false;
+        }
+
+        if (0 < invalid)
+            std::cerr << "Warning: " << path << " contains " << invalid <<
+                " NaN or infinite values." << std::endl;
+
+        limits = std::tuple<float, float>(
+            static_cast<float>(minimum), static_cast<float>(maximum));
+
+        return true;
+    }
+
+    /**
+     * \brief loads a cuboid region of a volume stored as gzip/zlib stream
+     *
+     * A single stream can only be inflated sequentially, so the slices are
+     * inflated one after the other up to the last slice of the region. The
+     * file is read in chunks with positional reads. Slices that belong to
+     * the region as a whole are inflated directly into the buffer in chunks
+     * of RAW_CHUNK_SIZE byte that are swapped and scanned for the limits
+     * right away, of all other slices only the rows of the region are
+     * copied. Concatenated gzip members are inflated one after the other.
+     * The first streamOffset byte of the inflated data are skipped.
+     */
+    template<typename T>
+    bool inflateGzip3dCuboid(
+        const std::string &path,
+        size_t fileOffset,
+        size_t streamOffset,
+        T *buffer,
+        std::array<size_t, 3> origVolumeDim,
+        std::array<size_t, 3> subsetMin,
+        std::array<size_t, 3> subsetMax,
+        bool swap,
+        std::tuple<float, float> &limits)
+    {
+        const size_t inputSize = 4 * cr::RAW_CHUNK_SIZE;
+        const size_t chunkValues =
+            std::max(cr::RAW_CHUNK_SIZE / sizeof(T), size_t(1));
+        const size_t sliceSize = origVolumeDim[0] * origVolumeDim[1];
+        const size_t dimX = subsetMax[0] - subsetMin[0] + 1;
+        const size_t dimY = subsetMax[1] - subsetMin[1] + 1;
+        const bool fullSlices =
+            (dimX == origVolumeDim[0]) && (dimY == origVolumeDim[1]);
+        util::io::File file(path);
+        boost::system::error_code ec;
+        uintmax_t fileSize = bfs::file_size(path, ec);
+        std::vector<uint8_t> input(inputSize);
+        std::vector<T> slice;
+        size_t inputOffset = fileOffset;
+        T minimum = static_cast<T>(0.0);
+        T maximum = static_cast<T>(1.0);
+        size_t invalid = 0;
+        z_stream stream;
+
+        if (!file.isValid() || ec)
+        {
+            std::cerr << "Error while loading gzip data: cannot open " <<
+                path << std::endl;
+            return false;
+        }
+
+        file.advise(util::io::Advice::sequential, fileOffset);
+
+        // 15 + 32: default window, detect gzip or zlib header automatically
+        std::memset(&stream, 0, sizeof(stream));
+        if (Z_OK != inflateInit2(&stream, 15 + 32))
+            return false;
+
+        // inflates the next length bytes of the stream into dst
+        auto inflateTo = [&](uint8_t *dst, size_t length) -> bool
+        {
+            stream.next_out = dst;
+            stream.avail_out = static_cast<uInt>(length);
+
+            while (0 < stream.avail_out)
+            {
+                if (0 == stream.avail_in)
+                {
+                    size_t count = static_cast<size_t>(std::min<uintmax_t>(
+                        inputSize, fileSize - std::min<uintmax_t>(
+                            fileSize, inputOffset)));
+
+                    if ((0 == count) ||
+                            !file.readAt(input.data(), count, inputOffset))
+                        return false;
+
+                    inputOffset += count;
+                    stream.next_in = input.data();
+                    stream.avail_in = static_cast<uInt>(count);
+                }
+
+                int ret = inflate(&stream, Z_NO_FLUSH);
+
+                if ((Z_STREAM_END == ret) && (0 < stream.avail_out))
+                    ret = inflateReset(&stream);
+                if ((Z_OK != ret) && (Z_STREAM_END != ret))
+                    return false;
+            }
+
+            return true;
+        };
+
+        bool success = true;
+        if (!fullSlices || (0 < subsetMin[2]))
+            slice.resize(sliceSize);
+
+        // bytes before the voxels are inflated and dropped
+        if (0 < streamOffset)
+        {
+            std::vector<uint8_t> skipped(
+                std::min(streamOffset, cr::RAW_CHUNK_SIZE));
+
+            for (size_t i = 0; (i < streamOffset) && success;
+                    i += skipped.size())
+                success = inflateTo(skipped.data(),
+                    std::min(skipped.size(), streamOffset - i));
+        }
+
+        for (size_t z = 0; (z <= subsetMax[2]) && success; ++z)
+        {
+            if (fullSlices && (z >= subsetMin[2]))
+            {
+                T *dst = buffer + (z - subsetMin[2]) * sliceSize;
+
+                for (size_t i = 0; (i < sliceSize) && success;
+                        i += chunkValues)
+                {
+                    size_t count = std::min(chunkValues, sliceSize - i);
+
+                    success = inflateTo(
+                        reinterpret_cast<uint8_t*>(dst + i),
+                        count * sizeof(T));
+                    if (success)
+                        cr::processChunk(
+                            dst + i, count, swap, minimum, maximum, invalid);
+                }
+                continue;
+            }
+
+            success = inflateTo(
+                reinterpret_cast<uint8_t*>(slice.data()),
+                sliceSize * sizeof(T));
+            if (!success || (z < subsetMin[2]))
+                continue;
+
+            for (size_t y = subsetMin[1]; y <= subsetMax[1]; ++y)
+            {
+                T *dst = buffer +
+                    (y - subsetMin[1]) * dimX +
+                    (z - subsetMin[2]) * dimX * dimY;
+                const T *src = slice.data() + y * origVolumeDim[0] +
+                    subsetMin[0];
+
+                std::copy(src, src + dimX, dst);
+                cr::processChunk(dst, dimX, swap, minimum, maximum, invalid);
+            }
+        }
+
+        inflateEnd(&stream);
+
+        if (!success)
+        {
+            std::cerr << "Error while loading gzip data: corrupt or " <<
+                "truncated stream in " << path << std::endl;
+            return false;
+        }
+
+        if (0 < invalid)
+            std::cerr << "Warning: " << path << " contains " << invalid <<
+                " NaN or infinite values." << std::endl;
+
+        limits = std::tuple<float, float>(
+            static_cast<float>(minimum), static_cast<float>(maximum));
+
+        return true;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// CompressedIndex Class Implementations
+//-----------------------------------------------------------------------------
+cr::CompressedIndex::CompressedIndex() :
+    m_voxelType(Datatype::none),
+    m_volumeDim{ {0, 0, 0} },
+    m_slabDepth(0),
+    m_codec(Codec::zlib),
+    m_blocks(),
+    m_valid(false)
+{
+}
+
+/**
+ * \brief reads header and block index of a compressed volume file
+ *
+ * Note: check isValid() if the file could be read
+ */
+cr::CompressedIndex::CompressedIndex(const std::string &path) :
+    CompressedIndex()
+{
+    std::ifstream fs(path.c_str(), std::ios::in | std::ios::binary);
+    char magic[sizeof(COMPRESSED_MAGIC)] = {};
+    uint32_t version = 0, type = 0, slabDepth = 0, codec = 0;
+    uint64_t dim = 0, numBlocks = 0;
+    boost::system::error_code ec;
+    uintmax_t fileSize = bfs::file_size(path, ec);
+
+    if (!fs.is_open())
+    {
+        std::cerr << "Error while reading block index: cannot open " <<
+            path << std::endl;
+        return;
+    }
+
+    fs.read(magic, sizeof(magic));
+    if (!fs.good() || (0 != std::memcmp(
+            magic, COMPRESSED_MAGIC, sizeof(COMPRESSED_MAGIC))))
+    {
+        std::cerr << "Error while reading block index: " << path <<
+            " is no compressed volume file" << std::endl;
+        return;
+    }
+
+    readValue(fs, version);
+    readValue(fs, type);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        readValue(fs, dim);
+        m_volumeDim[i] = static_cast<size_t>(dim);
+    }
+    readValue(fs, slabDepth);
+    readValue(fs, codec);
+    readValue(fs, numBlocks);
+
+    if (!fs.good() || (COMPRESSED_VERSION != version) || (0 == slabDepth) ||
+        (static_cast<uint32_t>(Codec::zlib) != codec))
+    {
+        std::cerr << "Error while reading block index: unsupported header " <<
+            "in " << path << std::endl;
+        return;
+    }
+
+    m_voxelType = static_cast<Datatype>(type);
+    m_slabDepth = slabDepth;
+    m_codec = static_cast<Codec>(codec);
+
+    if ((numBlocks != (m_volumeDim[2] + m_slabDepth - 1) / m_slabDepth) ||
+        ec || (numBlocks > (fileSize - HEADER_SIZE) / BLOCK_INFO_SIZE))
+    {
+        std::cerr << "Error while reading block index: inconsistent " <<
+            "number of blocks in " << path << std::endl;
+        return;
+    }
+
+    m_blocks.resize(numBlocks);
+    for (CompressedBlock &block : m_blocks)
+    {
+        readValue(fs, block.offset);
+        readValue(fs, block.size);
+    }
+
+    if (!fs.good())
+    {
+        std::cerr << "Error while reading block index: unexpected end of " <<
+            path << std::endl;
+        m_blocks.clear();
+        return;
+    }
+
+    // blocks have to lie behind the index and inside of the file
+    uint64_t dataStart = HEADER_SIZE + numBlocks * BLOCK_INFO_SIZE;
+    for (size_t b = 0; b < m_blocks.size(); ++b)
+    {
+        const CompressedBlock &block = m_blocks[b];
+
+        if ((block.offset < dataStart) || (block.size > fileSize) ||
+            (block.offset > fileSize - block.size))
+        {
+            std::cerr << "Error while reading block index: block " << b <<
+                " (offset " << block.offset << ", " << block.size <<
+                " byte) exceeds the file size of " << fileSize <<
+                " byte in " << path << std::endl;
+            m_blocks.clear();
+            return;
+        }
+    }
+
+    m_valid = true;
+}
+
+//-----------------------------------------------------------------------------
+// convenience functions
+//-----------------------------------------------------------------------------
+/**
+ * \brief writes volume data into a compressed volume file
+ *
+ * \param volumeData volume dataset representative class object
+ * \param path path of the created file
+ * \param blockSize approximate uncompressed size of a block in byte
+ * \param level zlib compression level (1 fastest, 9 smallest)
+ *
+ * \return EXIT_SUCCESS or EXIT_FAILURE
+ *
+ * The blocks are compressed in parallel. Blocks consist of whole z slices,
+ * at least one slice per block.
+ */
+int cr::writeCompressedVolume(
+    const VolumeDataBase &volumeData,
+    const std::string &path,
+    size_t blockSize,
+    int level)
+{
+    const VolumeConfig &volumeConfig = volumeData.getVolumeConfig();
+    const uint8_t *values =
+        static_cast<const uint8_t*>(volumeData.getRawData());
+    std::array<size_t, 3> dim = volumeConfig.getVolumeDim();
+    const size_t sliceBytes =
+        dim[0] * dim[1] * volumeConfig.getVoxelSizeOf();
+    std::ofstream fs;
+    bool success = true;
+
+    if ((nullptr == values) || (0 == sliceBytes))
+        return EXIT_FAILURE;
+
+    const size_t slabDepth = std::max(blockSize / sliceBytes, size_t(1));
+    const size_t numBlocks = (dim[2] + slabDepth - 1) / slabDepth;
+    std::vector<std::vector<uint8_t>> blocks(numBlocks);
+
+    #pragma omp parallel for schedule(dynamic) reduction(&&: success)
+    for (size_t b = 0; b < numBlocks; ++b)
+    {
+        const size_t slices = std::min(slabDepth, dim[2] - b * slabDepth);
+        const uLong length = static_cast<uLong>(slices * sliceBytes);
+        uLongf compressedLength = compressBound(length);
+
+        blocks[b].resize(compressedLength);
+        if (Z_OK != compress2(
+                blocks[b].data(),
+                &compressedLength,
+                values + b * slabDepth * sliceBytes,
+                length,
+                level))
+        {
+            success = false;
+            continue;
+        }
+        blocks[b].resize(compressedLength);
+    }
+
+    if (!success)
+    {
+        std::cerr << "Error while compressing the volume data for " <<
+            path << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    fs.open(path.c_str(), std::ios::out | std::ios::binary);
+    if (!fs.is_open())
+    {
+        std::cerr << "Error while writing compressed data: cannot open " <<
+            path << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    fs.write(COMPRESSED_MAGIC, sizeof(COMPRESSED_MAGIC));
+    writeValue<uint32_t>(fs, COMPRESSED_VERSION);
+    writeValue<uint32_t>(fs,
+        static_cast<uint32_t>(volumeConfig.getVoxelType()));
+    for (size_t i = 0; i < 3; ++i)
+        writeValue<uint64_t>(fs, dim[i]);
+    writeValue<uint32_t>(fs, static_cast<uint32_t>(slabDepth));
+    writeValue<uint32_t>(fs, static_cast<uint32_t>(Codec::zlib));
+    writeValue<uint64_t>(fs, numBlocks);
+
+    uint64_t offset = HEADER_SIZE + numBlocks * BLOCK_INFO_SIZE;
+    for (const std::vector<uint8_t> &block : blocks)
+    {
+        writeValue<uint64_t>(fs, offset);
+        writeValue<uint64_t>(fs, block.size());
+        offset += block.size();
+    }
+    for (const std::vector<uint8_t> &block : blocks)
+        fs.write(reinterpret_cast<const char*>(block.data()), block.size());
+
+    if (!fs.good())
+    {
+        std::cerr << "Error while writing compressed data to " << path <<
+            std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * \brief converts all timesteps of a volume dataset into compressed files
+ *
+ * \param volumeFile path to the volume description file
+ * \param outputDir directory for the compressed files
+ * \param level zlib compression level (1 fastest, 9 smallest)
+ *
+ * \return EXIT_SUCCESS or EXIT_FAILURE
+ *
+ * Each timestep is written as <raw file name>.zraw. A volume description
+ * file <name>_compressed.json for the converted dataset is placed next to
+ * them. If the description selects a subset, only the subset is converted.
+ */
+int cr::convertToCompressed(
+    const std::string &volumeFile,
+    const std::string &outputDir,
+    int level)
+{
+    VolumeConfig volumeConfig(volumeFile);
+    bfs::path outPath(outputDir);
+    json description;
+
+    if (!volumeConfig.isValid())
+        return EXIT_FAILURE;
+
+    try
+    {
+        bfs::create_directories(outPath);
+
+        for (unsigned int t = 0; t < volumeConfig.getNumTimesteps(); ++t)
+        {
+            bfs::path rawFile(volumeConfig.getTimestepFile(t));
+            bfs::path compressedFile =
+                outPath / (rawFile.filename().string() + ".zraw");
+            std::unique_ptr<VolumeDataBase> volumeData =
+                loadScalarVolumeTimestep(volumeConfig, t, false);
+
+            std::cout << "Converting " << rawFile.string() << " -> " <<
+                compressedFile.string() << std::endl;
+
+            if ((nullptr == volumeData) ||
+                (EXIT_SUCCESS != writeCompressedVolume(
+                    *volumeData,
+                    compressedFile.string(),
+                    DEFAULT_COMPRESSED_BLOCK_SIZE,
+                    level)))
+                return EXIT_FAILURE;
+        }
+
+        description["VOLUME_FILE_DIR"] = ".";
+        description["VOLUME_FILE_REGEX"] =
+            "(" + volumeConfig.getRawFileExp() + ")\\.zraw";
+        description["VOLUME_DIM"] = volumeConfig.getVolumeDim();
+        description["VOLUME_DATA_TYPE"] = volumeConfig.getVoxelType();
+        description["VOXEL_SIZE"] = volumeConfig.getVoxelDim();
+        description["VOLUME_NUM_TIMESTEPS"] = volumeConfig.getNumTimesteps();
+        description["VOLUME_FORMAT"] = FileFormat::compressed;
+
+        std::ofstream ofs((outPath / (bfs::path(volumeFile).stem().string() +
+            "_compressed.json")).string());
+        ofs << std::setw(4) << description << std::endl;
+    }
+    catch(std::exception &e)
+    {
+        std::cerr << "Error while converting " << volumeFile << ": " <<
+            e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * \brief loads the n-th timestep of a compressed volume dataset
+ *
+ * \param volumeConfig configuration object of the volume dataset
+ * \param n number of the requested timestep (starting from 0)
+ * \param buffer memory for the voxels of the (subset of the) volume
+ * \param swap flag if the byte order of the data shall be swapped
+ * \param limits Out: lowest and highest loaded value
+ *
+ * \return true if the data could be loaded
+ */
+bool cr::loadCompressedTimestep(
+    const VolumeConfig &volumeConfig,
+    unsigned int n,
+    void *buffer,
+    bool swap,
+    std::tuple<float, float> &limits)
+{
+    std::string path = volumeConfig.getTimestepFile(n);
+    CompressedIndex index(path);
+    std::array<size_t, 3> subsetMin = volumeConfig.getSubsetMin();
+    std::array<size_t, 3> subsetMax = volumeConfig.getSubsetMax();
+
+    if (!index.isValid())
+        return false;
+
+    if ((index.getVolumeDim() != volumeConfig.getOrigVolumeDim()) ||
+        (index.getVoxelType() != volumeConfig.getVoxelType()))
+    {
+        std::cerr << "Error while loading compressed data: " << path <<
+            " does not match the volume description" << std::endl;
+        return false;
+    }
+
+    switch(volumeConfig.getVoxelType())
+    {
+        case Datatype::unsigned_byte:
+            return loadCompressed3dCuboid(
+                index, path, static_cast<unsigned_byte_t*>(buffer),
+                subsetMin, subsetMax, swap, limits);
+
+        case Datatype::signed_byte:
+            return loadCompressed3dCuboid(
+                index, path, static_cast<signed_byte_t*>(buffer),
+                subsetMin, subsetMax, swap, limits);
+
+        case Datatype::unsigned_halfword:
+            return loadCompressed3dCuboid(
+                index, path, static_cast<unsigned_halfword_t*>(buffer),
+                subsetMin, subsetMax, swap, limits);
+
+        case Datatype::signed_halfword:
+            return loadCompressed3dCuboid(
+                index, path, static_cast<signed_halfword_t*>(buffer),
+                subsetMin, subsetMax, swap, limits);
+
+        case Datatype::unsigned_word:
+            return loadCompressed3dCuboid(
+                index, path, static_cast<unsigned_word_t*>(buffer),
+                subsetMin, subsetMax, swap, limits);
+
+        case Datatype::signed_word:
+            return loadCompressed3dCuboid(
+                index, path, static_cast<signed_word_t*>(buffer),
+                subsetMin, subsetMax, swap, limits);
+
+        case Datatype::unsigned_longword:
+            return loadCompressed3dCuboid(
+                index, path, static_cast<unsigned_longword_t*>(buffer),
+                subsetMin, subsetMax, swap, limits);
+
+        case Datatype::signed_longword:
+            return loadCompressed3dCuboid(
+                index, path, static_cast<signed_longword_t*>(buffer),
+                subsetMin, subsetMax, swap, limits);
+
+        case Datatype::single_precision_float:
+            return loadCompressed3dCuboid(
+                index, path, static_cast<single_precision_float_t*>(buffer),
+                subsetMin, subsetMax, swap, limits);
+
+        case Datatype::double_precision_float:
+            return loadCompressed3dCuboid(
+                index, path, static_cast<double_precision_float_t*>(buffer),
+                subsetMin, subsetMax, swap, limits);
+
+        default:
+            break;
+    }
+
+    return false;
+}
+
+/**
+ * \brief loads the n-th timestep of a volume dataset in gzip files
+ *
+ * \param volumeConfig configuration object of the volume dataset
+ * \param n number of the requested timestep (starting from 0)
+ * \param buffer memory for the voxels of the (subset of the) volume
+ * \param swap flag if the byte order of the data shall be swapped
+ * \param limits Out: lowest and highest loaded value
+ *
+ * \return true if the data could be loaded
+ *
+ * The stream starts at the raw file offset of the configuration, the voxels
+ * at the decoded offset of the inflated data.
+ */
+bool cr::loadGzipTimestep(
+    const VolumeConfig &volumeConfig,
+    unsigned int n,
+    void *buffer,
+    bool swap,
+    std::tuple<float, float> &limits)
+{
+    std::string path = volumeConfig.getTimestepFile(n);
+    size_t offset = volumeConfig.getRawFileOffset();
+    size_t skip = volumeConfig.getDecodedOffset();
+    std::array<size_t, 3> dim = volumeConfig.getOrigVolumeDim();
+    std::array<size_t, 3> subsetMin = volumeConfig.getSubsetMin();
+    std::array<size_t, 3> subsetMax = volumeConfig.getSubsetMax();
+
+    switch(volumeConfig.getVoxelType())
+    {
+        case Datatype::unsigned_byte:
+            return inflateGzip3dCuboid(
+                path, offset, skip,
+                static_cast<unsigned_byte_t*>(buffer),
+                dim, subsetMin, subsetMax, swap, limits);
+
+        case Datatype::signed_byte:
+            return inflateGzip3dCuboid(
+                path, offset, skip,
+                static_cast<signed_byte_t*>(buffer),
+                dim, subsetMin, subsetMax, swap, limits);
+
+        case Datatype::unsigned_halfword:
+            return inflateGzip3dCuboid(
+                path, offset, skip,
+                static_cast<unsigned_halfword_t*>(buffer),
+                dim, subsetMin, subsetMax, swap, limits);
+
+        case Datatype::signed_halfword:
+            return inflateGzip3dCuboid(
+                path, offset, skip,
+                static_cast<signed_halfword_t*>(buffer),
+                dim, subsetMin, subsetMax, swap, limits);
+
+        case Datatype::unsigned_word:
+            return inflateGzip3dCuboid(
+                path, offset, skip,
+                static_cast<unsigned_word_t*>(buffer),
+                dim, subsetMin, subsetMax, swap, limits);
+
+        case Datatype::signed_word:
+            return inflateGzip3dCuboid(
+                path, offset, skip,
+                static_cast<signed_word_t*>(buffer),
+                dim, subsetMin, subsetMax, swap, limits);
+
+        case Datatype::unsigned_longword:
+            return inflateGzip3dCuboid(
+                path, offset, skip,
+                static_cast<unsigned_longword_t*>(buffer),
+                dim, subsetMin, subsetMax, swap, limits);
+
+        case Datatype::signed_longword:
+            return inflateGzip3dCuboid(
+                path, offset, skip,
+                static_cast<signed_longword_t*>(buffer),
+                dim, subsetMin, subsetMax, swap, limits);
+
+        case Datatype::single_precision_float:
+            return inflateGzip3dCuboid(
+                path, offset, skip,
+                static_cast<single_precision_float_t*>(buffer),
+                dim, subsetMin, subsetMax, swap, limits);
+
+        case Datatype::double_precision_float:
+            return inflateGzip3dCuboid(
+                path, offset, skip,
+                static_cast<double_precision_float_t*>(buffer),
+                dim, subsetMin, subsetMax, swap, limits);
+
+        default:
+            break;
+    }
+
+    return false;
+}
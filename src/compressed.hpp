@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <array>
+#include <vector>
+#include <cstdint>
+
+#include "util/util.hpp"
+#include "configraw.hpp"
+
+namespace cr
+{
+    // ------------------------------------------------------------------------
+    // constants
+    // ------------------------------------------------------------------------
+    constexpr char COMPRESSED_MAGIC[8] =
+        {'M', 'V', 'R', 'Z', 'B', 'L', 'C', 'K'};
+    constexpr uint32_t COMPRESSED_VERSION = 1;
+    constexpr size_t DEFAULT_COMPRESSED_BLOCK_SIZE = 4 * 1024 * 1024;
+    constexpr int DEFAULT_COMPRESSION_LEVEL = 6;
+
+    // ------------------------------------------------------------------------
+    // type definitions
+    // ------------------------------------------------------------------------
+    /**
+     * \brief compression method of the blocks
+    */
+    enum class Codec : uint32_t
+    {
+        zlib = 1
+    };
+
+    /**
+     * \brief index entry of a single compressed block
+     */
+    struct CompressedBlock
+    {
+        uint64_t offset;    //!< position of the compressed block in the file
+        uint64_t size;      //!< size of the compressed block in byte
+    };
+
+    /**
+     * \brief header and block index of a compressed volume file
+     *
+     * File layout (native byte order):
+     *  - magic "MVRZBLCK", version (uint32), datatype (uint32)
+     *  - volume dimensions (3 x uint64), slab depth (uint32), codec (uint32)
+     *  - number of blocks (uint64)
+     *  - one CompressedBlock (offset, size) per block
+     *  - compressed blocks
+     * Each block holds a slab of slab depth complete z slices of the volume
+     * (the last one may be thinner) and is compressed on its own, so that
+     * blocks can be decompressed in parallel and subsets only need the
+     * slabs they intersect.
+     */
+    class CompressedIndex
+    {
+        public:
+        CompressedIndex();
+        CompressedIndex(const std::string &path);
+
+        bool isValid() const { return m_valid; }
+
+        Datatype getVoxelType() const { return m_voxelType; }
+        std::array<size_t, 3> getVolumeDim() const { return m_volumeDim; }
+        size_t getSlabDepth() const { return m_slabDepth; }
+        Codec getCodec() const { return m_codec; }
+        const std::vector<CompressedBlock>& getBlocks() const
+        {
+            return m_blocks;
+        }
+
+        private:
+        Datatype m_voxelType;
+        std::array<size_t, 3> m_volumeDim;
+        size_t m_slabDepth;
+        Codec m_codec;
+        std::vector<CompressedBlock> m_blocks;
+        bool m_valid;
+    };
+
+    // ------------------------------------------------------------------------
+    // function declarations
+    // ------------------------------------------------------------------------
+    int writeCompressedVolume(
+        const VolumeDataBase &volumeData,
+        const std::string &path,
+        size_t blockSize = DEFAULT_COMPRESSED_BLOCK_SIZE,
+        int level = DEFAULT_COMPRESSION_LEVEL);
+    int convertToCompressed(
+        const std::string &volumeFile,
+        const std::string &outputDir,
+        int level = DEFAULT_COMPRESSION_LEVEL);
+}
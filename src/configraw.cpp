@@ -4,19 +4,71 @@
 #include <exception>
 #include <vector>
 #include <algorithm>
+#include <cmath>
 
 #include <boost/filesystem.hpp>
 namespace bfs = boost::filesystem;
 
-#include <boost/regex.hpp>
-
 #include <json.hpp>
 using json = nlohmann::json;
 
 #include "configraw.hpp"
+#include "volumeheader.hpp"
+#include "timestepindex.hpp"
+#include "paged.hpp"
 #include "util/util.hpp"
 
 
+namespace
+{
+    /**
+     * \brief regular expression that matches exactly the given file name
+     */
+    std::string escapeRegex(const std::string &name)
+    {
+        const std::string special = "\\^$.|?*+()[]{}";
+        std::string exp;
+
+        for (char c : name)
+        {
+            if (std::string::npos != special.find(c))
+                exp.push_back('\\');
+            exp.push_back(c);
+        }
+
+        return exp;
+    }
+
+    /**
+     * \brief integer voxel size closest to the ratio of the spacings
+     *
+     * The voxel size is stored as integers, the smallest spacing maps to 1.
+     * Ratios that are not close to integers are rounded with a note.
+     */
+    std::array<size_t, 3> voxelRatio(const std::array<double, 3> &spacing)
+    {
+        double minSpacing = *std::min_element(spacing.begin(), spacing.end());
+        std::array<size_t, 3> ratio = {{1, 1, 1}};
+        bool exact = true;
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+            double r = spacing[i] / minSpacing;
+
+            ratio[i] = static_cast<size_t>(std::max(std::round(r), 1.));
+            exact = exact &&
+                (std::abs(r - static_cast<double>(ratio[i])) < 0.01 * r);
+        }
+
+        if (!exact)
+            std::cout << "Note: the voxel spacing " << spacing[0] << " x " <<
+                spacing[1] << " x " << spacing[2] << " is not an integer " <<
+                "ratio, the voxel size is rounded to " << ratio[0] <<
+                " x " << ratio[1] << " x " << ratio[2] << "." << std::endl;
+
+        return ratio;
+    }
+}
 
 namespace cr
 {
@@ -91,6 +143,14 @@ cr::VolumeConfig::VolumeConfig()
     _voxel_type = Datatype::none;
     _voxel_dim = {0, 0, 0};
     _voxel_sizeof = 0;
+    _raw_file_offset = 0;
+    _decoded_offset = 0;
+    _access_mode = AccessMode::read;
+    _paged_brick_size = DEFAULT_PAGED_BRICK_SIZE;
+    _paged_memory_budget = DEFAULT_PAGED_MEMORY_BUDGET << 20;
+    _file_format = FileFormat::raw;
+    _endianness = util::byteorder::isLittleEndianHost() ?
+        Endianness::little : Endianness::big;
     _valid = false;
 }
 
@@ -103,6 +163,13 @@ cr::VolumeConfig::VolumeConfig(std::string const &path) :
 {
     std::ifstream fs;
 
+    // volume files with a header describe themselves
+    if (isVolumeHeaderFile(path))
+    {
+        initFromHeader(path);
+        return;
+    }
+
     fs.open(path.c_str(), std::ofstream::in);
 
     // try loading as json config file
@@ -147,6 +214,20 @@ cr::VolumeConfig::VolumeConfig(std::string const &path) :
 
         _raw_file_dir = json_config["VOLUME_FILE_DIR"].get<std::string>();
         _raw_file_exp = json_config["VOLUME_FILE_REGEX"].get<std::string>();
+        if (!json_config["VOLUME_ACCESS"].is_null())
+            _access_mode = json_config["VOLUME_ACCESS"].get<AccessMode>();
+        if (!json_config["PAGED_BRICK_SIZE"].is_null())
+            _paged_brick_size = std::max(
+                json_config["PAGED_BRICK_SIZE"].get<size_t>(), size_t(1));
+        if (!json_config["PAGED_MEMORY_BUDGET"].is_null())
+            _paged_memory_budget =
+                json_config["PAGED_MEMORY_BUDGET"].get<size_t>() << 20;
+        if (!json_config["VOLUME_FORMAT"].is_null())
+            _file_format = json_config["VOLUME_FORMAT"].get<FileFormat>();
+        if (!json_config["VOLUME_ENDIANNESS"].is_null())
+            _endianness = json_config["VOLUME_ENDIANNESS"].get<Endianness>();
+        if (!json_config["VOLUME_FILE_OFFSET"].is_null())
+            _raw_file_offset = json_config["VOLUME_FILE_OFFSET"].get<size_t>();
 
         bfs::path p;
         if (bfs::path(_raw_file_dir).is_absolute())
@@ -154,12 +235,40 @@ cr::VolumeConfig::VolumeConfig(std::string const &path) :
         else
             p = bfs::path(path).parent_path() / bfs::path(_raw_file_dir);
 
-        for (bfs::directory_entry& x : bfs::directory_iterator(p))
-            if(boost::regex_match(x.path().filename().string(),
-                boost::regex(_raw_file_exp)))
-                _raw_files.push_back(x.path().string());
+        _timesteps = TimestepIndex::find(p.string(), _raw_file_exp);
 
-        std::sort(_raw_files.begin(), _raw_files.end());
+        // HDF5 timesteps are either the same dataset in each file or all
+        // matching datasets of a group, file after file
+        if (FileFormat::hdf5 == _file_format)
+        {
+            if (!json_config["HDF5_DATASET_REGEX"].is_null())
+            {
+                std::vector<std::string> files;
+                std::vector<std::string> datasets;
+                std::string group = json_config["HDF5_GROUP"].is_null() ?
+                    std::string("/") :
+                    json_config["HDF5_GROUP"].get<std::string>();
+                std::string exp =
+                    json_config["HDF5_DATASET_REGEX"].get<std::string>();
+
+                for (const std::string &file : _timesteps->getFiles())
+                    for (const std::string &dataset :
+                            findHdf5Datasets(file, group, exp))
+                    {
+                        files.push_back(file);
+                        datasets.push_back(dataset);
+                    }
+                _timesteps = std::make_shared<const TimestepIndex>(
+                    std::move(files), std::move(datasets));
+            }
+            else
+            {
+                _timesteps = std::make_shared<const TimestepIndex>(
+                    _timesteps->getFiles(),
+                    std::vector<std::string>{
+                        json_config["HDF5_DATASET"].get<std::string>()});
+            }
+        }
 
         _valid = true;
         return;
@@ -178,13 +287,100 @@ cr::VolumeConfig::VolumeConfig(std::string const &path) :
     }
 }
 
-std::string cr::VolumeConfig::getTimestepFile(unsigned int n)
+/**
+ * \brief sets up a single timestep volume from a NRRD, MetaImage or VTK file
+ *
+ * The payload is loaded directly from the data file given by the header,
+ * starting behind the header for attached data. Raw payloads are mapped
+ * into memory if their offset is aligned to the size of a voxel.
+*/
+void cr::VolumeConfig::initFromHeader(std::string const &path)
 {
-    if (this->_raw_files.size() < 1) return std::string("");
-    else if (n > (this->_raw_files.size() - 1))
-        n = this->_raw_files.size() - 1;
+    VolumeHeader header;
+
+    if (!readVolumeHeader(path, header))
+        return;
+
+    _num_timesteps = 1;
+    _subset = false;
+    _volume_dim = header.dim;
+    _orig_volume_dim = header.dim;
+    _subset_min = {0, 0, 0};
+    _subset_max = {
+        _volume_dim[0] - 1, _volume_dim[1] - 1, _volume_dim[2] - 1};
+    _voxel_count = _volume_dim[0] * _volume_dim[1] * _volume_dim[2];
+    _voxel_type = header.type;
+    _voxel_dim = voxelRatio(header.spacing);
+    _voxel_sizeof = datatypeSize(_voxel_type);
+
+    _raw_file_dir = bfs::path(header.dataFile).parent_path().string();
+    _raw_file_exp =
+        escapeRegex(bfs::path(header.dataFile).filename().string());
+    _timesteps = std::make_shared<const TimestepIndex>(
+        std::vector<std::string>{header.dataFile});
+    _raw_file_offset = header.dataOffset;
+    _decoded_offset = header.dataSkip;
+    _file_format = header.format;
+    _endianness = header.endianness;
+
+    // raw payloads are used in place unless a header of odd length would
+    // misalign the values
+    if ((FileFormat::raw == _file_format) &&
+        (0 == _raw_file_offset % _voxel_sizeof))
+        _access_mode = AccessMode::mapped_sequential;
+    else
+        _access_mode = AccessMode::read;
 
-    return this->_raw_files[n];
+    _valid = true;
+}
+
+/**
+ * \brief true if the byte order of the raw files differs from the host
+ *
+ * Bricked and compressed files are always written in the byte order of the
+ * host.
+*/
+bool cr::VolumeConfig::needsByteSwap() const
+{
+    Endianness host = util::byteorder::isLittleEndianHost() ?
+        Endianness::little : Endianness::big;
+
+    return ((FileFormat::raw == _file_format) ||
+        (FileFormat::gzip == _file_format)) && (host != _endianness);
+}
+
+std::string cr::VolumeConfig::getTimestepFile(unsigned int n) const
+{
+    if (nullptr == this->_timesteps) return std::string("");
+
+    return this->_timesteps->getFile(n);
+}
+
+std::string cr::VolumeConfig::getTimestepDataset(unsigned int n) const
+{
+    if (nullptr == this->_timesteps) return std::string("");
+
+    return this->_timesteps->getDataset(n);
+}
+
+cr::VolumeConfig cr::VolumeConfig::getRegionConfig(
+    std::array<size_t, 3> regionMin,
+    std::array<size_t, 3> regionMax) const
+{
+    VolumeConfig region = *this;
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        region._subset_min[i] = _subset_min[i] + regionMin[i];
+        region._subset_max[i] = _subset_min[i] + regionMax[i];
+        region._volume_dim[i] = regionMax[i] - regionMin[i] + 1;
+    }
+    region._subset = (region._volume_dim != _orig_volume_dim);
+    region._voxel_count =
+        region._volume_dim[0] * region._volume_dim[1] * region._volume_dim[2];
+    region._access_mode = AccessMode::read;
+
+    return region;
 }
 
 //-------------------------------------------------------------------------
@@ -195,344 +391,78 @@ std::string cr::VolumeConfig::getTimestepFile(unsigned int n)
  *
  * \param volumeConfig configuration object of the volume dataset
  * \param n number of the requested timestep (starting from 0)
- * \param swap flag if the byte order of the raw data shall be swapped
+ * \param swap flag if the byte order of the raw data shall be swapped in
+ *             addition to the swap required by VOLUME_ENDIANNESS
  *
  * \return pointer to the loaded data
  *
- * Note: Calling function has to delete the returned volume data.
+ * Note: Depending on the access mode of the volume configuration the
+ * returned object either owns a heap buffer or is a view on a memory
+ * mapping of the raw file. In both cases the memory is released together
+ * with the returned object.
  *
 */
 std::unique_ptr<cr::VolumeDataBase> cr::loadScalarVolumeTimestep(
     VolumeConfig volumeConfig, unsigned int n, bool swap)
 {
-    void *rawData = nullptr;
     std::unique_ptr<VolumeDataBase> pVolumeData = nullptr;
 
-    if (!volumeConfig.getSubset())
-    {
-        // the volume shall be loaded completely
-        switch(volumeConfig.getVoxelType())
-        {
-            case Datatype::unsigned_byte:
-                rawData = reinterpret_cast<void *>(
-                        new unsigned_byte_t[volumeConfig.getVoxelCount()]);
-                loadRaw<unsigned_byte_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<unsigned_byte_t*>(rawData),
-                    volumeConfig.getVoxelCount(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<unsigned_byte_t>>(
-                        volumeConfig,
-                        reinterpret_cast<unsigned_byte_t*>(rawData));
-                break;
-
-            case Datatype::signed_byte:
-                rawData = reinterpret_cast<void *>(
-                    new signed_byte_t[volumeConfig.getVoxelCount()]);
-                loadRaw<signed_byte_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<signed_byte_t*>(rawData),
-                    volumeConfig.getVoxelCount(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<signed_byte_t>>(
-                        volumeConfig,
-                        reinterpret_cast<signed_byte_t*>(rawData));
-                break;
-
-            case Datatype::unsigned_halfword:
-                rawData = reinterpret_cast<void *>(
-                    new unsigned_halfword_t[volumeConfig.getVoxelCount()]);
-                loadRaw<unsigned_halfword_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<unsigned_halfword_t*>(rawData),
-                    volumeConfig.getVoxelCount(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<unsigned_halfword_t>>(
-                        volumeConfig,
-                        reinterpret_cast<unsigned_halfword_t*>(rawData));
-                break;
-
-            case Datatype::signed_halfword:
-                rawData = reinterpret_cast<void *>(
-                    new signed_halfword_t[volumeConfig.getVoxelCount()]);
-                loadRaw<signed_halfword_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<signed_halfword_t*>(rawData),
-                    volumeConfig.getVoxelCount(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<signed_halfword_t>>(
-                        volumeConfig,
-                        reinterpret_cast<signed_halfword_t*>(rawData));
-                break;
-
-            case Datatype::unsigned_word:
-                rawData = reinterpret_cast<void *>(
-                    new unsigned_word_t[volumeConfig.getVoxelCount()]);
-                loadRaw<unsigned_word_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<unsigned_word_t*>(rawData),
-                    volumeConfig.getVoxelCount(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<unsigned_word_t>>(
-                        volumeConfig,
-                        reinterpret_cast<unsigned_word_t*>(rawData));
-                break;
-
-            case Datatype::signed_word:
-                rawData = reinterpret_cast<void *>(
-                    new signed_word_t[volumeConfig.getVoxelCount()]);
-                loadRaw<signed_word_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<signed_word_t*>(rawData),
-                    volumeConfig.getVoxelCount(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<signed_word_t>>(
-                        volumeConfig,
-                        reinterpret_cast<signed_word_t*>(rawData));
-                break;
-
-            case Datatype::unsigned_longword:
-                rawData = reinterpret_cast<void *>(
-                    new unsigned_longword_t[volumeConfig.getVoxelCount()]);
-                loadRaw<unsigned_longword_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<unsigned_longword_t*>(rawData),
-                    volumeConfig.getVoxelCount(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<unsigned_longword_t>>(
-                        volumeConfig,
-                        reinterpret_cast<unsigned_longword_t*>(rawData));
-                break;
-
-            case Datatype::signed_longword:
-                rawData = reinterpret_cast<void *>(
-                    new signed_longword_t[volumeConfig.getVoxelCount()]);
-                loadRaw<signed_longword_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<signed_longword_t*>(rawData),
-                    volumeConfig.getVoxelCount(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<signed_longword_t>>(
-                        volumeConfig,
-                        reinterpret_cast<signed_longword_t*>(rawData));
-                break;
-
-            case Datatype::single_precision_float:
-                rawData = reinterpret_cast<void *>(
-                    new single_precision_float_t[
-                        volumeConfig.getVoxelCount()]);
-                loadRaw<single_precision_float_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<single_precision_float_t*>(
-                        rawData),
-                    volumeConfig.getVoxelCount(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<single_precision_float_t>>(
-                        volumeConfig,
-                        reinterpret_cast<single_precision_float_t*>(rawData));
-                break;
+    swap = (swap != volumeConfig.needsByteSwap());
 
-            case Datatype::double_precision_float:
-                rawData = reinterpret_cast<void *>(
-                    new double_precision_float_t[
-                        volumeConfig.getVoxelCount()]);
-                loadRaw<double_precision_float_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<double_precision_float_t*>(rawData),
-                    volumeConfig.getVoxelCount(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<double_precision_float_t>>(
-                        volumeConfig,
-                        reinterpret_cast<double_precision_float_t*>(rawData));
-                break;
-
-            default:
-                break;
-        }
-    }
-    else
+    switch(volumeConfig.getVoxelType())
     {
-        // only a subset of the volume shall be loaded
-        switch(volumeConfig.getVoxelType())
-        {
-            case Datatype::unsigned_byte:
-                rawData = reinterpret_cast<void *>(
-                    new unsigned_byte_t[volumeConfig.getVoxelCount()]);
-                loadSubset3dCuboid<unsigned_byte_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<unsigned_byte_t*>(rawData),
-                    volumeConfig.getOrigVolumeDim(),
-                    volumeConfig.getSubsetMin(),
-                    volumeConfig.getSubsetMax(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<unsigned_byte_t>>(
-                        volumeConfig,
-                        reinterpret_cast<unsigned_byte_t*>(rawData));
-                break;
+        case Datatype::unsigned_byte:
+            pVolumeData = loadVolumeDataTimestep<unsigned_byte_t>(
+                volumeConfig, n, swap);
+            break;
 
-            case Datatype::signed_byte:
-                rawData = reinterpret_cast<void *>(
-                    new signed_byte_t[volumeConfig.getVoxelCount()]);
-                loadSubset3dCuboid<signed_byte_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<signed_byte_t*>(rawData),
-                    volumeConfig.getOrigVolumeDim(),
-                    volumeConfig.getSubsetMin(),
-                    volumeConfig.getSubsetMax(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<signed_byte_t>>(
-                        volumeConfig,
-                        reinterpret_cast<signed_byte_t*>(rawData));
-                break;
+        case Datatype::signed_byte:
+            pVolumeData = loadVolumeDataTimestep<signed_byte_t>(
+                volumeConfig, n, swap);
+            break;
 
-            case Datatype::unsigned_halfword:
-                rawData = reinterpret_cast<void *>(
-                    new unsigned_halfword_t[volumeConfig.getVoxelCount()]);
-                loadSubset3dCuboid<unsigned_halfword_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<unsigned_halfword_t*>(rawData),
-                    volumeConfig.getOrigVolumeDim(),
-                    volumeConfig.getSubsetMin(),
-                    volumeConfig.getSubsetMax(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<unsigned_halfword_t>>(
-                        volumeConfig,
-                        reinterpret_cast<unsigned_halfword_t*>(rawData));
-                break;
+        case Datatype::unsigned_halfword:
+            pVolumeData = loadVolumeDataTimestep<unsigned_halfword_t>(
+                volumeConfig, n, swap);
+            break;
 
-            case Datatype::signed_halfword:
-                rawData = reinterpret_cast<void *>(
-                    new signed_halfword_t[volumeConfig.getVoxelCount()]);
-                loadSubset3dCuboid<signed_halfword_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<signed_halfword_t*>(rawData),
-                    volumeConfig.getOrigVolumeDim(),
-                    volumeConfig.getSubsetMin(),
-                    volumeConfig.getSubsetMax(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<signed_halfword_t>>(
-                        volumeConfig,
-                        reinterpret_cast<signed_halfword_t*>(rawData));
-                break;
+        case Datatype::signed_halfword:
+            pVolumeData = loadVolumeDataTimestep<signed_halfword_t>(
+                volumeConfig, n, swap);
+            break;
 
-            case Datatype::unsigned_word:
-                rawData = reinterpret_cast<void *>(
-                    new unsigned_word_t[volumeConfig.getVoxelCount()]);
-                loadSubset3dCuboid<unsigned_word_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<unsigned_word_t*>(rawData),
-                    volumeConfig.getOrigVolumeDim(),
-                    volumeConfig.getSubsetMin(),
-                    volumeConfig.getSubsetMax(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<unsigned_word_t>>(
-                        volumeConfig,
-                        reinterpret_cast<unsigned_word_t*>(rawData));
-                break;
+        case Datatype::unsigned_word:
+            pVolumeData = loadVolumeDataTimestep<unsigned_word_t>(
+                volumeConfig, n, swap);
+            break;
 
-            case Datatype::signed_word:
-                rawData = reinterpret_cast<void *>(
-                    new signed_word_t[volumeConfig.getVoxelCount()]);
-                loadSubset3dCuboid<signed_word_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<signed_word_t*>(rawData),
-                    volumeConfig.getOrigVolumeDim(),
-                    volumeConfig.getSubsetMin(),
-                    volumeConfig.getSubsetMax(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<signed_word_t>>(
-                        volumeConfig,
-                        reinterpret_cast<signed_word_t*>(rawData));
-                break;
+        case Datatype::signed_word:
+            pVolumeData = loadVolumeDataTimestep<signed_word_t>(
+                volumeConfig, n, swap);
+            break;
 
-            case Datatype::unsigned_longword:
-                rawData = reinterpret_cast<void *>(
-                    new unsigned_longword_t[
-                        volumeConfig.getVoxelCount()]);
-                loadSubset3dCuboid<unsigned_longword_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<unsigned_longword_t*>(rawData),
-                    volumeConfig.getOrigVolumeDim(),
-                    volumeConfig.getSubsetMin(),
-                    volumeConfig.getSubsetMax(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<unsigned_longword_t>>(
-                        volumeConfig,
-                        reinterpret_cast<unsigned_longword_t*>(rawData));
-                break;
+        case Datatype::unsigned_longword:
+            pVolumeData = loadVolumeDataTimestep<unsigned_longword_t>(
+                volumeConfig, n, swap);
+            break;
 
-            case Datatype::signed_longword:
-                rawData = reinterpret_cast<void *>(
-                    new signed_longword_t[volumeConfig.getVoxelCount()]);
-                loadSubset3dCuboid<signed_longword_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<signed_longword_t*>(rawData),
-                    volumeConfig.getOrigVolumeDim(),
-                    volumeConfig.getSubsetMin(),
-                    volumeConfig.getSubsetMax(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<signed_longword_t>>(
-                        volumeConfig,
-                        reinterpret_cast<signed_longword_t*>(rawData));
-                break;
+        case Datatype::signed_longword:
+            pVolumeData = loadVolumeDataTimestep<signed_longword_t>(
+                volumeConfig, n, swap);
+            break;
 
-            case Datatype::single_precision_float:
-                rawData = reinterpret_cast<void *>(
-                    new single_precision_float_t[
-                        volumeConfig.getVoxelCount()]);
-                loadSubset3dCuboid<single_precision_float_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<single_precision_float_t*>(
-                        rawData),
-                    volumeConfig.getOrigVolumeDim(),
-                    volumeConfig.getSubsetMin(),
-                    volumeConfig.getSubsetMax(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<single_precision_float_t>>(
-                        volumeConfig,
-                        reinterpret_cast<single_precision_float_t*>(rawData));
-                break;
+        case Datatype::single_precision_float:
+            pVolumeData = loadVolumeDataTimestep<single_precision_float_t>(
+                volumeConfig, n, swap);
+            break;
 
-            case Datatype::double_precision_float:
-                rawData = reinterpret_cast<void *>(
-                    new double_precision_float_t[
-                        volumeConfig.getVoxelCount()]);
-                loadSubset3dCuboid<double_precision_float_t>(
-                    volumeConfig.getTimestepFile(n),
-                    reinterpret_cast<double_precision_float_t*>(
-                        rawData),
-                    volumeConfig.getOrigVolumeDim(),
-                    volumeConfig.getSubsetMin(),
-                    volumeConfig.getSubsetMax(),
-                    swap);
-                pVolumeData =
-                    std::make_unique<VolumeData<double_precision_float_t>>(
-                        volumeConfig,
-                        reinterpret_cast<double_precision_float_t*>(rawData));
-                break;
+        case Datatype::double_precision_float:
+            pVolumeData = loadVolumeDataTimestep<double_precision_float_t>(
+                volumeConfig, n, swap);
+            break;
 
-            default:
-                break;
-        }
+        default:
+            break;
     }
 
     return pVolumeData;
@@ -546,6 +476,9 @@ std::unique_ptr<cr::VolumeDataBase> cr::loadScalarVolumeTimestep(
  *
  * \return 3D texture object
  *
+ * The values are uploaded without conversion, see createVolumeTex for
+ * converted textures and for the mapping of the texels to data values.
+ *
  * Note: Texture has to be deleted by the calling function
 */
 util::texture::Texture3D cr::loadScalarVolumeTex(
@@ -554,38 +487,47 @@ util::texture::Texture3D cr::loadScalarVolumeTex(
     bool supported = true;
     GLenum type = GL_UNSIGNED_BYTE;
     GLenum internalFormat = GL_RED;
-    VolumeConfig volumeConfig = volumeData.getVolumeConfig();
+    const VolumeConfig &volumeConfig = volumeData.getVolumeConfig();
+
+    // out of core data is uploaded through an extracted region
+    if (volumeData.isPaged())
+    {
+        std::cerr << "Error: paged volume data cannot be uploaded as a " <<
+            "whole, see PagedVolumeData::extractRegion." << std::endl;
+        return util::texture::Texture3D();
+    }
 
     switch(volumeConfig.getVoxelType())
     {
         case Datatype::unsigned_byte:
             type = GL_UNSIGNED_BYTE;
-            internalFormat = GL_RED;
+            internalFormat = GL_R8;
             break;
 
         case Datatype::signed_byte:
             type = GL_BYTE;
-            internalFormat = GL_RED;
+            internalFormat = GL_R8_SNORM;
             break;
 
         case Datatype::unsigned_halfword:
             type = GL_UNSIGNED_SHORT;
-            internalFormat = GL_RED;
+            internalFormat = GL_R16;
             break;
 
         case Datatype::signed_halfword:
             type = GL_SHORT;
-            internalFormat = GL_RED;
+            internalFormat = GL_R16_SNORM;
             break;
 
+        // 32 bit integers are normalized by OpenGL and kept as float
         case Datatype::unsigned_word:
             type = GL_UNSIGNED_INT;
-            internalFormat = GL_RED;
+            internalFormat = GL_R32F;
             break;
 
         case Datatype::signed_word:
             type = GL_INT;
-            internalFormat = GL_RED;
+            internalFormat = GL_R32F;
             break;
 
         case Datatype::single_precision_float:
@@ -628,20 +570,22 @@ util::texture::Texture3D cr::loadScalarVolumeTex(
  * \param min lower histogram x axis limit
  * \param max upper histogram x axis limit
  *
- * \returns an vector of bin objects
- *
- * Note: vector of bins has to be deleted by the calling function
+ * \returns a histogram with the limits and counts of the bins
 */
-std::vector<util::bin_t> cr::bucketVolumeData(
+util::Histogram cr::bucketVolumeData(
     const VolumeDataBase &volumeData,
     size_t numBins,
     float min,
     float max)
 {
-    std::vector<util::bin_t> bins(0);
-    VolumeConfig volumeConfig = volumeData.getVolumeConfig();
+    util::Histogram bins;
+    const VolumeConfig &volumeConfig = volumeData.getVolumeConfig();
     void *values = reinterpret_cast<void*>(volumeData.getRawData());
 
+    if (volumeData.isPaged())
+        return static_cast<const PagedVolumeData&>(volumeData).bucket(
+            numBins, min, max);
+
     switch(volumeConfig.getVoxelType())
     {
         case Datatype::unsigned_byte:
@@ -753,9 +697,17 @@ std::tuple<float, float> cr::getLimitsVolumeData(
     const VolumeDataBase &volumeData)
 {
     std::tuple<float, float> limits({ 0, 0 });
-    VolumeConfig volumeConfig = volumeData.getVolumeConfig();
+    const VolumeConfig &volumeConfig = volumeData.getVolumeConfig();
     void *values = reinterpret_cast<void*>(volumeData.getRawData());
 
+    // limits that were determined while loading the data
+    if (volumeData.hasLimits())
+        return volumeData.getLimits();
+
+    // out of core data is scanned brick by brick
+    if (volumeData.isPaged())
+        return static_cast<const PagedVolumeData&>(volumeData).computeLimits();
+
     switch(volumeConfig.getVoxelType())
     {
         case Datatype::unsigned_byte:
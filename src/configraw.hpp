@@ -6,7 +6,12 @@
 #include <fstream>
 #include <vector>
 #include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <type_traits>
 #include <memory>
+#include <tuple>
+#include <algorithm>
 
 #include <GL/gl3w.h>
 
@@ -28,6 +33,13 @@ typedef double double_precision_float_t;
 
 namespace cr
 {
+    // ------------------------------------------------------------------------
+    // constants
+    // ------------------------------------------------------------------------
+    constexpr size_t RAW_CHUNK_SIZE = 256 * 1024;   //!< L2 sized read chunks
+    constexpr size_t DEFAULT_PAGED_BRICK_SIZE = 64;
+    constexpr size_t DEFAULT_PAGED_MEMORY_BUDGET = 4096;    //!< in MiB
+
     // ------------------------------------------------------------------------
     // type definitions
     // ------------------------------------------------------------------------
@@ -64,23 +76,122 @@ namespace cr
             {Datatype::double_precision_float, "DOUBLE"},
             } );
 
+    /**
+     * \brief enumeration for the different ways of accessing the raw files
+     *
+     * With the mapped access modes the raw files are mapped into memory
+     * instead of being copied into a heap buffer. The hint selects if the
+     * kernel shall read ahead (sequential) or only fetch the touched pages
+     * (random). The paged mode keeps the volume out of core and reads bricks
+     * on demand into a cache of limited size (see paged.hpp).
+    */
+    enum class AccessMode : int
+    {
+        read = 0,
+        mapped_sequential,
+        mapped_random,
+        paged
+    };
+
+    NLOHMANN_JSON_SERIALIZE_ENUM(
+        AccessMode, {
+            {AccessMode::read, "READ"},
+            {AccessMode::mapped_sequential, "MAP_SEQUENTIAL"},
+            {AccessMode::mapped_random, "MAP_RANDOM"},
+            {AccessMode::paged, "PAGED"},
+            } );
+
+    /**
+     * \brief enumeration for the layout of the volume files
+     *
+     * Raw files contain the voxels as flat array, bricked files contain
+     * the voxels in bricks together with a brick index (see bricked.hpp).
+     * Compressed files contain independently compressed slabs of z slices
+     * (see compressed.hpp). Gzip files contain the raw voxels as a single
+     * gzip or zlib stream, as used by NRRD and MetaImage files. HDF5 files
+     * contain one or more 3D datasets, each of which is a timestep.
+    */
+    enum class FileFormat : int
+    {
+        raw = 0,
+        bricked,
+        compressed,
+        gzip,
+        hdf5
+    };
+
+    NLOHMANN_JSON_SERIALIZE_ENUM(
+        FileFormat, {
+            {FileFormat::raw, "RAW"},
+            {FileFormat::bricked, "BRICKED"},
+            {FileFormat::compressed, "COMPRESSED"},
+            {FileFormat::gzip, "GZIP"},
+            {FileFormat::hdf5, "HDF5"},
+            } );
+
+    /**
+     * \brief enumeration for the byte order of the values in the raw files
+    */
+    enum class Endianness : int
+    {
+        little = 0,
+        big
+    };
+
+    NLOHMANN_JSON_SERIALIZE_ENUM(
+        Endianness, {
+            {Endianness::little, "LITTLE"},
+            {Endianness::big, "BIG"},
+            } );
+
     // ------------------------------------------------------------------------
     // forward declarations
     // ------------------------------------------------------------------------
     class VolumeConfig;
     class VolumeDataBase;
+    class TimestepIndex;
     unsigned int datatypeSize(cr::Datatype type);
     std::unique_ptr<VolumeDataBase> loadScalarVolumeTimestep(
         VolumeConfig volumeConfig, unsigned int n, bool swap);
     util::texture::Texture3D loadScalarVolumeTex(
         const VolumeDataBase &volumeData);
-    std::vector<util::bin_t> bucketVolumeData(
+    util::Histogram bucketVolumeData(
         const VolumeDataBase &volumeData,
         size_t numBins,
         float min,
         float max);
     std::tuple<float, float> getLimitsVolumeData(
         const VolumeDataBase &volumeData);
+    std::unique_ptr<VolumeDataBase> loadPagedTimestep(
+        const VolumeConfig &volumeConfig, unsigned int n, bool swap);
+    bool loadBrickedTimestep(
+        const VolumeConfig &volumeConfig,
+        unsigned int n,
+        void *buffer,
+        bool swap,
+        std::tuple<float, float> *limits);
+    bool loadCompressedTimestep(
+        const VolumeConfig &volumeConfig,
+        unsigned int n,
+        void *buffer,
+        bool swap,
+        std::tuple<float, float> &limits);
+    bool loadGzipTimestep(
+        const VolumeConfig &volumeConfig,
+        unsigned int n,
+        void *buffer,
+        bool swap,
+        std::tuple<float, float> &limits);
+    bool loadHdf5Timestep(
+        const VolumeConfig &volumeConfig,
+        unsigned int n,
+        void *buffer,
+        bool swap,
+        std::tuple<float, float> &limits);
+    std::vector<std::string> findHdf5Datasets(
+        const std::string &path,
+        const std::string &group,
+        const std::string &exp);
 
     // ------------------------------------------------------------------------
     // class declarations
@@ -112,10 +223,26 @@ namespace cr
         size_t _voxel_sizeof;               //!< size of a voxel in byte
         std::string _raw_file_dir;          //!< path to raw files
         std::string _raw_file_exp;          //!< filter regex for raw files
-        std::vector<std::string> _raw_files;//!< vector of file paths to
-                                            //!< the raw data
+        std::shared_ptr<const TimestepIndex> _timesteps;
+                                            //!< shared list of the files
+                                            //!< (and HDF5 datasets) of the
+                                            //!< timesteps
+        size_t _raw_file_offset;            //!< position of the voxels in
+                                            //!< the raw files in byte
+        size_t _decoded_offset;             //!< position of the voxels in
+                                            //!< the inflated data of gzip
+                                            //!< files in byte
+        AccessMode _access_mode;            //!< how the raw files are read
+        size_t _paged_brick_size;           //!< edge length of the bricks
+                                            //!< in paged access mode
+        size_t _paged_memory_budget;        //!< size of the brick cache in
+                                            //!< paged access mode in byte
+        FileFormat _file_format;            //!< layout of the volume files
+        Endianness _endianness;             //!< byte order of the raw files
         bool _valid;                        //!< health flag
 
+        void initFromHeader(std::string const &path);
+
         public:
         VolumeConfig();                         //!< default constructor
         VolumeConfig(std::string const &path);  //!< construction from file
@@ -127,12 +254,32 @@ namespace cr
          * \param n temporal index of the timestep {0, 1, 2 ..}
          * \return path to the according datafile
         */
-        std::string getTimestepFile(unsigned int n);
+        std::string getTimestepFile(unsigned int n) const;
+
+        /*
+         * \brief returns the HDF5 dataset containing the n-th timestep
+         *
+         * \param n temporal index of the timestep {0, 1, 2 ..}
+         * \return path of the dataset inside the file of the timestep
+        */
+        std::string getTimestepDataset(unsigned int n) const;
+
+        /*
+         * \brief configuration of a cuboid region of the loaded volume
+         *
+         * \param regionMin index of the lower left voxel of the region
+         * \param regionMax index of the upper right voxel of the region
+         * \return configuration that loads the region as subset of the
+         *         whole volume, always read into memory
+        */
+        VolumeConfig getRegionConfig(
+            std::array<size_t, 3> regionMin,
+            std::array<size_t, 3> regionMax) const;
 
         /*
          * \brief indicator if the object represents a valid configuration
         */
-        bool isValid(){ return _valid; }
+        bool isValid() const { return _valid; }
 
         // getter and setter
         unsigned int getNumTimesteps() const { return _num_timesteps; }
@@ -150,34 +297,90 @@ namespace cr
         size_t getVoxelSizeOf() const { return _voxel_sizeof; }
         std::string getRawFileDir() const { return _raw_file_dir; }
         std::string getRawFileExp() const { return _raw_file_exp; }
+        std::shared_ptr<const TimestepIndex> getTimestepIndex() const
+        {
+            return _timesteps;
+        }
+        size_t getRawFileOffset() const { return _raw_file_offset; }
+        size_t getDecodedOffset() const { return _decoded_offset; }
+        AccessMode getAccessMode() const { return _access_mode; }
+        void setAccessMode(AccessMode mode) { _access_mode = mode; }
+        size_t getPagedBrickSize() const { return _paged_brick_size; }
+        size_t getPagedMemoryBudget() const { return _paged_memory_budget; }
+        FileFormat getFileFormat() const { return _file_format; }
+        Endianness getEndianness() const { return _endianness; }
+        bool needsByteSwap() const;
     };
 
     // volume dataset representative
     class VolumeDataBase
     {
         public:
-        VolumeDataBase() : m_config() {}
+        VolumeDataBase() : m_config(), m_hasLimits(false), m_limits(0.f, 0.f)
+        {
+        }
         VolumeDataBase(VolumeConfig volumeConfig) :
-            m_config(volumeConfig)
+            m_config(volumeConfig),
+            m_hasLimits(false),
+            m_limits(0.f, 0.f)
         {
         }
         virtual ~VolumeDataBase() {};
 
         virtual void* getRawData() const = 0;
-        VolumeConfig getVolumeConfig() const { return m_config; }
+        virtual bool isMapped() const = 0;
 
-        private:
+        /**
+         * \brief true if the voxels are not held in memory but paged in
+         *        brick by brick, getRawData() returns nullptr then
+        */
+        virtual bool isPaged() const { return false; }
+        const VolumeConfig& getVolumeConfig() const { return m_config; }
+
+        /**
+         * \brief value limits that are already known from loading the data
+         *
+         * Used by getLimitsVolumeData to avoid scanning the whole volume.
+        */
+        bool hasLimits() const { return m_hasLimits; }
+        std::tuple<float, float> getLimits() const { return m_limits; }
+        void setLimits(std::tuple<float, float> limits)
+        {
+            m_limits = limits;
+            m_hasLimits = true;
+        }
+
+        protected:
         VolumeConfig m_config;
+        bool m_hasLimits;
+        std::tuple<float, float> m_limits;
     };
 
     template<typename T>
     class VolumeData : public VolumeDataBase
     {
         public:
-        VolumeData() : m_rawData(nullptr) {}
+        VolumeData() : m_rawData(nullptr), m_mapping(nullptr) {}
         VolumeData(VolumeConfig volumeConfig, T* rawData) :
             VolumeDataBase(volumeConfig),
-            m_rawData(rawData)
+            m_rawData(rawData),
+            m_mapping(nullptr)
+        {
+        }
+        /**
+         * \brief creates a non-owning view on memory mapped volume data
+         *
+         * \param volumeConfig configuration object of the volume dataset
+         * \param mapping memory mapped file which is kept alive by the view
+         * \param rawData pointer to the first voxel inside the mapping
+        */
+        VolumeData(
+                VolumeConfig volumeConfig,
+                std::shared_ptr<util::io::MappedFile> mapping,
+                T* rawData) :
+            VolumeDataBase(volumeConfig),
+            m_rawData(rawData),
+            m_mapping(std::move(mapping))
         {
         }
 
@@ -185,31 +388,45 @@ namespace cr
         VolumeData& operator=(VolumeData& other) = delete;
         VolumeData(VolumeData&& other) :
             VolumeDataBase(std::move(other.m_config)),
-            m_rawData(std::move(other.m_rawData))
+            m_rawData(other.m_rawData),
+            m_mapping(std::move(other.m_mapping))
         {
+            this->m_hasLimits = other.m_hasLimits;
+            this->m_limits = other.m_limits;
             other.m_config = VolumeConfig();
+            other.m_hasLimits = false;
             other.m_rawData = nullptr;
         }
         VolumeData& operator=(VolumeData&& other)
         {
-            if (nullptr != this->m_rawData)
+            if ((nullptr != this->m_rawData) && (nullptr == this->m_mapping))
                 delete[] this->m_rawData;
 
             this->m_config = std::move(other.m_config);
-            this->m_rawData = std::move(other.m_rawData);
+            this->m_hasLimits = other.m_hasLimits;
+            this->m_limits = other.m_limits;
+            this->m_rawData = other.m_rawData;
+            this->m_mapping = std::move(other.m_mapping);
             other.m_rawData = nullptr;
 
-            return this;
+            return *this;
+        }
+        ~VolumeData()
+        {
+            if ((nullptr != m_rawData) && (nullptr == m_mapping))
+                delete[] m_rawData;
         }
-        ~VolumeData() { if (nullptr != m_rawData) delete[] m_rawData; }
 
         void* getRawData() const override
         {
             return reinterpret_cast<void*>(m_rawData);
         }
 
+        bool isMapped() const override { return nullptr != m_mapping; }
+
         private:
         T* m_rawData;
+        std::shared_ptr<util::io::MappedFile> m_mapping;
     };
 
 
@@ -218,39 +435,41 @@ namespace cr
     // ------------------------------------------------------------------------
     /**
      * \brief swaps the byteorder of the given value
+     *
+     * The bytes are reordered through an unsigned integer of the same size,
+     * so that floating point values keep their bit pattern.
      */
     template<typename T>
     T swapByteOrder(T value)
     {
-        unsigned char *v = reinterpret_cast<unsigned char*>(&value);
-
         switch(sizeof(T))
         {
             case 8:
-                value =
-                    (static_cast<uint64_t>(v[0]) << 56) |
-                    (static_cast<uint64_t>(v[1]) << 48) |
-                    (static_cast<uint64_t>(v[2]) << 40) |
-                    (static_cast<uint64_t>(v[3]) << 32) |
-                    (static_cast<uint64_t>(v[4]) << 24) |
-                    (static_cast<uint64_t>(v[5]) << 16) |
-                    (static_cast<uint64_t>(v[6]) << 8) |
-                    static_cast<uint64_t>(v[7]);
+            {
+                uint64_t v;
+                std::memcpy(&v, &value, sizeof(v));
+                v = __builtin_bswap64(v);
+                std::memcpy(&value, &v, sizeof(v));
                 break;
+            }
 
             case 4:
-                value =
-                    (static_cast<uint32_t>(v[0]) << 24) |
-                    (static_cast<uint32_t>(v[1]) << 16) |
-                    (static_cast<uint32_t>(v[2]) << 8) |
-                    static_cast<uint32_t>(v[3]);
+            {
+                uint32_t v;
+                std::memcpy(&v, &value, sizeof(v));
+                v = __builtin_bswap32(v);
+                std::memcpy(&value, &v, sizeof(v));
                 break;
+            }
 
             case 2:
-                value =
-                    (static_cast<uint16_t>(v[0]) << 8) |
-                    static_cast<uint16_t>(v[1]);
+            {
+                uint16_t v;
+                std::memcpy(&v, &value, sizeof(v));
+                v = __builtin_bswap16(v);
+                std::memcpy(&value, &v, sizeof(v));
                 break;
+            }
 
             case 1:
             default:
@@ -260,6 +479,89 @@ namespace cr
         return value;
     }
 
+    /**
+     * \brief swaps and scans a chunk of values that was just read
+     * \param values Pointer to the first value of the chunk
+     * \param count Number of values in the chunk
+     * \param swap True if the byte order of the values shall be swapped
+     * \param minimum In/Out: lowest value found so far
+     * \param maximum In/Out: highest value found so far
+     * \param invalid In/Out: number of NaN and infinite values found so far
+     *
+     * Meant to be called on chunks that still reside in the cache, so that
+     * swapping, validation and the limits do not need extra passes over the
+     * whole volume.
+    */
+    template<typename T>
+    void processChunk(
+        T *values,
+        size_t count,
+        bool swap,
+        T &minimum,
+        T &maximum,
+        size_t &invalid)
+    {
+        if (swap)
+            util::byteorder::swap(values, count, sizeof(T));
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            T val = values[i];
+
+            if (std::is_floating_point<T>::value &&
+                    !std::isfinite(static_cast<double>(val)))
+                ++invalid;
+            if (val < minimum) minimum = val;
+            if (val > maximum) maximum = val;
+        }
+    }
+
+    /**
+     * \brief swaps a series of values in memory and determines their limits
+     * \param values Pointer to the first value
+     * \param count Number of values
+     * \param swap True if the byte order of the values shall be swapped
+     * \param limits Out: lowest and highest value (see getLimitsVolumeData)
+     * \return number of NaN and infinite values
+     *
+     * For data that did not pass through loadRawFused, e.g. mapped files.
+    */
+    template<typename T>
+    size_t processValues(
+        T *values, size_t count, bool swap, std::tuple<float, float> &limits)
+    {
+        const size_t chunkSize = std::max(RAW_CHUNK_SIZE / sizeof(T), size_t(1));
+        const size_t numChunks = (count + chunkSize - 1) / chunkSize;
+        T minimum = static_cast<T>(0.0);
+        T maximum = static_cast<T>(1.0);
+        size_t invalid = 0;
+
+        #pragma omp parallel for \
+            reduction(min: minimum) \
+            reduction(max: maximum) \
+            reduction(+: invalid)
+        for (size_t chunk = 0; chunk < numChunks; ++chunk)
+        {
+            size_t first = chunk * chunkSize;
+
+            processChunk(
+                values + first,
+                std::min(chunkSize, count - first),
+                swap,
+                minimum,
+                maximum,
+                invalid);
+        }
+
+        if (0 == count)
+            limits = std::tuple<float, float>(0.f, 0.f);
+        else
+            limits = std::tuple<float, float>(
+                static_cast<float>(minimum), static_cast<float>(maximum));
+
+        return invalid;
+    }
+
     /**
      * \brief loads a series of T values into a given buffer
      * \param path Destination of the file to be read
@@ -283,12 +585,85 @@ namespace cr
         fs.close();
 
         if (swap)
+            util::byteorder::swap(buffer, size, sizeof(T));
+    }
+
+    /**
+     * \brief loads a series of T values and determines their limits
+     * \param path Destination of the file to be read
+     * \param buffer Pointer to an array where the read values are stored
+     * \param size Number of values to be read
+     * \param swap True if the byte order of the read values shall be swapped
+     * \param limits Out: lowest and highest value (see getLimitsVolumeData)
+     * \param fileOffset position of the first value in the file in byte
+     * \return true if all values could be read
+     *
+     * The file is read in chunks of RAW_CHUNK_SIZE byte on several threads.
+     * Each chunk is swapped, checked for invalid floating point values and
+     * scanned for the limits right after it was read while it is still in
+     * the cache. Same result as loadRaw followed by util::findDataMinMax.
+    */
+    template<typename T>
+    bool loadRawFused(
+        std::string path,
+        T *buffer,
+        std::size_t size,
+        bool swap,
+        std::tuple<float, float> &limits,
+        size_t fileOffset = 0)
+    {
+        const size_t chunkSize = std::max(RAW_CHUNK_SIZE / sizeof(T), size_t(1));
+        const size_t numChunks = (size + chunkSize - 1) / chunkSize;
+        util::io::File file(path);
+        T minimum = static_cast<T>(0.0);
+        T maximum = static_cast<T>(1.0);
+        size_t invalid = 0;
+        bool success = true;
+
+        if (!file.isValid())
+        {
+            std::cerr << "Error while loading data: cannot open file!\n";
+            return false;
+        }
+
+        file.advise(
+            util::io::Advice::sequential, fileOffset, size * sizeof(T));
+
+        #pragma omp parallel for \
+            reduction(min: minimum) \
+            reduction(max: maximum) \
+            reduction(+: invalid) \
+            reduction(&&: success)
+        for (size_t chunk = 0; chunk < numChunks; ++chunk)
         {
-            for (std::size_t i = 0; i < size; ++i)
+            size_t first = chunk * chunkSize;
+            size_t count = std::min(chunkSize, size - first);
+
+            if (!file.readAt(
+                    buffer + first,
+                    count * sizeof(T),
+                    fileOffset + first * sizeof(T)))
             {
-                buffer[i] = swapByteOrder(buffer[i]);
+                success = false;
+                continue;
             }
+
+            processChunk(buffer + first, count, swap, minimum, maximum, invalid);
         }
+
+        if (!success)
+            std::cerr << "Error while loading data: unexpected end of file!\n";
+        if (0 < invalid)
+            std::cerr << "Warning: " << path << " contains " << invalid <<
+                " NaN or infinite values!\n";
+
+        if (0 == size)
+            limits = std::tuple<float, float>(0.f, 0.f);
+        else
+            limits = std::tuple<float, float>(
+                static_cast<float>(minimum), static_cast<float>(maximum));
+
+        return success;
     }
 
     /**
@@ -349,11 +724,416 @@ namespace cr
                 (subsetMax[1] - subsetMin[1] + 1) *
                 (subsetMax[2] - subsetMin[2] + 1));
 
-            for (std::size_t i = 0; i < count; ++i)
+            util::byteorder::swap(buffer, count, sizeof(T));
+        }
+    }
+
+    /**
+     * \brief loads a subset of 3d volume data with few, parallel reads
+     * \param path Destination of the file to be read
+     * \param buffer Pointer to an array where the read values are stored
+     * \param origVolumeDim dimensions of the whole volume
+     * \param subsetMin index of the lower left voxel of the loaded cuboid
+     * \param subsetMax index of the upper right voxel of the loaded cuboid
+     * \param swap True if the byte order of the read values shall be swapped
+     * \param limits Out: lowest and highest value (optional, see
+     *               getLimitsVolumeData)
+     * \param fileOffset position of the first voxel in the file in byte
+     * \return true if the whole subset could be read
+     *
+     * Same result as loadSubset3dCuboid but the file is read with positional
+     * reads on several threads, each of them handling whole z-slabs:
+     *  - if the subset spans the complete x (and y) extent the rows (and
+     *    slices) are contiguous in the file and are read at once
+     *  - if the gap between two rows is small the whole slab is read at once
+     *    and the rows are copied out of it
+     *  - otherwise each row is read separately
+     * The kernel is told about the access pattern beforehand so that the
+     * slabs can be read ahead while the threads are busy. Swapping and the
+     * search for the limits are done per slab while it is still cached.
+    */
+    template<typename T>
+    bool readSubset3dCuboid(
+        std::string path,
+        T *buffer,
+        std::array<size_t, 3> origVolumeDim,
+        std::array<size_t, 3> subsetMin,
+        std::array<size_t, 3> subsetMax,
+        bool swap = false,
+        std::tuple<float, float> *limits = nullptr,
+        size_t fileOffset = 0)
+    {
+        // minimum size of a read if whole slices are contiguous
+        const size_t minChunkBytes = 4 << 20;
+        const size_t pageBytes = 4096;
+
+        util::io::File file(path);
+
+        if (!file.isValid())
+        {
+            std::cerr <<
+                "Error while loading data subset: cannot open file!\n";
+            return false;
+        }
+
+        const size_t dimX = subsetMax[0] - subsetMin[0] + 1;
+        const size_t dimY = subsetMax[1] - subsetMin[1] + 1;
+        const size_t dimZ = subsetMax[2] - subsetMin[2] + 1;
+        const size_t rowBytes = sizeof(T) * dimX;
+        const size_t rowStride = sizeof(T) * origVolumeDim[0];
+        const size_t sliceStride = rowStride * origVolumeDim[1];
+        const size_t slabBytes = rowBytes * dimY;
+        const size_t slabSpan = (dimY - 1) * rowStride + rowBytes;
+        const size_t firstOffset = fileOffset + sizeof(T) * (
+            subsetMin[0] + subsetMin[1] * origVolumeDim[0]) +
+            subsetMin[2] * sliceStride;
+
+        const bool fullX = (dimX == origVolumeDim[0]);
+        const bool fullXY = fullX && (dimY == origVolumeDim[1]);
+        const bool readThrough = !fullX &&
+            ((rowStride - rowBytes) <= std::max(rowBytes, pageBytes));
+        const size_t slabsPerChunk =
+            fullXY ? std::max(minChunkBytes / slabBytes, size_t(1)) : 1;
+        const size_t numChunks = (dimZ + slabsPerChunk - 1) / slabsPerChunk;
+
+        T minimum = static_cast<T>(0.0);
+        T maximum = static_cast<T>(1.0);
+        size_t invalid = 0;
+        bool success = true;
+
+        // readahead hints for the accessed ranges
+        if (fullXY)
+        {
+            file.advise(
+                util::io::Advice::sequential, firstOffset, dimZ * slabBytes);
+        }
+        else if (fullX || readThrough)
+        {
+            for (size_t z = 0; z < dimZ; ++z)
+                file.advise(
+                    util::io::Advice::willneed,
+                    firstOffset + z * sliceStride,
+                    slabSpan);
+        }
+        else
+        {
+            // readahead would mostly fetch the gaps between the rows
+            file.advise(util::io::Advice::random);
+        }
+
+        #pragma omp parallel
+        {
+            std::vector<char> slab(readThrough ? slabSpan : 0);
+
+            #pragma omp for schedule(dynamic) \
+                reduction(min: minimum) \
+                reduction(max: maximum) \
+                reduction(+: invalid) \
+                reduction(&&: success)
+            for (size_t chunk = 0; chunk < numChunks; ++chunk)
             {
-                buffer[i] = swapByteOrder(buffer[i]);
+                size_t z = chunk * slabsPerChunk;
+                size_t numSlabs = std::min(slabsPerChunk, dimZ - z);
+                size_t offset = firstOffset + z * sliceStride;
+                char *dst = reinterpret_cast<char*>(buffer) + z * slabBytes;
+
+                if (fullX)
+                {
+                    success = file.readAt(dst, numSlabs * slabBytes, offset) &&
+                        success;
+                }
+                else if (readThrough)
+                {
+                    if (file.readAt(slab.data(), slabSpan, offset))
+                    {
+                        for (size_t y = 0; y < dimY; ++y)
+                            std::copy(
+                                slab.data() + y * rowStride,
+                                slab.data() + y * rowStride + rowBytes,
+                                dst + y * rowBytes);
+                    }
+                    else
+                        success = false;
+                }
+                else
+                {
+                    for (size_t y = 0; y < dimY; ++y)
+                        success = file.readAt(
+                            dst + y * rowBytes,
+                            rowBytes,
+                            offset + y * rowStride) && success;
+                }
+
+                processChunk(
+                    reinterpret_cast<T*>(dst),
+                    numSlabs * dimX * dimY,
+                    swap,
+                    minimum,
+                    maximum,
+                    invalid);
             }
         }
+
+        if (!success)
+            std::cerr <<
+                "Error while loading data subset: unexpected end of file!\n";
+        if (0 < invalid)
+            std::cerr << "Warning: " << path << " contains " << invalid <<
+                " NaN or infinite values!\n";
+
+        if (nullptr != limits)
+            *limits = std::tuple<float, float>(
+                static_cast<float>(minimum), static_cast<float>(maximum));
+
+        return success;
     }
-}
 
+    /**
+     * \brief copies a subset of 3d volume data from a linear array in memory
+     * \param volume Pointer to the complete volume data
+     * \param buffer Pointer to an array where the subset values are stored
+     * \param origVolumeDim dimensions of the whole volume
+     * \param subsetMin index of the lower left voxel of the copied cuboid
+     * \param subsetMax index of the upper right voxel of the copied cuboid
+     *
+     * In memory counterpart of loadSubset3dCuboid. If the volume data is
+     * memory mapped only the pages that contain the subset are touched.
+    */
+    template<typename T>
+    void extractSubset3dCuboid(
+        const T *volume,
+        T *buffer,
+        std::array<size_t, 3> origVolumeDim,
+        std::array<size_t, 3> subsetMin,
+        std::array<size_t, 3> subsetMax)
+    {
+        size_t chunkSize = subsetMax[0] - subsetMin[0] + 1;
+        size_t numRows = subsetMax[1] - subsetMin[1] + 1;
+
+        #pragma omp parallel for
+        for (size_t z = subsetMin[2]; z <= subsetMax[2]; ++z)
+        {
+            size_t bufferIdx = (z - subsetMin[2]) * numRows * chunkSize;
+            for (size_t y = subsetMin[1]; y <= subsetMax[1]; ++y)
+            {
+                size_t volumeIdx =
+                    subsetMin[0] +
+                    y * origVolumeDim[0] +
+                    z * origVolumeDim[0] * origVolumeDim[1];
+
+                std::copy(
+                    volume + volumeIdx,
+                    volume + volumeIdx + chunkSize,
+                    buffer + bufferIdx);
+                bufferIdx += chunkSize;
+            }
+        }
+    }
+
+    /**
+     * \brief loads the voxels of the n-th timestep with a known type
+     * \param volumeConfig configuration object of the volume dataset
+     * \param n number of the requested timestep (starting from 0)
+     * \param swap True if the byte order of the read values shall be swapped
+     *
+     * Depending on the access mode of the configuration the data is either
+     * read into a heap buffer or the raw file is mapped into memory. A
+     * complete mapped volume is returned as view on the mapping without
+     * copying, whereas for subsets only the touched pages are read from the
+     * mapping. If mapping the file fails the data is read conventionally.
+     * The voxels of raw files start at the raw file offset of the
+     * configuration, e.g. behind the header of a NRRD file. Raw and bricked
+     * files in paged access mode are not read at all but returned as
+     * PagedVolumeData, all other formats are read completely.
+    */
+    template<typename T>
+    std::unique_ptr<VolumeDataBase> loadVolumeDataTimestep(
+        const VolumeConfig &volumeConfig, unsigned int n, bool swap)
+    {
+        std::string path = volumeConfig.getTimestepFile(n);
+        std::array<size_t, 3> origDim = volumeConfig.getOrigVolumeDim();
+        size_t origVoxelCount = origDim[0] * origDim[1] * origDim[2];
+        size_t offset = volumeConfig.getRawFileOffset();
+        T *rawData = nullptr;
+
+        // out of core volumes only read the bricks that are accessed
+        if (AccessMode::paged == volumeConfig.getAccessMode())
+        {
+            if ((FileFormat::raw == volumeConfig.getFileFormat()) ||
+                (FileFormat::bricked == volumeConfig.getFileFormat()))
+                return loadPagedTimestep(volumeConfig, n, swap);
+
+            std::cerr << "Warning: paged access is only supported for raw " <<
+                "and bricked files, reading " << path << " completely." <<
+                std::endl;
+        }
+
+        // bricked files are always read, only the intersected bricks of a
+        // subset are touched
+        if (FileFormat::bricked == volumeConfig.getFileFormat())
+        {
+            std::tuple<float, float> limits(0.f, 0.f);
+            std::unique_ptr<VolumeDataBase> volumeData = nullptr;
+            bool exact = !volumeConfig.getSubset() && !swap;
+            bool loaded = false;
+
+            rawData = new T[volumeConfig.getVoxelCount()];
+            loaded = loadBrickedTimestep(
+                volumeConfig, n, rawData, swap, exact ? &limits : nullptr);
+
+            // bricks that could not be read would leave garbage behind
+            if (!loaded)
+                std::fill(
+                    rawData,
+                    rawData + volumeConfig.getVoxelCount(),
+                    static_cast<T>(0));
+            volumeData = std::make_unique<VolumeData<T>>(volumeConfig, rawData);
+
+            // the brick ranges only give exact limits for the whole volume
+            if (loaded && exact)
+                volumeData->setLimits(limits);
+
+            return volumeData;
+        }
+
+        // compressed and HDF5 files are decoded chunk by chunk into the
+        // buffer, the limits are determined while the chunks are still in
+        // the cache
+        if ((FileFormat::compressed == volumeConfig.getFileFormat()) ||
+            (FileFormat::gzip == volumeConfig.getFileFormat()) ||
+            (FileFormat::hdf5 == volumeConfig.getFileFormat()))
+        {
+            std::tuple<float, float> limits(0.f, 0.f);
+            std::unique_ptr<VolumeDataBase> volumeData = nullptr;
+            bool loaded = false;
+
+            rawData = new T[volumeConfig.getVoxelCount()];
+            switch(volumeConfig.getFileFormat())
+            {
+                case FileFormat::compressed:
+                    loaded = loadCompressedTimestep(
+                        volumeConfig, n, rawData, swap, limits);
+                    break;
+
+                case FileFormat::gzip:
+                    loaded = loadGzipTimestep(
+                        volumeConfig, n, rawData, swap, limits);
+                    break;
+
+                default:
+                    loaded = loadHdf5Timestep(
+                        volumeConfig, n, rawData, swap, limits);
+                    break;
+            }
+            volumeData = std::make_unique<VolumeData<T>>(volumeConfig, rawData);
+            if (loaded)
+                volumeData->setLimits(limits);
+
+            return volumeData;
+        }
+
+        // values behind a header of odd length cannot be used in place
+        if ((AccessMode::read != volumeConfig.getAccessMode()) &&
+            (0 == offset % sizeof(T)))
+        {
+            util::io::Advice advice =
+                (AccessMode::mapped_random == volumeConfig.getAccessMode()) ?
+                util::io::Advice::random : util::io::Advice::sequential;
+            std::shared_ptr<util::io::MappedFile> mapping =
+                std::make_shared<util::io::MappedFile>(
+                    path, swap && !volumeConfig.getSubset());
+
+            if (mapping->isValid() &&
+                (mapping->getSize() >= offset + origVoxelCount * sizeof(T)))
+            {
+                T *mapped = reinterpret_cast<T*>(
+                    static_cast<char*>(mapping->getData()) + offset);
+
+                if (!volumeConfig.getSubset())
+                {
+                    mapping->advise(
+                        advice, offset, origVoxelCount * sizeof(T));
+
+                    std::unique_ptr<VolumeDataBase> volumeData = nullptr;
+                    std::tuple<float, float> limits(0.f, 0.f);
+
+                    // swapping writes to the private copy of the mapping; the
+                    // limits are found in the same pass. Without swapping the
+                    // pages stay untouched until they are needed.
+                    if (swap)
+                        processValues(mapped, origVoxelCount, swap, limits);
+
+                    volumeData = std::make_unique<VolumeData<T>>(
+                        volumeConfig, std::move(mapping), mapped);
+                    if (swap)
+                        volumeData->setLimits(limits);
+
+                    return volumeData;
+                }
+
+                std::array<size_t, 3> subsetMin = volumeConfig.getSubsetMin();
+                std::array<size_t, 3> subsetMax = volumeConfig.getSubsetMax();
+                size_t first = sizeof(T) * (
+                    subsetMin[0] +
+                    subsetMin[1] * origDim[0] +
+                    subsetMin[2] * origDim[0] * origDim[1]);
+                size_t last = sizeof(T) * (
+                    subsetMax[0] +
+                    subsetMax[1] * origDim[0] +
+                    subsetMax[2] * origDim[0] * origDim[1] + 1);
+
+                mapping->advise(advice, offset + first, last - first);
+
+                rawData = new T[volumeConfig.getVoxelCount()];
+                extractSubset3dCuboid<T>(
+                    mapped, rawData, origDim, subsetMin, subsetMax);
+
+                std::tuple<float, float> limits(0.f, 0.f);
+                processValues(
+                    rawData, volumeConfig.getVoxelCount(), swap, limits);
+
+                std::unique_ptr<VolumeDataBase> volumeData =
+                    std::make_unique<VolumeData<T>>(volumeConfig, rawData);
+                volumeData->setLimits(limits);
+
+                return volumeData;
+            }
+
+            std::cerr << "Warning: could not map " << path <<
+                ", falling back to reading the file." << std::endl;
+        }
+
+        // the limits are determined while the data is read
+        std::tuple<float, float> limits(0.f, 0.f);
+        std::unique_ptr<VolumeDataBase> volumeData = nullptr;
+
+        rawData = new T[volumeConfig.getVoxelCount()];
+        if (!volumeConfig.getSubset())
+        {
+            loadRawFused<T>(
+                path,
+                rawData,
+                volumeConfig.getVoxelCount(),
+                swap,
+                limits,
+                offset);
+        }
+        else
+        {
+            readSubset3dCuboid<T>(
+                path,
+                rawData,
+                origDim,
+                volumeConfig.getSubsetMin(),
+                volumeConfig.getSubsetMax(),
+                swap,
+                &limits,
+                offset);
+        }
+
+        volumeData = std::make_unique<VolumeData<T>>(volumeConfig, rawData);
+        volumeData->setLimits(limits);
+
+        return volumeData;
+    }
+}
@@ -0,0 +1,178 @@
+#include <cmath>
+#include <algorithm>
+
+#include "gradient.hpp"
+
+//-----------------------------------------------------------------------------
+// GradientVolume Class Implementations
+//-----------------------------------------------------------------------------
+cr::GradientVolume::GradientVolume() :
+    m_volumeDim{ {0, 0, 0} },
+    m_data()
+{
+}
+
+cr::GradientVolume cr::GradientVolume::compute(
+    const VolumeDataBase &volumeData,
+    GradientOperator op)
+{
+    GradientVolume gradients;
+    void *values = volumeData.getRawData();
+
+    if (nullptr == values)
+        return gradients;
+
+    gradients.m_volumeDim = volumeData.getVolumeConfig().getVolumeDim();
+
+    switch(volumeData.getVolumeConfig().getVoxelType())
+    {
+        case Datatype::unsigned_byte:
+            gradients.computeT(static_cast<unsigned_byte_t*>(values), op);
+            break;
+
+        case Datatype::signed_byte:
+            gradients.computeT(static_cast<signed_byte_t*>(values), op);
+            break;
+
+        case Datatype::unsigned_halfword:
+            gradients.computeT(
+                static_cast<unsigned_halfword_t*>(values), op);
+            break;
+
+        case Datatype::signed_halfword:
+            gradients.computeT(static_cast<signed_halfword_t*>(values), op);
+            break;
+
+        case Datatype::unsigned_word:
+            gradients.computeT(static_cast<unsigned_word_t*>(values), op);
+            break;
+
+        case Datatype::signed_word:
+            gradients.computeT(static_cast<signed_word_t*>(values), op);
+            break;
+
+        case Datatype::unsigned_longword:
+            gradients.computeT(
+                static_cast<unsigned_longword_t*>(values), op);
+            break;
+
+        case Datatype::signed_longword:
+            gradients.computeT(
+                static_cast<signed_longword_t*>(values), op);
+            break;
+
+        case Datatype::single_precision_float:
+            gradients.computeT(
+                static_cast<single_precision_float_t*>(values), op);
+            break;
+
+        case Datatype::double_precision_float:
+            gradients.computeT(
+                static_cast<double_precision_float_t*>(values), op);
+            break;
+
+        default:
+            break;
+    }
+
+    return gradients;
+}
+
+namespace
+{
+    /**
+     * Stores a gradient as (g / |g| * 0.5 + 0.5) * 255 rounded. Zero and
+     * non-finite gradients are stored as 128, the encoding of no gradient.
+     */
+    inline void encodeGradient(float gx, float gy, float gz, uint8_t *out)
+    {
+        float g[3] = {gx, gy, gz};
+        float len = std::sqrt(gx * gx + gy * gy + gz * gz);
+        float s = 127.5f / len;
+
+        if (!std::isfinite(len) || !std::isfinite(s))
+        {
+            out[0] = out[1] = out[2] = 128;
+            return;
+        }
+
+        // g * s lies in [-127.5, 127.5], the clamp only catches rounding
+        for (size_t i = 0; i < 3; ++i)
+            out[i] = static_cast<uint8_t>(std::floor(
+                std::min(std::max(0.f, g[i] * s + 128.f), 255.f)));
+    }
+}
+
+/**
+ * Each thread works on whole rows. The neighbouring rows are addressed via
+ * pointers and the neighbouring columns via precomputed (border clamped)
+ * indices. The operator is selected once per row, so the loops over x only
+ * contain the stencil and the encoding.
+ */
+template<typename T>
+void cr::GradientVolume::computeT(const T *values, GradientOperator op)
+{
+    const std::array<size_t, 3> &dim = m_volumeDim;
+    size_t numRows = dim[1] * dim[2];
+    std::vector<size_t> xm(dim[0]), xp(dim[0]);
+
+    m_data.assign(dim[0] * dim[1] * dim[2] * 3, 0);
+
+    for (size_t x = 0; x < dim[0]; ++x)
+    {
+        xm[x] = (x > 0) ? x - 1 : 0;
+        xp[x] = std::min(x + 1, dim[0] - 1);
+    }
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t row = 0; row < numRows; ++row)
+    {
+        size_t y = row % dim[1];
+        size_t z = row / dim[1];
+        size_t yy[3] = {(y > 0) ? y - 1 : 0, y, std::min(y + 1, dim[1] - 1)};
+        size_t zz[3] = {(z > 0) ? z - 1 : 0, z, std::min(z + 1, dim[2] - 1)};
+        const float w[3] = {1.f, 2.f, 1.f};   //!< sobel smoothing weights
+        const T *r[3][3];                       //!< neighbouring rows [z][y]
+        uint8_t *out = m_data.data() + row * dim[0] * 3;
+
+        for (size_t k = 0; k < 3; ++k)
+            for (size_t j = 0; j < 3; ++j)
+                r[k][j] = values + (yy[j] + zz[k] * dim[1]) * dim[0];
+
+        if (GradientOperator::sobel == op)
+        {
+            for (size_t x = 0; x < dim[0]; ++x)
+            {
+                size_t xx[3] = {xm[x], x, xp[x]};
+                float gx = 0.f, gy = 0.f, gz = 0.f;
+
+                for (size_t a = 0; a < 3; ++a)
+                for (size_t b = 0; b < 3; ++b)
+                {
+                    float wab = w[a] * w[b];
+                    gx += wab * (static_cast<float>(r[a][b][xx[2]]) -
+                        static_cast<float>(r[a][b][xx[0]]));
+                    gy += wab * (static_cast<float>(r[a][2][xx[b]]) -
+                        static_cast<float>(r[a][0][xx[b]]));
+                    gz += wab * (static_cast<float>(r[2][a][xx[b]]) -
+                        static_cast<float>(r[0][a][xx[b]]));
+                }
+                encodeGradient(gx, gy, gz, out + 3 * x);
+            }
+        }
+        else
+        {
+            for (size_t x = 0; x < dim[0]; ++x)
+            {
+                float gx = static_cast<float>(r[1][1][xp[x]]) -
+                    static_cast<float>(r[1][1][xm[x]]);
+                float gy = static_cast<float>(r[1][2][x]) -
+                    static_cast<float>(r[1][0][x]);
+                float gz = static_cast<float>(r[2][1][x]) -
+                    static_cast<float>(r[0][1][x]);
+
+                encodeGradient(gx, gy, gz, out + 3 * x);
+            }
+        }
+    }
+}
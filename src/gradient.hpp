@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+#include "configraw.hpp"
+
+namespace cr
+{
+    // ------------------------------------------------------------------------
+    // type definitions
+    // ------------------------------------------------------------------------
+    enum class GradientOperator : int
+    {
+        central_differences = 0,    //!< 6 neighbours
+        sobel                       //!< 26 neighbours, smoother normals
+    };
+
+    // ------------------------------------------------------------------------
+    // class declarations
+    // ------------------------------------------------------------------------
+    /**
+     * \brief normalized gradients of a volume quantized to three bytes per
+     *        voxel
+     *
+     * Component c of a gradient g is stored as (g_c * 0.5 + 0.5) * 255
+     * rounded to the nearest integer, so the data can be uploaded as an RGB8
+     * texture and decoded in a shader with rgb * 2 - 1 to within 1/255. The
+     * gradients are computed in voxel space and point towards higher values;
+     * voxels without a gradient are stored as (128, 128, 128), which decodes
+     * to a vector of length 0.007 instead of a direction.
+     */
+    class GradientVolume
+    {
+        public:
+        GradientVolume();
+
+        /**
+         * \brief computes the gradients of in core volume data
+         *
+         * \return an invalid gradient volume if the data is not in memory
+         */
+        static GradientVolume compute(
+            const VolumeDataBase &volumeData,
+            GradientOperator op = GradientOperator::sobel);
+
+        bool isValid() const { return !m_data.empty(); }
+        std::array<size_t, 3> getVolumeDim() const { return m_volumeDim; }
+        const std::vector<uint8_t>& getData() const { return m_data; }
+        size_t getMemorySize() const { return m_data.size(); }
+
+        private:
+        template<typename T>
+        void computeT(const T *values, GradientOperator op);
+
+        std::array<size_t, 3> m_volumeDim;
+        std::vector<uint8_t> m_data;
+    };
+}
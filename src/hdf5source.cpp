@@ -0,0 +1,571 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <array>
+#include <tuple>
+#include <algorithm>
+#include <cstring>
+
+#include <boost/regex.hpp>
+
+#ifdef MVR_WITH_HDF5
+#include <hdf5.h>
+#include <zlib.h>
+#endif
+
+#include "configraw.hpp"
+
+#ifdef MVR_WITH_HDF5
+//-----------------------------------------------------------------------------
+// internal helpers
+//-----------------------------------------------------------------------------
+namespace
+{
+    /**
+     * \brief closes an HDF5 identifier when leaving the scope
+     */
+    class Handle
+    {
+        public:
+        Handle(hid_t id, herr_t (*close)(hid_t)) : m_id(id), m_close(close)
+        {
+        }
+        Handle(const Handle& other) = delete;
+        Handle& operator=(const Handle& other) = delete;
+        ~Handle() { if (0 <= m_id) m_close(m_id); }
+
+        bool isValid() const { return 0 <= m_id; }
+        operator hid_t() const { return m_id; }
+
+        private:
+        hid_t m_id;
+        herr_t (*m_close)(hid_t);
+    };
+
+    /**
+     * \brief HDF5 memory type of a voxel type
+     */
+    hid_t getNativeType(cr::Datatype type)
+    {
+        switch(type)
+        {
+            case cr::Datatype::unsigned_byte: return H5T_NATIVE_UINT8;
+            case cr::Datatype::signed_byte: return H5T_NATIVE_INT8;
+            case cr::Datatype::unsigned_halfword: return H5T_NATIVE_UINT16;
+            case cr::Datatype::signed_halfword: return H5T_NATIVE_INT16;
+            case cr::Datatype::unsigned_word: return H5T_NATIVE_UINT32;
+            case cr::Datatype::signed_word: return H5T_NATIVE_INT32;
+            case cr::Datatype::unsigned_longword: return H5T_NATIVE_UINT64;
+            case cr::Datatype::signed_longword: return H5T_NATIVE_INT64;
+            case cr::Datatype::single_precision_float:
+                return H5T_NATIVE_FLOAT;
+            case cr::Datatype::double_precision_float:
+                return H5T_NATIVE_DOUBLE;
+            default: return -1;
+        }
+    }
+
+    /**
+     * \brief filters of a chunked dataset that the direct chunk path knows
+     */
+    struct ChunkFilters
+    {
+        bool supported;
+        int deflate;    //!< position of the deflate filter, -1 if unused
+        int shuffle;    //!< position of the shuffle filter, -1 if unused
+    };
+
+    ChunkFilters getChunkFilters(hid_t dcpl)
+    {
+        ChunkFilters filters = {true, -1, -1};
+        int numFilters = H5Pget_nfilters(dcpl);
+
+        for (int i = 0; i < numFilters; ++i)
+        {
+            unsigned int flags = 0, config = 0;
+            size_t numValues = 0;
+            H5Z_filter_t filter = H5Pget_filter2(
+                dcpl, static_cast<unsigned>(i), &flags, &numValues, nullptr,
+                0, nullptr, &config);
+
+            if (H5Z_FILTER_DEFLATE == filter)
+                filters.deflate = i;
+            else if (H5Z_FILTER_SHUFFLE == filter)
+                filters.shuffle = i;
+            else
+                filters.supported = false;
+        }
+
+        // the shuffle has to be undone after inflating
+        if ((0 <= filters.shuffle) && (0 <= filters.deflate) &&
+                (filters.shuffle > filters.deflate))
+            filters.supported = false;
+
+        return filters;
+    }
+
+    /**
+     * \brief reverses the byte shuffle filter
+     */
+    void unshuffle(
+        const uint8_t *src, uint8_t *dst, size_t count, size_t valueSize)
+    {
+        for (size_t j = 0; j < valueSize; ++j)
+            for (size_t i = 0; i < count; ++i)
+                dst[i * valueSize + j] = src[j * count + i];
+    }
+
+    /**
+     * \brief reads the chunks of a dataset that intersect a region
+     *
+     * The raw chunks are fetched with H5Dread_chunk one at a time (the
+     * library serialises its calls anyway) while inflating, unshuffling,
+     * swapping and copying of the chunks runs on all threads. Chunks that
+     * were never written hold the fill value of the dataset.
+     *
+     * Note: HDF5 dimensions are ordered z, y, x.
+     */
+    template<typename T>
+    bool readChunks(
+        hid_t dataset,
+        hid_t dcpl,
+        hid_t memType,
+        const ChunkFilters &filters,
+        bool fileSwap,
+        bool swap,
+        T *buffer,
+        std::array<size_t, 3> subsetMin,
+        std::array<size_t, 3> subsetMax,
+        std::tuple<float, float> &limits)
+    {
+        hsize_t chunkDim[3] = {0, 0, 0};
+        T fill = static_cast<T>(0);
+        T minimum = static_cast<T>(0.0);
+        T maximum = static_cast<T>(1.0);
+        size_t invalid = 0;
+        bool success = true;
+
+        H5Pget_chunk(dcpl, 3, chunkDim);
+        H5Pget_fill_value(dcpl, memType, &fill);
+
+        // the fill value is native, the chunks are in the byte order of the
+        // file and are swapped like the chunks
+        if (fileSwap)
+            util::byteorder::swap(&fill, 1, sizeof(T));
+        swap = (swap != fileSwap);
+
+        // chunk dimensions in x, y, z order
+        const std::array<size_t, 3> chunk = {{
+            static_cast<size_t>(chunkDim[2]),
+            static_cast<size_t>(chunkDim[1]),
+            static_cast<size_t>(chunkDim[0])}};
+        const size_t chunkValues = chunk[0] * chunk[1] * chunk[2];
+        const size_t dimX = subsetMax[0] - subsetMin[0] + 1;
+        const size_t dimY = subsetMax[1] - subsetMin[1] + 1;
+        std::array<size_t, 3> first, count;
+        std::vector<std::array<size_t, 3>> origins;
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+            first[i] = subsetMin[i] / chunk[i];
+            count[i] = subsetMax[i] / chunk[i] - first[i] + 1;
+        }
+        for (size_t z = 0; z < count[2]; ++z)
+        for (size_t y = 0; y < count[1]; ++y)
+        for (size_t x = 0; x < count[0]; ++x)
+            origins.push_back({{
+                (first[0] + x) * chunk[0],
+                (first[1] + y) * chunk[1],
+                (first[2] + z) * chunk[2]}});
+
+        #pragma omp parallel
+        {
+            std::vector<uint8_t> raw, inflated, shuffled;
+            std::vector<T> values(chunkValues);
+
+            #pragma omp for schedule(dynamic) \
+                reduction(min: minimum) \
+                reduction(max: maximum) \
+                reduction(+: invalid) \
+                reduction(&&: success)
+            for (size_t c = 0; c < origins.size(); ++c)
+            {
+                const std::array<size_t, 3> &origin = origins[c];
+                hsize_t offset[3] = {origin[2], origin[1], origin[0]};
+                uint32_t filterMask = 0;
+                hsize_t size = 0;
+                haddr_t address = HADDR_UNDEF;
+                bool found = false, read = false;
+
+                #pragma omp critical(hdf5)
+                {
+                    unsigned mask = 0;
+                    found = (0 <= H5Dget_chunk_info_by_coord(
+                        dataset, offset, &mask, &address, &size));
+                    if (found && (HADDR_UNDEF != address))
+                    {
+                        raw.resize(size);
+                        read = (0 <= H5Dread_chunk(
+                            dataset, H5P_DEFAULT, offset, &filterMask,
+                            raw.data()));
+                    }
+                }
+
+                if (found && (HADDR_UNDEF == address))
+                {
+                    std::fill(values.begin(), values.end(), fill);
+                }
+                else if (!read)
+                {
+                    success = false;
+                    continue;
+                }
+                else
+                {
+                    const uint8_t *data = raw.data();
+                    size_t length = raw.size();
+
+                    // a set bit in the mask means the filter was skipped
+                    if ((0 <= filters.deflate) &&
+                        !(filterMask & (1u << filters.deflate)))
+                    {
+                        uLongf inflatedLength = chunkValues * sizeof(T);
+
+                        inflated.resize(inflatedLength);
+                        if (Z_OK != uncompress(
+                                inflated.data(), &inflatedLength,
+                                data, length))
+                        {
+                            success = false;
+                            continue;
+                        }
+                        data = inflated.data();
+                        length = inflatedLength;
+                    }
+
+                    if (length != chunkValues * sizeof(T))
+                    {
+                        success = false;
+                        continue;
+                    }
+
+                    if ((0 <= filters.shuffle) &&
+                        !(filterMask & (1u << filters.shuffle)))
+                    {
+                        shuffled.resize(length);
+                        unshuffle(data, shuffled.data(), chunkValues,
+                            sizeof(T));
+                        data = shuffled.data();
+                    }
+
+                    std::memcpy(values.data(), data, length);
+                }
+
+                // intersection of chunk and region
+                std::array<size_t, 3> lo, hi;
+                for (size_t j = 0; j < 3; ++j)
+                {
+                    lo[j] = std::max(origin[j], subsetMin[j]);
+                    hi[j] = std::min(origin[j] + chunk[j] - 1, subsetMax[j]);
+                }
+
+                for (size_t z = lo[2]; z <= hi[2]; ++z)
+                for (size_t y = lo[1]; y <= hi[1]; ++y)
+                {
+                    const T *src = values.data() +
+                        (lo[0] - origin[0]) +
+                        (y - origin[1]) * chunk[0] +
+                        (z - origin[2]) * chunk[0] * chunk[1];
+                    T *dst = buffer +
+                        (lo[0] - subsetMin[0]) +
+                        (y - subsetMin[1]) * dimX +
+                        (z - subsetMin[2]) * dimX * dimY;
+
+                    std::copy(src, src + (hi[0] - lo[0] + 1), dst);
+                    cr::processChunk(
+                        dst, hi[0] - lo[0] + 1, swap,
+                        minimum, maximum, invalid);
+                }
+            }
+        }
+
+        if (0 < invalid)
+            std::cerr << "Warning: the dataset contains " << invalid <<
+                " NaN or infinite values." << std::endl;
+
+        limits = std::tuple<float, float>(
+            static_cast<float>(minimum), static_cast<float>(maximum));
+
+        return success;
+    }
+
+    /**
+     * \brief reads a region of a dataset with a hyperslab selection
+     *
+     * Used for contiguous datasets and filters the direct chunk path does
+     * not know. The library converts the values into the native type.
+     */
+    template<typename T>
+    bool readHyperslab(
+        hid_t dataset,
+        hid_t memType,
+        bool swap,
+        T *buffer,
+        std::array<size_t, 3> subsetMin,
+        std::array<size_t, 3> subsetMax,
+        std::tuple<float, float> &limits)
+    {
+        hsize_t start[3] = {subsetMin[2], subsetMin[1], subsetMin[0]};
+        hsize_t count[3] = {
+            subsetMax[2] - subsetMin[2] + 1,
+            subsetMax[1] - subsetMin[1] + 1,
+            subsetMax[0] - subsetMin[0] + 1};
+        Handle fileSpace(H5Dget_space(dataset), H5Sclose);
+        Handle memSpace(H5Screate_simple(3, count, nullptr), H5Sclose);
+
+        if (!fileSpace.isValid() || !memSpace.isValid() ||
+            (0 > H5Sselect_hyperslab(
+                fileSpace, H5S_SELECT_SET, start, nullptr, count, nullptr)) ||
+            (0 > H5Dread(
+                dataset, memType, memSpace, fileSpace, H5P_DEFAULT, buffer)))
+            return false;
+
+        size_t invalid = cr::processValues(
+            buffer, count[0] * count[1] * count[2], swap, limits);
+        if (0 < invalid)
+            std::cerr << "Warning: the dataset contains " << invalid <<
+                " NaN or infinite values." << std::endl;
+
+        return true;
+    }
+
+    template<typename T>
+    bool loadHdf5Dataset(
+        hid_t dataset,
+        cr::Datatype type,
+        bool swap,
+        T *buffer,
+        std::array<size_t, 3> subsetMin,
+        std::array<size_t, 3> subsetMax,
+        std::tuple<float, float> &limits)
+    {
+        Handle dcpl(H5Dget_create_plist(dataset), H5Pclose);
+        Handle fileType(H5Dget_type(dataset), H5Tclose);
+        hid_t memType = getNativeType(type);
+
+        if (!dcpl.isValid() || !fileType.isValid())
+            return false;
+
+        // raw chunks can be used if they hold the values of the voxel type
+        if (H5D_CHUNKED == H5Pget_layout(dcpl))
+        {
+            ChunkFilters filters = getChunkFilters(dcpl);
+            H5T_order_t order = H5Tget_order(fileType);
+            bool bigEndianFile = (H5T_ORDER_BE == order);
+            bool fileSwap = (bigEndianFile ==
+                util::byteorder::isLittleEndianHost());
+
+            if (filters.supported &&
+                (H5Tget_class(fileType) == H5Tget_class(memType)) &&
+                (H5Tget_size(fileType) == sizeof(T)) &&
+                ((H5T_INTEGER != H5Tget_class(fileType)) ||
+                    (H5Tget_sign(fileType) == H5Tget_sign(memType))))
+                return readChunks(
+                    dataset, dcpl, memType, filters, fileSwap, swap, buffer,
+                    subsetMin, subsetMax, limits);
+        }
+
+        return readHyperslab(
+            dataset, memType, swap, buffer, subsetMin, subsetMax, limits);
+    }
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// HDF5 source functions
+//-----------------------------------------------------------------------------
+/**
+ * \brief names of the datasets inside a group that match an expression
+ *
+ * \param path path of the HDF5 file
+ * \param group path of the group inside the file
+ * \param exp regular expression for the dataset names
+ *
+ * \return sorted full paths of the matching datasets
+ */
+std::vector<std::string> cr::findHdf5Datasets(
+    const std::string &path,
+    const std::string &group,
+    const std::string &exp)
+{
+    std::vector<std::string> datasets;
+
+#ifdef MVR_WITH_HDF5
+    Handle file(H5Fopen(path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose);
+    boost::regex regex(exp);
+    hsize_t numObjects = 0;
+
+    if (!file.isValid())
+    {
+        std::cerr << "Error while reading " << path << ": no HDF5 file" <<
+            std::endl;
+        return datasets;
+    }
+
+    Handle groupId(H5Gopen2(file, group.c_str(), H5P_DEFAULT), H5Gclose);
+    if (!groupId.isValid() || (0 > H5Gget_num_objs(groupId, &numObjects)))
+    {
+        std::cerr << "Error while reading " << path << ": no group " <<
+            group << std::endl;
+        return datasets;
+    }
+
+    std::string prefix = ('/' == group.back()) ? group : group + "/";
+    for (hsize_t i = 0; i < numObjects; ++i)
+    {
+        std::vector<char> name(
+            static_cast<size_t>(H5Gget_objname_by_idx(
+                groupId, i, nullptr, 0)) + 1);
+
+        H5Gget_objname_by_idx(groupId, i, name.data(), name.size());
+        if ((H5G_DATASET == H5Gget_objtype_by_idx(groupId, i)) &&
+                boost::regex_match(std::string(name.data()), regex))
+            datasets.push_back(prefix + name.data());
+    }
+
+    std::sort(datasets.begin(), datasets.end());
+#else
+    (void) group;
+    (void) exp;
+    std::cerr << "Error while reading " << path << ": mvr was built " <<
+        "without HDF5 support (make HDF5=1)" << std::endl;
+#endif
+
+    return datasets;
+}
+
+/**
+ * \brief loads the n-th timestep of a volume dataset in HDF5 files
+ *
+ * \param volumeConfig configuration object of the volume dataset
+ * \param n number of the requested timestep (starting from 0)
+ * \param buffer memory for the voxels of the (subset of the) volume
+ * \param swap flag if the byte order of the data shall be swapped
+ * \param limits Out: lowest and highest loaded value
+ *
+ * \return true if the data could be loaded
+ *
+ * The timestep is the dataset getTimestepDataset(n) in the file
+ * getTimestepFile(n). The subset is read as hyperslab; chunked datasets
+ * without filters or with deflate and shuffle are read chunk by chunk and
+ * decoded in parallel.
+ */
+bool cr::loadHdf5Timestep(
+    const VolumeConfig &volumeConfig,
+    unsigned int n,
+    void *buffer,
+    bool swap,
+    std::tuple<float, float> &limits)
+{
+    std::string path = volumeConfig.getTimestepFile(n);
+    std::string name = volumeConfig.getTimestepDataset(n);
+
+#ifdef MVR_WITH_HDF5
+    std::array<size_t, 3> dim = volumeConfig.getOrigVolumeDim();
+    std::array<size_t, 3> subsetMin = volumeConfig.getSubsetMin();
+    std::array<size_t, 3> subsetMax = volumeConfig.getSubsetMax();
+    hsize_t datasetDim[3] = {0, 0, 0};
+
+    Handle file(H5Fopen(path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT), H5Fclose);
+    if (!file.isValid())
+    {
+        std::cerr << "Error while loading HDF5 data: cannot open " <<
+            path << std::endl;
+        return false;
+    }
+
+    Handle dataset(H5Dopen2(file, name.c_str(), H5P_DEFAULT), H5Dclose);
+    if (!dataset.isValid())
+    {
+        std::cerr << "Error while loading HDF5 data: no dataset " <<
+            name << " in " << path << std::endl;
+        return false;
+    }
+
+    Handle space(H5Dget_space(dataset), H5Sclose);
+    if (!space.isValid() || (3 != H5Sget_simple_extent_ndims(space)) ||
+        (0 > H5Sget_simple_extent_dims(space, datasetDim, nullptr)) ||
+        (datasetDim[0] != dim[2]) || (datasetDim[1] != dim[1]) ||
+        (datasetDim[2] != dim[0]))
+    {
+        std::cerr << "Error while loading HDF5 data: " << name << " in " <<
+            path << " does not match the volume description" << std::endl;
+        return false;
+    }
+
+    switch(volumeConfig.getVoxelType())
+    {
+        case Datatype::unsigned_byte:
+            return loadHdf5Dataset(dataset, volumeConfig.getVoxelType(),
+                swap, static_cast<unsigned_byte_t*>(buffer),
+                subsetMin, subsetMax, limits);
+
+        case Datatype::signed_byte:
+            return loadHdf5Dataset(dataset, volumeConfig.getVoxelType(),
+                swap, static_cast<signed_byte_t*>(buffer),
+                subsetMin, subsetMax, limits);
+
+        case Datatype::unsigned_halfword:
+            return loadHdf5Dataset(dataset, volumeConfig.getVoxelType(),
+                swap, static_cast<unsigned_halfword_t*>(buffer),
+                subsetMin, subsetMax, limits);
+
+        case Datatype::signed_halfword:
+            return loadHdf5Dataset(dataset, volumeConfig.getVoxelType(),
+                swap, static_cast<signed_halfword_t*>(buffer),
+                subsetMin, subsetMax, limits);
+
+        case Datatype::unsigned_word:
+            return loadHdf5Dataset(dataset, volumeConfig.getVoxelType(),
+                swap, static_cast<unsigned_word_t*>(buffer),
+                subsetMin, subsetMax, limits);
+
+        case Datatype::signed_word:
+            return loadHdf5Dataset(dataset, volumeConfig.getVoxelType(),
+                swap, static_cast<signed_word_t*>(buffer),
+                subsetMin, subsetMax, limits);
+
+        case Datatype::unsigned_longword:
+            return loadHdf5Dataset(dataset, volumeConfig.getVoxelType(),
+                swap, static_cast<unsigned_longword_t*>(buffer),
+                subsetMin, subsetMax, limits);
+
+        case Datatype::signed_longword:
+            return loadHdf5Dataset(dataset, volumeConfig.getVoxelType(),
+                swap, static_cast<signed_longword_t*>(buffer),
+                subsetMin, subsetMax, limits);
+
+        case Datatype::single_precision_float:
+            return loadHdf5Dataset(dataset, volumeConfig.getVoxelType(),
+                swap, static_cast<single_precision_float_t*>(buffer),
+                subsetMin, subsetMax, limits);
+
+        case Datatype::double_precision_float:
+            return loadHdf5Dataset(dataset, volumeConfig.getVoxelType(),
+                swap, static_cast<double_precision_float_t*>(buffer),
+                subsetMin, subsetMax, limits);
+
+        default:
+            break;
+    }
+
+    return false;
+#else
+    (void) buffer;
+    (void) swap;
+    (void) limits;
+    std::cerr << "Error while loading " << name << " from " << path <<
+        ": mvr was built without HDF5 support (make HDF5=1)" << std::endl;
+    return false;
+#endif
+}
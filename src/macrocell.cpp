@@ -0,0 +1,140 @@
+#include <limits>
+#include <algorithm>
+
+#include "macrocell.hpp"
+
+//-----------------------------------------------------------------------------
+// MacrocellGrid Class Implementations
+//-----------------------------------------------------------------------------
+cr::MacrocellGrid::MacrocellGrid() :
+    m_cellSize(DEFAULT_MACROCELL_SIZE),
+    m_cellCount{ {0, 0, 0} },
+    m_volumeDim{ {0, 0, 0} },
+    m_min(),
+    m_max()
+{
+}
+
+cr::MacrocellGrid cr::MacrocellGrid::compute(
+    const VolumeDataBase &volumeData,
+    size_t cellSize)
+{
+    MacrocellGrid grid;
+    void *values = volumeData.getRawData();
+
+    if (nullptr == values)
+        return grid;
+
+    grid.m_cellSize = std::max(cellSize, size_t(1));
+    grid.m_volumeDim = volumeData.getVolumeConfig().getVolumeDim();
+    for (size_t i = 0; i < 3; ++i)
+        grid.m_cellCount[i] =
+            (grid.m_volumeDim[i] + grid.m_cellSize - 1) / grid.m_cellSize;
+
+    switch(volumeData.getVolumeConfig().getVoxelType())
+    {
+        case Datatype::unsigned_byte:
+            grid.computeT(static_cast<unsigned_byte_t*>(values));
+            break;
+
+        case Datatype::signed_byte:
+            grid.computeT(static_cast<signed_byte_t*>(values));
+            break;
+
+        case Datatype::unsigned_halfword:
+            grid.computeT(static_cast<unsigned_halfword_t*>(values));
+            break;
+
+        case Datatype::signed_halfword:
+            grid.computeT(static_cast<signed_halfword_t*>(values));
+            break;
+
+        case Datatype::unsigned_word:
+            grid.computeT(static_cast<unsigned_word_t*>(values));
+            break;
+
+        case Datatype::signed_word:
+            grid.computeT(static_cast<signed_word_t*>(values));
+            break;
+
+        case Datatype::unsigned_longword:
+            grid.computeT(static_cast<unsigned_longword_t*>(values));
+            break;
+
+        case Datatype::signed_longword:
+            grid.computeT(static_cast<signed_longword_t*>(values));
+            break;
+
+        case Datatype::single_precision_float:
+            grid.computeT(static_cast<single_precision_float_t*>(values));
+            break;
+
+        case Datatype::double_precision_float:
+            grid.computeT(static_cast<double_precision_float_t*>(values));
+            break;
+
+        default:
+            break;
+    }
+
+    return grid;
+}
+
+/**
+ * The ranges are computed over the voxels of a cell and one voxel around it,
+ * which are all voxels that a linearly interpolated sample inside the cell
+ * depends on.
+ */
+template<typename T>
+void cr::MacrocellGrid::computeT(const T *values)
+{
+    const std::array<size_t, 3> &dim = m_volumeDim;
+    size_t numCells = m_cellCount[0] * m_cellCount[1] * m_cellCount[2];
+
+    m_min.assign(numCells, 0.f);
+    m_max.assign(numCells, 0.f);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t id = 0; id < numCells; ++id)
+    {
+        std::array<size_t, 3> cell = {{
+            id % m_cellCount[0],
+            (id / m_cellCount[0]) % m_cellCount[1],
+            id / (m_cellCount[0] * m_cellCount[1])}};
+        std::array<size_t, 3> lo, hi;
+        T minimum = std::numeric_limits<T>::max();
+        T maximum = std::numeric_limits<T>::lowest();
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+            lo[i] = cell[i] * m_cellSize;
+            lo[i] = (lo[i] > 0) ? lo[i] - 1 : 0;
+            hi[i] = std::min((cell[i] + 1) * m_cellSize + 1, dim[i]);
+        }
+
+        for (size_t z = lo[2]; z < hi[2]; ++z)
+        for (size_t y = lo[1]; y < hi[1]; ++y)
+        for (size_t x = lo[0]; x < hi[0]; ++x)
+        {
+            T val = values[x + (y + z * dim[1]) * dim[0]];
+            if (val < minimum) minimum = val;
+            if (val > maximum) maximum = val;
+        }
+
+        m_min[id] = static_cast<float>(minimum);
+        m_max[id] = static_cast<float>(maximum);
+    }
+}
+
+std::vector<uint8_t> cr::MacrocellGrid::computeVisibility(
+    const std::function<bool(float, float)> &isVisible) const
+{
+    std::vector<uint8_t> mask(m_min.size(), 0);
+
+    #pragma omp parallel for
+    for (size_t id = 0; id < mask.size(); ++id)
+        if (isVisible(m_min[id], m_max[id]))
+            mask[id] = 255;
+
+    return mask;
+}
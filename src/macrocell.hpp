@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+#include "configraw.hpp"
+
+namespace cr
+{
+    // ------------------------------------------------------------------------
+    // constants
+    // ------------------------------------------------------------------------
+    constexpr size_t DEFAULT_MACROCELL_SIZE = 8;
+
+    // ------------------------------------------------------------------------
+    // class declarations
+    // ------------------------------------------------------------------------
+    /**
+     * \brief value ranges of the blocks (macrocells) of a volume
+     *
+     * Cell (i, j, k) covers the voxels [i, i + 1) * cellSize along x etc.
+     * The range of a cell includes the neighbouring voxels, so it bounds all
+     * values that can be interpolated linearly at positions inside the
+     * cell. Cells whose whole range is invisible can thus be skipped by the
+     * ray marcher without changing the image.
+     */
+    class MacrocellGrid
+    {
+        public:
+        MacrocellGrid();
+
+        /**
+         * \brief computes the value ranges of in core volume data
+         *
+         * \return an invalid grid if the data is not in memory
+         */
+        static MacrocellGrid compute(
+            const VolumeDataBase &volumeData,
+            size_t cellSize = DEFAULT_MACROCELL_SIZE);
+
+        bool isValid() const { return !m_min.empty(); }
+        size_t getCellSize() const { return m_cellSize; }
+        std::array<size_t, 3> getCellCount() const { return m_cellCount; }
+        std::array<size_t, 3> getVolumeDim() const { return m_volumeDim; }
+        const std::vector<float>& getMin() const { return m_min; }
+        const std::vector<float>& getMax() const { return m_max; }
+
+        /**
+         * \brief visibility mask with one byte per cell (0 or 255)
+         *
+         * \param isVisible tells if any value of a range [min, max] is
+         *                  visible
+         */
+        std::vector<uint8_t> computeVisibility(
+            const std::function<bool(float, float)> &isVisible) const;
+
+        private:
+        template<typename T>
+        void computeT(const T *values);
+
+        size_t m_cellSize;
+        std::array<size_t, 3> m_cellCount;
+        std::array<size_t, 3> m_volumeDim;
+        std::vector<float> m_min;
+        std::vector<float> m_max;
+    };
+}
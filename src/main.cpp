@@ -4,6 +4,10 @@
 namespace po = boost::program_options;
 
 #include "mvr.hpp"
+#include "benchmark.hpp"
+#include "bricked.hpp"
+#include "compressed.hpp"
+#include "pyramid.hpp"
 
 //-----------------------------------------------------------------------------
 // function prototypes
@@ -12,7 +16,8 @@ int applyProgramOptions(
     int argc,
     char *argv[],
     mvr::Renderer &renderer,
-    std::string &output);
+    std::string &output,
+    bool &allTimesteps);
 
 //-----------------------------------------------------------------------------
 // main program
@@ -22,8 +27,9 @@ int main(int argc, char *argv[])
     int ret = EXIT_SUCCESS;
     mvr::Renderer renderer;
     std::string output = "";
+    bool allTimesteps = false;
 
-    ret = applyProgramOptions(argc, argv, renderer, output);
+    ret = applyProgramOptions(argc, argv, renderer, output, allTimesteps);
     if (EXIT_SUCCESS != ret)
     {
         std::cout <<
@@ -35,7 +41,12 @@ int main(int argc, char *argv[])
         ret = renderer.run();
     else
     {
-        ret = renderer.renderToFile(output);
+        if (allTimesteps)
+            ret = renderer.renderTimeSeriesToFiles(output);
+        else
+            ret = renderer.renderToFile(output);
+        if (EXIT_SUCCESS == ret)
+            ret = renderer.flushOutputFiles();
         if (EXIT_SUCCESS == ret)
             std::cout << "Successfully rendered to " << output << std::endl;
         else
@@ -59,15 +70,38 @@ int applyProgramOptions(
         int argc,
         char *argv[],
         mvr::Renderer& renderer,
-        std::string& output)
+        std::string& output,
+        bool& allTimesteps)
 {
     // Declare the supported options
     po::options_description desc("Allowed options");
     desc.add_options()
         ("help,h", "produce help message")
-        ("volume,v", po::value<std::string>(), "volume description file")
+        ("volume,v", po::value<std::string>(),
+            "volume description file (json, nrrd, nhdr, mhd, mha or vtk)")
         ("config,c", po::value<std::string>(), "renderer configuration file")
         ("output-file,o", po::value<std::string>(), "batch mode output file")
+        ("all-timesteps",
+            "render every timestep in batch mode into numbered output files")
+        ("benchmark,b", po::value<std::string>(),
+            "run a benchmark on the given volume and exit "
+            "(subset, histogram, bswap)")
+        ("convert-bricked", po::value<std::string>(),
+            "convert the volume into bricked files in the given directory "
+            "and exit")
+        ("brick-size", po::value<unsigned int>()->default_value(
+            cr::DEFAULT_BRICK_SIZE), "edge length of the bricks in voxels")
+        ("convert-compressed", po::value<std::string>(),
+            "convert the volume into block compressed files in the given "
+            "directory and exit")
+        ("compression-level", po::value<int>()->default_value(
+            cr::DEFAULT_COMPRESSION_LEVEL),
+            "zlib compression level (1 fastest, 9 smallest)")
+        ("build-pyramid",
+            "build the levels of detail of the volume next to the data and "
+            "exit")
+        ("pyramid-filter", po::value<std::string>()->default_value(
+            "average"), "downsampling filter of the levels (average, max)")
     ;
 
     int ret = EXIT_SUCCESS;
@@ -84,6 +118,65 @@ int applyProgramOptions(
             exit(EXIT_SUCCESS);
         }
 
+        // benchmarks work on the volume data only and need no renderer
+        if (vm.count("benchmark"))
+        {
+            if (!vm.count("volume"))
+            {
+                std::cout << "Error: a benchmark requires a volume." <<
+                    std::endl;
+                return EXIT_FAILURE;
+            }
+            exit(bench::runBenchmark(
+                vm["benchmark"].as<std::string>(),
+                vm["volume"].as<std::string>()));
+        }
+
+        if (vm.count("convert-bricked"))
+        {
+            if (!vm.count("volume"))
+            {
+                std::cout << "Error: a conversion requires a volume." <<
+                    std::endl;
+                return EXIT_FAILURE;
+            }
+            exit(cr::convertToBricked(
+                vm["volume"].as<std::string>(),
+                vm["convert-bricked"].as<std::string>(),
+                vm["brick-size"].as<unsigned int>()));
+        }
+
+        if (vm.count("convert-compressed"))
+        {
+            if (!vm.count("volume"))
+            {
+                std::cout << "Error: a conversion requires a volume." <<
+                    std::endl;
+                return EXIT_FAILURE;
+            }
+            exit(cr::convertToCompressed(
+                vm["volume"].as<std::string>(),
+                vm["convert-compressed"].as<std::string>(),
+                vm["compression-level"].as<int>()));
+        }
+
+        if (vm.count("build-pyramid"))
+        {
+            std::string filter = vm["pyramid-filter"].as<std::string>();
+
+            if (!vm.count("volume") ||
+                (("average" != filter) && ("max" != filter)))
+            {
+                std::cout << "Error: building levels of detail requires a "
+                    "volume and an average or max filter." << std::endl;
+                return EXIT_FAILURE;
+            }
+            exit(cr::buildPyramid(
+                vm["volume"].as<std::string>(),
+                ("max" == filter) ?
+                    cr::PyramidFilter::maximum : cr::PyramidFilter::average));
+        }
+
         // if we the program is started in batch rendering mode, initialize
         // the renderer with an invisible window
         if (vm.count("output-file"))
@@ -130,6 +223,7 @@ int applyProgramOptions(
 
         if (vm.count("output-file"))
             output = vm["output-file"].as<std::string>();
+        allTimesteps = (0 != vm.count("all-timesteps"));
 
     }
     catch(std::exception &e)
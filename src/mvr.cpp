@@ -12,6 +12,8 @@
 #include <ctime>
 #include <utility>
 #include <memory>
+#include <chrono>
+#include <limits>
 
 #include <GL/gl3w.h>
 #include <GLFW/glfw3.h>
@@ -28,12 +30,22 @@
 
 #include <FreeImage.h>
 
+#include <boost/filesystem.hpp>
+namespace bfs = boost::filesystem;
+
 #include <json.hpp>
 using json = nlohmann::json;
 
 #include "shader.hpp"
+#include "shadersources.hpp"
 #include "util/util.hpp"
 #include "configraw.hpp"
+#include "prefetch.hpp"
+#include "statistics.hpp"
+#include "quantize.hpp"
+#include "paged.hpp"
+#include "macrocell.hpp"
+#include "gradient.hpp"
 
 //-----------------------------------------------------------------------------
 // definition of static member variables
@@ -73,10 +85,33 @@ mvr::Renderer::Renderer() :
     m_volumeDescriptionFile(mvr::Renderer::DEFAULT_VOLUME_FILE),
     m_timestep(0),
     m_outputDataZSlice(0.f),
+    // time series playback and prefetching
+    m_playback(false),
+    m_prefetchTimesteps(4),
+    m_prefetchMemoryBudget(4096),
+    m_streamUploads(true),
+    m_streamSlabSize(16),
+    // level of detail selection
+    m_lodMemoryBudget(2048),
+    // conversion of the volume data for the GPU
+    m_textureFormat(cr::TextureFormat::native),
+    m_textureWindow(cr::ValueWindow::limits),
+    m_textureWindowRange{ {0.f, 255.f} },
+    m_texturePercentiles{ {0.5f, 99.5f} },
+    m_brickAtlas(false),
+    m_pagedRegionOrigin{ {0, 0, 0} },
+    m_pagedRegionSize{ {
+        DEFAULT_PAGED_REGION_SIZE,
+        DEFAULT_PAGED_REGION_SIZE,
+        DEFAULT_PAGED_REGION_SIZE} },
     // ray casting
     m_stepSize(0.25f),
     m_emptySpaceSkipping(true),
+    m_skippingMethod(mvr::Skipping::macrocells),
     m_gradientMethod(mvr::Gradient::sobel_operators),
+    m_precomputedGradients(false),
+    m_preIntegration(false),
+    m_shaderVariants(true),
     // camera settings
     m_fovY(45.f),
     m_zNear(0.000001f),
@@ -87,6 +122,20 @@ mvr::Renderer::Renderer() :
     m_cameraRotationSpeed(0.2f),
     m_cameraTranslationSpeed(0.002f),
     m_projection(mvr::Projection::perspective),
+    // reduced resolution while the camera or transfer function changes
+    m_adaptiveResolution(true),
+    m_targetFrameTime(16.f),
+    m_minRenderScale(0.25f),
+    m_interactionIdleTime(0.3f),
+    m_interactionScale(0.5f),
+    m_renderScale(1.f),
+    m_renderedDimensions{ {1920, 1080} },
+    m_lastInteraction(-std::numeric_limits<double>::infinity()),
+    m_lastCameraPosition(mvr::Renderer::DEFAULT_CAMERA_POSITION),
+    m_lastCameraLookAt(mvr::Renderer::DEFAULT_CAMERA_LOOKAT),
+    m_lastFovY(45.f),
+    m_lastTfRevision(0),
+    m_screenshotFile(),
     // isosurface mode
     m_isovalue(127.5f),
     m_isovalueDenoising(true),
@@ -119,7 +168,20 @@ mvr::Renderer::Renderer() :
     m_shaderTfColor(),
     m_shaderTfFunc(),
     m_shaderTfPoint(),
+    m_volumeShaderVariants(),
+    m_volumeShaderTimes(),
+    m_volumeTimerQuery(0),
+    m_volumeTimerKey(0),
+    m_volumeTimerRunning(false),
+    m_volumeTimerPending(false),
+    m_volumeTimerScale(1.f),
+    m_volumeSettingsUbo(0),
+    m_volumeSettings(),
+    m_volumeSettingsDirty(true),
+    m_shaderSourcesFromDisk(false),
     m_framebuffers(),
+    m_asyncReadback(true),
+    m_readback(),
     m_tfColorWidgetFBO(),
     m_tfFuncWidgetFBO(),
     m_volumeFrame(false),
@@ -132,12 +194,30 @@ mvr::Renderer::Renderer() :
     m_volumeViewMx(1.f),
     m_volumeProjMx(1.f),
     m_quadProjMx(glm::ortho(-0.5f, 0.5f, -0.5f, 0.5f)),
-    m_histogramBins(0),
+    m_histogramBins(),
     m_transferFunction(),
     m_volumeData(nullptr),
     m_volumeDataMin(0.f),
     m_volumeDataMax(1.f),
+    m_volumeStatistics(),
     m_volumeTex(),
+    m_volumeTexFormat(cr::TextureFormat::native),
+    m_volumeTexScale(1.f),
+    m_volumeTexOffset(0.f),
+    m_volumeTexDim{ {0, 0, 0} },
+    m_volumeAtlas(),
+    m_volumeStream(),
+    m_pendingTimestep(),
+    m_pendingLevel(0),
+    m_prefetcher(),
+    m_pyramid(),
+    m_volumeLevel(0),
+    m_pyramidLoader(),
+    m_macrocells(),
+    m_macrocellTex(),
+    m_macrocellMaskKey(),
+    m_gradientTex(),
+    m_gradientStream(),
     m_randomSeedTex(),
     m_voxelDiagonal(1.f),
     m_showMenues(true),
@@ -150,6 +230,15 @@ mvr::Renderer::Renderer() :
 
 mvr::Renderer::~Renderer()
 {
+    // pending image files are written while the context is still current
+    if (m_isInitialized)
+        m_readback.flush();
+
+    if (0 != m_volumeTimerQuery)
+        glDeleteQueries(1, &m_volumeTimerQuery);
+    if (0 != m_volumeSettingsUbo)
+        glDeleteBuffers(1, &m_volumeSettingsUbo);
+
     if (nullptr != m_window)
         glfwDestroyWindow(m_window);
 
@@ -180,16 +269,12 @@ int mvr::Renderer::initialize(bool visible)
     //-------------------------------------------------------------------------
     // shader setup
     //-------------------------------------------------------------------------
-    m_shaderQuad = Shader("src/shader/quad.vert", "src/shader/quad.frag");
-    m_shaderFrame = Shader("src/shader/frame.vert", "src/shader/frame.frag");
-    m_shaderVolume =
-        Shader("src/shader/volume.vert", "src/shader/volume.frag");
-    m_shaderTfColor =
-        Shader("src/shader/tfColor.vert", "src/shader/tfColor.frag");
-    m_shaderTfFunc =
-        Shader("src/shader/tfFunc.vert", "src/shader/tfFunc.frag");
-    m_shaderTfPoint =
-        Shader("src/shader/tfPoint.vert", "src/shader/tfPoint.frag");
+    m_shaderQuad = loadShader("quad");
+    m_shaderFrame = loadShader("frame");
+    m_shaderVolume = buildVolumeShader();
+    m_shaderTfColor = loadShader("tfColor");
+    m_shaderTfFunc = loadShader("tfFunc");
+    m_shaderTfPoint = loadShader("tfPoint");
 
     //-------------------------------------------------------------------------
     // ping pong framebuffers and rendering targets
@@ -326,18 +411,50 @@ int mvr::Renderer::run()
         std::swap(ping, pong);
         glfwPollEvents();
 
+        // advance the time series during playback once the texture of the
+        // last timestep is complete
+        if (m_playback && !m_volumeStream.isActive())
+        {
+            unsigned int numTimesteps =
+                m_pyramid.getLevel(0).getNumTimesteps();
+            if (numTimesteps > 0)
+                loadVolume(
+                    m_pyramid.getLevel(0),
+                    (m_timestep + 1) % numTimesteps,
+                    true);
+        }
+        updateVolumeLevel();
+        updateVolumeStream();
+        m_readback.poll();
+        updateRenderScale();
+
         // --------------------------------------------------------------------
         // draw the volume, frame etc. into a frame buffer object
         // --------------------------------------------------------------------
-        // activate one of the framebuffer objects as rendering target
-        glViewport(0, 0, m_renderingDimensions[0], m_renderingDimensions[1]);
+        // activate one of the framebuffer objects as rendering target, while
+        // interacting only its lower left part is rendered
+        glViewport(0, 0, m_renderedDimensions[0], m_renderedDimensions[1]);
         m_framebuffers[ping].bind();
 
         // clear old buffer content
         glClearColor(m_clearColor[0], m_clearColor[1], m_clearColor[2], 1.f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        timeVolumePass(true);
         drawVolume(m_framebuffers[pong].accessTextures()[1]);
+        timeVolumePass(false);
+
+        // screenshots wait for a frame at full resolution
+        if (!m_screenshotFile.empty())
+        {
+            m_readback.capture(
+                m_framebuffers[ping],
+                m_renderingDimensions[0],
+                m_renderingDimensions[1],
+                m_screenshotFile,
+                FIF_TIFF);
+            m_screenshotFile.clear();
+        }
 
         // --------------------------------------------------------------------
         // show the rendering result as window filling quad in the default
@@ -363,6 +480,9 @@ int mvr::Renderer::run()
         m_shaderQuad.setFloat("volumeZ", m_outputDataZSlice);
 
         m_shaderQuad.setMat4("projMX", m_quadProjMx);
+        m_shaderQuad.setIVec2("renderSize",
+            static_cast<GLint>(m_renderedDimensions[0]),
+            static_cast<GLint>(m_renderedDimensions[1]));
         m_shaderQuad.setInt("texSelect", static_cast<int>(m_outputSelect));
 
         m_windowQuad.draw();
@@ -389,6 +509,7 @@ int mvr::Renderer::run()
         if (printOpenGLError())
             ret = EXIT_FAILURE;
     }
+    m_readback.flush();
 
     // Cleanup
     ImGui_ImplOpenGL3_Shutdown();
@@ -422,7 +543,10 @@ int mvr::Renderer::renderToFile(std::string path)
     // --------------------------------------------------------------------
     // draw the volume, frame etc. into a frame buffer object
     // --------------------------------------------------------------------
-    // activate one of the framebuffer objects as rendering target
+    // activate one of the framebuffer objects as rendering target, output
+    // files are always rendered at full resolution
+    m_renderScale = 1.f;
+    m_renderedDimensions = m_renderingDimensions;
     glViewport(0, 0, m_renderingDimensions[0], m_renderingDimensions[1]);
     m_framebuffers[ping].bind();
 
@@ -435,16 +559,79 @@ int mvr::Renderer::renderToFile(std::string path)
     if (printOpenGLError())
         ret = EXIT_FAILURE;
 
-    util::makeScreenshot(
-        m_framebuffers[ping],
-        m_renderingDimensions[0],
-        m_renderingDimensions[1],
-        path,
-        FIF_TIFF);
+    // the file is written while the next frame is rendered, call
+    // flushOutputFiles() before it is used
+    if (m_asyncReadback)
+        m_readback.capture(
+            m_framebuffers[ping],
+            m_renderingDimensions[0],
+            m_renderingDimensions[1],
+            path,
+            FIF_TIFF);
+    else
+        util::makeScreenshot(
+            m_framebuffers[ping],
+            m_renderingDimensions[0],
+            m_renderingDimensions[1],
+            path,
+            FIF_TIFF);
+
+    return ret;
+}
+
+/**
+ * The timesteps are numbered into the file name, e.g. out.tiff becomes
+ * out_0000.tiff, out_0001.tiff, ... The throughput is printed, which
+ * includes loading the data, rendering and saving the images.
+ */
+int mvr::Renderer::renderTimeSeriesToFiles(std::string path)
+{
+    int ret = EXIT_SUCCESS;
+
+    if (false == m_isInitialized)
+    {
+        std::cerr << "Error: Renderer::initialize() must be called "
+            "successfully before Renderer::renderTimeSeriesToFiles(...) can "
+            "be used!" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    bfs::path file(path);
+    std::string stem = (file.parent_path() / file.stem()).string();
+    std::string extension = file.extension().string();
+    unsigned int numTimesteps = m_pyramid.getLevel(0).getNumTimesteps();
+    char number[16];
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int t = 0; t < numTimesteps; ++t)
+    {
+        if (t != m_timestep)
+            loadVolume(m_pyramid.getLevel(0), t);
+
+        snprintf(number, sizeof(number), "_%04u", t);
+        if (EXIT_SUCCESS != renderToFile(stem + number + extension))
+            ret = EXIT_FAILURE;
+    }
+    if (EXIT_SUCCESS != flushOutputFiles())
+        ret = EXIT_FAILURE;
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::cout << "Note: rendered " << numTimesteps << " frames in " <<
+        seconds << " s (" << numTimesteps / std::max(seconds, 1e-9) <<
+        " fps)." << std::endl;
 
     return ret;
 }
 
+int mvr::Renderer::flushOutputFiles()
+{
+    if (false == m_isInitialized)
+        return EXIT_SUCCESS;
+
+    return m_readback.flush() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int mvr::Renderer::saveConfigToFile(std::string path)
 {
     int ret = EXIT_SUCCESS;
@@ -477,10 +664,31 @@ int mvr::Renderer::saveConfigToFile(std::string path)
         conf["invertAlpha"] = m_invertAlpha;
         conf["clearColor"] = m_clearColor;
         conf["outputDataZSlice"] = m_outputDataZSlice;
+        conf["prefetchTimesteps"] = m_prefetchTimesteps;
+        conf["prefetchMemoryBudget"] = m_prefetchMemoryBudget;
+        conf["streamUploads"] = m_streamUploads;
+        conf["streamSlabSize"] = m_streamSlabSize;
+        conf["asyncReadback"] = m_asyncReadback;
+        conf["adaptiveResolution"] = m_adaptiveResolution;
+        conf["targetFrameTime"] = m_targetFrameTime;
+        conf["minRenderScale"] = m_minRenderScale;
+        conf["interactionIdleTime"] = m_interactionIdleTime;
+        conf["lodMemoryBudget"] = m_lodMemoryBudget;
+        conf["textureFormat"] = m_textureFormat;
+        conf["textureWindow"] = m_textureWindow;
+        conf["textureWindowRange"] = m_textureWindowRange;
+        conf["texturePercentiles"] = m_texturePercentiles;
+        conf["brickAtlas"] = m_brickAtlas;
+        conf["pagedRegionOrigin"] = m_pagedRegionOrigin;
+        conf["pagedRegionSize"] = m_pagedRegionSize;
 
         conf["stepSize"] = m_stepSize;
         conf["emptySpaceSkipping"] = m_emptySpaceSkipping;
+        conf["skippingMethod"] = m_skippingMethod;
         conf["gradientMethod"] = m_gradientMethod;
+        conf["precomputedGradients"] = m_precomputedGradients;
+        conf["preIntegration"] = m_preIntegration;
+        conf["shaderVariants"] = m_shaderVariants;
 
         conf["fovY"] = m_fovY;
         conf["zNear"] = m_zNear;
@@ -608,6 +816,7 @@ int mvr::Renderer::loadConfigFromFile(std::string path)
     try
     {
         bool rebucket = false;
+        bool reupload = false;
         json conf;
 
         fs >> conf;
@@ -657,13 +866,80 @@ int mvr::Renderer::loadConfigFromFile(std::string path)
 
         if (!conf["outputDataZSlice"].is_null())
             m_outputDataZSlice = conf["outputDataZSlice"].get<float>();
+        if (!conf["prefetchTimesteps"].is_null())
+            m_prefetchTimesteps = conf["prefetchTimesteps"].get<int>();
+        if (!conf["prefetchMemoryBudget"].is_null())
+            m_prefetchMemoryBudget = conf["prefetchMemoryBudget"].get<int>();
+        if (!conf["streamUploads"].is_null())
+            m_streamUploads = conf["streamUploads"].get<bool>();
+        if (!conf["streamSlabSize"].is_null())
+            m_streamSlabSize = conf["streamSlabSize"].get<int>();
+        if (!conf["asyncReadback"].is_null())
+            m_asyncReadback = conf["asyncReadback"].get<bool>();
+        if (!conf["adaptiveResolution"].is_null())
+            m_adaptiveResolution = conf["adaptiveResolution"].get<bool>();
+        if (!conf["targetFrameTime"].is_null())
+            m_targetFrameTime = conf["targetFrameTime"].get<float>();
+        if (!conf["minRenderScale"].is_null())
+            m_minRenderScale = conf["minRenderScale"].get<float>();
+        if (!conf["interactionIdleTime"].is_null())
+            m_interactionIdleTime = conf["interactionIdleTime"].get<float>();
+        if (!conf["lodMemoryBudget"].is_null())
+            m_lodMemoryBudget = conf["lodMemoryBudget"].get<int>();
+        if (!conf["textureFormat"].is_null())
+        {
+            m_textureFormat = conf["textureFormat"].get<cr::TextureFormat>();
+            reupload = true;
+        }
+        if (!conf["textureWindow"].is_null())
+        {
+            m_textureWindow = conf["textureWindow"].get<cr::ValueWindow>();
+            reupload = true;
+        }
+        if (!conf["textureWindowRange"].is_null())
+        {
+            m_textureWindowRange =
+                conf["textureWindowRange"].get<std::array<float, 2>>();
+            reupload = true;
+        }
+        if (!conf["texturePercentiles"].is_null())
+        {
+            m_texturePercentiles =
+                conf["texturePercentiles"].get<std::array<float, 2>>();
+            reupload = true;
+        }
+        if (!conf["brickAtlas"].is_null())
+        {
+            m_brickAtlas = conf["brickAtlas"].get<bool>();
+            reupload = true;
+        }
+        if (!conf["pagedRegionOrigin"].is_null())
+        {
+            m_pagedRegionOrigin =
+                conf["pagedRegionOrigin"].get<std::array<int, 3>>();
+            reupload = true;
+        }
+        if (!conf["pagedRegionSize"].is_null())
+        {
+            m_pagedRegionSize =
+                conf["pagedRegionSize"].get<std::array<int, 3>>();
+            reupload = true;
+        }
 
         if (!conf["stepSize"].is_null())
             m_stepSize = conf["stepSize"].get<float>();
         if (!conf["emptySpaceSkipping"].is_null())
             m_emptySpaceSkipping = conf["emptySpaceSkipping"].get<bool>();
+        if (!conf["skippingMethod"].is_null())
+            m_skippingMethod = conf["skippingMethod"].get<Skipping>();
         if (!conf["gradientMethod"].is_null())
             m_gradientMethod = conf["gradientMethod"].get<Gradient>();
+        if (!conf["precomputedGradients"].is_null())
+            m_precomputedGradients = conf["precomputedGradients"].get<bool>();
+        if (!conf["preIntegration"].is_null())
+            m_preIntegration = conf["preIntegration"].get<bool>();
+        if (!conf["shaderVariants"].is_null())
+            m_shaderVariants = conf["shaderVariants"].get<bool>();
 
         if (!conf["fovY"].is_null())
             m_fovY = conf["fovY"].get<float>();
@@ -789,11 +1065,16 @@ int mvr::Renderer::loadConfigFromFile(std::string path)
 
         // bucket volume data if one of the limits was changed
         if (rebucket)
-            m_histogramBins = cr::bucketVolumeData(
-             *m_volumeData,
+            m_histogramBins = m_volumeStatistics.rebin(
              m_binNumberHistogram,
              m_histogramIntervalMin,
              m_histogramIntervalMax);
+
+        // convert the volume data again if the texture settings changed
+        if (reupload)
+            uploadVolumeTex();
+
+        m_volumeSettingsDirty = true;
     }
     catch(json::exception &e)
     {
@@ -827,7 +1108,11 @@ int mvr::Renderer::loadVolumeFromFile(
     }
 
     if(volumeConfig.isValid())
+    {
+        // look for levels of detail that were built in the meantime
+        m_pyramid = cr::VolumePyramid();
         loadVolume(volumeConfig, timestep);
+    }
     else
         return EXIT_FAILURE;
 
@@ -845,15 +1130,15 @@ int mvr::Renderer::adjustIntervalsToLoadedVolume()
         return EXIT_FAILURE;
     }
 
-    auto limits = cr::getLimitsVolumeData(*m_volumeData);
+    auto limits = m_volumeStatistics.getLimits();
     m_volumeDataMin = std::get<0>(limits);
     m_volumeDataMax = std::get<1>(limits);
     m_mappedIntervalMin = m_volumeDataMin;
     m_mappedIntervalMax = m_volumeDataMax;
     m_histogramIntervalMin = m_volumeDataMin;
     m_histogramIntervalMax = m_volumeDataMax;
-    m_histogramBins = cr::bucketVolumeData(
-        *m_volumeData,
+    m_volumeSettingsDirty = true;
+    m_histogramBins = m_volumeStatistics.rebin(
         m_binNumberHistogram,
         m_histogramIntervalMin,
         m_histogramIntervalMax);
@@ -869,8 +1154,12 @@ void mvr::Renderer::drawVolume(const util::texture::Texture2D& stateInTexture)
     // ------------------------------------------------------------------------
     // local variables
     // ------------------------------------------------------------------------
-    glm::vec3 tempVec3 = glm::vec3(0.f);
     glm::vec3 right(0.f), up(0.f);
+    VolumeShader &volumeShader = accessVolumeShader();
+    const VolumeUniforms &uniforms = volumeShader.uniforms;
+    glm::mat4 pvmMx(1.f);
+    // the feature switches are compile time constants of shader variants
+    bool generic = !m_shaderVariants;
 
     // ------------------------------------------------------------------------
     // draw the volume
@@ -911,115 +1200,172 @@ void mvr::Renderer::drawVolume(const util::texture::Texture2D& stateInTexture)
     }
 
     // draw the volume
-    m_shaderVolume.use();
+    volumeShader.shader.use();
+    updateVolumeSettings();
 
     glActiveTexture(GL_TEXTURE0);
-    m_volumeTex.bind();
-    m_shaderVolume.setInt("volumeTex", 0);
-    GLint internalFormat = 0;
-    glGetTexLevelParameteriv(
-        GL_TEXTURE_3D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
-    m_shaderVolume.setBool(
-        "volumeTexNormalized",
-        (internalFormat == GL_RED) ? true : false);
+    if (generic)
+        glUniform1i(uniforms.brickAtlas, m_volumeAtlas.isValid());
+    if (m_volumeAtlas.isValid())
+    {
+        std::array<size_t, 3> dim = m_volumeAtlas.getVolumeDim();
+
+        m_volumeAtlas.getAtlasTexture().bind();
+        glActiveTexture(GL_TEXTURE7);
+        m_volumeAtlas.getPageTable().bind();
+        glUniform3f(uniforms.brickVolumeDim,
+            static_cast<float>(dim[0]),
+            static_cast<float>(dim[1]),
+            static_cast<float>(dim[2]));
+        glUniform1f(uniforms.brickSize,
+            static_cast<float>(m_volumeAtlas.getBrickSize()));
+    }
+    else
+        m_volumeTex.bind();
 
     glActiveTexture(GL_TEXTURE1);
     m_transferFunction.accessTexture().bind();
-    m_shaderVolume.setInt("transferfunctionTex", 1);
+
+    bool preIntegration =
+        m_preIntegration && (Mode::transfer_function == m_renderMode);
+    if (generic)
+        glUniform1i(uniforms.preIntegration, preIntegration);
+    if (preIntegration)
+    {
+        glActiveTexture(GL_TEXTURE5);
+        m_transferFunction.accessPreIntegrationTexture(m_stepSize).bind();
+    }
 
     glActiveTexture(GL_TEXTURE2);
     m_randomSeedTex.bind();
-    m_shaderVolume.setInt("seed", 2);
-    m_shaderVolume.setBool("useSeed", true);
+    glUniform1i(uniforms.useSeed, 1);
 
     glActiveTexture(GL_TEXTURE3);
     stateInTexture.bind();
-    m_shaderVolume.setInt("stateIn", 3);
 
-    m_shaderVolume.setFloat("valIntervalMin",
-        glm::clamp(
-            (m_mappedIntervalMin - m_volumeDataMin) /
-                (m_volumeDataMax - m_volumeDataMin),
-        0.f,
-        1.f));
-    m_shaderVolume.setFloat("valIntervalMax",
-        glm::clamp(
-            (m_mappedIntervalMax - m_volumeDataMin) /
-                (m_volumeDataMax - m_volumeDataMin),
-        0.f,
-        1.f));
-
-    m_shaderVolume.setFloat("volumeDataMin", m_volumeDataMin);
-    m_shaderVolume.setFloat("volumeDataMax", m_volumeDataMax);
-
-    m_shaderVolume.setInt("winWidth", m_renderingDimensions[0]);
-    m_shaderVolume.setInt("winHeight", m_renderingDimensions[1]);
-    m_shaderVolume.setMat4("modelMX", m_volumeModelMx);
-    m_shaderVolume.setMat4(
-        "pvmMX", m_volumeProjMx * m_volumeViewMx * m_volumeModelMx);
-    m_shaderVolume.setVec3("eyePos", m_cameraPosition);
-    m_shaderVolume.setVec3("bbMin", m_boundingBoxMin.xyz());
-    m_shaderVolume.setVec3("bbMax", m_boundingBoxMax.xyz());
-    m_shaderVolume.setInt("mode", static_cast<int>(m_renderMode));
-    m_shaderVolume.setInt(
-        "gradMethod", static_cast<int>(m_gradientMethod));
-    m_shaderVolume.setFloat("stepSize", m_voxelDiagonal * m_stepSize);
-    m_shaderVolume.setBool("emptySpaceSkipping", m_emptySpaceSkipping);
-    m_shaderVolume.setFloat("stepSizeVoxel", m_stepSize);
-    m_shaderVolume.setVec3("bgColor",
-        m_clearColor[0], m_clearColor[1], m_clearColor[2]);
-    m_shaderVolume.setFloat("brightness", m_brightness);
-    m_shaderVolume.setBool("ambientOcclusion", m_ambientOcclusion);
-    m_shaderVolume.setInt("aoSamples", m_ambientOcclusionNumSamples);
-    m_shaderVolume.setFloat(
-        "aoRadius", m_voxelDiagonal * m_ambientOcclusionRadius);
-    m_shaderVolume.setFloat("aoProportion", m_ambientOcclusionProportion);
-    m_shaderVolume.setFloat("isovalue",
-        glm::clamp(
-            (m_isovalue - m_volumeDataMin) /
-                (m_volumeDataMax - m_volumeDataMin),
-            0.f,
-            1.f));
-    m_shaderVolume.setBool("isoDenoise", m_isovalueDenoising);
-    m_shaderVolume.setFloat("isoDenoiseR",
-        m_voxelDiagonal * m_isovalueDenoisingRadius);
+    pvmMx = m_volumeProjMx * m_volumeViewMx * m_volumeModelMx;
+    glUniform1i(uniforms.winWidth, m_renderedDimensions[0]);
+    glUniform1i(uniforms.winHeight, m_renderedDimensions[1]);
+    glUniformMatrix4fv(uniforms.modelMX, 1, GL_FALSE, &m_volumeModelMx[0][0]);
+    glUniformMatrix4fv(uniforms.pvmMX, 1, GL_FALSE, &pvmMx[0][0]);
+    glUniform3fv(uniforms.eyePos, 1, &m_cameraPosition[0]);
+    glUniform3fv(uniforms.bbMin, 1, &m_boundingBoxMin[0]);
+    glUniform3fv(uniforms.bbMax, 1, &m_boundingBoxMax[0]);
+    if (generic)
+    {
+        glUniform1i(uniforms.mode, static_cast<int>(m_renderMode));
+        glUniform1i(uniforms.gradMethod, static_cast<int>(m_gradientMethod));
+        glUniform1i(uniforms.precomputedGradients, m_gradientTex.getID() != 0);
+        glUniform1i(uniforms.emptySpaceSkipping, m_emptySpaceSkipping);
+        glUniform1i(uniforms.ambientOcclusion, m_ambientOcclusion);
+        glUniform1i(uniforms.isoDenoise, m_isovalueDenoising);
+        glUniform1i(uniforms.invertColors, m_invertColors);
+        glUniform1i(uniforms.sliceVolume, m_slicingPlane);
+    }
+    if (m_gradientTex.getID() != 0)
+    {
+        glActiveTexture(GL_TEXTURE6);
+        m_gradientTex.bind();
+    }
+    if (m_emptySpaceSkipping && (Skipping::macrocells == m_skippingMethod) &&
+        m_macrocells.isValid())
+    {
+        updateMacrocellMask();
+
+        glActiveTexture(GL_TEXTURE4);
+        m_macrocellTex.bind();
+        if (generic)
+            glUniform1i(
+                uniforms.skipMethod, static_cast<int>(Skipping::macrocells));
+        float cellSize = static_cast<float>(m_macrocells.getCellSize());
+        glUniform3f(uniforms.macrocellScale,
+            static_cast<float>(m_macrocells.getVolumeDim()[0]) / cellSize,
+            static_cast<float>(m_macrocells.getVolumeDim()[1]) / cellSize,
+            static_cast<float>(m_macrocells.getVolumeDim()[2]) / cellSize);
+    }
+    else if (generic)
+        glUniform1i(
+            uniforms.skipMethod, static_cast<int>(Skipping::look_ahead));
+
+    m_volumeCube.draw();
+
+}
+
+void mvr::Renderer::updateVolumeSettings()
+{
+    if (!m_volumeSettingsDirty && (0 != m_volumeSettingsUbo))
+    {
+        glBindBufferBase(
+            GL_UNIFORM_BUFFER, VOLUME_SETTINGS_BINDING, m_volumeSettingsUbo);
+        return;
+    }
+
+    VolumeSettingsBlock settings = {};
+    glm::vec3 tempVec3(0.f);
+    float range = m_volumeDataMax - m_volumeDataMin;
+
     tempVec3 = glm::normalize( glm::vec3(
         m_lightDirection[0], m_lightDirection[1], m_lightDirection[2]));
-    m_shaderVolume.setVec3(
-        "lightDir", tempVec3[0], tempVec3[1], tempVec3[2]);
-    m_shaderVolume.setVec3(
-        "ambient",
-        m_ambientColor[0], m_ambientColor[1], m_ambientColor[2]);
-    m_shaderVolume.setVec3(
-        "diffuse",
-        m_diffuseColor[0], m_diffuseColor[1], m_diffuseColor[2]);
-    m_shaderVolume.setVec3(
-        "specular",
-        m_specularColor[0], m_specularColor[1], m_specularColor[2]);
-    m_shaderVolume.setFloat("kAmb", m_ambientFactor);
-    m_shaderVolume.setFloat("kDiff", m_diffuseFactor);
-    m_shaderVolume.setFloat("kSpec", m_specularFactor);
-    m_shaderVolume.setFloat("kExp", m_specularExponent);
-    m_shaderVolume.setBool("invertColors", m_invertColors);
-    m_shaderVolume.setBool("invertAlpha", m_invertAlpha);
-    m_shaderVolume.setBool("sliceVolume", m_slicingPlane);
+    std::copy_n(&tempVec3[0], 3, settings.lightDir);
+    settings.kAmb = m_ambientFactor;
+    std::copy_n(m_ambientColor.data(), 3, settings.ambient);
+    settings.kDiff = m_diffuseFactor;
+    std::copy_n(m_diffuseColor.data(), 3, settings.diffuse);
+    settings.kSpec = m_specularFactor;
+    std::copy_n(m_specularColor.data(), 3, settings.specular);
+    settings.kExp = m_specularExponent;
+    std::copy_n(m_clearColor.data(), 3, settings.bgColor);
+    settings.brightness = m_brightness;
+
     tempVec3 = glm::normalize( glm::vec3(
         m_slicingPlaneNormal[0],
         m_slicingPlaneNormal[1],
         m_slicingPlaneNormal[2]));
-    m_shaderVolume.setVec3(
-        "slicePlaneNormal", tempVec3[0], tempVec3[1], tempVec3[2]);
+    std::copy_n(&tempVec3[0], 3, settings.slicePlaneNormal);
+    settings.isovalue =
+        glm::clamp((m_isovalue - m_volumeDataMin) / range, 0.f, 1.f);
     tempVec3 = (m_volumeModelMx *
         glm::vec4(
             m_slicingPlaneBase[0] / 2.f,
             m_slicingPlaneBase[1] / 2.f,
             m_slicingPlaneBase[2] / 2.f,
             1.f)).xyz();
-    m_shaderVolume.setVec3(
-        "slicePlaneBase", tempVec3[0], tempVec3[1], tempVec3[2]);
+    std::copy_n(&tempVec3[0], 3, settings.slicePlaneBase);
+    settings.isoDenoiseR = m_voxelDiagonal * m_isovalueDenoisingRadius;
+
+    settings.volumeTexScale = m_volumeTexScale / range;
+    settings.volumeTexOffset = (m_volumeTexOffset - m_volumeDataMin) / range;
+    settings.valIntervalMin =
+        glm::clamp((m_mappedIntervalMin - m_volumeDataMin) / range, 0.f, 1.f);
+    settings.valIntervalMax =
+        glm::clamp((m_mappedIntervalMax - m_volumeDataMin) / range, 0.f, 1.f);
+
+    settings.stepSize = m_voxelDiagonal * m_stepSize;
+    settings.stepSizeVoxel = m_stepSize;
+    settings.aoProportion = m_ambientOcclusionProportion;
+    settings.aoRadius = m_voxelDiagonal * m_ambientOcclusionRadius;
+    settings.aoSamples = m_ambientOcclusionNumSamples;
+    settings.invertAlpha = m_invertAlpha ? 1 : 0;
+
+    if (0 == m_volumeSettingsUbo)
+    {
+        glGenBuffers(1, &m_volumeSettingsUbo);
+        glBindBuffer(GL_UNIFORM_BUFFER, m_volumeSettingsUbo);
+        glBufferData(
+            GL_UNIFORM_BUFFER, sizeof(settings), &settings, GL_DYNAMIC_DRAW);
+        m_volumeSettings = settings;
+    }
+    else if (0 != std::memcmp(&settings, &m_volumeSettings, sizeof(settings)))
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_volumeSettingsUbo);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(settings), &settings);
+        m_volumeSettings = settings;
+    }
 
-    m_volumeCube.draw();
+    m_volumeSettingsDirty = false;
 
+    glBindBufferBase(
+        GL_UNIFORM_BUFFER, VOLUME_SETTINGS_BINDING, m_volumeSettingsUbo);
 }
 
 void mvr::Renderer::drawSettingsWindow()
@@ -1028,12 +1374,15 @@ void mvr::Renderer::drawSettingsWindow()
     cr::VolumeConfig tempConf;
     static int renderMode = static_cast<int>(m_renderMode);
     static int gradientMethod = static_cast<int>(m_gradientMethod);
+    static int skippingMethod = static_cast<int>(m_skippingMethod);
     static int projection = static_cast<int>(m_projection);
     static int timestep = m_timestep;
     static int renderingDimensions[2] = {
         static_cast<int>(m_renderingDimensions[0]),
         static_cast<int>(m_renderingDimensions[1])};
     static int outputSelect = static_cast<int>(m_outputSelect);
+    static int textureFormat = static_cast<int>(m_textureFormat);
+    static int textureWindow = static_cast<int>(m_textureWindow);
     static time_t timer = std::time(nullptr);
     static char filename[200] = {};
 
@@ -1049,20 +1398,21 @@ void mvr::Renderer::drawSettingsWindow()
             if(tempConf.isValid())
             {
                 m_volumeDescriptionFile = volumeDescription;
+                m_pyramid = cr::VolumePyramid();
                 loadVolume(tempConf, 0);
             }
         }
         ImGui::SameLine();
         createHelpMarker("Path to the volume description file");
         std::array<size_t, 3> volumeDim =
-                m_volumeData->getVolumeConfig().getVolumeDim();
+                m_pyramid.getLevel(0).getVolumeDim();
         ImGui::Text(
             "Dimensions : (%zu, %zu, %zu)",
             volumeDim[0],
             volumeDim[1],
             volumeDim[2]);
         ImGui::Text("Number of timesteps: %u",
-                m_volumeData->getVolumeConfig().getNumTimesteps());
+                m_pyramid.getLevel(0).getNumTimesteps());
         ImGui::Text("Min. value: %.6f", m_volumeDataMin);
         ImGui::Text("Max. value: %.6f", m_volumeDataMax);
         if(ImGui::DragFloatRange2(
@@ -1074,7 +1424,10 @@ void mvr::Renderer::drawSettingsWindow()
                 m_volumeDataMax,
                 "Min: %.1f",
                 "Max: %.1f"))
+        {
             m_transferFunction.updateTexture(0.f, 1.f);
+            m_volumeSettingsDirty = true;
+        }
 
         ImGui::Separator();
         ImGui::Text("Mode");
@@ -1109,28 +1462,202 @@ void mvr::Renderer::drawSettingsWindow()
             if (timestep < 0) timestep = 0;
             else if(timestep >
                     static_cast<int>(
-                        m_volumeData->getVolumeConfig().getNumTimesteps() - 1))
+                        m_pyramid.getLevel(0).getNumTimesteps() - 1))
             {
                 timestep = static_cast<int>(
-                    m_volumeData->getVolumeConfig().getNumTimesteps() - 1);
+                    m_pyramid.getLevel(0).getNumTimesteps() - 1);
+            }
+
+            loadVolume(m_pyramid.getLevel(0), timestep, true);
+        }
+
+        if (ImGui::Checkbox("playback", &m_playback))
+            m_prefetcher.resetStatistics();
+        ImGui::SameLine();
+        createHelpMarker("Advances the timestep with each rendered frame");
+        if (m_playback)
+            timestep = static_cast<int>(m_timestep);
+
+        ImGui::SliderInt(
+            "prefetched timesteps", &m_prefetchTimesteps, 0, 16);
+        ImGui::SameLine();
+        createHelpMarker(
+            "Number of upcoming timesteps that are loaded in the background");
+        if (ImGui::InputInt(
+                "prefetch budget (MiB)", &m_prefetchMemoryBudget, 256, 1024))
+        {
+            if (m_prefetchMemoryBudget < 0) m_prefetchMemoryBudget = 0;
+        }
+        ImGui::Text(
+            "Prefetch hits: %zu, misses: %zu (%.1f %%), reserved: %zu MiB",
+            m_prefetcher.getHits(),
+            m_prefetcher.getMisses(),
+            m_prefetcher.getHitRate() * 100.f,
+            m_prefetcher.getReservedBytes() >> 20);
+        ImGui::Checkbox("stream uploads", &m_streamUploads);
+        ImGui::SameLine();
+        createHelpMarker(
+            "Uploads the texture of a new timestep in slabs over several "
+            "frames. The previous timestep stays visible until the upload is "
+            "complete.");
+        if (m_streamUploads)
+        {
+            if (ImGui::InputInt(
+                    "upload per frame (MiB)", &m_streamSlabSize, 1, 16))
+            {
+                m_streamSlabSize = std::max(m_streamSlabSize, 1);
             }
+            if (m_volumeStream.isActive())
+                ImGui::Text("Uploading timestep %u: %.0f %%",
+                    m_pendingTimestep.timestep,
+                    m_volumeStream.getProgress() * 100.f);
+        }
+
+        ImGui::Spacing();
+
+        if (ImGui::InputInt(
+                "detail budget (MiB)", &m_lodMemoryBudget, 256, 1024,
+                ImGuiInputTextFlags_EnterReturnsTrue))
+        {
+            if (m_lodMemoryBudget < 0) m_lodMemoryBudget = 0;
+            loadVolume(m_pyramid.getLevel(0), m_timestep);
+        }
+        ImGui::SameLine();
+        createHelpMarker(
+            "Memory for a timestep, the finest level of detail that fits is "
+            "shown. Levels of detail are built with --build-pyramid.");
+        ImGui::Text("Level of detail: %zu of %zu%s",
+            m_volumeLevel,
+            m_pyramid.getNumLevels() - 1,
+            m_pyramidLoader.isLoading() ? " (loading finer levels)" : "");
+
+        ImGui::Spacing();
 
-            loadVolume(m_volumeData->getVolumeConfig(), timestep);
+        bool reupload = false;
+        if (ImGui::Combo(
+                "texture format", &textureFormat, "native\0R8\0R16\0R16F\0"))
+        {
+            m_textureFormat = static_cast<cr::TextureFormat>(textureFormat);
+            reupload = true;
+        }
+        ImGui::SameLine();
+        createHelpMarker(
+            "Format of the volume texture on the GPU. R8, R16 and R16F store "
+            "the values inside the value window with 1 or 2 byte per voxel.");
+        if (cr::TextureFormat::native != m_textureFormat)
+        {
+            if (ImGui::Combo(
+                    "value window",
+                    &textureWindow,
+                    "limits\0manual\0percentile\0"))
+            {
+                m_textureWindow = static_cast<cr::ValueWindow>(textureWindow);
+                reupload = true;
+            }
+            if (cr::ValueWindow::manual == m_textureWindow)
+            {
+                ImGui::DragFloatRange2(
+                    "window", &m_textureWindowRange[0],
+                    &m_textureWindowRange[1], 1.f);
+                reupload |= ImGui::IsItemDeactivatedAfterEdit();
+            }
+            else if (cr::ValueWindow::percentile == m_textureWindow)
+            {
+                ImGui::DragFloatRange2(
+                    "percentiles", &m_texturePercentiles[0],
+                    &m_texturePercentiles[1], 0.1f, 0.f, 100.f, "%.1f %%");
+                reupload |= ImGui::IsItemDeactivatedAfterEdit();
+            }
         }
+        reupload |= ImGui::Checkbox("brick atlas", &m_brickAtlas);
+        ImGui::SameLine();
+        createHelpMarker(
+            "Uploads only the bricks with texels other than 0 into an "
+            "atlas texture. Saves memory for sparse volumes and is used "
+            "automatically for volumes beyond the 3D texture size limit. "
+            "Precomputed gradients are not available with an atlas.");
+        if (m_volumeData && m_volumeData->isPaged())
+        {
+            ImGui::DragInt3("region origin", m_pagedRegionOrigin.data(), 4.f);
+            reupload |= ImGui::IsItemDeactivatedAfterEdit();
+            ImGui::DragInt3("region size", m_pagedRegionSize.data(), 4.f);
+            reupload |= ImGui::IsItemDeactivatedAfterEdit();
+            ImGui::SameLine();
+            createHelpMarker(
+                "The volume is paged in brick by brick, only this region is "
+                "uploaded to the GPU.");
+            ImGui::Text("Brick cache: %zu / %zu MiB, hits: %zu, misses: %zu",
+                cr::BrickCache::getInstance().getUsage() >> 20,
+                cr::BrickCache::getInstance().getBudget() >> 20,
+                cr::BrickCache::getInstance().getHits(),
+                cr::BrickCache::getInstance().getMisses());
+        }
+        if (m_volumeAtlas.isValid())
+        {
+            ImGui::Text("Brick atlas: %zu of %zu bricks, %zu MiB",
+                m_volumeAtlas.getNumResidentBricks(),
+                m_volumeAtlas.getNumBricks(),
+                m_volumeAtlas.getMemorySize() >> 20);
+        }
+        else if (m_volumeData)
+        {
+            const cr::VolumeConfig &conf = m_volumeData->getVolumeConfig();
+            ImGui::Text("Volume texture: %zu MiB",
+                (cr::getTexelSize(m_volumeTexFormat, conf.getVoxelType()) *
+                    m_volumeTexDim[0] * m_volumeTexDim[1] * m_volumeTexDim[2])
+                    >> 20);
+        }
+        if (reupload)
+            uploadVolumeTex();
 
         ImGui::Spacing();
 
-        ImGui::SliderFloat(
+        m_volumeSettingsDirty |= ImGui::SliderFloat(
             "step size", &m_stepSize, 0.05f, 2.f, "%.3f");
         ImGui::Checkbox("empty space skipping", &m_emptySpaceSkipping);
+        if (m_emptySpaceSkipping)
+        {
+            ImGui::RadioButton(
+                "look ahead",
+                &skippingMethod,
+                static_cast<int>(Skipping::look_ahead));
+            ImGui::SameLine();
+            ImGui::RadioButton(
+                "macrocells",
+                &skippingMethod,
+                static_cast<int>(Skipping::macrocells));
+            ImGui::SameLine();
+            createHelpMarker(
+                "Look ahead jumps when a sample a few steps ahead is empty. "
+                "Macrocells skip whole 8^3 blocks without visible values.");
+            m_skippingMethod = static_cast<mvr::Skipping>(skippingMethod);
+        }
+        ImGui::Checkbox("shader variants", &m_shaderVariants);
+        ImGui::SameLine();
+        createHelpMarker(
+            "Builds a variant of the volume shader for each combination of "
+            "render mode and features, with the unused branches removed at "
+            "compile time. The list shows the GPU time of the volume pass "
+            "per variant at full render scale.");
+        if (!m_volumeShaderTimes.empty() && ImGui::TreeNode("Variant timings"))
+        {
+            for (const auto &time : m_volumeShaderTimes)
+                ImGui::Text("%7.3f ms  %s", time.second,
+                    (~0u == time.first) ? "generic" :
+                        getVolumeShaderLabel(time.first).c_str());
+            ImGui::TreePop();
+        }
 
         ImGui::Spacing();
 
-        ImGui::InputFloat("brightness", &m_brightness, 0.01f, 0.1f);
+        m_volumeSettingsDirty |= ImGui::InputFloat(
+            "brightness", &m_brightness, 0.01f, 0.1f);
 
         ImGui::Spacing();
 
         ImGui::Text("Gradient Calculation Method:");
+        mvr::Gradient gradientMethodLast = m_gradientMethod;
+        bool precomputedGradients = m_precomputedGradients;
         ImGui::RadioButton(
             "central differences",
             &gradientMethod,
@@ -1140,19 +1667,34 @@ void mvr::Renderer::drawSettingsWindow()
             &gradientMethod,
             static_cast<int>(Gradient::sobel_operators));
         m_gradientMethod = static_cast<mvr::Gradient>(gradientMethod);
+        ImGui::Checkbox("precomputed gradients", &m_precomputedGradients);
+        ImGui::SameLine();
+        createHelpMarker(
+            "Computes the gradients once per timestep on the CPU. Shading "
+            "then reads one texel instead of 6 (central differences) or 26 "
+            "(sobel operators) texture fetches.");
+        if (m_volumeData &&
+            ((precomputedGradients != m_precomputedGradients) ||
+                (m_precomputedGradients &&
+                    (gradientMethodLast != m_gradientMethod))))
+            uploadVolumeTex();
+        if (m_gradientTex.getID() != 0)
+            ImGui::Text("Gradient texture: %zu MiB",
+                (3 * m_volumeTexDim[0] * m_volumeTexDim[1] * m_volumeTexDim[2])
+                    >> 20);
 
         ImGui::Spacing();
 
         if (ImGui::CollapsingHeader("Isosurface"))
         {
-            ImGui::SliderFloat(
+            m_volumeSettingsDirty |= ImGui::SliderFloat(
                 "isovalue",
                 &m_isovalue,
                 m_mappedIntervalMin,
                 m_mappedIntervalMax,
                 "%.3f");
             ImGui::Checkbox("denoise", &m_isovalueDenoising);
-            ImGui::SliderFloat(
+            m_volumeSettingsDirty |= ImGui::SliderFloat(
                 "denoise radius",
                 &m_isovalueDenoisingRadius,
                 0.001f,
@@ -1160,18 +1702,24 @@ void mvr::Renderer::drawSettingsWindow()
                 "%.3f");
             if (ImGui::TreeNode("Lighting"))
             {
-                ImGui::SliderFloat3(
+                bool changed = ImGui::SliderFloat3(
                     "light direction", m_lightDirection.data(), -1.f, 1.f);
-                ImGui::ColorEdit3("ambient", m_ambientColor.data());
-                ImGui::ColorEdit3("diffuse", m_diffuseColor.data());
-                ImGui::ColorEdit3("specular", m_specularColor.data());
+                changed |= ImGui::ColorEdit3("ambient", m_ambientColor.data());
+                changed |= ImGui::ColorEdit3("diffuse", m_diffuseColor.data());
+                changed |= ImGui::ColorEdit3(
+                    "specular", m_specularColor.data());
 
                 ImGui::Spacing();
 
-                ImGui::SliderFloat("k_amb", &m_ambientFactor, 0.f, 1.f);
-                ImGui::SliderFloat("k_diff", &m_diffuseFactor, 0.f, 1.f);
-                ImGui::SliderFloat("k_spec", &m_specularFactor, 0.f, 1.f);
-                ImGui::SliderFloat("k_exp", &m_specularExponent, 0.f, 50.f);
+                changed |= ImGui::SliderFloat(
+                    "k_amb", &m_ambientFactor, 0.f, 1.f);
+                changed |= ImGui::SliderFloat(
+                    "k_diff", &m_diffuseFactor, 0.f, 1.f);
+                changed |= ImGui::SliderFloat(
+                    "k_spec", &m_specularFactor, 0.f, 1.f);
+                changed |= ImGui::SliderFloat(
+                    "k_exp", &m_specularExponent, 0.f, 50.f);
+                m_volumeSettingsDirty |= changed;
                 ImGui::TreePop();
             }
         }
@@ -1190,6 +1738,15 @@ void mvr::Renderer::drawSettingsWindow()
             ImGui::SameLine();
             createHelpMarker(
                 "Only visible in transfer function mode.");
+
+            ImGui::Spacing();
+
+            ImGui::Checkbox("pre-integration", &m_preIntegration);
+            ImGui::SameLine();
+            createHelpMarker(
+                "Integrates the transfer function between neighbouring "
+                "samples, which allows step sizes of 1-2 voxels without "
+                "slab artifacts.");
         }
 
         if (ImGui::CollapsingHeader("Camera"))
@@ -1281,9 +1838,33 @@ void mvr::Renderer::drawSettingsWindow()
                 resizeRendering(
                     renderingDimensions[0], renderingDimensions[1]);
 
+            ImGui::Checkbox("adaptive resolution", &m_adaptiveResolution);
+            ImGui::SameLine();
+            createHelpMarker(
+                "Renders at a reduced resolution while the camera or the "
+                "transfer function changes and upsamples the result. The "
+                "scale adapts to hold the target GPU time of the volume "
+                "pass. Full resolution returns after the idle time.");
+            if (m_adaptiveResolution)
+            {
+                ImGui::SliderFloat(
+                    "target volume pass (ms)", &m_targetFrameTime, 1.f, 100.f);
+                ImGui::SliderFloat(
+                    "minimum scale", &m_minRenderScale, 0.1f, 1.f);
+                ImGui::SliderFloat(
+                    "idle time (s)", &m_interactionIdleTime, 0.05f, 2.f);
+                ImGui::Text("Interaction scale: %.2f (%u x %u)",
+                    m_interactionScale,
+                    static_cast<unsigned int>(std::lround(
+                        m_interactionScale * m_renderingDimensions[0])),
+                    static_cast<unsigned int>(std::lround(
+                        m_interactionScale * m_renderingDimensions[1])));
+            }
+
             ImGui::Separator();
 
-            ImGui::ColorEdit3("background color", m_clearColor.data());
+            m_volumeSettingsDirty |= ImGui::ColorEdit3(
+                "background color", m_clearColor.data());
 
             ImGui::Separator();
 
@@ -1300,17 +1881,18 @@ void mvr::Renderer::drawSettingsWindow()
 
             ImGui::Checkbox("invert colors", &m_invertColors);
             ImGui::SameLine();
-            ImGui::Checkbox("invert alpha", &m_invertAlpha);
+            m_volumeSettingsDirty |= ImGui::Checkbox(
+                "invert alpha", &m_invertAlpha);
 
             ImGui::Separator();
 
             ImGui::Checkbox("slice volume", &m_slicingPlane);
-            ImGui::SliderFloat3(
+            m_volumeSettingsDirty |= ImGui::SliderFloat3(
                 "slicing plane normal",
                 m_slicingPlaneNormal.data(),
                 -1.f,
                 1.f);
-            ImGui::SliderFloat3(
+            m_volumeSettingsDirty |= ImGui::SliderFloat3(
                 "slicing plane base",
                 m_slicingPlaneBase.data(),
                 -1.f,
@@ -1319,12 +1901,13 @@ void mvr::Renderer::drawSettingsWindow()
             ImGui::Separator();
 
             ImGui::Checkbox("ambient occlusion", &m_ambientOcclusion);
-            ImGui::SliderFloat(
+            bool changed = ImGui::SliderFloat(
                 "proportion", &m_ambientOcclusionProportion, 0.f, 1.f);
-            ImGui::SliderFloat(
+            changed |= ImGui::SliderFloat(
                 "halfdome radius", &m_ambientOcclusionRadius, 0.01f, 10.f);
-            ImGui::SliderInt(
+            changed |= ImGui::SliderInt(
                 "number of samples", &m_ambientOcclusionNumSamples, 1, 100);
+            m_volumeSettingsDirty |= changed;
 
             ImGui::Separator();
 
@@ -1359,12 +1942,7 @@ void mvr::Renderer::drawSettingsWindow()
                 "./screenshots/%F_%H%M%S.tiff",
                 tm);
 
-            util::makeScreenshot(
-                m_framebuffers[0],
-                m_renderingDimensions[0],
-                m_renderingDimensions[1],
-                filename,
-                FIF_TIFF);
+            m_screenshotFile = filename;
         }
         ImGui::SameLine();
         if(ImGui::Button("save configuration"))
@@ -1407,9 +1985,9 @@ void mvr::Renderer::drawHistogramWindow()
     for(size_t i = 0; i < m_histogramBins.size(); i++)
     {
         if (m_semilogHistogram)
-            values[i] = log10(std::get<2>(m_histogramBins[i]));
+            values[i] = log10(m_histogramBins.counts[i]);
         else
-            values[i] = static_cast<float>(std::get<2>(m_histogramBins[i]));
+            values[i] = static_cast<float>(m_histogramBins.counts[i]);
 
         if (values[i] > yMax) yMax = values[i];
     }
@@ -1446,8 +2024,7 @@ void mvr::Renderer::drawHistogramWindow()
     ImGui::InputInt("number of bins", &m_binNumberHistogram);
     if(ImGui::Button("Regenerate Histogram"))
     {
-        m_histogramBins = cr::bucketVolumeData(
-            *m_volumeData,
+        m_histogramBins = m_volumeStatistics.rebin(
             m_binNumberHistogram,
             m_histogramIntervalMin,
             m_histogramIntervalMax);
@@ -1734,36 +2311,477 @@ void mvr::Renderer::drawTfFunc(util::FramebufferObject &tfFuncWidgetFBO)
 
 }
 
-void mvr::Renderer::loadVolume(
-        cr::VolumeConfig volumeConfig, unsigned int timestep)
+/**
+ * The texels are only converted on the workers if they can be streamed, the
+ * gradients only if they can be used.
+ */
+cr::TimestepPreparation mvr::Renderer::getTimestepPreparation() const
 {
-    m_timestep = timestep;
-    m_volumeData = cr::loadScalarVolumeTimestep(
-        volumeConfig, m_timestep, false);
+    cr::TimestepPreparation preparation;
+
+    preparation.enabled = true;
+    preparation.texels = m_streamUploads && !m_brickAtlas;
+    preparation.textureFormat = m_textureFormat;
+    preparation.textureWindow = m_textureWindow;
+    preparation.textureWindowRange = m_textureWindowRange;
+    preparation.texturePercentiles = m_texturePercentiles;
+    preparation.histogramBins = static_cast<size_t>(m_binNumberHistogram);
+    preparation.histogramMin = m_histogramIntervalMin;
+    preparation.histogramMax = m_histogramIntervalMax;
+    preparation.gradients = m_precomputedGradients && !m_brickAtlas;
+    preparation.gradientOperator =
+        (Gradient::sobel_operators == m_gradientMethod) ?
+            cr::GradientOperator::sobel :
+            cr::GradientOperator::central_differences;
+
+    return preparation;
+}
+
+/**
+ * \brief value interval that the texture conversion maps to [0, 1]
+ */
+std::tuple<float, float> mvr::Renderer::getTextureWindow() const
+{
+    return getTimestepPreparation().getTextureWindow(m_volumeStatistics);
+}
+
+void mvr::Renderer::uploadVolumeTex(cr::PrefetchedTimestep *prepared)
+{
+    const cr::VolumeDataBase *volumeData = m_volumeData.get();
+    std::unique_ptr<cr::VolumeDataBase> region = nullptr;
+
+    // a timestep whose texture is still streamed is shown right away with
+    // the current settings
+    if (m_volumeStream.isActive())
+    {
+        m_volumeStream.cancel();
+        m_gradientStream.cancel();
+        setVolumeData(std::move(m_pendingTimestep), m_pendingLevel, false);
+        return;
+    }
+
+    if (!m_volumeData)
+        return;
+
+    // out of core volumes only upload the selected region, which is clamped
+    // to the volume
+    if (m_volumeData->isPaged())
+    {
+        std::array<size_t, 3> dim =
+            m_volumeData->getVolumeConfig().getVolumeDim();
+        std::array<size_t, 3> regionMin, regionMax;
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+            m_pagedRegionSize[i] = std::max(
+                std::min(m_pagedRegionSize[i], static_cast<int>(dim[i])), 1);
+            m_pagedRegionOrigin[i] = std::max(
+                std::min(
+                    m_pagedRegionOrigin[i],
+                    static_cast<int>(dim[i]) - m_pagedRegionSize[i]),
+                0);
+            regionMin[i] = static_cast<size_t>(m_pagedRegionOrigin[i]);
+            regionMax[i] = regionMin[i] +
+                static_cast<size_t>(m_pagedRegionSize[i]) - 1;
+        }
+
+        region = static_cast<const cr::PagedVolumeData&>(
+            *m_volumeData).extractRegion(regionMin, regionMax);
+        volumeData = region.get();
+
+        // the current texture stays in place
+        if (nullptr == volumeData)
+        {
+            std::cerr << "Error while reading the region of the paged " <<
+                "volume, the texture is not updated." << std::endl;
+            return;
+        }
+
+        // the region is not covered by the prepared data
+        prepared = nullptr;
+    }
+
+    std::array<size_t, 3> dim = volumeData->getVolumeConfig().getVolumeDim();
+    GLint maxTextureSize = 0;
+
+    // volumes beyond the texture size limit only fit into a brick atlas
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxTextureSize);
+    bool exceedsLimit = *std::max_element(dim.begin(), dim.end()) >
+        static_cast<size_t>(maxTextureSize);
+
+    m_volumeAtlas = cr::BrickAtlas();
+    if (m_brickAtlas || exceedsLimit)
+    {
+        if (!m_brickAtlas)
+            std::cout << "Note: the volume exceeds the 3D texture size " <<
+                "limit of " << maxTextureSize << " and is uploaded as " <<
+                "brick atlas." << std::endl;
+        m_volumeAtlas = cr::BrickAtlas::create(
+            *volumeData, m_textureFormat, getTextureWindow());
+    }
+
+    if (m_volumeAtlas.isValid())
+    {
+        m_volumeTex = util::texture::Texture3D();
+        m_volumeTexFormat = m_volumeAtlas.getFormat();
+        m_volumeTexScale = m_volumeAtlas.getValueScale();
+        m_volumeTexOffset = m_volumeAtlas.getValueOffset();
+    }
+    else
+    {
+        cr::VolumeTexture volumeTex = cr::createVolumeTex(
+            *volumeData, m_textureFormat, getTextureWindow());
+
+        m_volumeTex = std::move(volumeTex.texture);
+        m_volumeTexFormat = volumeTex.format;
+        m_volumeTexScale = volumeTex.valueScale;
+        m_volumeTexOffset = volumeTex.valueOffset;
+    }
+    finishVolumeUpload(*volumeData, prepared);
+}
+
+void mvr::Renderer::finishVolumeUpload(
+    const cr::VolumeDataBase &volumeData,
+    cr::PrefetchedTimestep *prepared,
+    bool gradientsUploaded)
+{
+    std::array<size_t, 3> dim = volumeData.getVolumeConfig().getVolumeDim();
+    cr::TimestepPreparation preparation = getTimestepPreparation();
+
+    m_volumeTexDim = dim;
+
+    // value ranges of the uploaded data for the empty space skipping
+    if ((nullptr != prepared) && prepared->macrocells.isValid())
+        m_macrocells = std::move(prepared->macrocells);
+    else
+        m_macrocells = cr::MacrocellGrid::compute(volumeData);
+    m_macrocellMaskKey.clear();
+
+    // gradients for the shading, not with a brick atlas as the gradient
+    // texture would need more memory than the whole volume. Streamed
+    // gradients are already in place.
+    if (!gradientsUploaded)
+        m_gradientTex = util::texture::Texture3D();
+    if (!gradientsUploaded && m_precomputedGradients &&
+        !m_volumeAtlas.isValid())
+    {
+        cr::GradientVolume gradients;
+
+        if ((nullptr != prepared) && prepared->gradients.isValid() &&
+            (prepared->preparation.gradientOperator ==
+                preparation.gradientOperator))
+            gradients = std::move(prepared->gradients);
+        else
+            gradients = cr::GradientVolume::compute(
+                volumeData, preparation.gradientOperator);
+        if (gradients.isValid())
+            m_gradientTex = util::texture::Texture3D(
+                GL_RGB8,
+                GL_RGB,
+                0,
+                GL_UNSIGNED_BYTE,
+                GL_LINEAR,
+                GL_CLAMP_TO_EDGE,
+                dim[0],
+                dim[1],
+                dim[2],
+                gradients.getData().data());
+    }
+
     m_volumeModelMx = glm::scale(
         glm::mat4(1.f),
         glm::normalize(glm::vec3(
-            static_cast<float>(volumeConfig.getVolumeDim()[0]),
-            static_cast<float>(volumeConfig.getVolumeDim()[1]),
-            static_cast<float>(volumeConfig.getVolumeDim()[2]))));
+            static_cast<float>(dim[0]),
+            static_cast<float>(dim[1]),
+            static_cast<float>(dim[2]))));
     m_voxelDiagonal = glm::length(glm::vec3(
         (m_volumeModelMx *
             glm::vec4(
-                1.f / static_cast<float>(volumeConfig.getVolumeDim()[0]),
-                1.f / static_cast<float>(volumeConfig.getVolumeDim()[1]),
-                1.f / static_cast<float>(volumeConfig.getVolumeDim()[2]),
+                1.f / static_cast<float>(dim[0]),
+                1.f / static_cast<float>(dim[1]),
+                1.f / static_cast<float>(dim[2]),
                 1.f)).xyz()));
-    auto limits = cr::getLimitsVolumeData(*m_volumeData);
-    m_volumeDataMin = std::get<0>(limits);
-    m_volumeDataMax = std::get<1>(limits);
-    m_histogramBins = cr::bucketVolumeData(
-        *m_volumeData,
-        m_binNumberHistogram,
-        m_histogramIntervalMin,
-        m_histogramIntervalMax);
-    m_volumeTex = cr::loadScalarVolumeTex(*m_volumeData);
     m_boundingBoxMin = m_volumeModelMx * glm::vec4(glm::vec3(-0.5f), 1.f);
     m_boundingBoxMax = m_volumeModelMx * glm::vec4(glm::vec3(0.5f), 1.f);
+    m_volumeSettingsDirty = true;
+}
+
+void mvr::Renderer::updateMacrocellMask()
+{
+    std::array<size_t, 3> count = m_macrocells.getCellCount();
+    float range = m_volumeDataMax - m_volumeDataMin;
+    float intervalMin = glm::clamp(
+        (m_mappedIntervalMin - m_volumeDataMin) / range, 0.f, 1.f);
+    float intervalMax = glm::clamp(
+        (m_mappedIntervalMax - m_volumeDataMin) / range, 0.f, 1.f);
+    float isovalue = glm::clamp(
+        (m_isovalue - m_volumeDataMin) / range, 0.f, 1.f);
+    std::tuple<float, float> window(m_volumeDataMin, m_volumeDataMax);
+    float margin = 0.f;
+    util::tf::discreteTf1D_t tf = m_transferFunction.getDiscretized(0.f, 1.f);
+    std::vector<size_t> visibleTexels(tf.size() + 1, 0);
+    std::vector<float> key = {
+        static_cast<float>(m_renderMode), m_volumeDataMin, m_volumeDataMax,
+        intervalMin, intervalMax, isovalue, m_volumeTexScale,
+        m_volumeTexOffset};
+
+    // the transfer function only matters through its opacity
+    for (size_t i = 0; i < tf.size(); ++i)
+    {
+        key.push_back(tf[i][3]);
+        visibleTexels[i + 1] = visibleTexels[i] +
+            ((tf[i][3] > EMPTY_SPACE_MAX_ALPHA) ? 1 : 0);
+    }
+    if (key == m_macrocellMaskKey)
+        return;
+    m_macrocellMaskKey = key;
+
+    // quantized textures clamp the values to their window and round them
+    if (cr::TextureFormat::native != m_volumeTexFormat)
+    {
+        window = getTextureWindow();
+        margin = 0.5f / 255.f * std::abs(m_volumeTexScale) / range;
+    }
+
+    std::vector<uint8_t> mask = m_macrocells.computeVisibility(
+        [&](float min, float max)
+        {
+            float lo = (glm::clamp(
+                min, std::get<0>(window), std::get<1>(window)) -
+                m_volumeDataMin) / range - margin;
+            float hi = (glm::clamp(
+                max, std::get<0>(window), std::get<1>(window)) -
+                m_volumeDataMin) / range + margin;
+
+            if (Mode::isosurface == m_renderMode)
+                return (lo <= isovalue) && (isovalue <= hi);
+
+            // samples outside of the mapped interval are ignored
+            lo = std::max(lo, intervalMin);
+            hi = std::min(hi, intervalMax);
+            if (lo > hi)
+                return false;
+
+            if (Mode::transfer_function != m_renderMode)
+                return hi > EMPTY_SPACE_MAX_VAL;
+
+            // texels of the transfer function that the linear filtering
+            // mixes for the positions of the value range
+            float res = static_cast<float>(tf.size());
+            float first = std::floor(
+                glm::mix(intervalMin, intervalMax, lo) * res - 0.5f);
+            float last = std::floor(
+                glm::mix(intervalMin, intervalMax, hi) * res - 0.5f) + 1.f;
+            size_t i0 = static_cast<size_t>(glm::clamp(first, 0.f, res - 1.f));
+            size_t i1 = static_cast<size_t>(glm::clamp(last, 0.f, res - 1.f));
+
+            return visibleTexels[i1 + 1] > visibleTexels[i0];
+        });
+
+    m_macrocellTex = util::texture::Texture3D(
+        GL_R8,
+        GL_RED,
+        0,
+        GL_UNSIGNED_BYTE,
+        GL_NEAREST,
+        GL_CLAMP_TO_EDGE,
+        count[0],
+        count[1],
+        count[2],
+        mask.data());
+}
+
+void mvr::Renderer::loadVolume(
+        cr::VolumeConfig volumeConfig, unsigned int timestep, bool stream)
+{
+    cr::PrefetchedTimestep prefetched;
+    cr::TimestepPreparation preparation = getTimestepPreparation();
+    bool prefetchHit = false;
+    bool backwards = (timestep < m_timestep) && !m_playback;
+    size_t level = 0;
+    size_t coarsest = 0;
+
+    // pick the finest level of detail that fits into the memory budget
+    if (!m_pyramid.isPyramidOf(volumeConfig))
+        m_pyramid = cr::VolumePyramid(volumeConfig);
+    level = m_pyramid.selectLevel(
+        static_cast<size_t>(std::max(m_lodMemoryBudget, 0)) << 20);
+    coarsest = m_pyramid.getNumLevels() - 1;
+    m_pyramidLoader.cancel();
+
+    // swap in the timestep if it was already loaded in the background
+    m_prefetcher.configure(m_pyramid.getLevel(level), false);
+    m_prefetcher.setPreparation(preparation);
+    prefetchHit = m_prefetcher.acquire(timestep, prefetched);
+
+    m_timestep = timestep;
+    size_t shown = level;
+    if (!prefetchHit)
+    {
+        // interactively the coarsest level is shown right away and the
+        // finer levels follow, batch rendering and playback show each
+        // timestep only once
+        if (!m_playback && (level < coarsest) &&
+            glfwGetWindowAttrib(m_window, GLFW_VISIBLE))
+            shown = coarsest;
+
+        const cr::VolumeConfig &levelConfig = m_pyramid.getLevel(shown);
+        prefetched.timestep = m_timestep;
+        prefetched.data = cr::loadScalarVolumeTimestep(
+            levelConfig, m_timestep, false);
+        prefetched.statistics = cr::getVolumeStatistics(
+            levelConfig, m_timestep, false, *prefetched.data);
+        prefetched.data->setLimits(prefetched.statistics.getLimits());
+
+        if (shown != level)
+            m_pyramidLoader.start(
+                m_pyramid, m_timestep, shown - 1, level, preparation);
+    }
+
+    // schedule the following timesteps
+    m_prefetcher.update(
+        m_timestep,
+        backwards,
+        static_cast<unsigned int>(std::max(m_prefetchTimesteps, 0)),
+        static_cast<size_t>(std::max(m_prefetchMemoryBudget, 0)) << 20);
+
+    setVolumeData(std::move(prefetched), shown, stream);
+}
+
+void mvr::Renderer::updateVolumeLevel()
+{
+    cr::PrefetchedTimestep loaded;
+    size_t level = 0;
+
+    if (!m_pyramidLoader.poll(loaded, level) ||
+        (loaded.timestep != m_timestep))
+        return;
+
+    setVolumeData(std::move(loaded), level, true);
+}
+
+void mvr::Renderer::setVolumeData(
+    cr::PrefetchedTimestep loaded, size_t level, bool stream)
+{
+    cr::TimestepPreparation preparation = getTimestepPreparation();
+    GLint maxTextureSize = 0;
+
+    // the latest data replaces a timestep that is still streamed
+    m_volumeStream.cancel();
+    m_gradientStream.cancel();
+    m_pendingTimestep = cr::PrefetchedTimestep();
+
+    // texels are only converted here if they are streamed, uploadVolumeTex
+    // converts them otherwise
+    if (loaded.preparation != preparation)
+    {
+        preparation.texels = preparation.texels && stream;
+        cr::prepareTimestep(loaded, preparation);
+    }
+
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxTextureSize);
+    if (stream && m_streamUploads && !m_brickAtlas &&
+        (nullptr != loaded.texels.getData()) &&
+        (*std::max_element(
+            loaded.texels.dim.begin(), loaded.texels.dim.end()) <=
+            static_cast<size_t>(maxTextureSize)))
+    {
+        size_t slabSize =
+            static_cast<size_t>(std::max(m_streamSlabSize, 1)) << 20;
+        const cr::VolumeTexels &texels = loaded.texels;
+        const cr::GradientVolume &gradients = loaded.gradients;
+
+        m_volumeStream.start(
+            texels.internalFormat,
+            GL_RED,
+            texels.glType,
+            texels.dim[0],
+            texels.dim[1],
+            texels.dim[2],
+            texels.texelSize,
+            texels.getData(),
+            slabSize);
+        if (m_precomputedGradients && gradients.isValid())
+            m_gradientStream.start(
+                GL_RGB8,
+                GL_RGB,
+                GL_UNSIGNED_BYTE,
+                gradients.getVolumeDim()[0],
+                gradients.getVolumeDim()[1],
+                gradients.getVolumeDim()[2],
+                3,
+                gradients.getData().data(),
+                slabSize);
+
+        // moving the timestep keeps the texels and gradients in place
+        m_pendingTimestep = std::move(loaded);
+        m_pendingLevel = level;
+        return;
+    }
+
+    m_volumeData = std::move(loaded.data);
+    m_volumeStatistics = std::move(loaded.statistics);
+    m_volumeLevel = level;
+
+    applyVolumeData(loaded, true);
+}
+
+void mvr::Renderer::updateVolumeStream()
+{
+    if (!m_volumeStream.isActive())
+        return;
+
+    // both textures are swapped in together
+    bool complete = m_volumeStream.update();
+    if (m_gradientStream.isActive())
+        complete = m_gradientStream.update() && complete;
+    if (!complete)
+        return;
+
+    bool gradientsUploaded = m_gradientStream.isActive();
+    const cr::VolumeTexels &texels = m_pendingTimestep.texels;
+
+    m_volumeStream.exchange(m_volumeTex);
+    if (gradientsUploaded)
+        m_gradientStream.exchange(m_gradientTex);
+    m_volumeAtlas = cr::BrickAtlas();
+    m_volumeTexFormat = texels.format;
+    m_volumeTexScale = texels.valueScale;
+    m_volumeTexOffset = texels.valueOffset;
+
+    m_volumeData = std::move(m_pendingTimestep.data);
+    m_volumeStatistics = std::move(m_pendingTimestep.statistics);
+    m_volumeLevel = m_pendingLevel;
+
+    applyVolumeData(m_pendingTimestep, false, gradientsUploaded);
+    m_pendingTimestep = cr::PrefetchedTimestep();
+}
+
+void mvr::Renderer::applyVolumeData(
+    cr::PrefetchedTimestep &prepared, bool upload, bool gradientsUploaded)
+{
+    cr::TimestepPreparation preparation = getTimestepPreparation();
+    auto limits = m_volumeStatistics.getLimits();
+
+    m_volumeDataMin = std::get<0>(limits);
+    m_volumeDataMax = std::get<1>(limits);
+
+    // the histogram settings may have changed while the texture was streamed
+    if (prepared.preparation.enabled &&
+        (prepared.preparation.histogramBins == preparation.histogramBins) &&
+        (prepared.preparation.histogramMin == preparation.histogramMin) &&
+        (prepared.preparation.histogramMax == preparation.histogramMax))
+        m_histogramBins = std::move(prepared.histogram);
+    else
+        m_histogramBins = m_volumeStatistics.rebin(
+            m_binNumberHistogram,
+            m_histogramIntervalMin,
+            m_histogramIntervalMax);
+
+    if (upload)
+        uploadVolumeTex(&prepared);
+    else
+        finishVolumeUpload(*m_volumeData, &prepared, gradientsUploaded);
 }
 //-----------------------------------------------------------------------------
 // helper functions
@@ -1891,16 +2909,234 @@ void mvr::Renderer::updatePingPongFramebufferObjects()
 void::mvr::Renderer::reloadShaders()
 {
     std::cout << "Reloading shaders..." << std::endl;
-    m_shaderQuad = Shader("src/shader/quad.vert", "src/shader/quad.frag");
-    m_shaderFrame = Shader("src/shader/frame.vert", "src/shader/frame.frag");
-    m_shaderVolume =
-        Shader("src/shader/volume.vert", "src/shader/volume.frag");
-    m_shaderTfColor =
-        Shader("src/shader/tfColor.vert", "src/shader/tfColor.frag");
-    m_shaderTfFunc =
-        Shader("src/shader/tfFunc.vert", "src/shader/tfFunc.frag");
-    m_shaderTfPoint =
-        Shader("src/shader/tfPoint.vert", "src/shader/tfPoint.frag");
+    m_shaderSourcesFromDisk = true;
+    m_shaderQuad = loadShader("quad");
+    m_shaderFrame = loadShader("frame");
+    m_shaderVolume = buildVolumeShader();
+    m_shaderTfColor = loadShader("tfColor");
+    m_shaderTfFunc = loadShader("tfFunc");
+    m_shaderTfPoint = loadShader("tfPoint");
+
+    // variants are rebuilt from the new sources on demand
+    m_volumeShaderVariants.clear();
+    m_volumeShaderTimes.clear();
+}
+
+unsigned int mvr::Renderer::getVolumeShaderKey() const
+{
+    bool macrocells = m_emptySpaceSkipping &&
+        (Skipping::macrocells == m_skippingMethod) && m_macrocells.isValid();
+    bool preIntegration =
+        m_preIntegration && (Mode::transfer_function == m_renderMode);
+    unsigned int key = static_cast<unsigned int>(m_renderMode) & 3u;
+
+    key |= (Gradient::sobel_operators == m_gradientMethod) ? 1u << 2 : 0u;
+    key |= (m_gradientTex.getID() != 0) ? 1u << 3 : 0u;
+    key |= m_emptySpaceSkipping ? 1u << 4 : 0u;
+    key |= macrocells ? 1u << 5 : 0u;
+    key |= m_ambientOcclusion ? 1u << 6 : 0u;
+    key |= m_isovalueDenoising ? 1u << 7 : 0u;
+    key |= m_invertColors ? 1u << 8 : 0u;
+    key |= m_slicingPlane ? 1u << 9 : 0u;
+    key |= preIntegration ? 1u << 10 : 0u;
+    key |= m_volumeAtlas.isValid() ? 1u << 11 : 0u;
+
+    return key;
+}
+
+std::string mvr::Renderer::getVolumeShaderLabel(unsigned int key) const
+{
+    const char* modes[] = {"LOS", "MIP", "ISO", "TF"};
+    std::string label = modes[key & 3u];
+
+    label += (key & (1u << 2)) ? " sobel" : " central";
+    if (key & (1u << 3)) label += " gradtex";
+    if (key & (1u << 4))
+        label += (key & (1u << 5)) ? " skip:cells" : " skip:ahead";
+    if (key & (1u << 6)) label += " ao";
+    if (key & (1u << 7)) label += " denoise";
+    if (key & (1u << 8)) label += " invert";
+    if (key & (1u << 9)) label += " slice";
+    if (key & (1u << 10)) label += " preint";
+    if (key & (1u << 11)) label += " atlas";
+
+    return label;
+}
+
+mvr::VolumeShader& mvr::Renderer::accessVolumeShader()
+{
+    if (!m_shaderVariants)
+        return m_shaderVolume;
+
+    unsigned int key = getVolumeShaderKey();
+    auto variant = m_volumeShaderVariants.find(key);
+    if (m_volumeShaderVariants.end() != variant)
+        return variant->second;
+
+    auto flag = [key](unsigned int bit) {
+        return (key & (1u << bit)) ? "true" : "false";
+    };
+    std::string defines =
+        "#define SPECIALIZED\n"
+        "#define SPEC_MODE " + std::to_string(key & 3u) + "\n"
+        "#define SPEC_GRAD_METHOD " + std::to_string((key >> 2) & 1u) + "\n"
+        "#define SPEC_PRECOMPUTED_GRADIENTS " + flag(3) + "\n"
+        "#define SPEC_EMPTY_SPACE_SKIPPING " + flag(4) + "\n"
+        "#define SPEC_SKIP_METHOD " + std::to_string((key >> 5) & 1u) + "\n"
+        "#define SPEC_AMBIENT_OCCLUSION " + flag(6) + "\n"
+        "#define SPEC_ISO_DENOISE " + flag(7) + "\n"
+        "#define SPEC_INVERT_COLORS " + flag(8) + "\n"
+        "#define SPEC_SLICE_VOLUME " + flag(9) + "\n"
+        "#define SPEC_PRE_INTEGRATION " + flag(10) + "\n"
+        "#define SPEC_BRICK_ATLAS " + flag(11);
+
+    return m_volumeShaderVariants.emplace(
+        key, buildVolumeShader(defines)).first->second;
+}
+
+Shader mvr::Renderer::loadShader(
+    const std::string &name,
+    const std::string &defines) const
+{
+    return Shader::fromSource(
+        getShaderSource(name + ".vert", m_shaderSourcesFromDisk),
+        getShaderSource(name + ".frag", m_shaderSourcesFromDisk),
+        std::string(),
+        defines);
+}
+
+mvr::VolumeShader mvr::Renderer::buildVolumeShader(
+    const std::string &defines)
+{
+    Shader shader = loadShader("volume", defines);
+    VolumeUniforms uniforms;
+
+    shader.use();
+    shader.setInt("volumeTex", 0);
+    shader.setInt("transferfunctionTex", 1);
+    shader.setInt("seed", 2);
+    shader.setInt("stateIn", 3);
+    shader.setInt("macrocellTex", 4);
+    shader.setInt("preIntegrationTex", 5);
+    shader.setInt("gradientTex", 6);
+    shader.setInt("pageTableTex", 7);
+    shader.setUniformBlockBinding("VolumeSettings", VOLUME_SETTINGS_BINDING);
+
+    uniforms.useSeed = shader.getUniformLocation("useSeed");
+    uniforms.winWidth = shader.getUniformLocation("winWidth");
+    uniforms.winHeight = shader.getUniformLocation("winHeight");
+    uniforms.modelMX = shader.getUniformLocation("modelMX");
+    uniforms.pvmMX = shader.getUniformLocation("pvmMX");
+    uniforms.eyePos = shader.getUniformLocation("eyePos");
+    uniforms.bbMin = shader.getUniformLocation("bbMin");
+    uniforms.bbMax = shader.getUniformLocation("bbMax");
+    uniforms.macrocellScale = shader.getUniformLocation("macrocellScale");
+    uniforms.brickVolumeDim = shader.getUniformLocation("brickVolumeDim");
+    uniforms.brickSize = shader.getUniformLocation("brickSize");
+    uniforms.mode = shader.getUniformLocation("mode");
+    uniforms.gradMethod = shader.getUniformLocation("gradMethod");
+    uniforms.precomputedGradients =
+        shader.getUniformLocation("precomputedGradients");
+    uniforms.emptySpaceSkipping =
+        shader.getUniformLocation("emptySpaceSkipping");
+    uniforms.skipMethod = shader.getUniformLocation("skipMethod");
+    uniforms.ambientOcclusion = shader.getUniformLocation("ambientOcclusion");
+    uniforms.isoDenoise = shader.getUniformLocation("isoDenoise");
+    uniforms.invertColors = shader.getUniformLocation("invertColors");
+    uniforms.sliceVolume = shader.getUniformLocation("sliceVolume");
+    uniforms.preIntegration = shader.getUniformLocation("preIntegration");
+    uniforms.brickAtlas = shader.getUniformLocation("brickAtlas");
+
+    return VolumeShader{std::move(shader), uniforms};
+}
+
+void mvr::Renderer::timeVolumePass(bool begin)
+{
+    if (!begin)
+    {
+        if (m_volumeTimerRunning)
+            glEndQuery(GL_TIME_ELAPSED);
+        m_volumeTimerPending = m_volumeTimerPending || m_volumeTimerRunning;
+        m_volumeTimerRunning = false;
+        return;
+    }
+
+    if (0 == m_volumeTimerQuery)
+        glGenQueries(1, &m_volumeTimerQuery);
+
+    if (m_volumeTimerPending)
+    {
+        // the last query has not finished on the GPU -> skip this frame
+        GLint available = 0;
+        glGetQueryObjectiv(
+            m_volumeTimerQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return;
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(m_volumeTimerQuery, GL_QUERY_RESULT, &elapsed);
+        float ms = static_cast<float>(elapsed) * 1e-6f;
+        adaptRenderScale(ms, m_volumeTimerScale);
+        // only full resolution frames are comparable between the variants
+        if (1.f == m_volumeTimerScale)
+        {
+            auto time = m_volumeShaderTimes.find(m_volumeTimerKey);
+            if (m_volumeShaderTimes.end() == time)
+                m_volumeShaderTimes[m_volumeTimerKey] = ms;
+            else
+                time->second = 0.95f * time->second + 0.05f * ms;
+        }
+        m_volumeTimerPending = false;
+    }
+
+    // the generic shader is recorded under a key that no variant uses
+    m_volumeTimerKey = m_shaderVariants ? getVolumeShaderKey() : ~0u;
+    m_volumeTimerScale = m_renderScale;
+    glBeginQuery(GL_TIME_ELAPSED, m_volumeTimerQuery);
+    m_volumeTimerRunning = true;
+}
+
+void mvr::Renderer::updateRenderScale()
+{
+    double now = glfwGetTime();
+
+    if ((m_cameraPosition != m_lastCameraPosition) ||
+        (m_cameraLookAt != m_lastCameraLookAt) ||
+        (m_fovY != m_lastFovY) ||
+        (m_transferFunction.getRevision() != m_lastTfRevision))
+    {
+        m_lastInteraction = now;
+        m_lastCameraPosition = m_cameraPosition;
+        m_lastCameraLookAt = m_cameraLookAt;
+        m_lastFovY = m_fovY;
+        m_lastTfRevision = m_transferFunction.getRevision();
+    }
+
+    m_renderScale = 1.f;
+    if (m_adaptiveResolution && m_screenshotFile.empty() &&
+        (now - m_lastInteraction < m_interactionIdleTime))
+        m_renderScale = m_interactionScale;
+
+    for (size_t i = 0; i < 2; ++i)
+        m_renderedDimensions[i] = std::max(1u, static_cast<unsigned int>(
+            std::lround(m_renderScale * m_renderingDimensions[i])));
+}
+
+/**
+ * The time of the volume pass is assumed to grow with the number of pixels,
+ * i.e. with the square of the scale. The new scale is averaged with the old
+ * one, so that single outliers do not make the resolution jump.
+ */
+void mvr::Renderer::adaptRenderScale(float ms, float scale)
+{
+    if ((ms <= 0.f) || (m_targetFrameTime <= 0.f))
+        return;
+
+    float fit = scale * std::sqrt(m_targetFrameTime / ms);
+    m_interactionScale = glm::clamp(
+        0.5f * (m_interactionScale + fit),
+        glm::clamp(m_minRenderScale, 0.01f, 1.f),
+        1.f);
 }
 
 void mvr::Renderer::resizeRendering(
@@ -2074,13 +3310,8 @@ void mvr::Renderer::key_cb(
                 "./screenshots/%F_%H%M%S.tiff",
                 tm);
 
-        util::makeScreenshot(
-            pThis->m_framebuffers[0],
-            pThis->m_renderingDimensions[0],
-            pThis->m_renderingDimensions[1],
-            filename,
-            FIF_TIFF);
-        std::cout << "Saved screenshot " << filename << std::endl;
+        pThis->m_screenshotFile = filename;
+        std::cout << "Saving screenshot " << filename << std::endl;
     }
     // chain ImGui callback
     ImGui_ImplGlfw_KeyCallback(window, key, scancode, action, mods);
@@ -2126,6 +3357,10 @@ extern "C"
         { return obj->loadConfigFromFile(std::string(path)); }
     int Renderer_renderToFile(mvr::Renderer* obj, char* path)
         { return obj->renderToFile(std::string(path)); }
+    int Renderer_renderTimeSeriesToFiles(mvr::Renderer* obj, char* path)
+        { return obj->renderTimeSeriesToFiles(std::string(path)); }
+    int Renderer_flushOutputFiles(mvr::Renderer* obj)
+        { return obj->flushOutputFiles(); }
     int Renderer_saveConfigToFile(mvr::Renderer* obj, char* path)
         { return obj->saveConfigToFile(std::string(path)); }
     int Renderer_loadVolumeFromFile(
@@ -2,6 +2,8 @@
 
 #include <memory>
 #include <array>
+#include <map>
+#include <string>
 
 #include <GL/gl3w.h>
 #include <GLFW/glfw3.h>
@@ -13,8 +15,17 @@
 using json = nlohmann::json;
 
 #include "util/util.hpp"
+#include "util/texturestream.hpp"
+#include "util/readback.hpp"
 #include "shader.hpp"
 #include "configraw.hpp"
+#include "prefetch.hpp"
+#include "pyramid.hpp"
+#include "macrocell.hpp"
+#include "brickatlas.hpp"
+#include "gradient.hpp"
+#include "statistics.hpp"
+#include "quantize.hpp"
 
 namespace mvr
 {
@@ -51,6 +62,21 @@ namespace mvr
             {Gradient::central_differences, "central_differences"},
             {Gradient::sobel_operators, "sobel_operators"}});
 
+    /**
+     * Acceleration method for skipping parts of the volume that do not
+     * contribute to the image
+     */
+    enum class Skipping : int
+    {
+        look_ahead = 0,
+        macrocells
+    };
+
+    NLOHMANN_JSON_SERIALIZE_ENUM(
+        Skipping, {
+            {Skipping::look_ahead, "look_ahead"},
+            {Skipping::macrocells, "macrocells"}});
+
     /**
      * Selection setting for which output shall be shown. Can be used for
      * debugging purposes.
@@ -82,6 +108,88 @@ namespace mvr
             {Projection::perspective, "perspective"},
             {Projection::orthographic, "orthographic"}});
 
+    /**
+     * \brief CPU side of the VolumeSettings uniform block in volume.frag
+     *
+     * The members follow the std140 layout of the block: every vec3 shares a
+     * 16 byte slot with the scalar that follows it.
+     */
+    struct VolumeSettingsBlock
+    {
+        GLfloat lightDir[3];
+        GLfloat kAmb;
+        GLfloat ambient[3];
+        GLfloat kDiff;
+        GLfloat diffuse[3];
+        GLfloat kSpec;
+        GLfloat specular[3];
+        GLfloat kExp;
+        GLfloat bgColor[3];
+        GLfloat brightness;
+        GLfloat slicePlaneNormal[3];
+        GLfloat isovalue;
+        GLfloat slicePlaneBase[3];
+        GLfloat isoDenoiseR;
+
+        GLfloat volumeTexScale;
+        GLfloat volumeTexOffset;
+        GLfloat valIntervalMin;
+        GLfloat valIntervalMax;
+
+        GLfloat stepSize;
+        GLfloat stepSizeVoxel;
+        GLfloat aoProportion;
+        GLfloat aoRadius;
+
+        GLint aoSamples;
+        GLint invertAlpha;
+        GLint padding[2];
+    };
+
+    static_assert(sizeof(VolumeSettingsBlock) == 160,
+        "VolumeSettingsBlock does not match the std140 layout");
+
+    /**
+     * \brief locations of the uniforms the volume pass sets every frame
+     *
+     * They are resolved once when the shader is built. Uniforms that are
+     * compile time constants of a shader variant have the location -1.
+     */
+    struct VolumeUniforms
+    {
+        GLint useSeed = -1;
+        GLint winWidth = -1;
+        GLint winHeight = -1;
+        GLint modelMX = -1;
+        GLint pvmMX = -1;
+        GLint eyePos = -1;
+        GLint bbMin = -1;
+        GLint bbMax = -1;
+        GLint macrocellScale = -1;
+        GLint brickVolumeDim = -1;
+        GLint brickSize = -1;
+        GLint mode = -1;
+        GLint gradMethod = -1;
+        GLint precomputedGradients = -1;
+        GLint emptySpaceSkipping = -1;
+        GLint skipMethod = -1;
+        GLint ambientOcclusion = -1;
+        GLint isoDenoise = -1;
+        GLint invertColors = -1;
+        GLint sliceVolume = -1;
+        GLint preIntegration = -1;
+        GLint brickAtlas = -1;
+    };
+
+    /**
+     * \brief volume shader and the uniform locations of its program
+     */
+    struct VolumeShader
+    {
+        Shader shader;
+        VolumeUniforms uniforms;
+    };
+
     /**
      * \brief volume renderer for dynamic 3D scalar data
      *
@@ -104,6 +212,8 @@ namespace mvr
         int run();
         int loadConfigFromFile(std::string path);
         int renderToFile(std::string path);
+        int renderTimeSeriesToFiles(std::string path);
+        int flushOutputFiles();
         int saveConfigToFile(std::string path);
         int saveTransferFunctionToFile(std::string path);
         int loadVolumeFromFile(std::string path, unsigned int timestep = 0);
@@ -116,6 +226,14 @@ namespace mvr
         static constexpr int REQUIRED_OGL_VERSION_MINOR = 3;
 
         static constexpr size_t MAX_FILEPATH_LENGTH = 200;
+        static constexpr int DEFAULT_PAGED_REGION_SIZE = 512;
+
+        // thresholds of the empty space skipping, same as in volume.frag
+        static constexpr float EMPTY_SPACE_MAX_ALPHA = 0.00001f;
+        static constexpr float EMPTY_SPACE_MAX_VAL = 0.00001f;
+
+        // binding point of the VolumeSettings uniform block
+        static constexpr GLuint VOLUME_SETTINGS_BINDING = 0;
 
         static const std::string DEFAULT_VOLUME_FILE;
 
@@ -157,10 +275,35 @@ namespace mvr
         unsigned int m_timestep;
         float m_outputDataZSlice;
 
+        // time series playback and prefetching
+        bool m_playback;
+        int m_prefetchTimesteps;
+        int m_prefetchMemoryBudget;
+        bool m_streamUploads;
+        int m_streamSlabSize;
+
+        // level of detail selection
+        int m_lodMemoryBudget;
+
+        // conversion of the volume data for the GPU
+        cr::TextureFormat m_textureFormat;
+        cr::ValueWindow m_textureWindow;
+        std::array<float, 2> m_textureWindowRange;
+        std::array<float, 2> m_texturePercentiles;
+        bool m_brickAtlas;
+
+        // region of out of core volumes that is uploaded to the GPU
+        std::array<int, 3> m_pagedRegionOrigin;
+        std::array<int, 3> m_pagedRegionSize;
+
         // ray casting
         float m_stepSize;
         bool m_emptySpaceSkipping;
+        Skipping m_skippingMethod;
         Gradient m_gradientMethod;
+        bool m_precomputedGradients;
+        bool m_preIntegration;
+        bool m_shaderVariants;
 
         // camera settings
         float m_fovY;
@@ -173,6 +316,21 @@ namespace mvr
         float m_cameraTranslationSpeed;
         Projection m_projection;
 
+        // reduced resolution while the camera or transfer function changes
+        bool m_adaptiveResolution;
+        float m_targetFrameTime;        //!< GPU time of the volume pass in ms
+        float m_minRenderScale;
+        float m_interactionIdleTime;    //!< in s until full resolution
+        float m_interactionScale;       //!< adapted scale while interacting
+        float m_renderScale;            //!< scale of the current frame
+        std::array<unsigned int, 2> m_renderedDimensions;
+        double m_lastInteraction;       //!< glfwGetTime() of the last change
+        glm::vec3 m_lastCameraPosition;
+        glm::vec3 m_lastCameraLookAt;
+        float m_lastFovY;
+        size_t m_lastTfRevision;
+        std::string m_screenshotFile;   //!< saved after the next full frame
+
         // isosurface mode
         float m_isovalue;
         bool m_isovalueDenoising;
@@ -210,12 +368,34 @@ namespace mvr
         // shader and rendering targets
         Shader m_shaderQuad;
         Shader m_shaderFrame;
-        Shader m_shaderVolume;
+        VolumeShader m_shaderVolume;
         Shader m_shaderTfColor;
         Shader m_shaderTfFunc;
         Shader m_shaderTfPoint;
 
+        // variants of the volume shader keyed by their feature bits and the
+        // smoothed GPU time of the volume pass in ms per variant
+        std::map<unsigned int, VolumeShader> m_volumeShaderVariants;
+        std::map<unsigned int, float> m_volumeShaderTimes;
+        GLuint m_volumeTimerQuery;
+        unsigned int m_volumeTimerKey;
+        bool m_volumeTimerRunning;      //!< query started in this frame
+        bool m_volumeTimerPending;      //!< result has not been read yet
+        float m_volumeTimerScale;       //!< render scale of the query
+
+        // uniform buffer with the settings of the volume shader, the content
+        // that was uploaded last and if a setting has changed since then
+        GLuint m_volumeSettingsUbo;
+        VolumeSettingsBlock m_volumeSettings;
+        bool m_volumeSettingsDirty;
+        bool m_shaderSourcesFromDisk;
+
         std::array<util::FramebufferObject, 2> m_framebuffers;
+
+        // image files are read back and encoded while rendering continues
+        bool m_asyncReadback;
+        util::ReadbackPipeline m_readback;
+
         util::FramebufferObject m_tfColorWidgetFBO;
         util::FramebufferObject m_tfFuncWidgetFBO;
 
@@ -234,12 +414,30 @@ namespace mvr
         glm::mat4 m_quadProjMx;
 
         // volume data
-        std::vector<util::bin_t> m_histogramBins;
+        util::Histogram m_histogramBins;
         util::tf::TransferFuncRGBA1D m_transferFunction;
         std::unique_ptr<cr::VolumeDataBase> m_volumeData;
         float m_volumeDataMin;
         float m_volumeDataMax;
+        cr::VolumeStatistics m_volumeStatistics;
         util::texture::Texture3D m_volumeTex;
+        cr::TextureFormat m_volumeTexFormat;
+        float m_volumeTexScale;
+        float m_volumeTexOffset;
+        std::array<size_t, 3> m_volumeTexDim;
+        cr::BrickAtlas m_volumeAtlas;
+        util::texture::TextureStream3D m_volumeStream;
+        cr::PrefetchedTimestep m_pendingTimestep;   //!< data of the texture
+        size_t m_pendingLevel;                      //!< that is streamed
+        cr::TimestepPrefetcher m_prefetcher;
+        cr::VolumePyramid m_pyramid;
+        size_t m_volumeLevel;
+        cr::PyramidLoader m_pyramidLoader;
+        cr::MacrocellGrid m_macrocells;
+        util::texture::Texture3D m_macrocellTex;
+        std::vector<float> m_macrocellMaskKey;
+        util::texture::Texture3D m_gradientTex;
+        util::texture::TextureStream3D m_gradientStream;
 
         // miscellaneous
         util::texture::Texture2D m_randomSeedTex;
@@ -263,9 +461,91 @@ namespace mvr
 
         /**
          * \brief updates the volume data, texture, histogram information...
+         *
+         * \param stream true if the texture may be streamed over the next
+         *        frames (see setVolumeData), the previous timestep is shown
+         *        until then
         */
         void loadVolume(
-                cr::VolumeConfig volumeConfig, unsigned int timestep = 0);
+                cr::VolumeConfig volumeConfig,
+                unsigned int timestep = 0,
+                bool stream = false);
+
+        /**
+         * \brief converts the loaded volume data into the volume texture
+         *
+         * \param prepared derived data of the loaded volume data, if any
+         *
+         * Of paged volumes only the selected region is uploaded. The model
+         * matrix is fitted to the uploaded data.
+        */
+        void uploadVolumeTex(cr::PrefetchedTimestep *prepared = nullptr);
+
+        /**
+         * \brief updates the visible macrocells for the current settings
+         *
+         * The mask is only recomputed if the render mode, the value
+         * intervals or the transfer function have changed.
+        */
+        void updateMacrocellMask();
+
+        /**
+         * \brief swaps in a finer level of detail once it is loaded
+        */
+        void updateVolumeLevel();
+
+        /**
+         * \brief shows loaded volume data
+         *
+         * \param stream true to upload the texture in slabs through pixel
+         *        buffers while the current data stays visible. In core data
+         *        without brick atlas is streamed if uploads are streamed,
+         *        everything else is shown right away.
+         *
+         * Data that was not prepared with the current settings by a worker
+         * is prepared here (see cr::prepareTimestep).
+        */
+        void setVolumeData(
+            cr::PrefetchedTimestep loaded, size_t level, bool stream);
+
+        /**
+         * \brief uploads the next slabs of the streamed volume and gradient
+         *        textures and shows their data once both are complete
+        */
+        void updateVolumeStream();
+
+        /**
+         * \brief updates limits, histogram and texture of new volume data
+         *
+         * \param prepared derived data of the new volume data
+         * \param upload false if m_volumeTex already holds the data
+         * \param gradientsUploaded true if m_gradientTex already holds the
+         *        gradients of prepared
+        */
+        void applyVolumeData(
+            cr::PrefetchedTimestep &prepared,
+            bool upload,
+            bool gradientsUploaded = false);
+
+        /**
+         * \brief updates everything that depends on the uploaded data: the
+         *        macrocells, the gradients and the model matrix
+         *
+         * \param prepared derived data of volumeData, computed here if
+         *        missing
+         * \param gradientsUploaded true if m_gradientTex already holds the
+         *        gradients of prepared
+        */
+        void finishVolumeUpload(
+            const cr::VolumeDataBase &volumeData,
+            cr::PrefetchedTimestep *prepared = nullptr,
+            bool gradientsUploaded = false);
+
+        /**
+         * \brief how loaded timesteps are prepared with the current settings
+        */
+        cr::TimestepPreparation getTimestepPreparation() const;
+        std::tuple<float, float> getTextureWindow() const;
 
         //---------------------------------------------------------------------
         // helper functions
@@ -283,6 +563,76 @@ namespace mvr
 
         void reloadShaders();
 
+        /**
+         * \brief feature bits of the volume shader for the current settings
+         *
+         * bits 0-1: render mode, 2: gradient method, 3: precomputed
+         * gradients, 4: empty space skipping, 5: macrocells, 6: ambient
+         * occlusion, 7: isosurface denoising, 8: inverted colors, 9: slicing
+         * plane, 10: pre-integration, 11: brick atlas
+        */
+        unsigned int getVolumeShaderKey() const;
+        std::string getVolumeShaderLabel(unsigned int key) const;
+
+        /**
+         * \brief returns the volume shader for the current settings
+         *
+         * If shader variants are enabled, a variant with the features fixed
+         * at compile time is built on first use and cached. Otherwise the
+         * generic shader that reads all features from uniforms is returned.
+        */
+        VolumeShader& accessVolumeShader();
+
+        /**
+         * \brief builds the volume shader, assigns its texture units and
+         *        uniform block binding, which do not change per frame, and
+         *        resolves the locations of the per-frame uniforms
+        */
+        VolumeShader buildVolumeShader(
+            const std::string &defines = std::string());
+
+        /**
+         * \brief builds the program of <name>.vert and <name>.frag
+         *
+         * The embedded sources are used until the shaders are reloaded,
+         * afterwards the sources are read from src/shader.
+        */
+        Shader loadShader(
+            const std::string &name,
+            const std::string &defines = std::string()) const;
+
+        /**
+         * \brief uploads the VolumeSettings uniform block if a setting has
+         *        changed since the last upload
+        */
+        void updateVolumeSettings();
+
+        /**
+         * \brief measures the GPU time of the volume pass per shader variant
+         *
+         * Call with begin = true before and begin = false after the volume
+         * pass. Results are read without stalling once they are available.
+        */
+        void timeVolumePass(bool begin);
+
+        /**
+         * \brief selects the resolution of the next volume pass
+         *
+         * Changes of the camera or the transfer function start an
+         * interaction, during which the volume is rendered at the adapted
+         * scale. Full resolution is restored once nothing changed for the
+         * idle time or if a screenshot is pending.
+        */
+        void updateRenderScale();
+
+        /**
+         * \brief adapts the interaction scale to a measured volume pass
+         *
+         * \param ms GPU time of the volume pass
+         * \param scale render scale of the measured pass
+        */
+        void adaptRenderScale(float ms, float scale);
+
         void resizeRendering(int width, int height);
 
         void createHelpMarker(const char* desc);
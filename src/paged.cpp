@@ -0,0 +1,578 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <array>
+#include <tuple>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <type_traits>
+#include <algorithm>
+#include <cstring>
+
+#include "paged.hpp"
+#include "timestepindex.hpp"
+
+//-----------------------------------------------------------------------------
+// internal helpers
+//-----------------------------------------------------------------------------
+namespace
+{
+    /**
+     * \brief calls f with a null pointer of the C++ type of the datatype
+     *
+     * \return result of f, false for unknown datatypes
+     */
+    template<typename F>
+    bool dispatchType(cr::Datatype type, F &&f)
+    {
+        switch(type)
+        {
+            case cr::Datatype::unsigned_byte:
+                return f(static_cast<unsigned_byte_t*>(nullptr));
+
+            case cr::Datatype::signed_byte:
+                return f(static_cast<signed_byte_t*>(nullptr));
+
+            case cr::Datatype::unsigned_halfword:
+                return f(static_cast<unsigned_halfword_t*>(nullptr));
+
+            case cr::Datatype::signed_halfword:
+                return f(static_cast<signed_halfword_t*>(nullptr));
+
+            case cr::Datatype::unsigned_word:
+                return f(static_cast<unsigned_word_t*>(nullptr));
+
+            case cr::Datatype::signed_word:
+                return f(static_cast<signed_word_t*>(nullptr));
+
+            case cr::Datatype::unsigned_longword:
+                return f(static_cast<unsigned_longword_t*>(nullptr));
+
+            case cr::Datatype::signed_longword:
+                return f(static_cast<signed_longword_t*>(nullptr));
+
+            case cr::Datatype::single_precision_float:
+                return f(static_cast<single_precision_float_t*>(nullptr));
+
+            case cr::Datatype::double_precision_float:
+                return f(static_cast<double_precision_float_t*>(nullptr));
+
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * \brief reads the voxels of a brick from a raw or bricked file
+     *
+     * Called from the threads that fault in bricks, the parallel readers
+     * therefore run single threaded per brick.
+     *
+     * \return false if the brick could not be read completely, it must not
+     *         be cached then
+     */
+    template<typename T>
+    bool loadBrickT(
+        const cr::VolumeConfig &volumeConfig,
+        const std::string &path,
+        const cr::BrickIndex *index,
+        bool swap,
+        cr::PagedBrick &brick)
+    {
+        std::array<size_t, 3> subsetMin = volumeConfig.getSubsetMin();
+        std::array<size_t, 3> first, last;
+        T *buffer = reinterpret_cast<T*>(brick.data.data());
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+            first[i] = subsetMin[i] + brick.origin[i];
+            last[i] = first[i] + brick.extent[i] - 1;
+        }
+
+        if (nullptr != index)
+            return cr::loadBricked3dCuboid<T>(
+                *index, path, buffer, first, last, swap);
+
+        return cr::readSubset3dCuboid<T>(
+            path,
+            buffer,
+            volumeConfig.getOrigVolumeDim(),
+            first,
+            last,
+            swap,
+            nullptr,
+            volumeConfig.getRawFileOffset());
+    }
+}
+
+//-----------------------------------------------------------------------------
+// BrickCache Class Implementations
+//-----------------------------------------------------------------------------
+cr::BrickCache::BrickCache() :
+    m_budget(DEFAULT_PAGED_MEMORY_BUDGET << 20),
+    m_usage(0),
+    m_hits(0),
+    m_misses(0)
+{
+}
+
+cr::BrickCache& cr::BrickCache::getInstance()
+{
+    static BrickCache cache;
+    return cache;
+}
+
+void cr::BrickCache::setBudget(size_t budget)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = budget;
+    evict(0);
+}
+
+size_t cr::BrickCache::getBudget() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_budget;
+}
+
+size_t cr::BrickCache::getUsage() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_usage;
+}
+
+size_t cr::BrickCache::getHits() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+}
+
+size_t cr::BrickCache::getMisses() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+}
+
+std::shared_ptr<const cr::PagedBrick> cr::BrickCache::find(
+    uint64_t volume, size_t id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(Key(volume, id));
+
+    if (it == m_entries.end())
+    {
+        m_misses++;
+        return nullptr;
+    }
+
+    m_hits++;
+    m_lru.splice(m_lru.begin(), m_lru, it->second.position);
+
+    return it->second.brick;
+}
+
+std::shared_ptr<const cr::PagedBrick> cr::BrickCache::insert(
+    uint64_t volume,
+    size_t id,
+    std::shared_ptr<const PagedBrick> brick)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Key key(volume, id);
+    auto it = m_entries.find(key);
+
+    if (it != m_entries.end())
+        return it->second.brick;
+
+    evict(brick->data.size());
+    m_lru.push_front(key);
+    m_entries.emplace(key, Entry{brick, m_lru.begin()});
+    m_usage += brick->data.size();
+
+    return brick;
+}
+
+void cr::BrickCache::erase(uint64_t volume)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto first = m_entries.lower_bound(Key(volume, 0));
+    auto last = m_entries.lower_bound(Key(volume + 1, 0));
+
+    for (auto it = first; it != last; ++it)
+    {
+        m_usage -= it->second.brick->data.size();
+        m_lru.erase(it->second.position);
+    }
+    m_entries.erase(first, last);
+}
+
+/**
+ * \brief evicts bricks until the required memory fits into the budget,
+ *        the caller holds the lock
+ */
+void cr::BrickCache::evict(size_t required)
+{
+    while (!m_lru.empty() && (m_usage + required > m_budget))
+    {
+        auto it = m_entries.find(m_lru.back());
+
+        m_usage -= it->second.brick->data.size();
+        m_entries.erase(it);
+        m_lru.pop_back();
+    }
+}
+
+//-----------------------------------------------------------------------------
+// PagedVolumeData Class Implementations
+//-----------------------------------------------------------------------------
+cr::PagedVolumeData::PagedVolumeData(
+        VolumeConfig volumeConfig, unsigned int n, bool swap) :
+    VolumeDataBase(volumeConfig),
+    m_id(0),
+    m_path(volumeConfig.getTimestepFile(n)),
+    m_swap(swap),
+    m_brickSize(volumeConfig.getPagedBrickSize()),
+    m_brickCount{ {0, 0, 0} },
+    m_index(nullptr),
+    m_valid(false)
+{
+    static std::atomic<uint64_t> nextId(1);
+    std::array<size_t, 3> origDim = volumeConfig.getOrigVolumeDim();
+    std::array<size_t, 3> dim = volumeConfig.getVolumeDim();
+
+    m_id = nextId++;
+    BrickCache::getInstance().setBudget(volumeConfig.getPagedMemoryBudget());
+
+    if (FileFormat::bricked == volumeConfig.getFileFormat())
+    {
+        m_index = std::make_shared<const BrickIndex>(m_path);
+
+        if (!m_index->isValid() ||
+            (m_index->getVoxelType() != volumeConfig.getVoxelType()) ||
+            (m_index->getVolumeDim() != origDim))
+        {
+            std::cerr << "Error: " << m_path <<
+                " does not match the volume configuration." << std::endl;
+            return;
+        }
+        m_brickSize = m_index->getBrickSize();
+    }
+    else
+    {
+        uintmax_t required = volumeConfig.getRawFileOffset() +
+            origDim[0] * origDim[1] * origDim[2] *
+            volumeConfig.getVoxelSizeOf();
+
+        try
+        {
+            if (nullptr == volumeConfig.getTimestepIndex())
+                return;
+            if (volumeConfig.getTimestepIndex()->getFileSize(n) < required)
+            {
+                std::cerr << "Error: " << m_path <<
+                    " is smaller than the configured volume." << std::endl;
+                return;
+            }
+        }
+        catch(std::exception &e)
+        {
+            std::cerr << "Error: cannot open " << m_path << ": " <<
+                e.what() << std::endl;
+            return;
+        }
+    }
+
+    for (size_t i = 0; i < 3; ++i)
+        m_brickCount[i] = (dim[i] + m_brickSize - 1) / m_brickSize;
+
+    m_valid = true;
+}
+
+cr::PagedVolumeData::~PagedVolumeData()
+{
+    BrickCache::getInstance().erase(m_id);
+}
+
+std::array<size_t, 3> cr::PagedVolumeData::getBrickOrigin(size_t id) const
+{
+    return std::array<size_t, 3>{ {
+        (id % m_brickCount[0]) * m_brickSize,
+        ((id / m_brickCount[0]) % m_brickCount[1]) * m_brickSize,
+        (id / (m_brickCount[0] * m_brickCount[1])) * m_brickSize} };
+}
+
+std::array<size_t, 3> cr::PagedVolumeData::getBrickExtent(size_t id) const
+{
+    std::array<size_t, 3> origin = getBrickOrigin(id);
+    std::array<size_t, 3> dim = m_config.getVolumeDim();
+
+    return std::array<size_t, 3>{ {
+        std::min(m_brickSize, dim[0] - origin[0]),
+        std::min(m_brickSize, dim[1] - origin[1]),
+        std::min(m_brickSize, dim[2] - origin[2])} };
+}
+
+size_t cr::PagedVolumeData::getBrickId(std::array<size_t, 3> position) const
+{
+    return (position[0] / m_brickSize) + m_brickCount[0] * (
+        (position[1] / m_brickSize) +
+        m_brickCount[1] * (position[2] / m_brickSize));
+}
+
+std::shared_ptr<const cr::PagedBrick> cr::PagedVolumeData::getBrick(
+    size_t id) const
+{
+    std::shared_ptr<const PagedBrick> cached;
+    std::shared_ptr<PagedBrick> brick;
+
+    if (!m_valid || (id >= getNumBricks()))
+        return nullptr;
+
+    cached = BrickCache::getInstance().find(m_id, id);
+    if (nullptr != cached)
+        return cached;
+
+    brick = std::make_shared<PagedBrick>();
+    brick->origin = getBrickOrigin(id);
+    brick->extent = getBrickExtent(id);
+    brick->data.resize(brick->getVoxelCount() * m_config.getVoxelSizeOf());
+
+    bool loaded = dispatchType(m_config.getVoxelType(), [&](auto *tag) {
+        using T = typename std::remove_pointer<decltype(tag)>::type;
+        return loadBrickT<T>(
+            m_config, m_path, m_index.get(), m_swap, *brick);
+    });
+    if (!loaded)
+        return nullptr;
+
+    return BrickCache::getInstance().insert(m_id, id, std::move(brick));
+}
+
+bool cr::PagedVolumeData::readRegion(
+    std::array<size_t, 3> regionMin,
+    std::array<size_t, 3> regionMax,
+    void *buffer) const
+{
+    std::array<size_t, 3> dim = m_config.getVolumeDim();
+    std::array<size_t, 3> brickMin, brickMax;
+    std::vector<size_t> ids;
+    const size_t voxelSize = m_config.getVoxelSizeOf();
+    bool success = true;
+
+    if (!m_valid)
+        return false;
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        if ((regionMax[i] < regionMin[i]) || (regionMax[i] >= dim[i]))
+        {
+            std::cerr << "Error while reading paged data: invalid region!\n";
+            return false;
+        }
+        brickMin[i] = regionMin[i] / m_brickSize;
+        brickMax[i] = regionMax[i] / m_brickSize;
+    }
+
+    for (size_t bz = brickMin[2]; bz <= brickMax[2]; ++bz)
+    for (size_t by = brickMin[1]; by <= brickMax[1]; ++by)
+    for (size_t bx = brickMin[0]; bx <= brickMax[0]; ++bx)
+        ids.push_back(bx + m_brickCount[0] * (by + m_brickCount[1] * bz));
+
+    const size_t dimX = regionMax[0] - regionMin[0] + 1;
+    const size_t dimY = regionMax[1] - regionMin[1] + 1;
+
+    #pragma omp parallel for schedule(dynamic) reduction(&&:success)
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        std::shared_ptr<const PagedBrick> brick = getBrick(ids[i]);
+        std::array<size_t, 3> lo, hi;
+
+        if (nullptr == brick)
+        {
+            success = false;
+            continue;
+        }
+
+        // intersection of brick and region in volume coordinates
+        for (size_t j = 0; j < 3; ++j)
+        {
+            lo[j] = std::max(brick->origin[j], regionMin[j]);
+            hi[j] = std::min(
+                brick->origin[j] + brick->extent[j] - 1, regionMax[j]);
+        }
+
+        for (size_t z = lo[2]; z <= hi[2]; ++z)
+        for (size_t y = lo[1]; y <= hi[1]; ++y)
+        {
+            const char *src = brick->data.data() + voxelSize * (
+                (lo[0] - brick->origin[0]) +
+                (y - brick->origin[1]) * brick->extent[0] +
+                (z - brick->origin[2]) * brick->extent[0] * brick->extent[1]);
+            char *dst = static_cast<char*>(buffer) + voxelSize * (
+                (lo[0] - regionMin[0]) +
+                (y - regionMin[1]) * dimX +
+                (z - regionMin[2]) * dimX * dimY);
+
+            std::memcpy(dst, src, voxelSize * (hi[0] - lo[0] + 1));
+        }
+    }
+
+    if (!success)
+        std::cerr << "Error while reading paged data: cannot read " <<
+            m_path << std::endl;
+
+    return success;
+}
+
+std::unique_ptr<cr::VolumeDataBase> cr::PagedVolumeData::extractRegion(
+    std::array<size_t, 3> regionMin,
+    std::array<size_t, 3> regionMax) const
+{
+    VolumeConfig regionConfig = m_config.getRegionConfig(regionMin, regionMax);
+    std::unique_ptr<VolumeDataBase> volumeData = nullptr;
+
+    bool success = dispatchType(m_config.getVoxelType(), [&](auto *tag) {
+        using T = typename std::remove_pointer<decltype(tag)>::type;
+        std::tuple<float, float> limits(0.f, 0.f);
+        T *rawData = new T[regionConfig.getVoxelCount()];
+
+        // the buffer is owned by the volume data, also if the read failed
+        volumeData = std::make_unique<VolumeData<T>>(regionConfig, rawData);
+        if (!readRegion(regionMin, regionMax, rawData))
+            return false;
+
+        processValues(rawData, regionConfig.getVoxelCount(), false, limits);
+        volumeData->setLimits(limits);
+        return true;
+    });
+
+    if (!success)
+        return nullptr;
+
+    return volumeData;
+}
+
+double cr::PagedVolumeData::getVoxel(std::array<size_t, 3> position) const
+{
+    std::shared_ptr<const PagedBrick> brick = getBrick(getBrickId(position));
+    double value = 0.0;
+
+    if (nullptr == brick)
+        return value;
+
+    dispatchType(m_config.getVoxelType(), [&](auto *tag) {
+        using T = typename std::remove_pointer<decltype(tag)>::type;
+        value = static_cast<double>(brick->getValues<T>()[
+            (position[0] - brick->origin[0]) +
+            (position[1] - brick->origin[1]) * brick->extent[0] +
+            (position[2] - brick->origin[2]) *
+                brick->extent[0] * brick->extent[1]]);
+        return true;
+    });
+
+    return value;
+}
+
+/**
+ * Same semantics as processValues, all bricks are faulted in once.
+ */
+std::tuple<float, float> cr::PagedVolumeData::computeLimits() const
+{
+    std::tuple<float, float> limits(0.f, 0.f);
+
+    if (hasLimits())
+        return getLimits();
+
+    dispatchType(m_config.getVoxelType(), [&](auto *tag) {
+        using T = typename std::remove_pointer<decltype(tag)>::type;
+        T minimum = static_cast<T>(0.0);
+        T maximum = static_cast<T>(1.0);
+        bool success = true;
+
+        #pragma omp parallel for schedule(dynamic) \
+            reduction(min: minimum) \
+            reduction(max: maximum) \
+            reduction(&&: success)
+        for (size_t id = 0; id < getNumBricks(); ++id)
+        {
+            std::shared_ptr<const PagedBrick> brick = getBrick(id);
+
+            if (nullptr == brick)
+            {
+                success = false;
+                continue;
+            }
+
+            const T *values = brick->getValues<T>();
+            for (size_t i = 0; i < brick->getVoxelCount(); ++i)
+            {
+                if (values[i] < minimum) minimum = values[i];
+                if (values[i] > maximum) maximum = values[i];
+            }
+        }
+
+        if (0 < getNumBricks())
+            limits = std::tuple<float, float>(
+                static_cast<float>(minimum), static_cast<float>(maximum));
+        return success;
+    });
+
+    return limits;
+}
+
+util::Histogram cr::PagedVolumeData::bucket(
+    size_t numBins, float min, float max) const
+{
+    util::Histogram bins;
+
+    dispatchType(m_config.getVoxelType(), [&](auto *tag) {
+        using T = typename std::remove_pointer<decltype(tag)>::type;
+
+        #pragma omp parallel for schedule(dynamic)
+        for (size_t id = 0; id < getNumBricks(); ++id)
+        {
+            std::shared_ptr<const PagedBrick> brick = getBrick(id);
+
+            if (nullptr == brick)
+                continue;
+
+            util::Histogram brickBins = util::binData<T>(
+                numBins,
+                static_cast<T>(min),
+                static_cast<T>(max),
+                brick->getValues<T>(),
+                brick->getVoxelCount());
+
+            #pragma omp critical(pagedBucket)
+            {
+                if (bins.empty())
+                    bins = std::move(brickBins);
+                else if (!brickBins.empty())
+                    for (size_t i = 0; i < bins.size(); ++i)
+                        bins.counts[i] += brickBins.counts[i];
+            }
+        }
+        return true;
+    });
+
+    return bins;
+}
+
+//-----------------------------------------------------------------------------
+// convenience functions
+//-----------------------------------------------------------------------------
+/**
+ * \brief opens the n-th timestep for paged access
+ *
+ * \param volumeConfig configuration object of the volume dataset
+ * \param n number of the requested timestep (starting from 0)
+ * \param swap flag if the byte order of the read values shall be swapped
+ *
+ * \return paged volume data, no voxels are read until they are accessed
+ */
+std::unique_ptr<cr::VolumeDataBase> cr::loadPagedTimestep(
+    const VolumeConfig &volumeConfig, unsigned int n, bool swap)
+{
+    return std::make_unique<PagedVolumeData>(volumeConfig, n, swap);
+}
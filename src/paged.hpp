@@ -0,0 +1,205 @@
+#pragma once
+
+#include <string>
+#include <array>
+#include <vector>
+#include <list>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <cstdint>
+
+#include "util/util.hpp"
+#include "configraw.hpp"
+#include "bricked.hpp"
+
+namespace cr
+{
+    // ------------------------------------------------------------------------
+    // type definitions
+    // ------------------------------------------------------------------------
+    /**
+     * \brief voxels of a single brick of a paged volume
+     *
+     * The voxels are stored with x running fastest. Bricks at the upper
+     * borders of the volume are cropped to the volume.
+     */
+    struct PagedBrick
+    {
+        std::array<size_t, 3> origin;   //!< first voxel in the volume
+        std::array<size_t, 3> extent;   //!< number of voxels along each axis
+        std::vector<char> data;         //!< voxel values
+
+        size_t getVoxelCount() const
+        {
+            return extent[0] * extent[1] * extent[2];
+        }
+
+        template<typename T>
+        const T* getValues() const
+        {
+            return reinterpret_cast<const T*>(data.data());
+        }
+    };
+
+    // ------------------------------------------------------------------------
+    // class declarations
+    // ------------------------------------------------------------------------
+    /**
+     * \brief least recently used cache for the bricks of all paged volumes
+     *
+     * The cache only drops its own reference to evicted bricks; bricks that
+     * are still used by a consumer stay valid until they are released. The
+     * memory in use can thus exceed the budget by the bricks that are being
+     * processed at the same time.
+     */
+    class BrickCache
+    {
+        public:
+        static BrickCache& getInstance();
+
+        BrickCache(const BrickCache &other) = delete;
+        BrickCache& operator=(const BrickCache &other) = delete;
+
+        void setBudget(size_t budget);
+        size_t getBudget() const;
+        size_t getUsage() const;
+        size_t getHits() const;
+        size_t getMisses() const;
+
+        /**
+         * \brief cached brick or nullptr, marks the brick as used
+         */
+        std::shared_ptr<const PagedBrick> find(uint64_t volume, size_t id);
+
+        /**
+         * \brief adds a brick and evicts the least recently used bricks
+         *
+         * \return the brick in the cache, which is the one inserted by
+         *         another thread if the brick was loaded twice
+         */
+        std::shared_ptr<const PagedBrick> insert(
+            uint64_t volume,
+            size_t id,
+            std::shared_ptr<const PagedBrick> brick);
+
+        /**
+         * \brief drops all bricks of a volume
+         */
+        void erase(uint64_t volume);
+
+        private:
+        typedef std::pair<uint64_t, size_t> Key;
+
+        struct Entry
+        {
+            std::shared_ptr<const PagedBrick> brick;
+            std::list<Key>::iterator position;
+        };
+
+        BrickCache();
+        void evict(size_t required);
+
+        mutable std::mutex m_mutex;
+        std::map<Key, Entry> m_entries;
+        std::list<Key> m_lru;           //!< most recently used first
+        size_t m_budget;
+        size_t m_usage;
+        size_t m_hits;
+        size_t m_misses;
+    };
+
+    /**
+     * \brief out of core volume data that is read brick by brick on demand
+     *
+     * The (sub)volume of the configuration is split into bricks of the paged
+     * brick size of the configuration, bricked files use the brick size of
+     * the file instead. Consumers fault in the bricks they need through
+     * getBrick, readRegion or extractRegion; the bricks are kept in the
+     * shared BrickCache under the paged memory budget of the configuration.
+     */
+    class PagedVolumeData : public VolumeDataBase
+    {
+        public:
+        PagedVolumeData(VolumeConfig volumeConfig, unsigned int n, bool swap);
+        ~PagedVolumeData();
+
+        PagedVolumeData(const PagedVolumeData &other) = delete;
+        PagedVolumeData& operator=(const PagedVolumeData &other) = delete;
+
+        void* getRawData() const override { return nullptr; }
+        bool isMapped() const override { return false; }
+        bool isPaged() const override { return true; }
+        bool isValid() const { return m_valid; }
+
+        size_t getBrickSize() const { return m_brickSize; }
+        std::array<size_t, 3> getBrickCount() const { return m_brickCount; }
+        size_t getNumBricks() const
+        {
+            return m_brickCount[0] * m_brickCount[1] * m_brickCount[2];
+        }
+        std::array<size_t, 3> getBrickOrigin(size_t id) const;
+        std::array<size_t, 3> getBrickExtent(size_t id) const;
+
+        /**
+         * \brief voxels of a brick, read from the file if not cached
+         *
+         * \return the brick or nullptr if it could not be read
+         */
+        std::shared_ptr<const PagedBrick> getBrick(size_t id) const;
+
+        /**
+         * \brief copies a cuboid region of the volume into a buffer
+         *
+         * \param regionMin index of the lower left voxel of the region
+         * \param regionMax index of the upper right voxel of the region
+         * \param buffer memory for the voxels of the region
+         *
+         * \return true if all intersected bricks could be read
+         */
+        bool readRegion(
+            std::array<size_t, 3> regionMin,
+            std::array<size_t, 3> regionMax,
+            void *buffer) const;
+
+        /**
+         * \brief in core copy of a cuboid region of the volume
+         *
+         * The configuration of the returned data describes the region as
+         * subset of the original volume.
+         *
+         * \return the region or nullptr if it could not be read
+         */
+        std::unique_ptr<VolumeDataBase> extractRegion(
+            std::array<size_t, 3> regionMin,
+            std::array<size_t, 3> regionMax) const;
+
+        /**
+         * \brief value of a single voxel
+         */
+        double getVoxel(std::array<size_t, 3> position) const;
+
+        /**
+         * \brief limits of the whole volume (see getLimitsVolumeData)
+         */
+        std::tuple<float, float> computeLimits() const;
+
+        /**
+         * \brief histogram of the whole volume (see bucketVolumeData)
+         */
+        util::Histogram bucket(size_t numBins, float min, float max) const;
+
+        private:
+        size_t getBrickId(std::array<size_t, 3> position) const;
+
+        uint64_t m_id;                  //!< key of the volume in the cache
+        std::string m_path;
+        bool m_swap;
+        size_t m_brickSize;
+        std::array<size_t, 3> m_brickCount;
+        std::shared_ptr<const BrickIndex> m_index;
+        bool m_valid;
+    };
+}
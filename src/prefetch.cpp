@@ -0,0 +1,459 @@
+#include <iostream>
+#include <exception>
+#include <algorithm>
+#include <utility>
+
+#include "prefetch.hpp"
+
+//-----------------------------------------------------------------------------
+// TimestepPreparation Implementations
+//-----------------------------------------------------------------------------
+std::tuple<float, float> cr::TimestepPreparation::getTextureWindow(
+    const VolumeStatistics &statistics) const
+{
+    switch(textureWindow)
+    {
+        case ValueWindow::manual:
+            return std::make_tuple(
+                textureWindowRange[0], textureWindowRange[1]);
+
+        case ValueWindow::percentile:
+            return std::make_tuple(
+                statistics.getPercentile(texturePercentiles[0]),
+                statistics.getPercentile(texturePercentiles[1]));
+
+        default:
+            return statistics.getLimits();
+    }
+}
+
+/**
+ * Texels in the native format refer to the volume data and need no memory
+ * of their own; the macrocells and the histogram are negligible.
+ */
+size_t cr::TimestepPreparation::getMemorySize(
+    const VolumeConfig &volumeConfig) const
+{
+    Datatype type = volumeConfig.getVoxelType();
+    size_t bytes = 0;
+
+    if (!enabled)
+        return bytes;
+
+    if (texels && (TextureFormat::native !=
+            getEffectiveTextureFormat(textureFormat, type)))
+        bytes += volumeConfig.getVoxelCount() *
+            getTexelSize(getEffectiveTextureFormat(textureFormat, type), type);
+    if (gradients)
+        bytes += volumeConfig.getVoxelCount() * 3;
+
+    return bytes;
+}
+
+bool cr::TimestepPreparation::operator==(
+    const TimestepPreparation &other) const
+{
+    return (enabled == other.enabled) &&
+        (texels == other.texels) &&
+        (textureFormat == other.textureFormat) &&
+        (textureWindow == other.textureWindow) &&
+        (textureWindowRange == other.textureWindowRange) &&
+        (texturePercentiles == other.texturePercentiles) &&
+        (histogramBins == other.histogramBins) &&
+        (histogramMin == other.histogramMin) &&
+        (histogramMax == other.histogramMax) &&
+        (gradients == other.gradients) &&
+        (gradientOperator == other.gradientOperator);
+}
+
+//-----------------------------------------------------------------------------
+// TimestepPrefetcher Class Implementations
+//-----------------------------------------------------------------------------
+cr::TimestepPrefetcher::TimestepPrefetcher() :
+    m_config(),
+    m_swap(false),
+    m_preparation(),
+    m_generation(0),
+    m_slots(),
+    m_queue(),
+    m_reservedBytes(0),
+    m_workers(),
+    m_mutex(),
+    m_workAvailable(),
+    m_slotChanged(),
+    m_stop(false),
+    m_hits(0),
+    m_misses(0)
+{
+}
+
+cr::TimestepPrefetcher::~TimestepPrefetcher()
+{
+    stopWorkers();
+}
+
+void cr::TimestepPrefetcher::configure(
+    const cr::VolumeConfig &volumeConfig,
+    bool swap,
+    unsigned int numThreads)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_workers.empty() && (swap == m_swap) &&
+                isSameDataset(volumeConfig))
+            return;
+
+        // results of loads that are still in flight are discarded by the
+        // workers as they belong to an older generation
+        m_slots.clear();
+        m_queue.clear();
+        m_reservedBytes = 0;
+        m_generation++;
+
+        m_config = volumeConfig;
+        m_swap = swap;
+    }
+
+    if (m_workers.empty())
+        startWorkers(std::max(numThreads, 1u));
+}
+
+void cr::TimestepPrefetcher::setPreparation(
+    const TimestepPreparation &preparation)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_preparation = preparation;
+}
+
+void cr::TimestepPrefetcher::reset()
+{
+    stopWorkers();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_slots.clear();
+    m_queue.clear();
+    m_reservedBytes = 0;
+    m_generation++;
+}
+
+void cr::TimestepPrefetcher::update(
+    unsigned int current,
+    bool backwards,
+    unsigned int lookahead,
+    size_t memoryBudget)
+{
+    std::vector<unsigned int> wanted;
+    size_t timestepBytes = 0;
+    size_t budgetLeft = memoryBudget;
+    unsigned int numTimesteps = 0;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_workers.empty())
+        return;
+
+    numTimesteps = m_config.getNumTimesteps();
+    if (0 == numTimesteps)
+        return;
+    timestepBytes = m_config.getVoxelCount() * m_config.getVoxelSizeOf() +
+        m_preparation.getMemorySize(m_config);
+
+    // timesteps in the order in which they are expected to be shown; the
+    // series is treated as ring so that a looping playback finds the first
+    // timestep resident
+    for (unsigned int i = 1; i <= lookahead; ++i)
+    {
+        unsigned int step = backwards ? numTimesteps - i % numTimesteps : i;
+        unsigned int t = (current + step) % numTimesteps;
+
+        if (t == current)
+            break;
+        if (std::find(wanted.begin(), wanted.end(), t) == wanted.end())
+            wanted.push_back(t);
+    }
+
+    // cut the list down to what fits into the memory budget
+    for (size_t i = 0; i < wanted.size(); ++i)
+    {
+        if (timestepBytes > budgetLeft)
+        {
+            wanted.resize(i);
+            break;
+        }
+        budgetLeft -= timestepBytes;
+    }
+
+    // drop every slot that is not expected anymore
+    for (auto it = m_slots.begin(); it != m_slots.end();)
+    {
+        if (std::find(wanted.begin(), wanted.end(), it->first) == wanted.end())
+        {
+            m_reservedBytes -= it->second.bytes;
+            it = m_slots.erase(it);
+        }
+        else
+            ++it;
+    }
+
+    // schedule the missing timesteps in the order of their priority
+    m_queue.clear();
+    for (unsigned int t : wanted)
+    {
+        auto it = m_slots.find(t);
+
+        if (it == m_slots.end())
+        {
+            Slot slot;
+            slot.state = SlotState::queued;
+            slot.bytes = timestepBytes;
+            slot.content.timestep = t;
+
+            m_slots.emplace(t, std::move(slot));
+            m_reservedBytes += timestepBytes;
+            m_queue.push_back(t);
+        }
+        else if (SlotState::queued == it->second.state)
+            m_queue.push_back(t);
+    }
+
+    m_workAvailable.notify_all();
+}
+
+bool cr::TimestepPrefetcher::acquire(
+    unsigned int timestep, cr::PrefetchedTimestep &prefetched)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto it = m_slots.find(timestep);
+
+    if ((it == m_slots.end()) || (SlotState::queued == it->second.state))
+    {
+        // the caller loads the timestep itself, so the queued work is
+        // dropped
+        if (it != m_slots.end())
+        {
+            m_queue.erase(std::remove(m_queue.begin(), m_queue.end(), timestep),
+                m_queue.end());
+            m_reservedBytes -= it->second.bytes;
+            m_slots.erase(it);
+        }
+        m_misses++;
+        return false;
+    }
+
+    // a timestep that is not resident yet still counts as miss but waiting
+    // for the running load is cheaper than starting a new one
+    if (SlotState::ready == it->second.state)
+        m_hits++;
+    else
+        m_misses++;
+
+    m_slotChanged.wait(lock, [&]() {
+        it = m_slots.find(timestep);
+        return (it == m_slots.end()) || (SlotState::loading != it->second.state);
+    });
+
+    // the load failed
+    if (it == m_slots.end())
+        return false;
+
+    prefetched = std::move(it->second.content);
+    m_reservedBytes -= it->second.bytes;
+    m_slots.erase(it);
+
+    return true;
+}
+
+size_t cr::TimestepPrefetcher::getHits() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+}
+
+size_t cr::TimestepPrefetcher::getMisses() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+}
+
+float cr::TimestepPrefetcher::getHitRate() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (0 == (m_hits + m_misses))
+        return 0.f;
+
+    return static_cast<float>(m_hits) / static_cast<float>(m_hits + m_misses);
+}
+
+/**
+ * Bytes reserved against the budget by the queued, loading and loaded
+ * timesteps. This is the accounted size, not a measurement of the memory
+ * that is actually resident.
+ */
+size_t cr::TimestepPrefetcher::getReservedBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_reservedBytes;
+}
+
+void cr::TimestepPrefetcher::resetStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hits = 0;
+    m_misses = 0;
+}
+
+void cr::TimestepPrefetcher::startWorkers(unsigned int numThreads)
+{
+    m_stop = false;
+    for (unsigned int i = 0; i < numThreads; ++i)
+        m_workers.emplace_back(&TimestepPrefetcher::work, this);
+}
+
+void cr::TimestepPrefetcher::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_workAvailable.notify_all();
+
+    for (auto &worker : m_workers)
+        worker.join();
+    m_workers.clear();
+}
+
+void cr::TimestepPrefetcher::work()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_workAvailable.wait(lock, [this]() {
+            return m_stop || !m_queue.empty(); });
+
+        if (m_stop)
+            return;
+
+        unsigned int timestep = m_queue.front();
+        m_queue.pop_front();
+
+        auto it = m_slots.find(timestep);
+        if ((it == m_slots.end()) || (SlotState::queued != it->second.state))
+            continue;
+        it->second.state = SlotState::loading;
+
+        VolumeConfig volumeConfig = m_config;
+        bool swap = m_swap;
+        TimestepPreparation preparation = m_preparation;
+        unsigned int generation = m_generation;
+
+        // load, analyze and prepare the timestep without holding the lock
+        lock.unlock();
+
+        PrefetchedTimestep content;
+        bool success = true;
+
+        content.timestep = timestep;
+        try
+        {
+            content.data = loadScalarVolumeTimestep(
+                volumeConfig, timestep, swap);
+
+            content.statistics = getVolumeStatistics(
+                volumeConfig, timestep, swap, *content.data);
+            content.data->setLimits(content.statistics.getLimits());
+
+            prepareTimestep(content, preparation);
+        }
+        catch (std::exception &e)
+        {
+            std::cerr << "Error while prefetching timestep " << timestep <<
+                ": " << e.what() << std::endl;
+            success = false;
+        }
+
+        lock.lock();
+
+        // the slot might have been dropped or the dataset might have changed
+        // in the meantime
+        it = m_slots.find(timestep);
+        if ((generation == m_generation) && (it != m_slots.end()) &&
+            (SlotState::loading == it->second.state))
+        {
+            if (success)
+            {
+                it->second.content = std::move(content);
+                it->second.state = SlotState::ready;
+            }
+            else
+            {
+                m_reservedBytes -= it->second.bytes;
+                m_slots.erase(it);
+            }
+        }
+
+        m_slotChanged.notify_all();
+    }
+}
+
+bool cr::TimestepPrefetcher::isSameDataset(
+    const cr::VolumeConfig &volumeConfig) const
+{
+    return (m_config.isValid() == volumeConfig.isValid()) &&
+        (m_config.getRawFileDir() == volumeConfig.getRawFileDir()) &&
+        (m_config.getRawFileExp() == volumeConfig.getRawFileExp()) &&
+        (m_config.getNumTimesteps() == volumeConfig.getNumTimesteps()) &&
+        (m_config.getVoxelType() == volumeConfig.getVoxelType()) &&
+        (m_config.getOrigVolumeDim() == volumeConfig.getOrigVolumeDim()) &&
+        (m_config.getSubset() == volumeConfig.getSubset()) &&
+        (m_config.getSubsetMin() == volumeConfig.getSubsetMin()) &&
+        (m_config.getSubsetMax() == volumeConfig.getSubsetMax()) &&
+        (m_config.getAccessMode() == volumeConfig.getAccessMode());
+}
+
+//-----------------------------------------------------------------------------
+// convenience functions
+//-----------------------------------------------------------------------------
+/**
+ * \brief derives the data that is needed to show a loaded timestep
+ *
+ * \param timestep loaded timestep with its statistics
+ * \param preparation what shall be derived and how
+ *
+ * Data that can not be derived from paged volumes is left empty. Running on
+ * a worker thread the conversions use the threads of OpenMP like they would
+ * on the render thread.
+ */
+void cr::prepareTimestep(
+    PrefetchedTimestep &timestep,
+    const TimestepPreparation &preparation)
+{
+    timestep.preparation = preparation;
+    timestep.texels = VolumeTexels();
+    timestep.histogram = util::Histogram();
+    timestep.macrocells = MacrocellGrid();
+    timestep.gradients = GradientVolume();
+
+    if (!preparation.enabled || !timestep.data)
+        return;
+
+    timestep.histogram = timestep.statistics.rebin(
+        preparation.histogramBins,
+        preparation.histogramMin,
+        preparation.histogramMax);
+
+    if (preparation.texels)
+        convertVolumeTexels(
+            *timestep.data,
+            preparation.textureFormat,
+            preparation.getTextureWindow(timestep.statistics),
+            timestep.texels);
+
+    timestep.macrocells = MacrocellGrid::compute(*timestep.data);
+
+    if (preparation.gradients)
+        timestep.gradients = GradientVolume::compute(
+            *timestep.data, preparation.gradientOperator);
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <array>
+#include <tuple>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+#include "util/util.hpp"
+#include "configraw.hpp"
+#include "statistics.hpp"
+#include "quantize.hpp"
+#include "macrocell.hpp"
+#include "gradient.hpp"
+
+namespace cr
+{
+    // ------------------------------------------------------------------------
+    // type definitions
+    // ------------------------------------------------------------------------
+    /**
+     * \brief settings for the data that is derived from a loaded timestep
+     *        before it is shown
+     *
+     * Deriving the texels, the histogram, the macrocells and the gradients
+     * along with the load keeps this work out of the frame in which the
+     * timestep is swapped in.
+     */
+    struct TimestepPreparation
+    {
+        bool enabled = false;               //!< false derives nothing
+        bool texels = false;                //!< convert the texels
+        TextureFormat textureFormat = TextureFormat::native;
+        ValueWindow textureWindow = ValueWindow::limits;
+        std::array<float, 2> textureWindowRange = {{0.f, 1.f}};
+        std::array<float, 2> texturePercentiles = {{0.f, 100.f}};
+        size_t histogramBins = 0;
+        float histogramMin = 0.f;
+        float histogramMax = 0.f;
+        bool gradients = false;             //!< compute the gradients
+        GradientOperator gradientOperator = GradientOperator::sobel;
+
+        /**
+         * \brief value window of the texel conversion for a timestep
+         */
+        std::tuple<float, float> getTextureWindow(
+            const VolumeStatistics &statistics) const;
+
+        /**
+         * \brief memory of the derived data of a timestep in byte
+         */
+        size_t getMemorySize(const VolumeConfig &volumeConfig) const;
+
+        bool operator==(const TimestepPreparation &other) const;
+        bool operator!=(const TimestepPreparation &other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    /**
+     * \brief a timestep that was loaded in the background
+     *
+     * The derived data is only set if the timestep was prepared, all but
+     * the histogram require in core data.
+     */
+    struct PrefetchedTimestep
+    {
+        unsigned int timestep;
+        std::unique_ptr<VolumeDataBase> data;
+        VolumeStatistics statistics;
+
+        TimestepPreparation preparation;    //!< settings of the data below
+        VolumeTexels texels;
+        util::Histogram histogram;
+        MacrocellGrid macrocells;
+        GradientVolume gradients;
+    };
+
+    /**
+     * \brief loads upcoming timesteps of a time series on worker threads
+     *
+     * The prefetcher keeps a ring of loaded timesteps around the current
+     * position of the time series. With each update the timesteps that are
+     * expected next (t+1..t+k, or t-1..t-k when moving backwards) are
+     * scheduled for loading as long as the memory budget allows it, and
+     * timesteps that are no longer expected are dropped. The worker threads
+     * also provide the value statistics so that a resident timestep can be
+     * swapped in without touching the data again.
+     */
+    class TimestepPrefetcher
+    {
+        public:
+        TimestepPrefetcher();
+        TimestepPrefetcher(const TimestepPrefetcher& other) = delete;
+        TimestepPrefetcher(TimestepPrefetcher&& other) = delete;
+        TimestepPrefetcher& operator=(const TimestepPrefetcher& other) = delete;
+        TimestepPrefetcher& operator=(TimestepPrefetcher&& other) = delete;
+        ~TimestepPrefetcher();
+
+        /**
+         * \brief sets the dataset whose timesteps shall be prefetched
+         *
+         * \param volumeConfig configuration object of the volume dataset
+         * \param swap flag if the byte order of the raw data shall be swapped
+         * \param numThreads number of worker threads
+         *
+         * Nothing happens if the same dataset is already configured.
+         * Otherwise all resident timesteps are dropped.
+         */
+        void configure(
+            const VolumeConfig &volumeConfig,
+            bool swap,
+            unsigned int numThreads = 2);
+
+        /**
+         * \brief sets how the workers prepare the timesteps they load
+         *
+         * Timesteps that are already resident keep their preparation.
+         */
+        void setPreparation(const TimestepPreparation &preparation);
+
+        /**
+         * \brief drops all prefetched timesteps and stops the workers
+         */
+        void reset();
+
+        /**
+         * \brief schedules the timesteps around the current one for loading
+         *
+         * \param current timestep that is currently shown
+         * \param backwards true if the time series is traversed backwards
+         * \param lookahead number of timesteps that shall be kept resident
+         * \param memoryBudget maximum memory for resident timesteps in byte
+         */
+        void update(
+            unsigned int current,
+            bool backwards,
+            unsigned int lookahead,
+            size_t memoryBudget);
+
+        /**
+         * \brief hands out a prefetched timestep
+         *
+         * \param timestep requested timestep
+         * \param prefetched Out: the loaded timestep
+         * \return true if the timestep was resident or in flight (hit),
+         *         false if it has to be loaded by the caller (miss)
+         *
+         * If the requested timestep is currently being loaded the call
+         * blocks until it is available.
+         */
+        bool acquire(unsigned int timestep, PrefetchedTimestep &prefetched);
+
+        // statistics
+        size_t getHits() const;
+        size_t getMisses() const;
+        float getHitRate() const;
+        size_t getReservedBytes() const;
+        void resetStatistics();
+
+        private:
+        enum class SlotState : int
+        {
+            queued = 0,
+            loading,
+            ready
+        };
+
+        struct Slot
+        {
+            SlotState state;
+            size_t bytes;
+            PrefetchedTimestep content;
+        };
+
+        VolumeConfig m_config;
+        bool m_swap;
+        TimestepPreparation m_preparation;
+        unsigned int m_generation;
+
+        std::map<unsigned int, Slot> m_slots;
+        std::deque<unsigned int> m_queue;
+        size_t m_reservedBytes;
+
+        std::vector<std::thread> m_workers;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_workAvailable;
+        std::condition_variable m_slotChanged;
+        bool m_stop;
+
+        size_t m_hits;
+        size_t m_misses;
+
+        void startWorkers(unsigned int numThreads);
+        void stopWorkers();
+        void work();
+        bool isSameDataset(const VolumeConfig &volumeConfig) const;
+    };
+
+    // ------------------------------------------------------------------------
+    // function declarations
+    // ------------------------------------------------------------------------
+    void prepareTimestep(
+        PrefetchedTimestep &timestep,
+        const TimestepPreparation &preparation);
+}
@@ -0,0 +1,714 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <limits>
+#include <type_traits>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+#include <functional>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+namespace bfs = boost::filesystem;
+
+#include "pyramid.hpp"
+#include "paged.hpp"
+#include "statistics.hpp"
+#include "timestepindex.hpp"
+
+//-----------------------------------------------------------------------------
+// internal helpers
+//-----------------------------------------------------------------------------
+namespace
+{
+    /**
+     * \brief upper limit of the memory for the slices that are downsampled
+     *        at once while a pyramid is built
+     */
+    constexpr size_t PYRAMID_SLAB_SIZE = 64 << 20;
+
+    /**
+     * \brief directory of the levels of detail next to the data
+     *
+     * The levels are stored in <first timestep file>.pyramid, so that their
+     * files can not match the regex of the timestep files.
+     */
+    bfs::path getPyramidDir(const cr::VolumeConfig &volumeConfig)
+    {
+        if (!volumeConfig.getTimestepIndex() ||
+            volumeConfig.getTimestepIndex()->empty())
+            return bfs::path();
+
+        bfs::path first(volumeConfig.getTimestepFile(0));
+        return first.parent_path() / (first.filename().string() + ".pyramid");
+    }
+
+    /**
+     * \brief combines 2x2x2 voxels of src into a voxel of dst
+     *
+     * Voxels at the upper borders of volumes with odd dimensions are
+     * combined with the voxels that exist.
+     */
+    template<typename T>
+    void downsampleT(
+        const T *src,
+        std::array<size_t, 3> dim,
+        T *dst,
+        cr::PyramidFilter filter)
+    {
+        std::array<size_t, 3> dstDim = cr::getPyramidLevelDim(dim, 1);
+
+        // each thread writes whole z-slabs of the destination
+        #pragma omp parallel for schedule(dynamic)
+        for (size_t z = 0; z < dstDim[2]; ++z)
+        for (size_t y = 0; y < dstDim[1]; ++y)
+        for (size_t x = 0; x < dstDim[0]; ++x)
+        {
+            double sum = 0.0;
+            T maximum = std::numeric_limits<T>::lowest();
+            size_t count = 0;
+
+            for (size_t sz = 2 * z; sz < std::min(2 * z + 2, dim[2]); ++sz)
+            for (size_t sy = 2 * y; sy < std::min(2 * y + 2, dim[1]); ++sy)
+            for (size_t sx = 2 * x; sx < std::min(2 * x + 2, dim[0]); ++sx)
+            {
+                T val = src[sx + (sy + sz * dim[1]) * dim[0]];
+                sum += static_cast<double>(val);
+                maximum = std::max(maximum, val);
+                ++count;
+            }
+
+            T &out = dst[x + (y + z * dstDim[1]) * dstDim[0]];
+            if (cr::PyramidFilter::maximum == filter)
+                out = maximum;
+            else if (std::is_integral<T>::value)
+                out = static_cast<T>(std::floor(sum / count + 0.5));
+            else
+                out = static_cast<T>(sum / count);
+        }
+    }
+
+    bool downsample(
+        cr::Datatype type,
+        const void *src,
+        std::array<size_t, 3> dim,
+        void *dst,
+        cr::PyramidFilter filter)
+    {
+        switch(type)
+        {
+            case cr::Datatype::unsigned_byte:
+                downsampleT(static_cast<const unsigned_byte_t*>(src), dim,
+                    static_cast<unsigned_byte_t*>(dst), filter);
+                return true;
+
+            case cr::Datatype::signed_byte:
+                downsampleT(static_cast<const signed_byte_t*>(src), dim,
+                    static_cast<signed_byte_t*>(dst), filter);
+                return true;
+
+            case cr::Datatype::unsigned_halfword:
+                downsampleT(static_cast<const unsigned_halfword_t*>(src), dim,
+                    static_cast<unsigned_halfword_t*>(dst), filter);
+                return true;
+
+            case cr::Datatype::signed_halfword:
+                downsampleT(static_cast<const signed_halfword_t*>(src), dim,
+                    static_cast<signed_halfword_t*>(dst), filter);
+                return true;
+
+            case cr::Datatype::unsigned_word:
+                downsampleT(static_cast<const unsigned_word_t*>(src), dim,
+                    static_cast<unsigned_word_t*>(dst), filter);
+                return true;
+
+            case cr::Datatype::signed_word:
+                downsampleT(static_cast<const signed_word_t*>(src), dim,
+                    static_cast<signed_word_t*>(dst), filter);
+                return true;
+
+            case cr::Datatype::unsigned_longword:
+                downsampleT(static_cast<const unsigned_longword_t*>(src), dim,
+                    static_cast<unsigned_longword_t*>(dst), filter);
+                return true;
+
+            case cr::Datatype::signed_longword:
+                downsampleT(static_cast<const signed_longword_t*>(src), dim,
+                    static_cast<signed_longword_t*>(dst), filter);
+                return true;
+
+            case cr::Datatype::single_precision_float:
+                downsampleT(
+                    static_cast<const single_precision_float_t*>(src), dim,
+                    static_cast<single_precision_float_t*>(dst), filter);
+                return true;
+
+            case cr::Datatype::double_precision_float:
+                downsampleT(
+                    static_cast<const double_precision_float_t*>(src), dim,
+                    static_cast<double_precision_float_t*>(dst), filter);
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * \brief downsamples a volume slab by slab into a stream
+     *
+     * \param read reads a number of z-slices starting at a z-slice into a
+     *             buffer, false if they could not be read
+     *
+     * Each slab has an even number of z-slices, so that every voxel of the
+     * next level is combined from the slices of a single slab.
+     */
+    bool downsampleSlabs(
+        cr::Datatype type,
+        size_t voxelSize,
+        std::array<size_t, 3> dim,
+        cr::PyramidFilter filter,
+        const std::function<bool(size_t, size_t, char*)> &read,
+        std::ostream &os)
+    {
+        size_t sliceSize = dim[0] * dim[1] * voxelSize;
+        size_t slabDepth = std::max(
+            (PYRAMID_SLAB_SIZE / sliceSize) & ~size_t(1), size_t(2));
+        std::vector<char> src;
+        std::vector<char> dst;
+
+        for (size_t z = 0; z < dim[2]; z += slabDepth)
+        {
+            std::array<size_t, 3> slabDim{
+                {dim[0], dim[1], std::min(slabDepth, dim[2] - z)}};
+            std::array<size_t, 3> dstDim = cr::getPyramidLevelDim(slabDim, 1);
+
+            src.resize(slabDim[2] * sliceSize);
+            dst.resize(dstDim[0] * dstDim[1] * dstDim[2] * voxelSize);
+
+            if (!read(z, slabDim[2], src.data()) ||
+                !downsample(type, src.data(), slabDim, dst.data(), filter))
+                return false;
+
+            os.write(dst.data(), static_cast<std::streamsize>(dst.size()));
+            if (!os)
+                return false;
+        }
+
+        return true;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// VolumePyramid Class Implementations
+//-----------------------------------------------------------------------------
+cr::VolumePyramid::VolumePyramid() :
+    m_levels()
+{
+}
+
+/**
+ * The levels are searched next to the first timestep file. A level is only
+ * used if it was built from a volume of the same dimensions and subset and
+ * none of its files is older than the file of the same timestep. The search
+ * stops at the first level that is not usable.
+ */
+cr::VolumePyramid::VolumePyramid(const VolumeConfig &volumeConfig) :
+    m_levels{volumeConfig}
+{
+    if (!volumeConfig.isValid() || getPyramidDir(volumeConfig).empty())
+        return;
+
+    try
+    {
+        const TimestepIndex &dataIndex = *volumeConfig.getTimestepIndex();
+
+        for (size_t k = 1; ; ++k)
+        {
+            bfs::path path(getPyramidLevelPath(volumeConfig, k));
+            json description;
+
+            if (!bfs::exists(path))
+                break;
+
+            {
+                std::ifstream fs(path.string());
+                fs >> description;
+            }
+            if ((PYRAMID_VERSION !=
+                    description["PYRAMID_VERSION"].get<unsigned int>()) ||
+                (k != description["PYRAMID_LEVEL"].get<size_t>()) ||
+                (volumeConfig.getVolumeDim() !=
+                    description["PYRAMID_SOURCE_DIM"].get<
+                        std::array<size_t, 3>>()) ||
+                (volumeConfig.getSubsetMin() !=
+                    description["PYRAMID_SOURCE_MIN"].get<
+                        std::array<size_t, 3>>()))
+                break;
+
+            VolumeConfig level(path.string());
+            if (!level.isValid() ||
+                (level.getVoxelType() != volumeConfig.getVoxelType()) ||
+                (level.getNumTimesteps() != volumeConfig.getNumTimesteps()) ||
+                (level.getVolumeDim() !=
+                    getPyramidLevelDim(volumeConfig.getVolumeDim(), k)))
+                break;
+
+            // a single rewritten timestep makes the level stale
+            unsigned int stale = level.getNumTimesteps();
+            for (unsigned int t = 0; t < level.getNumTimesteps(); ++t)
+            {
+                if (level.getTimestepIndex()->getModificationTime(t) <
+                        dataIndex.getModificationTime(t))
+                {
+                    stale = t;
+                    break;
+                }
+            }
+            if (stale < level.getNumTimesteps())
+            {
+                std::cerr << "Warning: ignoring " << path.string() <<
+                    " since timestep " << stale << " is older than the " <<
+                    "volume data" << std::endl;
+                break;
+            }
+
+            m_levels.push_back(level);
+        }
+    }
+    catch(std::exception &e)
+    {
+        std::cerr << "Warning: could not read the levels of detail of " <<
+            volumeConfig.getTimestepFile(0) << ": " << e.what() << std::endl;
+    }
+}
+
+const cr::VolumeConfig& cr::VolumePyramid::getLevel(size_t level) const
+{
+    static const VolumeConfig none;
+
+    if (m_levels.empty()) return none;
+    return m_levels[std::min(level, m_levels.size() - 1)];
+}
+
+bool cr::VolumePyramid::isPyramidOf(const VolumeConfig &volumeConfig) const
+{
+    if (m_levels.empty())
+        return false;
+
+    const VolumeConfig &base = m_levels.front();
+
+    return (base.getTimestepIndex() == volumeConfig.getTimestepIndex()) &&
+        (base.getVoxelType() == volumeConfig.getVoxelType()) &&
+        (base.getOrigVolumeDim() == volumeConfig.getOrigVolumeDim()) &&
+        (base.getSubsetMin() == volumeConfig.getSubsetMin()) &&
+        (base.getSubsetMax() == volumeConfig.getSubsetMax()) &&
+        (base.getAccessMode() == volumeConfig.getAccessMode());
+}
+
+/**
+ * Paged volumes are not held in memory, so level 0 of a paged configuration
+ * always fits.
+ */
+size_t cr::VolumePyramid::selectLevel(size_t memoryBudget) const
+{
+    if (m_levels.empty() ||
+        (AccessMode::paged == m_levels.front().getAccessMode()))
+        return 0;
+
+    for (size_t k = 0; k < m_levels.size(); ++k)
+        if (m_levels[k].getVoxelCount() * m_levels[k].getVoxelSizeOf() <=
+                memoryBudget)
+            return k;
+
+    return m_levels.size() - 1;
+}
+
+//-----------------------------------------------------------------------------
+// PyramidLoader Class Implementations
+//-----------------------------------------------------------------------------
+cr::PyramidLoader::PyramidLoader() :
+    m_queue(),
+    m_timestep(0),
+    m_preparation(),
+    m_generation(0),
+    m_busy(false),
+    m_ready(false),
+    m_readyLevel(0),
+    m_readyTimestep(),
+    m_worker(),
+    m_mutex(),
+    m_workAvailable(),
+    m_levelLoaded(),
+    m_stop(false)
+{
+}
+
+cr::PyramidLoader::~PyramidLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_workAvailable.notify_all();
+
+    if (m_worker.joinable())
+        m_worker.join();
+}
+
+void cr::PyramidLoader::start(
+    const VolumePyramid &pyramid,
+    unsigned int timestep,
+    size_t coarse,
+    size_t fine,
+    const TimestepPreparation &preparation)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // a level that is still in flight is discarded by the worker as it
+    // belongs to an older generation
+    m_generation++;
+    m_queue.clear();
+    m_ready = false;
+    m_readyTimestep = PrefetchedTimestep();
+    m_timestep = timestep;
+    m_preparation = preparation;
+
+    for (size_t k = coarse + 1; k-- > fine; )
+        m_queue.emplace_back(k, pyramid.getLevel(k));
+
+    if (!m_worker.joinable())
+        m_worker = std::thread(&PyramidLoader::work, this);
+    m_workAvailable.notify_all();
+}
+
+void cr::PyramidLoader::cancel()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_generation++;
+    m_queue.clear();
+    m_ready = false;
+    m_readyTimestep = PrefetchedTimestep();
+    m_levelLoaded.notify_all();
+}
+
+bool cr::PyramidLoader::poll(
+    PrefetchedTimestep &loaded,
+    size_t &level,
+    bool wait)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (wait)
+        m_levelLoaded.wait(lock, [this]() {
+            return m_queue.empty() && !m_busy; });
+
+    if (!m_ready)
+        return false;
+
+    loaded = std::move(m_readyTimestep);
+    level = m_readyLevel;
+    m_ready = false;
+
+    return true;
+}
+
+bool cr::PyramidLoader::isLoading() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_queue.empty() || m_busy;
+}
+
+void cr::PyramidLoader::work()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_workAvailable.wait(lock, [this]() {
+            return m_stop || !m_queue.empty(); });
+
+        if (m_stop)
+            return;
+
+        size_t level = m_queue.front().first;
+        VolumeConfig volumeConfig = std::move(m_queue.front().second);
+        unsigned int timestep = m_timestep;
+        TimestepPreparation preparation = m_preparation;
+        unsigned int generation = m_generation;
+        m_queue.pop_front();
+        m_busy = true;
+
+        // load, analyze and prepare the level without holding the lock
+        lock.unlock();
+
+        PrefetchedTimestep content;
+        bool success = true;
+
+        content.timestep = timestep;
+        try
+        {
+            content.data = loadScalarVolumeTimestep(
+                volumeConfig, timestep, false);
+            if (!content.data)
+                throw std::runtime_error("no data");
+
+            content.statistics = getVolumeStatistics(
+                volumeConfig, timestep, false, *content.data);
+            content.data->setLimits(content.statistics.getLimits());
+
+            prepareTimestep(content, preparation);
+        }
+        catch (std::exception &e)
+        {
+            std::cerr << "Error while loading level " << level <<
+                " of timestep " << timestep << ": " << e.what() << std::endl;
+            success = false;
+        }
+
+        lock.lock();
+
+        // a finer level replaces a coarser one that was not picked up yet
+        if (success && (generation == m_generation))
+        {
+            m_readyTimestep = std::move(content);
+            m_readyLevel = level;
+            m_ready = true;
+        }
+        m_busy = false;
+
+        m_levelLoaded.notify_all();
+    }
+}
+
+//-----------------------------------------------------------------------------
+// convenience functions
+//-----------------------------------------------------------------------------
+std::array<size_t, 3> cr::getPyramidLevelDim(
+    std::array<size_t, 3> volumeDim,
+    size_t level)
+{
+    for (size_t k = 0; k < level; ++k)
+        for (size_t i = 0; i < 3; ++i)
+            volumeDim[i] = (volumeDim[i] + 1) / 2;
+
+    return volumeDim;
+}
+
+/**
+ * \brief location of the volume description of a level of detail
+ *
+ * The description <first timestep file>.pyramid/level<k>.json is stored
+ * next to the data.
+ */
+std::string cr::getPyramidLevelPath(
+    const VolumeConfig &volumeConfig,
+    size_t level)
+{
+    bfs::path dir = getPyramidDir(volumeConfig);
+
+    if (dir.empty())
+        return std::string("");
+
+    return (dir / ("level" + std::to_string(level) + ".json")).string();
+}
+
+/**
+ * \brief builds the levels of detail of a volume dataset
+ *
+ * \param volumeFile path to the volume description file
+ * \param filter filter that combines 2x2x2 voxels
+ * \param minSize the coarsest level is the first level whose dimensions do
+ *                not exceed minSize
+ *
+ * \return EXIT_SUCCESS or EXIT_FAILURE
+ *
+ * Level k of timestep t is written next to the data as raw file
+ * <first timestep file>.pyramid/level<k>.<t>.raw in the byte order of the
+ * host, together with a volume description of the level (see
+ * getPyramidLevelPath). If the description selects a subset, the levels
+ * are built from the subset. Each level is computed from the previous one,
+ * slab by slab, so that the memory in use is bounded by a few slabs instead
+ * of a whole timestep.
+ */
+int cr::buildPyramid(
+    const std::string &volumeFile,
+    PyramidFilter filter,
+    size_t minSize)
+{
+    VolumeConfig volumeConfig(volumeFile);
+    std::array<size_t, 3> dim = volumeConfig.getVolumeDim();
+    bfs::path dir = getPyramidDir(volumeConfig);
+    size_t numLevels = 0;
+
+    if (!volumeConfig.isValid() || dir.empty())
+        return EXIT_FAILURE;
+
+    while (*std::max_element(dim.begin(), dim.end()) > std::max(minSize,
+            size_t(1)))
+    {
+        dim = getPyramidLevelDim(dim, 1);
+        ++numLevels;
+    }
+
+    if (0 == numLevels)
+    {
+        std::cout << "The volume is not larger than " << minSize <<
+            " voxels, no levels of detail are needed." << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    try
+    {
+        size_t voxelSize = volumeConfig.getVoxelSizeOf();
+
+        bfs::create_directories(dir);
+
+        for (unsigned int t = 0; t < volumeConfig.getNumTimesteps(); ++t)
+        {
+            std::unique_ptr<VolumeDataBase> volumeData = nullptr;
+            const PagedVolumeData *paged = nullptr;
+            std::function<bool(size_t, size_t, char*)> read;
+            std::ostringstream suffix;
+
+            dim = volumeConfig.getVolumeDim();
+            suffix << "." << std::setw(6) << std::setfill('0') << t << ".raw";
+
+            // raw and bricked files are paged through the brick cache, the
+            // chunks of compressed and HDF5 files that intersect a slab are
+            // decoded per slab. A gzip stream can only be inflated from its
+            // start, so it is the only format that is read completely.
+            if ((FileFormat::raw == volumeConfig.getFileFormat()) ||
+                (FileFormat::bricked == volumeConfig.getFileFormat()))
+            {
+                volumeData = loadPagedTimestep(
+                    volumeConfig, t, volumeConfig.needsByteSwap());
+                paged = static_cast<const PagedVolumeData*>(volumeData.get());
+                if (!paged->isValid())
+                    return EXIT_FAILURE;
+
+                read = [&](size_t z, size_t depth, char *buffer) {
+                    return paged->readRegion(
+                        std::array<size_t, 3>{{0, 0, z}},
+                        std::array<size_t, 3>{
+                            {dim[0] - 1, dim[1] - 1, z + depth - 1}},
+                        buffer);
+                };
+            }
+            else if (FileFormat::gzip == volumeConfig.getFileFormat())
+            {
+                volumeData = loadScalarVolumeTimestep(volumeConfig, t, false);
+                if ((nullptr == volumeData) ||
+                    (nullptr == volumeData->getRawData()))
+                    return EXIT_FAILURE;
+
+                read = [&](size_t z, size_t depth, char *buffer) {
+                    std::memcpy(buffer,
+                        static_cast<const char*>(volumeData->getRawData()) +
+                            z * dim[0] * dim[1] * voxelSize,
+                        depth * dim[0] * dim[1] * voxelSize);
+                    return true;
+                };
+            }
+            else
+            {
+                read = [&](size_t z, size_t depth, char *buffer) {
+                    std::unique_ptr<VolumeDataBase> slab =
+                        loadScalarVolumeTimestep(volumeConfig.getRegionConfig(
+                            std::array<size_t, 3>{{0, 0, z}},
+                            std::array<size_t, 3>{
+                                {dim[0] - 1, dim[1] - 1, z + depth - 1}}),
+                            t, false);
+
+                    if ((nullptr == slab) || (nullptr == slab->getRawData()))
+                        return false;
+                    std::memcpy(buffer, slab->getRawData(),
+                        depth * dim[0] * dim[1] * voxelSize);
+                    return true;
+                };
+            }
+
+            // each level is streamed from the file of the previous level
+            for (size_t k = 1; k <= numLevels; ++k)
+            {
+                std::array<size_t, 3> levelDim = getPyramidLevelDim(dim, 1);
+                bfs::path levelFile =
+                    dir / ("level" + std::to_string(k) + suffix.str());
+                std::ifstream ifs;
+
+                std::cout << "Writing " << levelFile.string() << " (" <<
+                    levelDim[0] << "x" << levelDim[1] << "x" <<
+                    levelDim[2] << ")" << std::endl;
+
+                if (1 < k)
+                {
+                    ifs.open((dir / ("level" + std::to_string(k - 1) +
+                        suffix.str())).string(), std::ios::binary);
+                    read = [&](size_t, size_t depth, char *buffer) {
+                        ifs.read(buffer, static_cast<std::streamsize>(
+                            depth * dim[0] * dim[1] * voxelSize));
+                        return static_cast<bool>(ifs);
+                    };
+                }
+
+                std::ofstream ofs(levelFile.string(), std::ios::binary);
+                if (!downsampleSlabs(volumeConfig.getVoxelType(), voxelSize,
+                        dim, filter, read, ofs))
+                {
+                    std::cerr << "Error: could not write " <<
+                        levelFile.string() << std::endl;
+                    return EXIT_FAILURE;
+                }
+
+                dim = levelDim;
+            }
+        }
+
+        // the descriptions are written last, so that the levels are only
+        // used once all timesteps are complete
+        dim = volumeConfig.getVolumeDim();
+        for (size_t k = 1; k <= numLevels; ++k)
+        {
+            json description;
+            std::array<size_t, 3> voxelDim = volumeConfig.getVoxelDim();
+
+            for (size_t i = 0; i < 3; ++i)
+                voxelDim[i] <<= k;
+
+            description["VOLUME_FILE_DIR"] = ".";
+            description["VOLUME_FILE_REGEX"] =
+                "level" + std::to_string(k) + "\\.[0-9]+\\.raw";
+            description["VOLUME_DIM"] = getPyramidLevelDim(dim, k);
+            description["VOLUME_DATA_TYPE"] = volumeConfig.getVoxelType();
+            description["VOXEL_SIZE"] = voxelDim;
+            description["VOLUME_NUM_TIMESTEPS"] =
+                volumeConfig.getNumTimesteps();
+            description["PYRAMID_VERSION"] = PYRAMID_VERSION;
+            description["PYRAMID_LEVEL"] = k;
+            description["PYRAMID_FILTER"] = filter;
+            description["PYRAMID_SOURCE_DIM"] = dim;
+            description["PYRAMID_SOURCE_MIN"] = volumeConfig.getSubsetMin();
+
+            std::ofstream ofs(getPyramidLevelPath(volumeConfig, k));
+            ofs << std::setw(4) << description << std::endl;
+        }
+    }
+    catch(std::exception &e)
+    {
+        std::cerr << "Error while building the levels of detail of " <<
+            volumeFile << ": " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <string>
+#include <array>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+#include <cstddef>
+
+#include <json.hpp>
+using json = nlohmann::json;
+
+#include "configraw.hpp"
+#include "prefetch.hpp"
+
+namespace cr
+{
+    // ------------------------------------------------------------------------
+    // constants
+    // ------------------------------------------------------------------------
+    constexpr unsigned int PYRAMID_VERSION = 1;
+    constexpr size_t DEFAULT_PYRAMID_MIN_SIZE = 32;
+
+    // ------------------------------------------------------------------------
+    // type definitions
+    // ------------------------------------------------------------------------
+    /**
+     * \brief filter that combines 2x2x2 voxels into a voxel of the next level
+     */
+    enum class PyramidFilter : int
+    {
+        average = 0,    //!< mean value, smooth but lowers isolated peaks
+        maximum         //!< highest value, keeps thin bright structures
+    };
+
+    NLOHMANN_JSON_SERIALIZE_ENUM(
+        PyramidFilter, {
+            {PyramidFilter::average, "AVERAGE"},
+            {PyramidFilter::maximum, "MAX"}});
+
+    // ------------------------------------------------------------------------
+    // class declarations
+    // ------------------------------------------------------------------------
+    /**
+     * \brief levels of detail of a volume dataset
+     *
+     * Level 0 is the dataset itself, level k has half the dimensions of
+     * level k-1 (rounded up). The levels are created by buildPyramid and
+     * stored next to the data; levels that are missing, do not belong to
+     * the configuration or are older than the data are not used.
+     */
+    class VolumePyramid
+    {
+        public:
+        VolumePyramid();
+        explicit VolumePyramid(const VolumeConfig &volumeConfig);
+
+        size_t getNumLevels() const { return m_levels.size(); }
+
+        /**
+         * \brief configuration of a level, clamped to the coarsest level
+         */
+        const VolumeConfig& getLevel(size_t level) const;
+
+        /**
+         * \brief true if the pyramid was created for the configuration
+         */
+        bool isPyramidOf(const VolumeConfig &volumeConfig) const;
+
+        /**
+         * \brief finest level whose timesteps fit into the memory budget
+         *
+         * \param memoryBudget memory for a single timestep in byte
+         * \return the coarsest level if no level fits
+         */
+        size_t selectLevel(size_t memoryBudget) const;
+
+        private:
+        std::vector<VolumeConfig> m_levels;
+    };
+
+    /**
+     * \brief loads finer and finer levels of a timestep on a worker thread
+     *
+     * The renderer shows a coarse level immediately and polls the loader
+     * for the finer levels as they become available. Starting a new load
+     * discards the levels of the previous one.
+     */
+    class PyramidLoader
+    {
+        public:
+        PyramidLoader();
+        PyramidLoader(const PyramidLoader& other) = delete;
+        PyramidLoader& operator=(const PyramidLoader& other) = delete;
+        ~PyramidLoader();
+
+        /**
+         * \brief schedules the levels from coarse to fine for loading
+         *
+         * \param pyramid levels of the dataset
+         * \param timestep timestep to load
+         * \param coarse first (coarsest) level to load
+         * \param fine last (finest) level to load
+         * \param preparation how the loaded levels are prepared
+         */
+        void start(
+            const VolumePyramid &pyramid,
+            unsigned int timestep,
+            size_t coarse,
+            size_t fine,
+            const TimestepPreparation &preparation = TimestepPreparation());
+
+        /**
+         * \brief discards all scheduled and loaded levels
+         */
+        void cancel();
+
+        /**
+         * \brief hands out the finest level that was loaded since the last
+         *        call
+         *
+         * \param loaded Out: the loaded timestep with its statistics
+         * \param level Out: level of the loaded timestep
+         * \param wait block until all scheduled levels are loaded
+         * \return true if a level was handed out
+         */
+        bool poll(PrefetchedTimestep &loaded, size_t &level, bool wait = false);
+
+        bool isLoading() const;
+
+        private:
+        void work();
+
+        std::deque<std::pair<size_t, VolumeConfig>> m_queue;
+        unsigned int m_timestep;
+        TimestepPreparation m_preparation;
+        unsigned int m_generation;
+        bool m_busy;
+
+        bool m_ready;
+        size_t m_readyLevel;
+        PrefetchedTimestep m_readyTimestep;
+
+        std::thread m_worker;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_workAvailable;
+        std::condition_variable m_levelLoaded;
+        bool m_stop;
+    };
+
+    // ------------------------------------------------------------------------
+    // function declarations
+    // ------------------------------------------------------------------------
+    std::array<size_t, 3> getPyramidLevelDim(
+        std::array<size_t, 3> volumeDim,
+        size_t level);
+    std::string getPyramidLevelPath(
+        const VolumeConfig &volumeConfig,
+        size_t level);
+    int buildPyramid(
+        const std::string &volumeFile,
+        PyramidFilter filter = PyramidFilter::average,
+        size_t minSize = DEFAULT_PYRAMID_MIN_SIZE);
+}
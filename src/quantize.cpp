@@ -0,0 +1,490 @@
+#include <iostream>
+#include <vector>
+#include <array>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+
+#include "quantize.hpp"
+#include "paged.hpp"
+
+//-----------------------------------------------------------------------------
+// internal helpers
+//-----------------------------------------------------------------------------
+namespace
+{
+    /**
+     * \brief converts a float from [0, 1] into a half float
+     *
+     * Rounds to nearest even like the F16C instructions but without
+     * branches, so that the conversion loop can be vectorized. Values below
+     * the smallest normal half float are shifted into place by adding a
+     * magic number, all others are rebiased and rounded by integer
+     * arithmetic. Infinity, NaN and overflows cannot occur in [0, 1].
+     */
+    inline uint16_t unitFloatToHalf(float value)
+    {
+        const float denormMagic = 0.5f;     // 2^(-15 + 23 - 10 + 1)
+        float shifted = value + denormMagic;
+        uint32_t bits, shiftedBits;
+
+        std::memcpy(&bits, &value, sizeof(bits));
+        std::memcpy(&shiftedBits, &shifted, sizeof(shiftedBits));
+
+        uint32_t subnormal = shiftedBits - 0x3f000000u;
+        uint32_t normal = (bits +
+            (static_cast<uint32_t>(15 - 127) << 23) + 0xfffu +
+            ((bits >> 13) & 1u)) >> 13;
+
+        return static_cast<uint16_t>(
+            (bits < (113u << 23)) ? subnormal : normal);
+    }
+
+    /**
+     * \brief maps the values inside the window to [0, 1] and encodes them
+     *
+     * Values outside the window (and NaN) are clamped. The work is split
+     * into contiguous parts for the threads, each of which runs a
+     * vectorized loop.
+     */
+    template<typename T, typename U, typename F>
+    void quantizeT(
+        const T *values,
+        U *texels,
+        size_t count,
+        std::tuple<float, float> window,
+        F encode)
+    {
+        // float is precise enough for small integers and floats
+        using calc_t = typename std::conditional<
+            std::is_same<T, float>::value || (sizeof(T) <= 2),
+            float, double>::type;
+
+        const calc_t min = static_cast<calc_t>(std::get<0>(window));
+        const calc_t max = static_cast<calc_t>(std::get<1>(window));
+        const calc_t scale = (max > min) ?
+            static_cast<calc_t>(1) / (max - min) : static_cast<calc_t>(0);
+
+        #pragma omp parallel for simd schedule(static)
+        for (size_t i = 0; i < count; ++i)
+        {
+            calc_t t = (static_cast<calc_t>(values[i]) - min) * scale;
+            t = (t > static_cast<calc_t>(0)) ? t : static_cast<calc_t>(0);
+            t = (t < static_cast<calc_t>(1)) ? t : static_cast<calc_t>(1);
+            texels[i] = encode(static_cast<float>(t));
+        }
+    }
+
+    template<typename T>
+    void quantizeFormat(
+        const T *values,
+        void *texels,
+        size_t count,
+        std::tuple<float, float> window,
+        cr::TextureFormat format)
+    {
+        switch(format)
+        {
+            case cr::TextureFormat::r8:
+                quantizeT(values, static_cast<uint8_t*>(texels), count, window,
+                    [](float t) {
+                        return static_cast<uint8_t>(t * 255.f + 0.5f); });
+                break;
+
+            case cr::TextureFormat::r16:
+                quantizeT(values, static_cast<uint16_t*>(texels), count, window,
+                    [](float t) {
+                        return static_cast<uint16_t>(t * 65535.f + 0.5f); });
+                break;
+
+            case cr::TextureFormat::r16f:
+                quantizeT(values, static_cast<uint16_t*>(texels), count, window,
+                    [](float t) { return unitFloatToHalf(t); });
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// conversion functions
+//-----------------------------------------------------------------------------
+/**
+ * \brief texture format that is used for the given format and data type
+ *
+ * Types without a matching OpenGL format are converted to r16.
+ */
+cr::TextureFormat cr::getEffectiveTextureFormat(
+    TextureFormat format, Datatype type)
+{
+    if (TextureFormat::native != format)
+        return format;
+
+    switch(type)
+    {
+        case Datatype::double_precision_float:
+        case Datatype::unsigned_longword:
+        case Datatype::signed_longword:
+            return TextureFormat::r16;
+
+        default:
+            return TextureFormat::native;
+    }
+}
+
+/**
+ * \brief size of a texel in byte on the GPU
+ */
+size_t cr::getTexelSize(TextureFormat format, Datatype type)
+{
+    switch(getEffectiveTextureFormat(format, type))
+    {
+        case TextureFormat::r8:
+            return 1;
+
+        case TextureFormat::r16:
+        case TextureFormat::r16f:
+            return 2;
+
+        default:
+            break;
+    }
+
+    // 32 bit integers are kept as float
+    return datatypeSize(type);
+}
+
+/**
+ * \brief OpenGL internal format and pixel type of volume texels
+ *
+ * \param format texture format (see getEffectiveTextureFormat)
+ * \param type data type of the volume
+ * \param internalFormat receives the internal format of the texture
+ * \param glType receives the pixel type of the texels
+ *
+ * \return false if the native format is requested for an unsupported type
+ */
+bool cr::getGlTextureFormat(
+    TextureFormat format,
+    Datatype type,
+    GLenum &internalFormat,
+    GLenum &glType)
+{
+    switch(getEffectiveTextureFormat(format, type))
+    {
+        case TextureFormat::r8:
+            internalFormat = GL_R8;
+            glType = GL_UNSIGNED_BYTE;
+            return true;
+
+        case TextureFormat::r16:
+            internalFormat = GL_R16;
+            glType = GL_UNSIGNED_SHORT;
+            return true;
+
+        case TextureFormat::r16f:
+            internalFormat = GL_R16F;
+            glType = GL_HALF_FLOAT;
+            return true;
+
+        default:
+            break;
+    }
+
+    // 32 bit integers are normalized by OpenGL and kept as float
+    switch(type)
+    {
+        case Datatype::unsigned_byte:
+            internalFormat = GL_R8;
+            glType = GL_UNSIGNED_BYTE;
+            return true;
+
+        case Datatype::signed_byte:
+            internalFormat = GL_R8_SNORM;
+            glType = GL_BYTE;
+            return true;
+
+        case Datatype::unsigned_halfword:
+            internalFormat = GL_R16;
+            glType = GL_UNSIGNED_SHORT;
+            return true;
+
+        case Datatype::signed_halfword:
+            internalFormat = GL_R16_SNORM;
+            glType = GL_SHORT;
+            return true;
+
+        case Datatype::unsigned_word:
+            internalFormat = GL_R32F;
+            glType = GL_UNSIGNED_INT;
+            return true;
+
+        case Datatype::signed_word:
+            internalFormat = GL_R32F;
+            glType = GL_INT;
+            return true;
+
+        case Datatype::single_precision_float:
+            internalFormat = GL_R32F;
+            glType = GL_FLOAT;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/**
+ * \brief texel to data value factor of the textures without conversion
+ *
+ * OpenGL maps unsigned integers to [0, 1] and signed integers to [-1, 1] by
+ * dividing through the largest value of the type.
+ */
+float cr::getNativeValueScale(Datatype type)
+{
+    switch(type)
+    {
+        case Datatype::unsigned_byte: return 255.f;
+        case Datatype::signed_byte: return 127.f;
+        case Datatype::unsigned_halfword: return 65535.f;
+        case Datatype::signed_halfword: return 32767.f;
+        case Datatype::unsigned_word: return 4294967295.f;
+        case Datatype::signed_word: return 2147483647.f;
+        default: return 1.f;
+    }
+}
+
+/**
+ * \brief converts the volume data into r8, r16 or r16f texels
+ *
+ * \param volumeData volume dataset representative class object
+ * \param format target format (r8, r16 or r16f)
+ * \param window values that are mapped to 0 and 1
+ * \param texels buffer for voxel count texels of the target format
+ *
+ * \return false if the format or the data type is not supported
+ */
+bool cr::quantizeVolumeData(
+    const VolumeDataBase &volumeData,
+    TextureFormat format,
+    std::tuple<float, float> window,
+    void *texels)
+{
+    return quantizeValues(
+        volumeData.getRawData(),
+        volumeData.getVolumeConfig().getVoxelType(),
+        volumeData.getVolumeConfig().getVoxelCount(),
+        format,
+        window,
+        texels);
+}
+
+/**
+ * \brief converts an array of values into r8, r16 or r16f texels
+ *
+ * \param values values of the given data type
+ * \param type data type of the values
+ * \param count number of values
+ * \param format target format (r8, r16 or r16f)
+ * \param window values that are mapped to 0 and 1
+ * \param texels buffer for count texels of the target format
+ *
+ * \return false if the format or the data type is not supported
+ */
+bool cr::quantizeValues(
+    const void *values,
+    Datatype type,
+    size_t count,
+    TextureFormat format,
+    std::tuple<float, float> window,
+    void *texels)
+{
+    if ((TextureFormat::native == format) || (nullptr == values))
+        return false;
+
+    switch(type)
+    {
+        case Datatype::unsigned_byte:
+            quantizeFormat(static_cast<const unsigned_byte_t*>(values),
+                texels, count, window, format);
+            break;
+
+        case Datatype::signed_byte:
+            quantizeFormat(static_cast<const signed_byte_t*>(values),
+                texels, count, window, format);
+            break;
+
+        case Datatype::unsigned_halfword:
+            quantizeFormat(static_cast<const unsigned_halfword_t*>(values),
+                texels, count, window, format);
+            break;
+
+        case Datatype::signed_halfword:
+            quantizeFormat(static_cast<const signed_halfword_t*>(values),
+                texels, count, window, format);
+            break;
+
+        case Datatype::unsigned_word:
+            quantizeFormat(static_cast<const unsigned_word_t*>(values),
+                texels, count, window, format);
+            break;
+
+        case Datatype::signed_word:
+            quantizeFormat(static_cast<const signed_word_t*>(values),
+                texels, count, window, format);
+            break;
+
+        case Datatype::unsigned_longword:
+            quantizeFormat(static_cast<const unsigned_longword_t*>(values),
+                texels, count, window, format);
+            break;
+
+        case Datatype::signed_longword:
+            quantizeFormat(static_cast<const signed_longword_t*>(values),
+                texels, count, window, format);
+            break;
+
+        case Datatype::single_precision_float:
+            quantizeFormat(static_cast<const single_precision_float_t*>(values),
+                texels, count, window, format);
+            break;
+
+        case Datatype::double_precision_float:
+            quantizeFormat(static_cast<const double_precision_float_t*>(values),
+                texels, count, window, format);
+            break;
+
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief converts in core volume data into texels for a texture
+ *
+ * \param volumeData volume dataset representative class object
+ * \param format format of the texture on the GPU
+ * \param window values that are mapped to 0 and 1 by the conversion
+ * \param texels receives the texels, their formats and the mapping of the
+ *        texels to data values
+ *
+ * \return false if the data is paged or its type is not supported
+ */
+bool cr::convertVolumeTexels(
+    const VolumeDataBase &volumeData,
+    TextureFormat format,
+    std::tuple<float, float> window,
+    VolumeTexels &texels)
+{
+    const VolumeConfig &volumeConfig = volumeData.getVolumeConfig();
+    Datatype type = volumeConfig.getVoxelType();
+
+    if (volumeData.isPaged() || (nullptr == volumeData.getRawData()))
+        return false;
+
+    texels.format = getEffectiveTextureFormat(format, type);
+    texels.dim = volumeConfig.getVolumeDim();
+    texels.texelSize = getTexelSize(texels.format, type);
+    texels.converted.clear();
+    texels.raw = nullptr;
+    if (!getGlTextureFormat(
+            texels.format, type, texels.internalFormat, texels.glType))
+    {
+        std::cerr << "Error: unsupported volume datatype." << std::endl;
+        return false;
+    }
+
+    if (TextureFormat::native == texels.format)
+    {
+        texels.raw = volumeData.getRawData();
+        texels.valueScale = getNativeValueScale(type);
+        texels.valueOffset = 0.f;
+        return true;
+    }
+
+    if (texels.format != format)
+        std::cout << "Note: " << json(type).get<std::string>() <<
+            " volumes are converted to " <<
+            json(texels.format).get<std::string>() << " textures." <<
+            std::endl;
+
+    texels.converted.resize(volumeConfig.getVoxelCount() * texels.texelSize);
+    quantizeVolumeData(volumeData, texels.format, window,
+        texels.converted.data());
+    texels.valueScale = std::get<1>(window) - std::get<0>(window);
+    texels.valueOffset = std::get<0>(window);
+
+    return true;
+}
+
+/**
+ * \brief creates a 3d texture of the volume data in the given format
+ *
+ * \param volumeData volume dataset representative class object
+ * \param format format of the texture on the GPU
+ * \param window values that are mapped to 0 and 1 by the conversion
+ *
+ * \return the texture and the mapping of its texels to data values
+ *
+ * The native format uploads the data as it is (see loadScalarVolumeTex).
+ * The other formats store the values inside the window with 1 or 2 byte
+ * per voxel, values outside of the window are clamped. Paged volume data is
+ * paged in completely, use PagedVolumeData::extractRegion to upload only a
+ * part of it.
+ */
+cr::VolumeTexture cr::createVolumeTex(
+    const VolumeDataBase &volumeData,
+    TextureFormat format,
+    std::tuple<float, float> window)
+{
+    VolumeTexture volumeTex;
+    VolumeTexels texels;
+
+    if (volumeData.isPaged())
+    {
+        std::array<size_t, 3> dim =
+            volumeData.getVolumeConfig().getVolumeDim();
+        std::unique_ptr<VolumeDataBase> region =
+            static_cast<const PagedVolumeData&>(volumeData).extractRegion(
+                {{0, 0, 0}}, {{dim[0] - 1, dim[1] - 1, dim[2] - 1}});
+
+        if (nullptr == region)
+        {
+            volumeTex.format = format;
+            volumeTex.valueScale = 1.f;
+            volumeTex.valueOffset = 0.f;
+            return volumeTex;
+        }
+
+        return createVolumeTex(*region, format, window);
+    }
+
+    if (!convertVolumeTexels(volumeData, format, window, texels))
+    {
+        volumeTex.format = texels.format;
+        volumeTex.valueScale = 1.f;
+        volumeTex.valueOffset = 0.f;
+        return volumeTex;
+    }
+
+    volumeTex.texture = util::texture::Texture3D(
+        texels.internalFormat,
+        GL_RED,
+        0,
+        texels.glType,
+        GL_LINEAR,
+        GL_CLAMP_TO_EDGE,
+        texels.dim[0],
+        texels.dim[1],
+        texels.dim[2],
+        texels.getData());
+    volumeTex.format = texels.format;
+    volumeTex.valueScale = texels.valueScale;
+    volumeTex.valueOffset = texels.valueOffset;
+
+    return volumeTex;
+}
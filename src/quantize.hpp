@@ -0,0 +1,131 @@
+#pragma once
+
+#include <tuple>
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <json.hpp>
+using json = nlohmann::json;
+
+#include "util/util.hpp"
+#include "configraw.hpp"
+
+namespace cr
+{
+    // ------------------------------------------------------------------------
+    // type definitions
+    // ------------------------------------------------------------------------
+    /**
+     * \brief formats the volume data can be converted to for the GPU
+     *
+     * native uploads the values as they are (types without a matching
+     * texture format fall back to r16). r8 and r16 store the values inside
+     * the value window as normalized integers, r16f as half floats in [0,1].
+    */
+    enum class TextureFormat : int
+    {
+        native = 0,
+        r8,
+        r16,
+        r16f
+    };
+
+    NLOHMANN_JSON_SERIALIZE_ENUM(
+        TextureFormat, {
+            {TextureFormat::native, "NATIVE"},
+            {TextureFormat::r8, "R8"},
+            {TextureFormat::r16, "R16"},
+            {TextureFormat::r16f, "R16F"},
+            } );
+
+    /**
+     * \brief how the value window of the conversion is chosen
+    */
+    enum class ValueWindow : int
+    {
+        limits = 0,     //!< lowest and highest value of the data
+        manual,         //!< window set by the user
+        percentile      //!< window between two percentiles of the data
+    };
+
+    NLOHMANN_JSON_SERIALIZE_ENUM(
+        ValueWindow, {
+            {ValueWindow::limits, "LIMITS"},
+            {ValueWindow::manual, "MANUAL"},
+            {ValueWindow::percentile, "PERCENTILE"},
+            } );
+
+    /**
+     * \brief 3D texture of a volume and how its texels map to data values
+     *
+     * A sampled texel t corresponds to the data value
+     * t * valueScale + valueOffset.
+    */
+    struct VolumeTexture
+    {
+        util::texture::Texture3D texture;
+        TextureFormat format;
+        float valueScale;
+        float valueOffset;
+    };
+
+    /**
+     * \brief texels of a volume ready for the upload and their formats
+     *
+     * The native format refers to the data of the volume, which then has to
+     * outlive the texels. The other formats own the converted texels.
+    */
+    struct VolumeTexels
+    {
+        std::vector<uint8_t> converted;     //!< empty for the native format
+        const void *raw = nullptr;          //!< volume data (native format)
+        std::array<size_t, 3> dim = {{0, 0, 0}};
+        size_t texelSize = 0;
+        TextureFormat format = TextureFormat::native;
+        GLenum internalFormat = GL_R8;
+        GLenum glType = GL_UNSIGNED_BYTE;
+        float valueScale = 1.f;
+        float valueOffset = 0.f;
+
+        const void* getData() const
+        {
+            return converted.empty() ? raw : converted.data();
+        }
+    };
+
+    // ------------------------------------------------------------------------
+    // function declarations
+    // ------------------------------------------------------------------------
+    TextureFormat getEffectiveTextureFormat(
+        TextureFormat format, Datatype type);
+    size_t getTexelSize(TextureFormat format, Datatype type);
+    float getNativeValueScale(Datatype type);
+    bool getGlTextureFormat(
+        TextureFormat format,
+        Datatype type,
+        GLenum &internalFormat,
+        GLenum &glType);
+    bool quantizeVolumeData(
+        const VolumeDataBase &volumeData,
+        TextureFormat format,
+        std::tuple<float, float> window,
+        void *texels);
+    bool quantizeValues(
+        const void *values,
+        Datatype type,
+        size_t count,
+        TextureFormat format,
+        std::tuple<float, float> window,
+        void *texels);
+    bool convertVolumeTexels(
+        const VolumeDataBase &volumeData,
+        TextureFormat format,
+        std::tuple<float, float> window,
+        VolumeTexels &texels);
+    VolumeTexture createVolumeTex(
+        const VolumeDataBase &volumeData,
+        TextureFormat format,
+        std::tuple<float, float> window);
+}
@@ -19,18 +19,29 @@
 #include <glm/glm.hpp>
 
 #include <string>
+#include <unordered_map>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+#include "util/programcache.hpp"
+
 class Shader
 {
     public:
-    Shader() : m_ID(0){};
+    Shader() : m_ID(0), m_uniformLocations(){};
+    /**
+     * \brief builds a program from vertex, fragment and geometry shader
+     *
+     * \param defines preprocessor directives that are inserted after the
+     *                #version line of each stage, e.g. to build variants of
+     *                a shader with features fixed at compile time
+     */
     Shader(
         const char* vertexPath,
         const char* fragmentPath,
-        const char* geometryPath = nullptr)
+        const char* geometryPath = nullptr,
+        const std::string &defines = std::string())
     {
         std::string vertexCode;
         std::string fragmentCode;
@@ -72,45 +83,26 @@ class Shader
             std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" <<
                 std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-
-        // compile shaders
-        // ---------------
-        unsigned int vertex = 0, fragment = 0;
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, nullptr);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, nullptr);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
+        build(vertexCode, fragmentCode, geometryCode, defines);
+    }
 
-        unsigned int geometry = 0;
-        if(geometryPath != nullptr)
-        {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, nullptr);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
-        }
+    /**
+     * \brief builds a program from shader sources in memory
+     *
+     * \param geometryCode source of the geometry shader, no geometry shader
+     *                     is used if it is empty
+     * \param defines see above
+     */
+    static Shader fromSource(
+        const std::string &vertexCode,
+        const std::string &fragmentCode,
+        const std::string &geometryCode = std::string(),
+        const std::string &defines = std::string())
+    {
+        Shader shader;
+        shader.build(vertexCode, fragmentCode, geometryCode, defines);
 
-        // build shader program
-        // --------------------
-        m_ID = glCreateProgram();
-        glAttachShader(m_ID, vertex);
-        glAttachShader(m_ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(m_ID, geometry);
-        glLinkProgram(m_ID);
-        checkCompileErrors(m_ID, "PROGRAM");
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
+        return shader;
     }
 
     Shader(const char* computePath)
@@ -155,13 +147,19 @@ class Shader
     }
 
     Shader(const Shader& other) = delete;
-    Shader(Shader&& other) : m_ID(other.m_ID) {other.m_ID = 0;}
+    Shader(Shader&& other) :
+        m_ID(other.m_ID),
+        m_uniformLocations(std::move(other.m_uniformLocations))
+    {
+        other.m_ID = 0;
+    }
     Shader& operator=(const Shader& other) = delete;
     Shader& operator=(Shader&& other)
     {
         if (0 != m_ID)
             glDeleteShader(m_ID);
         m_ID = other.m_ID;
+        m_uniformLocations = std::move(other.m_uniformLocations);
         other.m_ID = 0;
 
         return *this;
@@ -181,82 +179,195 @@ class Shader
     {
         glUseProgram(m_ID);
     }
-    // utility uniform functions
+    // utility uniform functions. The locations are looked up once per name
+    // and cached, as glGetUniformLocation is slow on many drivers.
+    // ------------------------------------------------------------------------
+    GLint getUniformLocation(const std::string &name) const
+    {
+        auto location = m_uniformLocations.find(name);
+        if (m_uniformLocations.end() != location)
+            return location->second;
+
+        GLint id = glGetUniformLocation(m_ID, name.c_str());
+        m_uniformLocations.emplace(name, id);
+        return id;
+    }
+    // ------------------------------------------------------------------------
+    void setUniformBlockBinding(const std::string &name, GLuint binding) const
+    {
+        GLuint index = glGetUniformBlockIndex(m_ID, name.c_str());
+        if (GL_INVALID_INDEX != index)
+            glUniformBlockBinding(m_ID, index, binding);
+    }
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(m_ID, name.c_str()), (int)value);
+        glUniform1i(getUniformLocation(name), (int)value);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     {
-        glUniform1i(glGetUniformLocation(m_ID, name.c_str()), value);
+        glUniform1i(getUniformLocation(name), value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     {
-        glUniform1f(glGetUniformLocation(m_ID, name.c_str()), value);
+        glUniform1f(getUniformLocation(name), value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     {
-        glUniform2fv(glGetUniformLocation(m_ID, name.c_str()), 1, &value[0]);
+        glUniform2fv(getUniformLocation(name), 1, &value[0]);
     }
     void setVec2(const std::string &name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(m_ID, name.c_str()), x, y);
+        glUniform2f(getUniformLocation(name), x, y);
+    }
+    void setIVec2(const std::string &name, GLint x, GLint y) const
+    {
+        glUniform2i(getUniformLocation(name), x, y);
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     {
-        glUniform3fv(glGetUniformLocation(m_ID, name.c_str()), 1, &value[0]);
+        glUniform3fv(getUniformLocation(name), 1, &value[0]);
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(m_ID, name.c_str()), x, y, z);
+        glUniform3f(getUniformLocation(name), x, y, z);
     }
     void setUVec3(const std::string &name, const glm::uvec3 &value) const
     {
-        glUniform3uiv(glGetUniformLocation(m_ID, name.c_str()), 1, &value[0]);
+        glUniform3uiv(getUniformLocation(name), 1, &value[0]);
     }
     void setUVec3(const std::string &name, GLuint x, GLuint y, GLuint z) const
     {
-        glUniform3ui(glGetUniformLocation(m_ID, name.c_str()), x, y, z);
+        glUniform3ui(getUniformLocation(name), x, y, z);
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     {
-        glUniform4fv(glGetUniformLocation(m_ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(getUniformLocation(name), 1, &value[0]);
     }
     void setVec4(const std::string &name, float x, float y, float z, float w)
     {
-        glUniform4f(glGetUniformLocation(m_ID, name.c_str()), x, y, z, w);
+        glUniform4f(getUniformLocation(name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
         glUniformMatrix2fv(
-            glGetUniformLocation(m_ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+            getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
         glUniformMatrix3fv(
-            glGetUniformLocation(m_ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+            getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
         glUniformMatrix4fv(
-            glGetUniformLocation(m_ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+            getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
 
     private:
     unsigned int m_ID;
+    mutable std::unordered_map<std::string, GLint> m_uniformLocations;
+
+    // compiles and links the program. Linked programs are taken from and
+    // added to the program binary cache if the driver supports it.
+    // ------------------------------------------------------------------------
+    void build(
+        std::string vertexCode,
+        std::string fragmentCode,
+        std::string geometryCode,
+        const std::string &defines)
+    {
+        vertexCode = insertDefines(vertexCode, defines);
+        fragmentCode = insertDefines(fragmentCode, defines);
+        geometryCode = insertDefines(geometryCode, defines);
+        bool hasGeometry = !geometryCode.empty();
+
+        std::string cacheKey = util::programcache::getKey(
+            vertexCode + '\0' + fragmentCode + '\0' + geometryCode);
+        m_ID = util::programcache::loadProgram(cacheKey);
+        if (0 != m_ID)
+            return;
+
+        const char* vShaderCode = vertexCode.c_str();
+        const char * fShaderCode = fragmentCode.c_str();
+
+        // compile shaders
+        // ---------------
+        unsigned int vertex = 0, fragment = 0;
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vShaderCode, nullptr);
+        glCompileShader(vertex);
+        checkCompileErrors(vertex, "VERTEX");
+
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fShaderCode, nullptr);
+        glCompileShader(fragment);
+        checkCompileErrors(fragment, "FRAGMENT");
+
+        unsigned int geometry = 0;
+        if(hasGeometry)
+        {
+            const char * gShaderCode = geometryCode.c_str();
+            geometry = glCreateShader(GL_GEOMETRY_SHADER);
+            glShaderSource(geometry, 1, &gShaderCode, nullptr);
+            glCompileShader(geometry);
+            checkCompileErrors(geometry, "GEOMETRY");
+        }
+
+        // build shader program
+        // --------------------
+        m_ID = glCreateProgram();
+        glAttachShader(m_ID, vertex);
+        glAttachShader(m_ID, fragment);
+        if(hasGeometry)
+            glAttachShader(m_ID, geometry);
+        bool cache = util::programcache::isAvailable();
+        if (cache)
+            glProgramParameteri(
+                m_ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(m_ID);
+        if (checkCompileErrors(m_ID, "PROGRAM") && cache)
+            util::programcache::storeProgram(cacheKey, m_ID);
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        if(hasGeometry)
+            glDeleteShader(geometry);
+    }
+
+    // inserts the defines after the #version line. The #line directive keeps
+    // the line numbers of compiler messages in sync with the source file.
+    // ------------------------------------------------------------------------
+    static std::string insertDefines(
+        const std::string &code,
+        const std::string &defines)
+    {
+        if (defines.empty() || code.empty())
+            return code;
+
+        size_t pos = 0;
+        size_t lines = 0;
+        if (0 == code.compare(0, 8, "#version"))
+        {
+            pos = code.find('\n');
+            pos = (std::string::npos == pos) ? code.size() : pos + 1;
+            lines = 1;
+        }
+
+        return code.substr(0, pos) + defines + "\n#line " +
+            std::to_string(lines + 1) + "\n" + code.substr(pos);
+    }
 
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -283,6 +394,8 @@ class Shader
                     std::string(79, '-') << std::endl;
             }
         }
+
+        return success;
     }
 };
 
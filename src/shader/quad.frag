@@ -11,16 +11,65 @@ uniform sampler3D volumeTex;    //!< 3D texture that contains the volume data
 uniform int texSelect;          //!< selection which texture shall be shown
 
 uniform float volumeZ;          //!< z coordinate for volume sampling
+uniform ivec2 renderSize;       //!< pixels of renderTex covered by the
+                                //!< rendering, less while interacting
+
+// weight of color differences in the upsampling, higher keeps edges sharper
+const float EDGE_SHARPNESS = 64.f;
+
+/*!
+ *  \brief upsamples a rendering of reduced resolution to the quad
+ *
+ *  Bilinear interpolation between the 2x2 nearest texels whose weights are
+ *  lowered for texels that differ in color from the nearest one. Smooth
+ *  areas are interpolated, while edges such as silhouettes and isosurface
+ *  borders are not blurred across.
+ *
+ *  \param texCoord normalized coordinates on the quad
+ *
+ *  \return upsampled color
+ */
+vec4 upsample(vec2 texCoord)
+{
+    vec2 pos = texCoord * vec2(renderSize) - 0.5f;
+    ivec2 base = ivec2(floor(pos));
+    vec2 f = pos - vec2(base);
+    ivec2 maxPos = renderSize - ivec2(1);
+    vec4 guide = texelFetch(
+        renderTex, clamp(base + ivec2(step(0.5f, f)), ivec2(0), maxPos), 0);
+    vec4 sum = vec4(0.f);
+    float weightSum = 0.f;
+
+    // the nearest texel has a weight of at least 0.25, so weightSum > 0
+    for (int j = 0; j < 2; ++j)
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            vec4 color = texelFetch(
+                renderTex, clamp(base + ivec2(i, j), ivec2(0), maxPos), 0);
+            vec4 diff = color - guide;
+            float weight = (i == 0 ? 1.f - f.x : f.x) *
+                (j == 0 ? 1.f - f.y : f.y) *
+                exp(-EDGE_SHARPNESS * dot(diff, diff));
+
+            sum += weight * color;
+            weightSum += weight;
+        }
+    }
+
+    return sum / weightSum;
+}
 
 void main()
 {
     uvec4 state = uvec4(0U);
     float value = 0.f;
+    vec2 scale = vec2(renderSize) / vec2(textureSize(renderTex, 0));
 
     switch(texSelect)
     {
         case 1: // random number generator texture
-            state = texture(rngTex, vTexCoord);
+            state = texture(rngTex, vTexCoord * scale);
             fragColor.r = float(state.x % 256U) / 255.f;
             fragColor.g = float(state.y % 256U) / 255.f;
             fragColor.b = float(state.z % 256U) / 255.f;
@@ -34,7 +83,10 @@ void main()
 
         case 0:
         default:
-            fragColor = texture(renderTex, vTexCoord);
+            if (all(equal(renderSize, textureSize(renderTex, 0))))
+                fragColor = texture(renderTex, vTexCoord);
+            else
+                fragColor = upsample(vTexCoord);
             break;
     }
 }
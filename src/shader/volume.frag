@@ -6,17 +6,9 @@ in vec3 vTexCoord;          //!< texture coordinates
 in vec3 vWorldCoord;        //!< texture coordinates
 
 uniform sampler3D volumeTex;            //!< 3D texture handle
-uniform bool volumeTexNormalized;       //!< does the volume only contain
-                                        //!< values in [0,1]
 uniform sampler2D transferfunctionTex;  //!< 3D texture handle
-
-uniform float valIntervalMin;    //!< lower limit of the shown normalized
-                                 //!< value interval
-uniform float valIntervalMax;    //!< upper limit of the shown normalized
-                                 //!< value interval
-
-uniform float volumeDataMin;    //!< min. value of the unnormalized volume data
-uniform float volumeDataMax;    //!< max. value of the unnormalized volume data
+uniform sampler2D preIntegrationTex;    //!< pre-integration table indexed
+                                        //!< by (front value, back value)
 
 uniform bool useSeed;           //!< flag if the seed texture shall be used
 uniform usampler2D seed;        //!< seed texture for random number generator
@@ -38,46 +30,87 @@ uniform int winHeight;          //!< height of the window in pixels
 #define MODE_MIP    1
 #define MODE_ISO    2
 #define MODE_TF     3
-uniform int mode;
 
 #define GRAD_CENTRAL    0
 #define GRAD_SOBEL      1
+uniform sampler3D gradientTex;      //!< normalized gradients (rgb * 2 - 1)
+
+#define SKIP_LOOK_AHEAD 0
+#define SKIP_MACROCELLS 1
+
+// feature switches. Shader variants define SPECIALIZED and the SPEC_* values
+// to fix them at compile time, which removes the branches of the disabled
+// features from the ray marching loop.
+#ifdef SPECIALIZED
+const int mode = SPEC_MODE;
+const int gradMethod = SPEC_GRAD_METHOD;
+const bool precomputedGradients = SPEC_PRECOMPUTED_GRADIENTS;
+const bool emptySpaceSkipping = SPEC_EMPTY_SPACE_SKIPPING;
+const int skipMethod = SPEC_SKIP_METHOD;
+const bool ambientOcclusion = SPEC_AMBIENT_OCCLUSION;
+const bool isoDenoise = SPEC_ISO_DENOISE;
+const bool invertColors = SPEC_INVERT_COLORS;
+const bool sliceVolume = SPEC_SLICE_VOLUME;
+const bool preIntegration = SPEC_PRE_INTEGRATION;
+const bool brickAtlas = SPEC_BRICK_ATLAS;
+#else
+uniform int mode;
 uniform int gradMethod;     //!< switch to select gradient calculation method
-
-uniform float stepSize;         //!< distance between sample points between
-                                //!< sample points in world coordinates
+uniform bool precomputedGradients;  //!< switch for the gradient texture
 uniform bool emptySpaceSkipping;//!< switch for acceleration method
-uniform float stepSizeVoxel;    //!< distance between sample points in voxels
-uniform float brightness;       //!< color coefficient
-
+uniform int skipMethod;         //!< empty space skipping method
 uniform bool ambientOcclusion;  //!< switch for activating ambient occlusion
-uniform float aoProportion;     //!< weight of ambient occlusion on final color
-uniform int aoSamples;          //!< number of samples involved in ambient
-                                //!< occlusion calculation
-uniform float aoRadius;         //!< radius of the sampled halfdome
-
-uniform float isovalue;         //!< normalized value for isosurface
 uniform bool isoDenoise;        //!< switch for smoothing of the isosurface
-uniform float isoDenoiseR;      //!< radius for denoising
-
-uniform vec3 lightDir;      //!< light direction
-
-uniform vec3 ambient;       //!< ambient color
-uniform vec3 diffuse;       //!< diffuse color
-uniform vec3 specular;      //!< specular color
-
-uniform float kAmb;        //!< ambient factor
-uniform float kDiff;       //!< diffuse factor
-uniform float kSpec;       //!< specular factor
-uniform float kExp;        //!< specular exponent
-
-uniform vec3 bgColor;      //!< color of the background
-uniform bool invertColors; //!< switch for inverting the color output
-uniform bool invertAlpha;  //!< switch for inverting the alpha output
+uniform bool invertColors;      //!< switch for inverting the color output
+uniform bool sliceVolume;       //!< switch for slicing plane
+uniform bool preIntegration;    //!< switch for pre-integrated transfer
+                                //!< functions
+uniform bool brickAtlas;        //!< volumeTex is a brick atlas
+#endif
+
+uniform sampler3D macrocellTex; //!< visibility of the macrocells
+uniform vec3 macrocellScale;    //!< macrocells per texture coordinate unit
+
+uniform usampler3D pageTableTex;//!< atlas slot of each brick (rgb) and if the
+                                //!< brick is stored (a)
+uniform vec3 brickVolumeDim;    //!< voxels of the bricked volume
+uniform float brickSize;        //!< edge length of a brick in the atlas
+
+// settings that only change with the user interface. The renderer keeps them
+// in a uniform buffer that is only updated on changes (std140 layout, see
+// mvr::VolumeSettingsBlock).
+layout(std140) uniform VolumeSettings
+{
+    vec3 lightDir;          //!< light direction
+    float kAmb;             //!< ambient factor
+    vec3 ambient;           //!< ambient color
+    float kDiff;            //!< diffuse factor
+    vec3 diffuse;           //!< diffuse color
+    float kSpec;            //!< specular factor
+    vec3 specular;          //!< specular color
+    float kExp;             //!< specular exponent
+    vec3 bgColor;           //!< color of the background
+    float brightness;       //!< color coefficient
+    vec3 slicePlaneNormal;  //!< normal of slicing plane
+    float isovalue;         //!< normalized value for isosurface
+    vec3 slicePlaneBase;    //!< base point of slicing plane
+    float isoDenoiseR;      //!< radius for denoising
+
+    float volumeTexScale;   //!< maps a texel to the normalized
+    float volumeTexOffset;  //!< value: t * scale + offset
+    float valIntervalMin;   //!< lower limit of the shown normalized values
+    float valIntervalMax;   //!< upper limit of the shown normalized values
+
+    float stepSize;         //!< distance between sample points in world
+                            //!< coordinates
+    float stepSizeVoxel;    //!< distance between sample points in voxels
+    float aoProportion;     //!< weight of ambient occlusion on final color
+    float aoRadius;         //!< radius of the sampled halfdome
 
-uniform bool sliceVolume;          //!< switch for slicing plane
-uniform vec3 slicePlaneNormal;    //!< normal of slicing plane
-uniform vec3 slicePlaneBase;      //!< base point of slicing plane
+    int aoSamples;          //!< number of samples involved in ambient
+                            //!< occlusion calculation
+    bool invertAlpha;       //!< switch for inverting the alpha output
+};
 
 #define M_PIH   1.570796
 #define M_PI    3.141592
@@ -222,6 +255,50 @@ vec3 blinnPhong(vec3 n, vec3 l, vec3 v)
 
     return color;
 }
+/*!
+ *  \brief samples the volume texture with linear interpolation
+ *
+ *  \param volume sampler that contains the volume data
+ *  \param pos position in volume texture coordinates
+ *  \return the interpolated texel
+ *
+ *  A brick atlas is addressed through the page table. Each brick stores the
+ *  first voxel of its upper neighbours, so the interpolation stays inside
+ *  the brick. Bricks that are not stored only contain texels 0.
+ */
+float sampleVolume(sampler3D volume, vec3 pos)
+{
+    if (!brickAtlas)
+        return texture(volume, pos).r;
+
+    // voxel centers at integer coordinates, clamped like GL_CLAMP_TO_EDGE
+    vec3 voxel = clamp(
+        pos * brickVolumeDim - 0.5f, vec3(0.f), brickVolumeDim - 1.f);
+    ivec3 brick = min(
+        ivec3(voxel / (brickSize - 1.f)), textureSize(pageTableTex, 0) - 1);
+    uvec4 page = texelFetch(pageTableTex, brick, 0);
+
+    if (0u == page.a)
+        return 0.f;
+
+    vec3 local = voxel - vec3(brick) * (brickSize - 1.f);
+    return texture(
+        volume,
+        (vec3(page.rgb) * brickSize + local + 0.5f) /
+            vec3(textureSize(volume, 0))).r;
+}
+
+/*!
+ *  \brief maps a texel of the volume texture to the normalized value range
+ *
+ *  \param texel value sampled from the volume texture
+ *  \return value in [0,1] with respect to the limits of the volume data
+ */
+float normalizeTexel(float texel)
+{
+    return clamp(texel * volumeTexScale + volumeTexOffset, 0.f, 1.f);
+}
+
 /*!
  *  \brief calculates and scalar ambient occlusion factor
  *
@@ -254,7 +331,7 @@ float calcAmbientOcclussionFactor(
     {
         sampleDir = sampleHalfdomeDirectionUpper(n);
         sampleCoord = pos + r * sampleDir;
-        value = texture(volume, sampleCoord).r;
+        value = normalizeTexel(sampleVolume(volume, sampleCoord));
         if (value > threshold)
             ++count;
     }
@@ -364,12 +441,12 @@ vec3 gradientCentral(sampler3D volume, vec3 pos, float h)
 {
     vec3 grad = vec3(0.0);      // gradient vector
 
-    grad.x = texture(volume, pos + vec3(h, 0.f, 0.f)).r -
-        texture(volume, pos - vec3(h, 0.f, 0.f)).r;
-    grad.y = texture(volume, pos + vec3(0.f, h, 0.f)).r -
-        texture(volume, pos - vec3(0.f, h, 0.f)).r;
-    grad.z = texture(volume, pos + vec3(0.f, 0.f, h)).r -
-        texture(volume, pos - vec3(0.f, 0.f, h)).r;
+    grad.x = sampleVolume(volume, pos + vec3(h, 0.f, 0.f)) -
+        sampleVolume(volume, pos - vec3(h, 0.f, 0.f));
+    grad.y = sampleVolume(volume, pos + vec3(0.f, h, 0.f)) -
+        sampleVolume(volume, pos - vec3(0.f, h, 0.f));
+    grad.z = sampleVolume(volume, pos + vec3(0.f, 0.f, h)) -
+        sampleVolume(volume, pos - vec3(0.f, 0.f, h));
     grad /= 2.0 * h;
 
     return normalize(grad);
@@ -399,34 +476,34 @@ vec3 gradientCentral(sampler3D volume, vec3 pos, float h)
      *
      * Multiple suffixes used to indicate offset in the different directions!
      */
-    float v_mmm = texture(volume, pos + vec3(-h,    -h,     -h)).r;
-    float v_mmz = texture(volume, pos + vec3(-h,    -h,     0.f)).r;
-    float v_mmp = texture(volume, pos + vec3(-h,    -h,     h)).r;
-    float v_mzm = texture(volume, pos + vec3(-h,    0.f,    -h)).r;
-    float v_mzz = texture(volume, pos + vec3(-h,    0.f,    0.f)).r;
-    float v_mzp = texture(volume, pos + vec3(-h,    0.f,    h)).r;
-    float v_mpm = texture(volume, pos + vec3(-h,    h,      -h)).r;
-    float v_mpz = texture(volume, pos + vec3(-h,    h,      0.f)).r;
-    float v_mpp = texture(volume, pos + vec3(-h,    h,      h)).r;
-
-    float v_zmm = texture(volume, pos + vec3(0.f,   -h,     -h)).r;
-    float v_zmz = texture(volume, pos + vec3(0.f,   -h,     0.f)).r;
-    float v_zmp = texture(volume, pos + vec3(0.f,   -h,     h)).r;
-    float v_zzm = texture(volume, pos + vec3(0.f,   0.f,    -h)).r;
-    float v_zzp = texture(volume, pos + vec3(0.f,   0.f,    h)).r;
-    float v_zpm = texture(volume, pos + vec3(0.f,   h,      -h)).r;
-    float v_zpz = texture(volume, pos + vec3(0.f,   h,      0.f)).r;
-    float v_zpp = texture(volume, pos + vec3(0.f,   h,      h)).r;
-
-    float v_pmm = texture(volume, pos + vec3(h,     -h,     -h)).r;
-    float v_pmz = texture(volume, pos + vec3(h,     -h,     0.f)).r;
-    float v_pmp = texture(volume, pos + vec3(h,     -h,     h)).r;
-    float v_pzm = texture(volume, pos + vec3(h,     0.f,    -h)).r;
-    float v_pzz = texture(volume, pos + vec3(h,     0.f,    0.f)).r;
-    float v_pzp = texture(volume, pos + vec3(h,     0.f,    h)).r;
-    float v_ppm = texture(volume, pos + vec3(h,     h,      -h)).r;
-    float v_ppz = texture(volume, pos + vec3(h,     h,      0.f)).r;
-    float v_ppp = texture(volume, pos + vec3(h,     h,      h)).r;
+    float v_mmm = sampleVolume(volume, pos + vec3(-h,    -h,     -h));
+    float v_mmz = sampleVolume(volume, pos + vec3(-h,    -h,     0.f));
+    float v_mmp = sampleVolume(volume, pos + vec3(-h,    -h,     h));
+    float v_mzm = sampleVolume(volume, pos + vec3(-h,    0.f,    -h));
+    float v_mzz = sampleVolume(volume, pos + vec3(-h,    0.f,    0.f));
+    float v_mzp = sampleVolume(volume, pos + vec3(-h,    0.f,    h));
+    float v_mpm = sampleVolume(volume, pos + vec3(-h,    h,      -h));
+    float v_mpz = sampleVolume(volume, pos + vec3(-h,    h,      0.f));
+    float v_mpp = sampleVolume(volume, pos + vec3(-h,    h,      h));
+
+    float v_zmm = sampleVolume(volume, pos + vec3(0.f,   -h,     -h));
+    float v_zmz = sampleVolume(volume, pos + vec3(0.f,   -h,     0.f));
+    float v_zmp = sampleVolume(volume, pos + vec3(0.f,   -h,     h));
+    float v_zzm = sampleVolume(volume, pos + vec3(0.f,   0.f,    -h));
+    float v_zzp = sampleVolume(volume, pos + vec3(0.f,   0.f,    h));
+    float v_zpm = sampleVolume(volume, pos + vec3(0.f,   h,      -h));
+    float v_zpz = sampleVolume(volume, pos + vec3(0.f,   h,      0.f));
+    float v_zpp = sampleVolume(volume, pos + vec3(0.f,   h,      h));
+
+    float v_pmm = sampleVolume(volume, pos + vec3(h,     -h,     -h));
+    float v_pmz = sampleVolume(volume, pos + vec3(h,     -h,     0.f));
+    float v_pmp = sampleVolume(volume, pos + vec3(h,     -h,     h));
+    float v_pzm = sampleVolume(volume, pos + vec3(h,     0.f,    -h));
+    float v_pzz = sampleVolume(volume, pos + vec3(h,     0.f,    0.f));
+    float v_pzp = sampleVolume(volume, pos + vec3(h,     0.f,    h));
+    float v_ppm = sampleVolume(volume, pos + vec3(h,     h,      -h));
+    float v_ppz = sampleVolume(volume, pos + vec3(h,     h,      0.f));
+    float v_ppp = sampleVolume(volume, pos + vec3(h,     h,      h));
 
 
     grad.x =
@@ -469,11 +546,20 @@ vec3 gradientCentral(sampler3D volume, vec3 pos, float h)
  *  methods:
  *      1 = sobel operators
  *      0 = central differences
+ *  If the gradients were precomputed for the volume they are read from the
+ *  gradient texture instead.
  */
 vec3 gradient(sampler3D volume, vec3 pos, float h, int method)
 {
     vec3 grad = vec3(0.0);      // gradient vector
 
+    // voxels without a gradient decode to a vector of length 1/255 * sqrt(3)
+    if (precomputedGradients)
+    {
+        grad = texture(gradientTex, pos).rgb * 2.f - 1.f;
+        return (dot(grad, grad) > 1e-3f) ? normalize(grad) : vec3(0.0);
+    }
+
     switch(method)
     {
         case GRAD_SOBEL:
@@ -494,34 +580,34 @@ vec3 gradient(sampler3D volume, vec3 pos, float h, int method)
  *  \param volume handle to the 3d texture
  *  \param pos central volume postion where the value shall be calculated
  *  \param r radius of the averaged sphere
- *  \return averaged value
+ *  \return averaged normalized value
  *
  *  Calculates the average value of the volume around a given position by
  *  sampling a sphere with paramatrizable radius at fixed positions.
  */
 float denoiseSphereAvg(sampler3D volume, vec3 pos, float r)
 {
-    float avg = 4.f * texture(volume, pos).r;
+    float avg = 4.f * sampleVolume(volume, pos);
     float sqrt_rr_by_2 = sqrt(r * r / 2.f);
     float r_by_2 = r / 2.f;
 
-    avg += 2.f * texture(volume, pos + vec3(-r, 0.f, 0.f)).r;
-    avg += 2.f * texture(volume, pos + vec3(r, 0.f, 0.f)).r;
-    avg += 2.f * texture(volume, pos + vec3(0.f, -r, 0.f)).r;
-    avg += 2.f * texture(volume, pos + vec3(0.f, r, 0.f)).r;
-    avg += 2.f * texture(volume, pos + vec3(0.f, 0.f, -r)).r;
-    avg += 2.f * texture(volume, pos + vec3(0.f, 0.f, r)).r;
-
-    avg += texture(volume, pos + vec3(r_by_2,   sqrt_rr_by_2,   r_by_2)).r;
-    avg += texture(volume, pos + vec3(-r_by_2,  sqrt_rr_by_2,   r_by_2)).r;
-    avg += texture(volume, pos + vec3(r_by_2,   sqrt_rr_by_2,   -r_by_2)).r;
-    avg += texture(volume, pos + vec3(-r_by_2,  sqrt_rr_by_2,   -r_by_2)).r;
-    avg += texture(volume, pos + vec3(r_by_2,   -sqrt_rr_by_2,  r_by_2)).r;
-    avg += texture(volume, pos + vec3(-r_by_2,  -sqrt_rr_by_2,  r_by_2)).r;
-    avg += texture(volume, pos + vec3(r_by_2,   -sqrt_rr_by_2,  -r_by_2)).r;
-    avg += texture(volume, pos + vec3(-r_by_2,  -sqrt_rr_by_2,  -r_by_2)).r;
-
-    return (avg / 24.f);
+    avg += 2.f * sampleVolume(volume, pos + vec3(-r, 0.f, 0.f));
+    avg += 2.f * sampleVolume(volume, pos + vec3(r, 0.f, 0.f));
+    avg += 2.f * sampleVolume(volume, pos + vec3(0.f, -r, 0.f));
+    avg += 2.f * sampleVolume(volume, pos + vec3(0.f, r, 0.f));
+    avg += 2.f * sampleVolume(volume, pos + vec3(0.f, 0.f, -r));
+    avg += 2.f * sampleVolume(volume, pos + vec3(0.f, 0.f, r));
+
+    avg += sampleVolume(volume, pos + vec3(r_by_2,   sqrt_rr_by_2,   r_by_2));
+    avg += sampleVolume(volume, pos + vec3(-r_by_2,  sqrt_rr_by_2,   r_by_2));
+    avg += sampleVolume(volume, pos + vec3(r_by_2,   sqrt_rr_by_2,   -r_by_2));
+    avg += sampleVolume(volume, pos + vec3(-r_by_2,  sqrt_rr_by_2,   -r_by_2));
+    avg += sampleVolume(volume, pos + vec3(r_by_2,   -sqrt_rr_by_2,  r_by_2));
+    avg += sampleVolume(volume, pos + vec3(-r_by_2,  -sqrt_rr_by_2,  r_by_2));
+    avg += sampleVolume(volume, pos + vec3(r_by_2,   -sqrt_rr_by_2,  -r_by_2));
+    avg += sampleVolume(volume, pos + vec3(-r_by_2,  -sqrt_rr_by_2,  -r_by_2));
+
+    return normalizeTexel(avg / 24.f);
 }
 
 /**
@@ -572,6 +658,30 @@ bool testEmptySpaceSkipping(float nextValue, float currentValue)
 
     return skip;
 }
+
+/**
+ *  \brief distance to the exit of the current macrocell if it is invisible
+ *
+ *  \param volCoord    position in volume texture coordinates
+ *  \param dirTex      ray direction in volume texture coordinates
+ *  \return distance along the ray, 0 if the macrocell contains visible values
+ */
+float macrocellSkipDistance(vec3 volCoord, vec3 dirTex)
+{
+    ivec3 cell = clamp(
+        ivec3(floor(volCoord * macrocellScale)),
+        ivec3(0),
+        textureSize(macrocellTex, 0) - 1);
+
+    if (texelFetch(macrocellTex, cell, 0).r > 0.f)
+        return 0.f;
+
+    // leave the cell through the faces the ray points to
+    vec3 exitCoord = (vec3(cell) + step(0.f, dirTex)) / macrocellScale;
+    vec3 t = abs(exitCoord - volCoord) / max(abs(dirTex), vec3(EPS));
+
+    return min(min(t.x, t.y), t.z);
+}
 // ----------------------------------------------------------------------------
 //   main
 // ----------------------------------------------------------------------------
@@ -600,6 +710,8 @@ void main()
 
     vec3 rayOrig = eyePos;                          //!< origin of the ray
     vec3 rayDir = normalize(vWorldCoord - rayOrig); //!< direction of the ray
+    vec3 rayDirTex = rayDir / (bbMax - bbMin);      //!< direction of the ray
+                                                    //!< in texture coordinates
 
     float aoFactor = 0.f;   //! multiplicative factor for ambient occlusion
 
@@ -628,6 +740,10 @@ void main()
 
     // transfer function
     vec4 tfColor = vec4(0.f);       //!< color value from the transferfunction
+    float tfCoord = 0.f;            //!< transfer function coordinate
+    float tfCoordLast = 0.f;        //!< coordinate of the last sample
+    float xTfLast = -1.f;           //!< distance of the last sample on the ray
+    float tStep = 1.f;              //!< segment length over base step size
 
     // initialize random number generator
     initRNG();
@@ -704,26 +820,40 @@ void main()
         }
 
         // Get data value, normalize and filter it
-        value = texture(volumeTex, volCoord).r;
-        if (volumeTexNormalized == true)
-            valueNormalized = value;
-        else
-            valueNormalized = clamp(
-                (value - volumeDataMin) / (volumeDataMax - volumeDataMin),
-                0.f,
-                1.f);
+        value = sampleVolume(volumeTex, volCoord);
+        valueNormalized = normalizeTexel(value);
         if (true == first)
         {
             first = false;
             lastValueNormalized = valueNormalized;
             posLast = pos;
         }
+
+        // skip the remaining samples of macrocells without visible values.
+        // In isosurface mode the surface may lie between the last sample and
+        // this one, otherwise all values up to the cell exit are on the same
+        // side of the isovalue as this one.
+        if (emptySpaceSkipping && (SKIP_MACROCELLS == skipMethod))
+        {
+            float tCell = macrocellSkipDistance(volCoord, rayDirTex);
+            if ((tCell > 0.f) &&
+                ((MODE_ISO != mode) ||
+                    ((valueNormalized - isovalue) *
+                        (lastValueNormalized - isovalue) >= 0.f)))
+            {
+                x += floor(tCell / dx) * dx;
+                posLast = rayOrig + x * rayDir;
+                lastValueNormalized = valueNormalized;
+                continue;
+            }
+        }
+
         if (valueNormalized < valIntervalMin) continue;
         else if (valueNormalized > valIntervalMax) continue;
 
         // accelerate ray marching if voxels don't contribute to the final
         // pixel color
-        if (emptySpaceSkipping == true)
+        if (emptySpaceSkipping && (SKIP_LOOK_AHEAD == skipMethod))
         {
             if (skippingCounter > 0)
                 --skippingCounter;
@@ -731,14 +861,8 @@ void main()
             {
                 vec3 posSkip = pos + EMPTY_SPACE_JUMPSIZE * rayDir;
                 vec3 volCoordSkip = (posSkip - bbMin) / (bbMax - bbMin);
-                float valueSkip = texture(volumeTex, volCoordSkip).r;
-                float valueNormalizedSkip = valueSkip;
-                if (volumeTexNormalized == false)
-                    valueNormalizedSkip = clamp(
-                        (valueSkip - volumeDataMin) /
-                            (volumeDataMax - volumeDataMin),
-                        0.f,
-                        1.f);
+                float valueNormalizedSkip = normalizeTexel(
+                    sampleVolume(volumeTex, volCoordSkip));
                 bool doSkip = testEmptySpaceSkipping(
                         valueNormalizedSkip, valueNormalized);
                 if (doSkip == true)
@@ -872,14 +996,37 @@ void main()
 
             // transfer function
             case MODE_TF:
-                tfColor = texture(
-                    transferfunctionTex,
-                    vec2(
-                        mix(valIntervalMin, valIntervalMax, valueNormalized),
-                        0.5f));
-                color = frontToBack(
-                    color,
-                    tfColor.rgb, tfColor.a, dxVoxel);
+                tfCoord = mix(valIntervalMin, valIntervalMax, valueNormalized);
+                if (preIntegration)
+                {
+                    // integrate over the segment from the last sample if it
+                    // directly precedes this one. Otherwise (e.g. after
+                    // skipped samples) the value is taken as constant.
+                    if ((xTfLast >= 0.f) && (x - xTfLast < 1.5f * stepSize))
+                    {
+                        tfColor = texture(
+                            preIntegrationTex, vec2(tfCoordLast, tfCoord));
+                        tStep = (x - xTfLast) / stepSize;
+                    }
+                    else
+                    {
+                        tfColor = texture(
+                            preIntegrationTex, vec2(tfCoord, tfCoord));
+                        tStep = dx / stepSize;
+                    }
+                    tfCoordLast = tfCoord;
+                    xTfLast = x;
+                    color = frontToBack(
+                        color,
+                        tfColor.rgb, tfColor.a, tStep);
+                }
+                else
+                {
+                    tfColor = texture(transferfunctionTex, vec2(tfCoord, 0.5f));
+                    color = frontToBack(
+                        color,
+                        tfColor.rgb, tfColor.a, dxVoxel);
+                }
                 if (color.a > 0.99f)
                 {
                     if(ambientOcclusion)
@@ -0,0 +1,46 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <map>
+
+#include "shadersources.hpp"
+
+//-----------------------------------------------------------------------------
+// internal constants
+//-----------------------------------------------------------------------------
+namespace
+{
+    // file name -> source, generated from src/shader by the Makefile
+    const std::map<std::string, const char*> EMBEDDED_SHADERS = {
+#include "shader/shaders.inc"
+    };
+}
+
+//-----------------------------------------------------------------------------
+// function definitions
+//-----------------------------------------------------------------------------
+std::string mvr::getShaderSource(const std::string &name, bool fromDisk)
+{
+    if (fromDisk)
+    {
+        std::ifstream ifs("src/shader/" + name);
+        if (ifs.good())
+        {
+            std::stringstream source;
+            source << ifs.rdbuf();
+            return source.str();
+        }
+        std::cerr << "Warning: src/shader/" << name << " not found, using "
+            "the embedded shader." << std::endl;
+    }
+
+    auto source = EMBEDDED_SHADERS.find(name);
+    if (EMBEDDED_SHADERS.end() == source)
+    {
+        std::cerr << "Error: unknown shader " << name << std::endl;
+        return std::string();
+    }
+
+    return std::string(source->second);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+
+namespace mvr
+{
+    // ------------------------------------------------------------------------
+    // function declarations
+    // ------------------------------------------------------------------------
+    /**
+     * \brief returns the source of a shader from src/shader
+     *
+     * The sources are embedded into the executable at build time, so the
+     * renderer works independent of the working directory.
+     *
+     * \param name file name of the shader, e.g. "volume.frag"
+     * \param fromDisk read src/shader/<name> relative to the working
+     *                 directory if it exists, which allows to edit shaders
+     *                 while the renderer is running
+     * \return empty string if the shader does not exist
+     */
+    std::string getShaderSource(const std::string &name, bool fromDisk = false);
+}
@@ -0,0 +1,786 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <array>
+#include <tuple>
+#include <limits>
+#include <type_traits>
+#include <functional>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <stdexcept>
+#include <cmath>
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+namespace bfs = boost::filesystem;
+
+#include "statistics.hpp"
+#include "paged.hpp"
+#include "timestepindex.hpp"
+
+//-----------------------------------------------------------------------------
+// internal helpers
+//-----------------------------------------------------------------------------
+namespace
+{
+    /**
+     * \brief identifies the part of a file the statistics belong to
+     */
+    std::string makeEntryKey(
+        const cr::VolumeConfig &volumeConfig, unsigned int n, bool swap)
+    {
+        std::ostringstream key;
+        std::array<size_t, 3> subsetMin = volumeConfig.getSubsetMin();
+        std::array<size_t, 3> subsetMax = volumeConfig.getSubsetMax();
+
+        // HDF5 files may hold several timesteps
+        if (!volumeConfig.getTimestepDataset(n).empty())
+            key << volumeConfig.getTimestepDataset(n) << ":";
+        key << json(volumeConfig.getVoxelType()).get<std::string>() << ":" <<
+            subsetMin[0] << "," << subsetMin[1] << "," << subsetMin[2] <<
+            "-" <<
+            subsetMax[0] << "," << subsetMax[1] << "," << subsetMax[2] <<
+            (swap ? ":swapped" : "");
+
+        return key.str();
+    }
+}
+
+//-----------------------------------------------------------------------------
+// VolumeStatistics Class Implementations
+//-----------------------------------------------------------------------------
+cr::VolumeStatistics::VolumeStatistics() :
+    m_valid(false),
+    m_voxelType(Datatype::none),
+    m_min(0.f),
+    m_max(0.f),
+    m_exact(false),
+    m_baseMin(0.0),
+    m_baseMax(0.0),
+    m_baseCounts(),
+    m_brickSize(STATISTICS_BRICK_SIZE),
+    m_brickCount{ {0, 0, 0} },
+    m_brickMin(),
+    m_brickMax()
+{
+}
+
+/**
+ * \brief computes limits, base histogram and brick ranges of volume data
+ *
+ * Paged volume data is processed brick by brick, so that only the bricks
+ * that are currently processed need to be in memory.
+ */
+cr::VolumeStatistics cr::VolumeStatistics::compute(
+    const VolumeDataBase &volumeData)
+{
+    VolumeStatistics statistics;
+    const VolumeConfig &volumeConfig = volumeData.getVolumeConfig();
+    std::array<size_t, 3> dim = volumeConfig.getVolumeDim();
+    void *values = volumeData.getRawData();
+
+    if ((nullptr == values) && !volumeData.isPaged())
+        return statistics;
+
+    statistics.m_voxelType = volumeConfig.getVoxelType();
+    if (volumeData.hasLimits())
+        std::tie(statistics.m_min, statistics.m_max) = volumeData.getLimits();
+    else
+        std::tie(statistics.m_min, statistics.m_max) =
+            getLimitsVolumeData(volumeData);
+
+    if (volumeData.isPaged())
+    {
+        statistics.m_valid = statistics.computePaged(
+            static_cast<const PagedVolumeData&>(volumeData));
+        return statistics;
+    }
+
+    switch(volumeConfig.getVoxelType())
+    {
+        case Datatype::unsigned_byte:
+            statistics.computeT(static_cast<unsigned_byte_t*>(values), dim);
+            break;
+
+        case Datatype::signed_byte:
+            statistics.computeT(static_cast<signed_byte_t*>(values), dim);
+            break;
+
+        case Datatype::unsigned_halfword:
+            statistics.computeT(
+                static_cast<unsigned_halfword_t*>(values), dim);
+            break;
+
+        case Datatype::signed_halfword:
+            statistics.computeT(static_cast<signed_halfword_t*>(values), dim);
+            break;
+
+        case Datatype::unsigned_word:
+            statistics.computeT(static_cast<unsigned_word_t*>(values), dim);
+            break;
+
+        case Datatype::signed_word:
+            statistics.computeT(static_cast<signed_word_t*>(values), dim);
+            break;
+
+        case Datatype::unsigned_longword:
+            statistics.computeT(
+                static_cast<unsigned_longword_t*>(values), dim);
+            break;
+
+        case Datatype::signed_longword:
+            statistics.computeT(static_cast<signed_longword_t*>(values), dim);
+            break;
+
+        case Datatype::single_precision_float:
+            statistics.computeT(
+                static_cast<single_precision_float_t*>(values), dim);
+            break;
+
+        case Datatype::double_precision_float:
+            statistics.computeT(
+                static_cast<double_precision_float_t*>(values), dim);
+            break;
+
+        default:
+            return statistics;
+    }
+
+    statistics.m_valid = true;
+
+    return statistics;
+}
+
+/**
+ * \brief sets up the empty base histogram for the type and the limits
+ *
+ * \return number of base bins
+ */
+template<typename T>
+size_t cr::VolumeStatistics::initBase()
+{
+    size_t numBase = 0;
+
+    m_exact = std::is_integral<T>::value && (sizeof(T) <= 2);
+    if (m_exact)
+    {
+        m_baseMin = static_cast<double>(std::numeric_limits<T>::lowest());
+        numBase = size_t(1) << (8 * std::min(sizeof(T), size_t(2)));
+    }
+    else
+    {
+        m_baseMin = static_cast<double>(m_min);
+        m_baseMax = static_cast<double>(m_max);
+        if (m_baseMax <= m_baseMin)
+            m_baseMax = m_baseMin + 1.0;
+        numBase = STATISTICS_BASE_BINS;
+    }
+    m_baseCounts.assign(numBase, 0);
+
+    return numBase;
+}
+
+/**
+ * \brief only keeps the occupied value range of the exact histogram
+ */
+void cr::VolumeStatistics::trimBase()
+{
+    if (!m_exact)
+        return;
+
+    auto first = std::find_if(m_baseCounts.begin(), m_baseCounts.end(),
+        [](uint64_t c) { return 0 != c; });
+    auto last = std::find_if(m_baseCounts.rbegin(), m_baseCounts.rend(),
+        [](uint64_t c) { return 0 != c; }).base();
+
+    if (first < last)
+    {
+        m_baseMin += static_cast<double>(first - m_baseCounts.begin());
+        m_baseCounts = std::vector<uint64_t>(first, last);
+    }
+    else
+        m_baseCounts.clear();
+    m_baseMax = m_baseMin + static_cast<double>(m_baseCounts.size());
+}
+
+template<typename T>
+void cr::VolumeStatistics::computeT(const T *values, std::array<size_t, 3> dim)
+{
+    size_t count = dim[0] * dim[1] * dim[2];
+
+    //-------------------------------------------------------------------------
+    // base histogram
+    //-------------------------------------------------------------------------
+    size_t numBase = initBase<T>();
+
+    if (m_exact)
+    {
+        // bins of size one over the whole type go through the lookup table
+        // of the histogram engine
+        m_baseCounts = util::binData<T>(
+            numBase,
+            std::numeric_limits<T>::lowest(),
+            std::numeric_limits<T>::max(),
+            values,
+            count).counts;
+        m_baseCounts.resize(numBase, 0);
+    }
+    else
+    {
+        const double baseScale =
+            static_cast<double>(numBase) / (m_baseMax - m_baseMin);
+
+        #pragma omp parallel
+        {
+            std::vector<uint64_t> counts(numBase, 0);
+
+            #pragma omp for nowait
+            for (size_t i = 0; i < count; ++i)
+            {
+                double val = static_cast<double>(values[i]);
+
+                if ((m_baseMin <= val) && (val <= m_baseMax))
+                    counts[std::min(
+                        static_cast<size_t>((val - m_baseMin) * baseScale),
+                        numBase - 1)]++;
+            }
+
+            #pragma omp critical
+            for (size_t i = 0; i < numBase; ++i)
+                m_baseCounts[i] += counts[i];
+        }
+    }
+
+    trimBase();
+
+    //-------------------------------------------------------------------------
+    // brick ranges
+    //-------------------------------------------------------------------------
+    for (size_t i = 0; i < 3; ++i)
+        m_brickCount[i] = (dim[i] + m_brickSize - 1) / m_brickSize;
+
+    size_t numBricks = m_brickCount[0] * m_brickCount[1] * m_brickCount[2];
+    m_brickMin.assign(numBricks, 0.f);
+    m_brickMax.assign(numBricks, 0.f);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t id = 0; id < numBricks; ++id)
+    {
+        std::array<size_t, 3> lo = {{
+            (id % m_brickCount[0]) * m_brickSize,
+            ((id / m_brickCount[0]) % m_brickCount[1]) * m_brickSize,
+            (id / (m_brickCount[0] * m_brickCount[1])) * m_brickSize}};
+        std::array<size_t, 3> hi;
+        T minimum = std::numeric_limits<T>::max();
+        T maximum = std::numeric_limits<T>::lowest();
+
+        for (size_t i = 0; i < 3; ++i)
+            hi[i] = std::min(lo[i] + m_brickSize, dim[i]);
+
+        for (size_t z = lo[2]; z < hi[2]; ++z)
+        for (size_t y = lo[1]; y < hi[1]; ++y)
+        for (size_t x = lo[0]; x < hi[0]; ++x)
+        {
+            T val = values[x + y * dim[0] + z * dim[0] * dim[1]];
+            if (val < minimum) minimum = val;
+            if (val > maximum) maximum = val;
+        }
+
+        m_brickMin[id] = static_cast<float>(minimum);
+        m_brickMax[id] = static_cast<float>(maximum);
+    }
+}
+
+bool cr::VolumeStatistics::computePaged(const PagedVolumeData &volumeData)
+{
+    switch(volumeData.getVolumeConfig().getVoxelType())
+    {
+        case Datatype::unsigned_byte:
+            return computePagedT<unsigned_byte_t>(volumeData);
+
+        case Datatype::signed_byte:
+            return computePagedT<signed_byte_t>(volumeData);
+
+        case Datatype::unsigned_halfword:
+            return computePagedT<unsigned_halfword_t>(volumeData);
+
+        case Datatype::signed_halfword:
+            return computePagedT<signed_halfword_t>(volumeData);
+
+        case Datatype::unsigned_word:
+            return computePagedT<unsigned_word_t>(volumeData);
+
+        case Datatype::signed_word:
+            return computePagedT<signed_word_t>(volumeData);
+
+        case Datatype::unsigned_longword:
+            return computePagedT<unsigned_longword_t>(volumeData);
+
+        case Datatype::signed_longword:
+            return computePagedT<signed_longword_t>(volumeData);
+
+        case Datatype::single_precision_float:
+            return computePagedT<single_precision_float_t>(volumeData);
+
+        case Datatype::double_precision_float:
+            return computePagedT<double_precision_float_t>(volumeData);
+
+        default:
+            return false;
+    }
+}
+
+/**
+ * \brief streams the bricks of paged volume data through the statistics
+ *
+ * Same results as computeT, but every paged brick is faulted in once and
+ * contributes to the base histogram and to the ranges of the statistics
+ * bricks it intersects.
+ */
+template<typename T>
+bool cr::VolumeStatistics::computePagedT(const PagedVolumeData &volumeData)
+{
+    std::array<size_t, 3> dim = volumeData.getVolumeConfig().getVolumeDim();
+    size_t numBase = initBase<T>();
+    const double baseScale = m_exact ?
+        1.0 : static_cast<double>(numBase) / (m_baseMax - m_baseMin);
+    bool valid = true;
+
+    for (size_t i = 0; i < 3; ++i)
+        m_brickCount[i] = (dim[i] + m_brickSize - 1) / m_brickSize;
+
+    size_t numBricks = m_brickCount[0] * m_brickCount[1] * m_brickCount[2];
+    m_brickMin.assign(numBricks, std::numeric_limits<float>::max());
+    m_brickMax.assign(numBricks, std::numeric_limits<float>::lowest());
+
+    #pragma omp parallel
+    {
+        std::vector<uint64_t> counts(numBase, 0);
+
+        #pragma omp for schedule(dynamic) nowait
+        for (size_t id = 0; id < volumeData.getNumBricks(); ++id)
+        {
+            std::shared_ptr<const PagedBrick> brick = volumeData.getBrick(id);
+
+            if (!brick)
+            {
+                #pragma omp atomic write
+                valid = false;
+                continue;
+            }
+
+            const T *values = brick->getValues<T>();
+            size_t count = brick->getVoxelCount();
+            std::array<size_t, 3> lo, hi;
+
+            //-----------------------------------------------------------------
+            // base histogram
+            //-----------------------------------------------------------------
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (m_exact)
+                {
+                    counts[static_cast<size_t>(static_cast<int64_t>(values[i]) -
+                        static_cast<int64_t>(
+                            std::numeric_limits<T>::lowest()))]++;
+                    continue;
+                }
+
+                double val = static_cast<double>(values[i]);
+
+                if ((m_baseMin <= val) && (val <= m_baseMax))
+                    counts[std::min(
+                        static_cast<size_t>((val - m_baseMin) * baseScale),
+                        numBase - 1)]++;
+            }
+
+            //-----------------------------------------------------------------
+            // ranges of the intersected statistics bricks
+            //-----------------------------------------------------------------
+            for (size_t i = 0; i < 3; ++i)
+            {
+                lo[i] = brick->origin[i] / m_brickSize;
+                hi[i] = (brick->origin[i] + brick->extent[i] - 1) /
+                    m_brickSize;
+            }
+
+            for (size_t bz = lo[2]; bz <= hi[2]; ++bz)
+            for (size_t by = lo[1]; by <= hi[1]; ++by)
+            for (size_t bx = lo[0]; bx <= hi[0]; ++bx)
+            {
+                std::array<size_t, 3> b = {{bx, by, bz}};
+                std::array<size_t, 3> first, last;
+                T minimum = std::numeric_limits<T>::max();
+                T maximum = std::numeric_limits<T>::lowest();
+                size_t statId = bx + by * m_brickCount[0] +
+                    bz * m_brickCount[0] * m_brickCount[1];
+
+                // intersection in coordinates of the paged brick
+                for (size_t i = 0; i < 3; ++i)
+                {
+                    first[i] = std::max(b[i] * m_brickSize,
+                        brick->origin[i]) - brick->origin[i];
+                    last[i] = std::min((b[i] + 1) * m_brickSize,
+                        brick->origin[i] + brick->extent[i]) -
+                        brick->origin[i];
+                }
+
+                for (size_t z = first[2]; z < last[2]; ++z)
+                for (size_t y = first[1]; y < last[1]; ++y)
+                for (size_t x = first[0]; x < last[0]; ++x)
+                {
+                    T val = values[x + (y + z * brick->extent[1]) *
+                        brick->extent[0]];
+                    if (val < minimum) minimum = val;
+                    if (val > maximum) maximum = val;
+                }
+
+                #pragma omp critical(pagedStatisticsRanges)
+                {
+                    m_brickMin[statId] = std::min(m_brickMin[statId],
+                        static_cast<float>(minimum));
+                    m_brickMax[statId] = std::max(m_brickMax[statId],
+                        static_cast<float>(maximum));
+                }
+            }
+        }
+
+        #pragma omp critical(pagedStatisticsBase)
+        for (size_t i = 0; i < numBase; ++i)
+            m_baseCounts[i] += counts[i];
+    }
+
+    if (!valid)
+        return false;
+
+    trimBase();
+
+    return true;
+}
+
+util::Histogram cr::VolumeStatistics::rebin(
+    size_t numBins, float min, float max) const
+{
+    if (!m_valid)
+        return util::Histogram();
+
+    switch(m_voxelType)
+    {
+        case Datatype::unsigned_byte:
+            return rebinT<unsigned_byte_t>(numBins, min, max);
+
+        case Datatype::signed_byte:
+            return rebinT<signed_byte_t>(numBins, min, max);
+
+        case Datatype::unsigned_halfword:
+            return rebinT<unsigned_halfword_t>(numBins, min, max);
+
+        case Datatype::signed_halfword:
+            return rebinT<signed_halfword_t>(numBins, min, max);
+
+        case Datatype::unsigned_word:
+            return rebinT<unsigned_word_t>(numBins, min, max);
+
+        case Datatype::signed_word:
+            return rebinT<signed_word_t>(numBins, min, max);
+
+        case Datatype::unsigned_longword:
+            return rebinT<unsigned_longword_t>(numBins, min, max);
+
+        case Datatype::signed_longword:
+            return rebinT<signed_longword_t>(numBins, min, max);
+
+        case Datatype::single_precision_float:
+            return rebinT<single_precision_float_t>(numBins, min, max);
+
+        case Datatype::double_precision_float:
+            return rebinT<double_precision_float_t>(numBins, min, max);
+
+        default:
+            break;
+    }
+
+    return util::Histogram();
+}
+
+template<typename T>
+util::Histogram cr::VolumeStatistics::rebinT(
+    size_t numBins, float min, float max) const
+{
+    // same interval handling and bin layout as util::binData
+    T tMin = static_cast<T>(min);
+    T tMax = static_cast<T>(max);
+
+    if ((0 == numBins) || (tMin > tMax))
+        return util::Histogram();
+
+    util::Histogram bins;
+    double binSize =
+        (static_cast<double>(tMax - tMin) + 1.0) /
+        static_cast<double>(numBins);
+    double baseWidth = m_exact ? 1.0 :
+        (m_baseMax - m_baseMin) / static_cast<double>(m_baseCounts.size());
+
+    bins.lower.resize(numBins);
+    bins.upper.resize(numBins);
+    bins.counts.assign(numBins, 0);
+    for (size_t i = 0; i < numBins; ++i)
+    {
+        bins.lower[i] =
+            static_cast<double>(i) * binSize - 0.5 * binSize +
+            static_cast<double>(tMin);
+        bins.upper[i] =
+            static_cast<double>(i + 1) * binSize - 0.5 * binSize +
+            static_cast<double>(tMin);
+    }
+
+    for (size_t i = 0; i < m_baseCounts.size(); ++i)
+    {
+        if (0 == m_baseCounts[i])
+            continue;
+
+        // approximate histograms place the count at the center of the bin
+        T val = static_cast<T>(m_exact ?
+            m_baseMin + static_cast<double>(i) :
+            m_baseMin + (static_cast<double>(i) + 0.5) * baseWidth);
+
+        if ((tMin <= val) && (val <= tMax))
+        {
+            size_t idx = std::min(
+                static_cast<size_t>(
+                    std::round(static_cast<double>(val - tMin) / binSize)),
+                numBins - 1);
+            bins.counts[idx] += m_baseCounts[i];
+        }
+    }
+
+    return bins;
+}
+
+float cr::VolumeStatistics::getPercentile(float percent) const
+{
+    uint64_t total = 0;
+    double target = 0.0;
+    double cumulative = 0.0;
+
+    for (uint64_t c : m_baseCounts)
+        total += c;
+
+    if (!m_valid || (0 == total))
+        return (percent < 50.f) ? m_min : m_max;
+
+    target = static_cast<double>(std::min(std::max(percent, 0.f), 100.f)) /
+        100.0 * static_cast<double>(total);
+    const double baseWidth = m_exact ? 1.0 :
+        (m_baseMax - m_baseMin) / static_cast<double>(m_baseCounts.size());
+
+    for (size_t i = 0; i < m_baseCounts.size(); ++i)
+    {
+        double count = static_cast<double>(m_baseCounts[i]);
+
+        if ((cumulative + count >= target) && (0 < m_baseCounts[i]))
+        {
+            if (m_exact)
+                return static_cast<float>(m_baseMin + static_cast<double>(i));
+
+            return static_cast<float>(m_baseMin + baseWidth * (
+                static_cast<double>(i) + (target - cumulative) / count));
+        }
+        cumulative += count;
+    }
+
+    return m_max;
+}
+
+cr::VolumeStatistics cr::VolumeStatistics::fromJson(const json &j)
+{
+    VolumeStatistics statistics;
+
+    statistics.m_voxelType = j["datatype"].get<Datatype>();
+    statistics.m_min = j["min"].get<float>();
+    statistics.m_max = j["max"].get<float>();
+    statistics.m_exact = j["exact"].get<bool>();
+    statistics.m_baseMin = j["baseMin"].get<double>();
+    statistics.m_baseMax = j["baseMax"].get<double>();
+    statistics.m_baseCounts = j["baseCounts"].get<std::vector<uint64_t>>();
+    statistics.m_brickSize = j["brickSize"].get<size_t>();
+    statistics.m_brickCount = j["brickCount"].get<std::array<size_t, 3>>();
+    statistics.m_brickMin = j["brickMin"].get<std::vector<float>>();
+    statistics.m_brickMax = j["brickMax"].get<std::vector<float>>();
+
+    statistics.m_valid =
+        (0 < statistics.m_brickSize) &&
+        (statistics.m_brickMin.size() ==
+            statistics.m_brickCount[0] *
+            statistics.m_brickCount[1] *
+            statistics.m_brickCount[2]) &&
+        (statistics.m_brickMax.size() == statistics.m_brickMin.size());
+
+    return statistics;
+}
+
+json cr::VolumeStatistics::toJson() const
+{
+    json j;
+
+    j["datatype"] = m_voxelType;
+    j["min"] = m_min;
+    j["max"] = m_max;
+    j["exact"] = m_exact;
+    j["baseMin"] = m_baseMin;
+    j["baseMax"] = m_baseMax;
+    j["baseCounts"] = m_baseCounts;
+    j["brickSize"] = m_brickSize;
+    j["brickCount"] = m_brickCount;
+    j["brickMin"] = m_brickMin;
+    j["brickMax"] = m_brickMax;
+
+    return j;
+}
+
+//-----------------------------------------------------------------------------
+// convenience functions
+//-----------------------------------------------------------------------------
+/**
+ * \brief location of the statistics cache file for a raw file
+ *
+ * The cache is stored as sidecar <raw file>.stats.json if the directory of
+ * the raw file is writable, otherwise in $XDG_CACHE_HOME/mvr (default
+ * ~/.cache/mvr) under a name derived from the path of the raw file.
+ */
+std::string cr::getStatisticsCachePath(const std::string &rawFile)
+{
+    bfs::path rawPath = bfs::absolute(bfs::path(rawFile));
+    bfs::path cacheDir;
+    std::ostringstream name;
+
+    if (0 == access(rawPath.parent_path().string().c_str(), W_OK))
+        return rawPath.string() + ".stats.json";
+
+    if (nullptr != std::getenv("XDG_CACHE_HOME"))
+        cacheDir = bfs::path(std::getenv("XDG_CACHE_HOME")) / "mvr";
+    else if (nullptr != std::getenv("HOME"))
+        cacheDir = bfs::path(std::getenv("HOME")) / ".cache" / "mvr";
+    else
+        return std::string("");
+
+    name << rawPath.filename().string() << "." << std::hex <<
+        std::hash<std::string>()(rawPath.string()) << ".stats.json";
+
+    return (cacheDir / name.str()).string();
+}
+
+/**
+ * \brief statistics of a loaded timestep from the cache or computed
+ *
+ * \param volumeConfig configuration object of the volume dataset
+ * \param n number of the loaded timestep
+ * \param swap flag if the byte order of the data was swapped while loading
+ *             (in addition to the swap required by VOLUME_ENDIANNESS)
+ * \param volumeData the loaded data
+ *
+ * \return statistics of the data
+ *
+ * A cache file is valid as long as path, size and modification time of the
+ * raw file match. It holds one entry per datatype, subset and byte order.
+ * Newly computed statistics are added to the cache file. Size and
+ * modification time are taken from the timestep index, which queries each
+ * file only once.
+ */
+cr::VolumeStatistics cr::getVolumeStatistics(
+    const VolumeConfig &volumeConfig,
+    unsigned int n,
+    bool swap,
+    const VolumeDataBase &volumeData)
+{
+    VolumeStatistics statistics;
+    std::string rawFile = volumeConfig.getTimestepFile(n);
+    std::shared_ptr<const TimestepIndex> timesteps =
+        volumeConfig.getTimestepIndex();
+    std::string cachePath;
+    std::string key = makeEntryKey(
+        volumeConfig, n, swap != volumeConfig.needsByteSwap());
+    std::string absolutePath;
+    uintmax_t fileSize = 0;
+    std::time_t modificationTime = 0;
+    json cache;
+
+    try
+    {
+        cachePath = getStatisticsCachePath(rawFile);
+        absolutePath = bfs::absolute(bfs::path(rawFile)).string();
+        if (nullptr == timesteps)
+            throw std::runtime_error("no timestep files");
+        fileSize = timesteps->getFileSize(n);
+        modificationTime = timesteps->getModificationTime(n);
+
+        std::ifstream fs(cachePath);
+        if (fs.is_open())
+        {
+            fs >> cache;
+
+            if ((STATISTICS_VERSION == cache["version"].get<unsigned int>()) &&
+                (absolutePath == cache["path"].get<std::string>()) &&
+                (fileSize == cache["size"].get<uintmax_t>()) &&
+                (modificationTime == cache["mtime"].get<std::time_t>()))
+            {
+                if (!cache["entries"][key].is_null())
+                {
+                    statistics = VolumeStatistics::fromJson(
+                        cache["entries"][key]);
+                    if (statistics.isValid())
+                        return statistics;
+                }
+            }
+            else
+                cache = json();
+        }
+    }
+    catch(std::exception &e)
+    {
+        // unreadable or outdated cache files are replaced
+        cache = json();
+    }
+
+    statistics = VolumeStatistics::compute(volumeData);
+    if (!statistics.isValid() || cachePath.empty())
+        return statistics;
+
+    try
+    {
+        // prefetch workers and the main thread may write the same cache
+        // file at once, each writer renames its own temporary file
+        bfs::path tmpPath(cachePath + "." + std::to_string(getpid()) + "." +
+            std::to_string(std::hash<std::thread::id>()(
+                std::this_thread::get_id())) + ".tmp");
+
+        cache["version"] = STATISTICS_VERSION;
+        cache["path"] = absolutePath;
+        cache["size"] = fileSize;
+        cache["mtime"] = modificationTime;
+        cache["entries"][key] = statistics.toJson();
+
+        bfs::create_directories(tmpPath.parent_path());
+        {
+            std::ofstream ofs(tmpPath.string());
+            ofs << cache;
+        }
+        // replace the old file at once, other readers never see a partial
+        // cache file
+        bfs::rename(tmpPath, bfs::path(cachePath));
+    }
+    catch(std::exception &e)
+    {
+        std::cerr << "Warning: could not write statistics cache " <<
+            cachePath << ": " << e.what() << std::endl;
+    }
+
+    return statistics;
+}
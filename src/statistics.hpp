@@ -0,0 +1,118 @@
+#pragma once
+
+#include <string>
+#include <array>
+#include <vector>
+#include <tuple>
+#include <cstdint>
+
+#include <json.hpp>
+using json = nlohmann::json;
+
+#include "util/util.hpp"
+#include "configraw.hpp"
+
+namespace cr
+{
+    // ------------------------------------------------------------------------
+    // constants
+    // ------------------------------------------------------------------------
+    constexpr unsigned int STATISTICS_VERSION = 1;
+    constexpr size_t STATISTICS_BASE_BINS = 4096;
+    constexpr size_t STATISTICS_BRICK_SIZE = 32;
+
+    // ------------------------------------------------------------------------
+    // forward declarations
+    // ------------------------------------------------------------------------
+    class PagedVolumeData;
+
+    // ------------------------------------------------------------------------
+    // class declarations
+    // ------------------------------------------------------------------------
+    /**
+     * \brief value statistics of a single timestep
+     *
+     * Contains the value limits, a base histogram and the value ranges of
+     * bricks of STATISTICS_BRICK_SIZE^3 voxels. For 8 and 16 bit integer
+     * data the base histogram has one bin per value, so that rebinning gives
+     * exactly the result of util::binData. For all other types the base
+     * histogram has STATISTICS_BASE_BINS bins over the value limits and the
+     * rebinned histogram is an approximation.
+     */
+    class VolumeStatistics
+    {
+        public:
+        VolumeStatistics();
+
+        static VolumeStatistics compute(const VolumeDataBase &volumeData);
+        static VolumeStatistics fromJson(const json &j);
+        json toJson() const;
+
+        bool isValid() const { return m_valid; }
+        std::tuple<float, float> getLimits() const
+        {
+            return std::tuple<float, float>(m_min, m_max);
+        }
+
+        /**
+         * \brief histogram with the given bins from the base histogram
+         *
+         * Same bin layout as util::binData.
+         */
+        util::Histogram rebin(
+            size_t numBins, float min, float max) const;
+
+        /**
+         * \brief value below which the given percentage of the voxels lie
+         *
+         * Exact for 8 and 16 bit integer data, interpolated inside the base
+         * bins for all other types.
+         */
+        float getPercentile(float percent) const;
+
+        size_t getBrickSize() const { return m_brickSize; }
+        std::array<size_t, 3> getBrickCount() const { return m_brickCount; }
+        const std::vector<float>& getBrickMin() const { return m_brickMin; }
+        const std::vector<float>& getBrickMax() const { return m_brickMax; }
+
+        private:
+        bool m_valid;
+        Datatype m_voxelType;
+        float m_min;
+        float m_max;
+
+        // base histogram
+        bool m_exact;                   //!< one bin per integer value
+        double m_baseMin;               //!< value of the first bin
+        double m_baseMax;               //!< upper limit of the last bin
+        std::vector<uint64_t> m_baseCounts;
+
+        // brick value ranges
+        size_t m_brickSize;
+        std::array<size_t, 3> m_brickCount;
+        std::vector<float> m_brickMin;
+        std::vector<float> m_brickMax;
+
+        template<typename T>
+        size_t initBase();
+        void trimBase();
+        template<typename T>
+        void computeT(const T *values, std::array<size_t, 3> dim);
+        bool computePaged(const PagedVolumeData &volumeData);
+        template<typename T>
+        bool computePagedT(const PagedVolumeData &volumeData);
+        template<typename T>
+        util::Histogram rebinT(
+            size_t numBins, float min, float max) const;
+    };
+
+    // ------------------------------------------------------------------------
+    // function declarations
+    // ------------------------------------------------------------------------
+    VolumeStatistics getVolumeStatistics(
+        const VolumeConfig &volumeConfig,
+        unsigned int n,
+        bool swap,
+        const VolumeDataBase &volumeData);
+    std::string getStatisticsCachePath(const std::string &rawFile);
+}
@@ -0,0 +1,321 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include <stdexcept>
+#include <ctime>
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+namespace bfs = boost::filesystem;
+
+#include <boost/regex.hpp>
+
+#include <json.hpp>
+using json = nlohmann::json;
+
+#include "timestepindex.hpp"
+
+//-----------------------------------------------------------------------------
+// internal helpers
+//-----------------------------------------------------------------------------
+namespace
+{
+    /**
+     * \brief an index of the shared registry
+     */
+    struct RegistryEntry
+    {
+        std::time_t dirTime;    //!< modification time of the directory
+        std::shared_ptr<const cr::TimestepIndex> index;
+    };
+
+    /**
+     * \brief true for the files mvr writes next to the timesteps
+     *
+     * Statistics sidecars (with their temporary files) and the levels of
+     * detail are written into the directory of the series. They are never
+     * timesteps, even if the regex of the series would match them.
+     */
+    bool isSidecar(const std::string &name)
+    {
+        const std::string stats = ".stats.json";
+        const std::string pyramid = ".pyramid";
+
+        return (std::string::npos != name.find(stats + ".")) ||
+            ((name.size() > stats.size()) &&
+                (0 == name.compare(
+                    name.size() - stats.size(), stats.size(), stats))) ||
+            ((name.size() > pyramid.size()) &&
+                (0 == name.compare(
+                    name.size() - pyramid.size(), pyramid.size(), pyramid)));
+    }
+
+    /**
+     * \brief names of the files in dir matching exp from the cache file
+     *
+     * \return true if the cache file belongs to dir and exp and is not
+     *         older than the directory
+     */
+    bool readCache(
+        const std::string &cachePath,
+        const std::string &absoluteDir,
+        const std::string &exp,
+        std::time_t dirTime,
+        std::vector<std::string> &names)
+    {
+        try
+        {
+            json cache;
+            std::ifstream fs(cachePath);
+
+            if (!fs.is_open())
+                return false;
+            fs >> cache;
+
+            if ((cr::TIMESTEP_INDEX_VERSION !=
+                    cache["version"].get<unsigned int>()) ||
+                (absoluteDir != cache["dir"].get<std::string>()) ||
+                (exp != cache["regex"].get<std::string>()) ||
+                (dirTime != cache["mtime"].get<std::time_t>()))
+                return false;
+
+            names = cache["files"].get<std::vector<std::string>>();
+        }
+        catch(std::exception &e)
+        {
+            // unreadable cache files are replaced
+            return false;
+        }
+
+        return true;
+    }
+
+    void writeCache(
+        const std::string &cachePath,
+        const std::string &absoluteDir,
+        const std::string &exp,
+        std::time_t dirTime,
+        const std::vector<std::string> &names)
+    {
+        try
+        {
+            json cache;
+            // several processes and threads may index the same directory,
+            // each writer renames its own temporary file
+            bfs::path tmpPath(cachePath + "." + std::to_string(getpid()) +
+                "." + std::to_string(std::hash<std::thread::id>()(
+                    std::this_thread::get_id())) + ".tmp");
+
+            cache["version"] = cr::TIMESTEP_INDEX_VERSION;
+            cache["dir"] = absoluteDir;
+            cache["regex"] = exp;
+            cache["mtime"] = dirTime;
+            cache["files"] = names;
+
+            bfs::create_directories(tmpPath.parent_path());
+            {
+                std::ofstream ofs(tmpPath.string());
+                ofs << cache;
+            }
+            bfs::rename(tmpPath, bfs::path(cachePath));
+        }
+        catch(std::exception &e)
+        {
+            std::cerr << "Warning: could not write timestep index cache " <<
+                cachePath << ": " << e.what() << std::endl;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Definition of TimestepIndex member functions
+//-----------------------------------------------------------------------------
+cr::TimestepIndex::TimestepIndex(
+        std::vector<std::string> files,
+        std::vector<std::string> datasets) :
+    m_files(std::move(files)),
+    m_datasets(std::move(datasets)),
+    m_status(m_files.size(), FileStatus{false, 0, 0})
+{
+}
+
+/**
+ * The modification time of a directory changes whenever an entry is added,
+ * removed or renamed, so it identifies the list of files. Directories that
+ * were modified within the last seconds are scanned but neither registered
+ * nor cached, since further changes within the same second would not be
+ * visible in the modification time.
+ *
+ * Writing statistics sidecars or levels of detail also changes the
+ * modification time. Their names are skipped while scanning, and a scan that
+ * finds the same timesteps keeps the registered index, so that only the
+ * modification time of the cache is updated.
+ */
+std::shared_ptr<const cr::TimestepIndex> cr::TimestepIndex::find(
+    const std::string &dir,
+    const std::string &exp)
+{
+    static std::mutex registryMutex;
+    static std::map<std::string, RegistryEntry> registry;
+
+    std::string absoluteDir = bfs::absolute(bfs::path(dir)).string();
+    std::string key = absoluteDir + "\n" + exp;
+    std::time_t dirTime = bfs::last_write_time(bfs::path(dir));
+    bool settled = (std::difftime(std::time(nullptr), dirTime) > 1.0);
+    std::string cachePath = getTimestepIndexCachePath(dir, exp);
+    std::vector<std::string> names;
+    std::vector<std::string> files;
+    std::shared_ptr<const TimestepIndex> index = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto it = registry.find(key);
+
+        if (registry.end() != it)
+        {
+            if (dirTime == it->second.dirTime)
+                return it->second.index;
+            index = it->second.index;
+        }
+    }
+
+    if (!settled || cachePath.empty() ||
+        !readCache(cachePath, absoluteDir, exp, dirTime, names))
+    {
+        const boost::regex re(exp);
+
+        for (bfs::directory_entry& x : bfs::directory_iterator(dir))
+        {
+            std::string name = x.path().filename().string();
+            if (!isSidecar(name) && boost::regex_match(name, re))
+                names.push_back(name);
+        }
+        std::sort(names.begin(), names.end());
+
+        if (settled && !cachePath.empty())
+            writeCache(cachePath, absoluteDir, exp, dirTime, names);
+    }
+
+    // the registered index stays valid if only sidecars have changed
+    if (index && (index->size() == names.size()))
+    {
+        for (size_t i = 0; (i < names.size()) && index; ++i)
+            if (bfs::path(index->getFile(i)).filename().string() != names[i])
+                index = nullptr;
+    }
+    else
+        index = nullptr;
+
+    if (!index)
+    {
+        files.reserve(names.size());
+        for (const std::string &name : names)
+            files.push_back((bfs::path(dir) / name).string());
+
+        index = std::make_shared<const TimestepIndex>(std::move(files));
+    }
+
+    if (settled)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry[key] = RegistryEntry{dirTime, index};
+    }
+
+    return index;
+}
+
+const std::string& cr::TimestepIndex::getFile(size_t n) const
+{
+    static const std::string none;
+
+    if (m_files.empty()) return none;
+    return m_files[std::min(n, m_files.size() - 1)];
+}
+
+const std::string& cr::TimestepIndex::getDataset(size_t n) const
+{
+    static const std::string none;
+
+    if (m_datasets.empty()) return none;
+    return m_datasets[std::min(n, m_datasets.size() - 1)];
+}
+
+uintmax_t cr::TimestepIndex::getFileSize(size_t n) const
+{
+    return getStatus(n).size;
+}
+
+std::time_t cr::TimestepIndex::getModificationTime(size_t n) const
+{
+    return getStatus(n).mtime;
+}
+
+/**
+ * \brief size and modification time of a file, throws a
+ *        bfs::filesystem_error if the file can not be queried
+ */
+cr::TimestepIndex::FileStatus cr::TimestepIndex::getStatus(size_t n) const
+{
+    FileStatus status;
+
+    if (m_files.empty())
+        throw std::out_of_range("timestep index is empty");
+    n = std::min(n, m_files.size() - 1);
+    {
+        std::lock_guard<std::mutex> lock(m_statusMutex);
+        if (m_status[n].known)
+            return m_status[n];
+    }
+
+    // the (possibly remote) file system is queried without holding the lock
+    status.size = bfs::file_size(m_files[n]);
+    status.mtime = bfs::last_write_time(m_files[n]);
+    status.known = true;
+
+    std::lock_guard<std::mutex> lock(m_statusMutex);
+    m_status[n] = status;
+
+    return status;
+}
+
+//-----------------------------------------------------------------------------
+// convenience functions
+//-----------------------------------------------------------------------------
+/**
+ * \brief location of the timestep index cache file of a directory
+ *
+ * The cache is stored in $XDG_CACHE_HOME/mvr (default ~/.cache/mvr) and not
+ * next to the volume files, since adding it to the directory would change
+ * the modification time the cache is validated with.
+ */
+std::string cr::getTimestepIndexCachePath(
+    const std::string &dir,
+    const std::string &exp)
+{
+    bfs::path dirPath = bfs::absolute(bfs::path(dir));
+    bfs::path cacheDir;
+    std::ostringstream name;
+
+    if (nullptr != std::getenv("XDG_CACHE_HOME"))
+        cacheDir = bfs::path(std::getenv("XDG_CACHE_HOME")) / "mvr";
+    else if (nullptr != std::getenv("HOME"))
+        cacheDir = bfs::path(std::getenv("HOME")) / ".cache" / "mvr";
+    else
+        return std::string("");
+
+    name << dirPath.filename().string() << "." << std::hex <<
+        std::hash<std::string>()(dirPath.string() + "\n" + exp) <<
+        ".timesteps.json";
+
+    return (cacheDir / name.str()).string();
+}
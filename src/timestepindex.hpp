@@ -0,0 +1,100 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <ctime>
+#include <cstdint>
+
+namespace cr
+{
+    // ------------------------------------------------------------------------
+    // constants
+    // ------------------------------------------------------------------------
+    constexpr unsigned int TIMESTEP_INDEX_VERSION = 1;
+
+    // ------------------------------------------------------------------------
+    // class declarations
+    // ------------------------------------------------------------------------
+    /**
+     * \brief immutable list of the files (and HDF5 datasets) of a time series
+     *
+     * Indices of a directory are created through find() and shared by all
+     * VolumeConfig objects that refer to the same directory and regex, so
+     * copying a configuration never copies the file list. Size and
+     * modification time of a file are only queried when they are requested
+     * for the first time.
+     */
+    class TimestepIndex
+    {
+        public:
+        /**
+         * \brief index with the given files
+         *
+         * \param files path of the file of each timestep
+         * \param datasets HDF5 dataset of each timestep, a single dataset is
+         *                 used for all timesteps
+         */
+        TimestepIndex(
+            std::vector<std::string> files,
+            std::vector<std::string> datasets = std::vector<std::string>());
+
+        TimestepIndex(const TimestepIndex &other) = delete;
+        TimestepIndex& operator=(const TimestepIndex &other) = delete;
+
+        /**
+         * \brief sorted index of the files in dir matching the regex exp
+         *
+         * The index is taken from the in-process registry or the cache file
+         * of the directory as long as the modification time of the directory
+         * is unchanged, otherwise the directory is scanned and the cache
+         * file is rewritten. Sidecar files of mvr are never listed, and a
+         * scan that finds the same files returns the registered index.
+         */
+        static std::shared_ptr<const TimestepIndex> find(
+            const std::string &dir,
+            const std::string &exp);
+
+        size_t size() const { return m_files.size(); }
+        bool empty() const { return m_files.empty(); }
+
+        /**
+         * \brief file and dataset of the n-th timestep, n is clamped to the
+         *        last timestep
+         */
+        const std::string& getFile(size_t n) const;
+        const std::string& getDataset(size_t n) const;
+
+        /**
+         * \brief size and modification time of the file of the n-th
+         *        timestep, queried once per index
+         */
+        uintmax_t getFileSize(size_t n) const;
+        std::time_t getModificationTime(size_t n) const;
+
+        const std::vector<std::string>& getFiles() const { return m_files; }
+
+        private:
+        struct FileStatus
+        {
+            bool known;
+            uintmax_t size;
+            std::time_t mtime;
+        };
+
+        FileStatus getStatus(size_t n) const;
+
+        std::vector<std::string> m_files;
+        std::vector<std::string> m_datasets;
+        mutable std::vector<FileStatus> m_status;
+        mutable std::mutex m_statusMutex;
+    };
+
+    // ------------------------------------------------------------------------
+    // function declarations
+    // ------------------------------------------------------------------------
+    std::string getTimestepIndexCachePath(
+        const std::string &dir,
+        const std::string &exp);
+}
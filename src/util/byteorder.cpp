@@ -0,0 +1,167 @@
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MVR_X86_SHUFFLE
+#endif
+
+#include "byteorder.hpp"
+
+//-----------------------------------------------------------------------------
+// internal helpers
+//-----------------------------------------------------------------------------
+namespace
+{
+    using SwapFunction = void (*)(uint8_t*, size_t, size_t);
+
+    template<typename T, typename F>
+    void swapValues(uint8_t *bytes, size_t count, F bswap)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            T v;
+            std::memcpy(&v, bytes + i * sizeof(T), sizeof(T));
+            v = bswap(v);
+            std::memcpy(bytes + i * sizeof(T), &v, sizeof(T));
+        }
+    }
+
+    void swapScalarBytes(uint8_t *bytes, size_t count, size_t valueSize)
+    {
+        switch(valueSize)
+        {
+            case 2:
+                swapValues<uint16_t>(bytes, count,
+                    [](uint16_t v) { return __builtin_bswap16(v); });
+                break;
+
+            case 4:
+                swapValues<uint32_t>(bytes, count,
+                    [](uint32_t v) { return __builtin_bswap32(v); });
+                break;
+
+            case 8:
+                swapValues<uint64_t>(bytes, count,
+                    [](uint64_t v) { return __builtin_bswap64(v); });
+                break;
+
+            default:
+                break;
+        }
+    }
+
+#ifdef MVR_X86_SHUFFLE
+    /**
+     * \brief shuffle control that reverses each group of valueSize bytes
+     *        within 16 bytes
+     */
+    void makeShuffleMask(uint8_t mask[16], size_t valueSize)
+    {
+        for (size_t j = 0; j < 16; ++j)
+            mask[j] = static_cast<uint8_t>(
+                (j / valueSize) * valueSize + (valueSize - 1 - j % valueSize));
+    }
+
+    __attribute__((target("ssse3")))
+    void swapSsse3(uint8_t *bytes, size_t count, size_t valueSize)
+    {
+        const size_t length = count * valueSize;
+        uint8_t control[16];
+        size_t i = 0;
+
+        makeShuffleMask(control, valueSize);
+        const __m128i mask =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(control));
+
+        for (; i + 16 <= length; i += 16)
+        {
+            __m128i *p = reinterpret_cast<__m128i*>(bytes + i);
+            _mm_storeu_si128(p, _mm_shuffle_epi8(_mm_loadu_si128(p), mask));
+        }
+
+        swapScalarBytes(bytes + i, (length - i) / valueSize, valueSize);
+    }
+
+    __attribute__((target("avx2")))
+    void swapAvx2(uint8_t *bytes, size_t count, size_t valueSize)
+    {
+        const size_t length = count * valueSize;
+        uint8_t control[16];
+        size_t i = 0;
+
+        // the shuffle works on each 128 bit lane separately, which is fine
+        // as the values never cross a lane boundary
+        makeShuffleMask(control, valueSize);
+        const __m256i mask = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(control)));
+
+        for (; i + 64 <= length; i += 64)
+        {
+            __m256i *p = reinterpret_cast<__m256i*>(bytes + i);
+            __m256i a = _mm256_loadu_si256(p);
+            __m256i b = _mm256_loadu_si256(p + 1);
+            _mm256_storeu_si256(p, _mm256_shuffle_epi8(a, mask));
+            _mm256_storeu_si256(p + 1, _mm256_shuffle_epi8(b, mask));
+        }
+        for (; i + 32 <= length; i += 32)
+        {
+            __m256i *p = reinterpret_cast<__m256i*>(bytes + i);
+            _mm256_storeu_si256(
+                p, _mm256_shuffle_epi8(_mm256_loadu_si256(p), mask));
+        }
+
+        swapScalarBytes(bytes + i, (length - i) / valueSize, valueSize);
+    }
+#endif
+
+    struct Implementation
+    {
+        SwapFunction function;
+        const char *name;
+    };
+
+    /**
+     * \brief selects the widest shuffle the processor supports (once)
+     */
+    const Implementation& getSelected()
+    {
+        static const Implementation selected = []() {
+#ifdef MVR_X86_SHUFFLE
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return Implementation{swapAvx2, "avx2"};
+            if (__builtin_cpu_supports("ssse3"))
+                return Implementation{swapSsse3, "ssse3"};
+#endif
+            return Implementation{swapScalarBytes, "scalar"};
+        }();
+
+        return selected;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// byte order functions
+//-----------------------------------------------------------------------------
+void util::byteorder::swap(void *values, size_t count, size_t valueSize)
+{
+    if ((nullptr == values) || (valueSize < 2))
+        return;
+
+    getSelected().function(
+        reinterpret_cast<uint8_t*>(values), count, valueSize);
+}
+
+void util::byteorder::swapScalar(void *values, size_t count, size_t valueSize)
+{
+    if ((nullptr == values) || (valueSize < 2))
+        return;
+
+    swapScalarBytes(reinterpret_cast<uint8_t*>(values), count, valueSize);
+}
+
+const char* util::byteorder::getImplementation()
+{
+    return getSelected().name;
+}
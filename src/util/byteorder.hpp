@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+
+namespace util
+{
+    namespace byteorder
+    {
+        //---------------------------------------------------------------------
+        // Convenience functions
+        //---------------------------------------------------------------------
+        /**
+         * \brief true if the host stores multi byte values little endian
+         */
+        constexpr bool isLittleEndianHost()
+        {
+            return __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+        }
+
+        /**
+         * \brief reverses the byte order of count values in place
+         *
+         * \param values pointer to the first value
+         * \param count number of values
+         * \param valueSize size of a single value in byte (1, 2, 4 or 8)
+         *
+         * Uses byte shuffles of the widest vector unit the processor
+         * supports (AVX2 or SSSE3, selected at runtime) and falls back to
+         * swapping single values.
+         */
+        void swap(void *values, size_t count, size_t valueSize);
+
+        /**
+         * \brief reverses the byte order of count values one at a time
+         *
+         * Same result as swap, used for the remainder of the vectorised
+         * loops and as reference.
+         */
+        void swapScalar(void *values, size_t count, size_t valueSize);
+
+        /**
+         * \brief name of the implementation that is used by swap
+         */
+        const char* getImplementation();
+    }
+}
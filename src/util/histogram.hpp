@@ -0,0 +1,236 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+namespace util
+{
+    //-------------------------------------------------------------------------
+    // Constants
+    //-------------------------------------------------------------------------
+    constexpr size_t HISTOGRAM_BLOCK_SIZE = 512;    //!< values per index block
+    constexpr size_t HISTOGRAM_LANES_MAX_BINS = 1024; //!< interleaving limit
+
+    //-------------------------------------------------------------------------
+    // Type definitions
+    //-------------------------------------------------------------------------
+    /**
+     * \brief histogram with the limits and counts of its bins in separate
+     *        arrays
+     *
+     * The interval of bin i is [lower[i], upper[i]) except for the last bin
+     * which includes its upper limit.
+     */
+    struct Histogram
+    {
+        std::vector<double> lower;      //!< lower limit of each bin
+        std::vector<double> upper;      //!< upper limit of each bin
+        std::vector<uint64_t> counts;   //!< number of values inside each bin
+
+        size_t size() const { return counts.size(); }
+        bool empty() const { return counts.empty(); }
+    };
+
+    namespace detail
+    {
+        //---------------------------------------------------------------------
+        // Histogram helpers
+        //---------------------------------------------------------------------
+        /**
+         * \brief index of the bin a value inside [min, max] falls into
+         *
+         * The division is kept (instead of a multiplication with the
+         * reciprocal) so that the bins match those of the statistics.
+         */
+        inline double binPosition(
+            double val, double min, double binSize, double last)
+        {
+            return std::min((val - min) / binSize + 0.5, last);
+        }
+
+        /**
+         * \brief counts values of 8 and 16 bit integer types
+         *
+         * A lookup table maps every value of the type to its bin (or to the
+         * overflow counter behind the last bin if it is outside the
+         * interval). Each thread counts into private counters; small
+         * histograms use several interleaved sets of counters so that runs
+         * of equal values do not wait for the previous increment.
+         */
+        template<class T>
+        void countValues(
+            std::vector<uint64_t> &counts,
+            double min,
+            double max,
+            double binSize,
+            const T* values,
+            size_t num_values,
+            std::true_type /* lookup table */)
+        {
+            const size_t num_bins = counts.size() - 1;
+            const size_t lanes =
+                (num_bins <= HISTOGRAM_LANES_MAX_BINS) ? 4 : 1;
+            const double lowest =
+                static_cast<double>(std::numeric_limits<T>::lowest());
+            const size_t numTypeValues = size_t(1) << (8 * sizeof(T));
+            std::vector<uint32_t> lut(numTypeValues);
+
+            for (size_t v = 0; v < numTypeValues; ++v)
+            {
+                double val = lowest + static_cast<double>(v);
+
+                if ((min <= val) && (val <= max))
+                    lut[v] = static_cast<uint32_t>(binPosition(
+                        val, min, binSize, static_cast<double>(num_bins - 1)));
+                else
+                    lut[v] = static_cast<uint32_t>(num_bins);
+            }
+
+            #pragma omp parallel
+            {
+                std::vector<uint64_t> local(lanes * (num_bins + 1), 0);
+
+                #pragma omp for schedule(static) nowait
+                for (size_t i = 0; i < num_values; ++i)
+                {
+                    size_t v = static_cast<size_t>(
+                        static_cast<int>(values[i]) -
+                        static_cast<int>(std::numeric_limits<T>::lowest()));
+                    ++local[(i & (lanes - 1)) * (num_bins + 1) + lut[v]];
+                }
+
+                #pragma omp critical
+                for (size_t l = 0; l < lanes; ++l)
+                    for (size_t b = 0; b <= num_bins; ++b)
+                        counts[b] += local[l * (num_bins + 1) + b];
+            }
+        }
+
+        /**
+         * \brief counts values of all other types
+         *
+         * The bin indices of a block of values are computed in a loop without
+         * branches that the compiler can vectorise, the counters are
+         * incremented afterwards. Each thread counts into private counters.
+         */
+        template<class T>
+        void countValues(
+            std::vector<uint64_t> &counts,
+            double min,
+            double max,
+            double binSize,
+            const T* values,
+            size_t num_values,
+            std::false_type /* lookup table */)
+        {
+            const size_t num_bins = counts.size() - 1;
+            const size_t numBlocks =
+                (num_values + HISTOGRAM_BLOCK_SIZE - 1) / HISTOGRAM_BLOCK_SIZE;
+            const double last = static_cast<double>(num_bins - 1);
+            const double overflow = static_cast<double>(num_bins);
+
+            #pragma omp parallel
+            {
+                std::vector<uint64_t> local(num_bins + 1, 0);
+                int32_t idx[HISTOGRAM_BLOCK_SIZE];
+
+                #pragma omp for schedule(static) nowait
+                for (size_t block = 0; block < numBlocks; ++block)
+                {
+                    const T *first = values + block * HISTOGRAM_BLOCK_SIZE;
+                    const size_t count = std::min(
+                        HISTOGRAM_BLOCK_SIZE,
+                        num_values - block * HISTOGRAM_BLOCK_SIZE);
+
+                    #pragma omp simd
+                    for (size_t j = 0; j < count; ++j)
+                    {
+                        double val = static_cast<double>(first[j]);
+                        bool inside = (min <= val) && (val <= max);
+                        double pos = inside ?
+                            binPosition(val, min, binSize, last) : overflow;
+                        idx[j] = static_cast<int32_t>(pos);
+                    }
+
+                    for (size_t j = 0; j < count; ++j)
+                        ++local[idx[j]];
+                }
+
+                #pragma omp critical
+                for (size_t b = 0; b <= num_bins; ++b)
+                    counts[b] += local[b];
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    // Templated functions
+    //-------------------------------------------------------------------------
+    /**
+     * \brief create a histogram from the given data
+     *
+     * \param num_bins   number of bins
+     * \param min        minimum value
+     * \param max        maximum value
+     * \param values     pointer to data values
+     * \param num_values number of values in the vector pointed to by values.
+     *
+     * \return A histogram with the limits and the count of each bin.
+     *
+     * The bins cover the interval [min - 0.5 * size, max + 0.5 * size] with
+     * size = (max - min + 1) / num_bins, values outside of [min, max] are not
+     * counted. 8 and 16 bit integer data is counted through a lookup table,
+     * for all other types the bin index is computed. The values are
+     * distributed over the threads which count into private counters that
+     * are summed up at the end.
+     *
+     * Note: the interval of the last bin includes the upper limit
+     *       [first, second] with second = max
+     */
+    template<class T>
+    Histogram binData(
+        size_t num_bins,
+        T min,
+        T max,
+        const T* values,
+        size_t num_values)
+    {
+        Histogram histogram;
+
+        if (num_bins == 0 || min > max || values == nullptr || num_values == 0)
+            return histogram;
+
+        const double dMin = static_cast<double>(min);
+        const double dMax = static_cast<double>(max);
+        const double bin_size =
+            (dMax - dMin + 1.0) / static_cast<double>(num_bins);
+
+        histogram.lower.resize(num_bins);
+        histogram.upper.resize(num_bins);
+        for (size_t i = 0; i < num_bins; i++)
+        {
+            histogram.lower[i] =
+                static_cast<double>(i) * bin_size - 0.5 * bin_size + dMin;
+            histogram.upper[i] =
+                static_cast<double>(i + 1) * bin_size - 0.5 * bin_size + dMin;
+        }
+
+        // one additional counter for the values outside the interval
+        std::vector<uint64_t> counts(num_bins + 1, 0);
+
+        detail::countValues<T>(
+            counts, dMin, dMax, bin_size, values, num_values,
+            std::integral_constant<bool,
+                std::is_integral<T>::value && (sizeof(T) <= 2)>());
+
+        counts.pop_back();
+        histogram.counts = std::move(counts);
+
+        return histogram;
+    }
+}
@@ -0,0 +1,300 @@
+#include <iostream>
+#include <string>
+#include <utility>
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "io.hpp"
+
+//-----------------------------------------------------------------------------
+// MappedFile Class Implementations
+//-----------------------------------------------------------------------------
+util::io::MappedFile::MappedFile() :
+    m_data(nullptr),
+    m_size(0)
+{
+}
+
+/**
+ * \brief maps the file at the given path into memory
+ *
+ * \param path        path of the file that shall be mapped
+ * \param privateCopy if true the mapping is writable and changes are only
+ *                    visible in this process (copy on write)
+ *
+ * Note: check isValid() if the file could be mapped
+ */
+util::io::MappedFile::MappedFile(const std::string &path, bool privateCopy) :
+    m_data(nullptr),
+    m_size(0)
+{
+    struct stat st;
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if (0 > fd)
+    {
+        std::cerr << "Error while mapping " << path << ": cannot open file!" <<
+            std::endl;
+        return;
+    }
+
+    if ((0 == fstat(fd, &st)) && (0 < st.st_size))
+    {
+        void *data = mmap(
+            nullptr,
+            static_cast<size_t>(st.st_size),
+            privateCopy ? (PROT_READ | PROT_WRITE) : PROT_READ,
+            MAP_PRIVATE,
+            fd,
+            0);
+
+        if (MAP_FAILED != data)
+        {
+            m_data = data;
+            m_size = static_cast<size_t>(st.st_size);
+        }
+        else
+        {
+            std::cerr << "Error while mapping " << path <<
+                ": mmap failed!" << std::endl;
+        }
+    }
+
+    // the mapping stays valid after the file descriptor is closed
+    close(fd);
+}
+
+util::io::MappedFile::MappedFile(util::io::MappedFile&& other) :
+    m_data(other.m_data),
+    m_size(other.m_size)
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+
+util::io::MappedFile& util::io::MappedFile::operator=(
+        util::io::MappedFile&& other)
+{
+    unmap();
+
+    m_data = other.m_data;
+    m_size = other.m_size;
+    other.m_data = nullptr;
+    other.m_size = 0;
+
+    return *this;
+}
+
+util::io::MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+void util::io::MappedFile::advise(
+        util::io::Advice advice, size_t offset, size_t length) const
+{
+    int flag = MADV_NORMAL;
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t alignedOffset = 0;
+
+    if ((nullptr == m_data) || (offset >= m_size))
+        return;
+
+    if ((0 == length) || (offset + length > m_size))
+        length = m_size - offset;
+
+    switch(advice)
+    {
+        case Advice::sequential:
+            flag = MADV_SEQUENTIAL;
+            break;
+
+        case Advice::random:
+            flag = MADV_RANDOM;
+            break;
+
+        case Advice::willneed:
+            flag = MADV_WILLNEED;
+            break;
+
+        case Advice::dontneed:
+            flag = MADV_DONTNEED;
+            break;
+
+        case Advice::normal:
+        default:
+            flag = MADV_NORMAL;
+            break;
+    }
+
+    // madvise requires a page aligned start address
+    alignedOffset = offset - (offset % pageSize);
+    length += offset - alignedOffset;
+
+    madvise(static_cast<char*>(m_data) + alignedOffset, length, flag);
+}
+
+void util::io::MappedFile::unmap()
+{
+    if (nullptr != m_data)
+        munmap(m_data, m_size);
+
+    m_data = nullptr;
+    m_size = 0;
+}
+
+//-----------------------------------------------------------------------------
+// File Class Implementations
+//-----------------------------------------------------------------------------
+util::io::File::File() :
+    m_fd(-1)
+{
+}
+
+/**
+ * \brief opens the file at the given path for reading
+ *
+ * Note: check isValid() if the file could be opened
+ */
+util::io::File::File(const std::string &path) :
+    m_fd(-1)
+{
+    m_fd = open(path.c_str(), O_RDONLY);
+
+    if (0 > m_fd)
+        std::cerr << "Error while opening " << path << ": cannot open file!" <<
+            std::endl;
+}
+
+util::io::File::File(util::io::File&& other) :
+    m_fd(other.m_fd)
+{
+    other.m_fd = -1;
+}
+
+util::io::File& util::io::File::operator=(util::io::File&& other)
+{
+    close();
+
+    m_fd = other.m_fd;
+    other.m_fd = -1;
+
+    return *this;
+}
+
+util::io::File::~File()
+{
+    close();
+}
+
+bool util::io::File::readAt(void *buffer, size_t length, size_t offset) const
+{
+    char *dst = static_cast<char*>(buffer);
+
+    if (0 > m_fd)
+        return false;
+
+    // pread may return less than requested, e.g. for very large requests
+    while (0 < length)
+    {
+        ssize_t count = pread(m_fd, dst, length, static_cast<off_t>(offset));
+
+        if (0 > count)
+        {
+            if (EINTR == errno)
+                continue;
+            return false;
+        }
+        if (0 == count)
+            return false;
+
+        dst += count;
+        offset += static_cast<size_t>(count);
+        length -= static_cast<size_t>(count);
+    }
+
+    return true;
+}
+
+void util::io::File::advise(
+        util::io::Advice advice, size_t offset, size_t length) const
+{
+    int flag = POSIX_FADV_NORMAL;
+
+    if (0 > m_fd)
+        return;
+
+    switch(advice)
+    {
+        case Advice::sequential:
+            flag = POSIX_FADV_SEQUENTIAL;
+            break;
+
+        case Advice::random:
+            flag = POSIX_FADV_RANDOM;
+            break;
+
+        case Advice::willneed:
+            flag = POSIX_FADV_WILLNEED;
+            break;
+
+        case Advice::dontneed:
+            flag = POSIX_FADV_DONTNEED;
+            break;
+
+        case Advice::normal:
+        default:
+            flag = POSIX_FADV_NORMAL;
+            break;
+    }
+
+    posix_fadvise(
+        m_fd,
+        static_cast<off_t>(offset),
+        static_cast<off_t>(length),
+        flag);
+}
+
+void util::io::File::close()
+{
+    if (0 <= m_fd)
+        ::close(m_fd);
+
+    m_fd = -1;
+}
+
+//-----------------------------------------------------------------------------
+// convenience functions
+//-----------------------------------------------------------------------------
+/**
+ * \brief returns the size of the file at the given path in byte
+ *
+ * \return file size or 0 if the file does not exist
+ */
+size_t util::io::getFileSize(const std::string &path)
+{
+    struct stat st;
+
+    if (0 != stat(path.c_str(), &st))
+        return 0;
+
+    return static_cast<size_t>(st.st_size);
+}
+
+/**
+ * \brief asks the kernel to evict the cached pages of a file
+ *
+ * Only clean pages can be dropped, which is sufficient to get a cold cache
+ * for the volume files that are only read.
+ */
+void util::io::dropFromPageCache(const std::string &path)
+{
+    File file(path);
+
+    file.advise(Advice::dontneed);
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace util
+{
+    namespace io
+    {
+        //---------------------------------------------------------------------
+        // Type definitions
+        //---------------------------------------------------------------------
+        /**
+         * \brief access pattern hints that can be given to the kernel
+         */
+        enum class Advice : int
+        {
+            normal = 0,
+            sequential,
+            random,
+            willneed,
+            dontneed
+        };
+
+        /**
+         * \brief read only memory mapping of a whole file
+         *
+         * Maps a file into the address space of the process. The pages of
+         * the file are only loaded when they are accessed and can be shared
+         * with the page cache. If the mapping is created as private copy
+         * the mapped memory can be modified (e.g. for swapping the byte order
+         * in place) without the changes being written back to the file.
+         */
+        class MappedFile
+        {
+            public:
+            MappedFile();
+            MappedFile(const std::string &path, bool privateCopy = false);
+            MappedFile(const MappedFile& other) = delete;
+            MappedFile(MappedFile&& other);
+            MappedFile& operator=(const MappedFile& other) = delete;
+            MappedFile& operator=(MappedFile&& other);
+            ~MappedFile();
+
+            bool isValid() const { return nullptr != m_data; }
+            void* getData() const { return m_data; }
+            size_t getSize() const { return m_size; }
+
+            /**
+             * \brief gives the kernel a hint how the mapping will be accessed
+             *
+             * \param advice expected access pattern
+             * \param offset start of the affected range in byte
+             * \param length length of the affected range in byte (0 for the
+             *               rest of the file)
+             */
+            void advise(Advice advice, size_t offset = 0, size_t length = 0)
+                const;
+
+            private:
+            void *m_data;
+            size_t m_size;
+
+            void unmap();
+        };
+
+        /**
+         * \brief read only file handle for positional reads
+         *
+         * Reads with an explicit file offset (pread) do not share a file
+         * position, so a single handle can be used by several threads at
+         * once.
+         */
+        class File
+        {
+            public:
+            File();
+            File(const std::string &path);
+            File(const File& other) = delete;
+            File(File&& other);
+            File& operator=(const File& other) = delete;
+            File& operator=(File&& other);
+            ~File();
+
+            bool isValid() const { return 0 <= m_fd; }
+            int getDescriptor() const { return m_fd; }
+
+            /**
+             * \brief reads length bytes starting at offset into buffer
+             *
+             * \return true if all bytes could be read
+             */
+            bool readAt(void *buffer, size_t length, size_t offset) const;
+
+            /**
+             * \brief gives the kernel a hint how the file will be accessed
+             *
+             * \param advice expected access pattern
+             * \param offset start of the affected range in byte
+             * \param length length of the affected range in byte (0 for the
+             *               rest of the file)
+             */
+            void advise(Advice advice, size_t offset = 0, size_t length = 0)
+                const;
+
+            private:
+            int m_fd;
+
+            void close();
+        };
+
+        //---------------------------------------------------------------------
+        // Convenience functions
+        //---------------------------------------------------------------------
+        size_t getFileSize(const std::string &path);
+        void dropFromPageCache(const std::string &path);
+    }
+}
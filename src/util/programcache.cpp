@@ -0,0 +1,156 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdlib>
+#include <cstdint>
+
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+
+#include "programcache.hpp"
+
+namespace bfs = boost::filesystem;
+
+//-----------------------------------------------------------------------------
+// internal helpers
+//-----------------------------------------------------------------------------
+namespace
+{
+    /**
+     * \brief directory of the program binaries
+     *
+     * The binaries are stored in $XDG_CACHE_HOME/mvr/programs (default
+     * ~/.cache/mvr/programs), next to the timestep index cache.
+     */
+    bfs::path getCacheDir()
+    {
+        if (nullptr != std::getenv("XDG_CACHE_HOME"))
+            return bfs::path(std::getenv("XDG_CACHE_HOME")) / "mvr" /
+                "programs";
+        else if (nullptr != std::getenv("HOME"))
+            return bfs::path(std::getenv("HOME")) / ".cache" / "mvr" /
+                "programs";
+
+        return bfs::path();
+    }
+
+    std::string getGlString(GLenum name)
+    {
+        const GLubyte *str = glGetString(name);
+
+        return (nullptr != str) ?
+            std::string(reinterpret_cast<const char*>(str)) : std::string();
+    }
+}
+
+//-----------------------------------------------------------------------------
+// function definitions
+//-----------------------------------------------------------------------------
+bool util::programcache::isAvailable()
+{
+    GLint numFormats = 0;
+
+    if ((nullptr == glGetProgramBinary) || (nullptr == glProgramBinary) ||
+        (nullptr == glProgramParameteri) || getCacheDir().empty())
+        return false;
+
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+
+    return numFormats > 0;
+}
+
+std::string util::programcache::getKey(const std::string &sources)
+{
+    std::ostringstream key;
+    std::string driver =
+        getGlString(GL_VENDOR) + "\n" +
+        getGlString(GL_RENDERER) + "\n" +
+        getGlString(GL_VERSION);
+
+    key << std::hex << std::hash<std::string>()(driver) << "-" <<
+        std::hash<std::string>()(sources);
+
+    return key.str();
+}
+
+GLuint util::programcache::loadProgram(const std::string &key)
+{
+    if (!isAvailable())
+        return 0;
+
+    bfs::path path = getCacheDir() / (key + ".bin");
+    std::ifstream ifs(path.string(), std::ios::binary);
+    uint32_t format = 0;
+    std::vector<char> binary;
+    GLint success = GL_FALSE;
+
+    if (!ifs.good())
+        return 0;
+
+    ifs.read(reinterpret_cast<char*>(&format), sizeof(format));
+    binary.assign(std::istreambuf_iterator<char>(ifs),
+        std::istreambuf_iterator<char>());
+    if (binary.empty())
+        return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(
+        program,
+        static_cast<GLenum>(format),
+        binary.data(),
+        static_cast<GLsizei>(binary.size()));
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+    // binaries can be rejected after driver updates that keep the version
+    // string. The caller compiles the sources and replaces the binary.
+    if (GL_TRUE != success)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+void util::programcache::storeProgram(const std::string &key, GLuint program)
+{
+    if (!isAvailable())
+        return;
+
+    GLint length = 0;
+    GLenum format = 0;
+
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    bfs::path path = getCacheDir() / (key + ".bin");
+    bfs::path tmpPath(
+        path.string() + "." + std::to_string(getpid()) + ".tmp");
+
+    try
+    {
+        uint32_t format32 = static_cast<uint32_t>(format);
+
+        bfs::create_directories(path.parent_path());
+        {
+            std::ofstream ofs(tmpPath.string(), std::ios::binary);
+            ofs.write(reinterpret_cast<const char*>(&format32),
+                sizeof(format32));
+            ofs.write(binary.data(), length);
+        }
+        bfs::rename(tmpPath, path);
+    }
+    catch(std::exception &e)
+    {
+        std::cerr << "Warning: could not write program binary " <<
+            path.string() << ": " << e.what() << std::endl;
+    }
+}
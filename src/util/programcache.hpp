@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+
+#include <GL/gl3w.h>
+
+namespace util
+{
+    namespace programcache
+    {
+        //---------------------------------------------------------------------
+        // function declarations
+        //---------------------------------------------------------------------
+        /**
+         * \brief true if the driver can save and restore program binaries
+         *        and a cache directory is available
+         */
+        bool isAvailable();
+
+        /**
+         * \brief cache key of a program
+         *
+         * The key combines the vendor, renderer and version strings of the
+         * driver with a hash of the sources, so binaries are never used with
+         * another driver or after a change of the sources.
+         *
+         * \param sources all shader sources of the program in a fixed order
+         */
+        std::string getKey(const std::string &sources);
+
+        /**
+         * \brief creates a program from a cached binary
+         *
+         * \return the ID of the linked program or 0 if there is no usable
+         *         binary for the key
+         */
+        GLuint loadProgram(const std::string &key);
+
+        /**
+         * \brief saves the binary of a linked program in the cache
+         *
+         * The program should have been linked with
+         * GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+         */
+        void storeProgram(const std::string &key, GLuint program);
+    }
+}
@@ -0,0 +1,257 @@
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+#include "readback.hpp"
+
+//-----------------------------------------------------------------------------
+// ReadbackPipeline Class Implementations
+//-----------------------------------------------------------------------------
+util::ReadbackPipeline::ReadbackPipeline(
+    size_t ringSize,
+    unsigned int numWorkers) :
+    m_frames(std::max(ringSize, size_t(1))),
+    m_next(0),
+    m_numWorkers(numWorkers),
+    m_workers(),
+    m_queue(),
+    m_mutex(),
+    m_workAvailable(),
+    m_queueChanged(),
+    m_encoding(0),
+    m_failures(0),
+    m_stop(false)
+{
+    for (Frame &frame : m_frames)
+    {
+        frame.buffer = 0;
+        frame.size = 0;
+        frame.fence = nullptr;
+        frame.width = 0;
+        frame.height = 0;
+        frame.type = FIF_TIFF;
+    }
+
+    if (0 == m_numWorkers)
+        m_numWorkers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+}
+
+util::ReadbackPipeline::~ReadbackPipeline()
+{
+    flush();
+    stopWorkers();
+
+    for (Frame &frame : m_frames)
+        if (0 != frame.buffer)
+            glDeleteBuffers(1, &frame.buffer);
+}
+
+/**
+ * The pixels are read as BGR, which is the byte order FreeImage expects on
+ * little endian machines, with rows packed without padding.
+ */
+void util::ReadbackPipeline::capture(
+    const FramebufferObject &fbo,
+    unsigned int width,
+    unsigned int height,
+    const std::string &file,
+    FREE_IMAGE_FORMAT type)
+{
+    startWorkers();
+    poll();
+
+    // the ring is full, the oldest frame has to be finished first
+    Frame &frame = m_frames[m_next];
+    if (nullptr != frame.fence)
+        retire(frame, true);
+    m_next = (m_next + 1) % m_frames.size();
+
+    size_t size = static_cast<size_t>(3) * width * height;
+    if (0 == frame.buffer)
+        glGenBuffers(1, &frame.buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, frame.buffer);
+    if (size != frame.size)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        frame.size = size;
+    }
+
+    fbo.bind();
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_BGR, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frame.width = width;
+    frame.height = height;
+    frame.file = file;
+    frame.type = type;
+}
+
+void util::ReadbackPipeline::poll()
+{
+    // oldest frames first, so that the files are written in capture order
+    for (size_t i = 0; i < m_frames.size(); ++i)
+    {
+        Frame &frame = m_frames[(m_next + i) % m_frames.size()];
+
+        if ((nullptr != frame.fence) &&
+            (GL_TIMEOUT_EXPIRED != glClientWaitSync(
+                frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0)))
+            retire(frame, false);
+    }
+}
+
+bool util::ReadbackPipeline::flush()
+{
+    bool success = true;
+
+    for (size_t i = 0; i < m_frames.size(); ++i)
+    {
+        Frame &frame = m_frames[(m_next + i) % m_frames.size()];
+
+        if (nullptr != frame.fence)
+            retire(frame, true);
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_queueChanged.wait(lock,
+        [this]() { return m_queue.empty() && (0 == m_encoding); });
+    success = (0 == m_failures);
+    m_failures = 0;
+
+    return success;
+}
+
+/**
+ * Copies the pixels out of the buffer, so that the buffer can take the next
+ * readback while the image is encoded. The queue of images is bounded to
+ * keep the memory in check if the encoding is slower than the rendering.
+ */
+void util::ReadbackPipeline::retire(Frame &frame, bool wait)
+{
+    Image image;
+    const void *pixels = nullptr;
+
+    if (wait)
+    {
+        GLenum status = GL_TIMEOUT_EXPIRED;
+        while (GL_TIMEOUT_EXPIRED == status)
+            status = glClientWaitSync(
+                frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    }
+    glDeleteSync(frame.fence);
+    frame.fence = nullptr;
+
+    image.pixels.resize(frame.size);
+    image.width = frame.width;
+    image.height = frame.height;
+    image.file = frame.file;
+    image.type = frame.type;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, frame.buffer);
+    pixels = glMapBufferRange(
+        GL_PIXEL_PACK_BUFFER, 0, frame.size, GL_MAP_READ_BIT);
+    if (nullptr != pixels)
+    {
+        std::memcpy(image.pixels.data(), pixels, frame.size);
+        pixels = (GL_TRUE == glUnmapBuffer(GL_PIXEL_PACK_BUFFER)) ?
+            image.pixels.data() : nullptr;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (nullptr == pixels)
+    {
+        std::cerr << "Error: could not read back " << image.file <<
+            std::endl;
+        ++m_failures;
+        return;
+    }
+
+    m_queueChanged.wait(lock,
+        [this]() { return m_queue.size() < 2 * m_workers.size(); });
+    m_queue.push_back(std::move(image));
+    lock.unlock();
+    m_workAvailable.notify_one();
+}
+
+void util::ReadbackPipeline::startWorkers()
+{
+    if (!m_workers.empty())
+        return;
+
+    m_stop = false;
+    for (unsigned int i = 0; i < m_numWorkers; ++i)
+        m_workers.emplace_back(&ReadbackPipeline::work, this);
+}
+
+void util::ReadbackPipeline::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_workAvailable.notify_all();
+
+    for (std::thread &worker : m_workers)
+        worker.join();
+    m_workers.clear();
+}
+
+void util::ReadbackPipeline::work()
+{
+    while (true)
+    {
+        Image image;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workAvailable.wait(lock,
+                [this]() { return m_stop || !m_queue.empty(); });
+
+            // the queue is drained before the workers stop
+            if (m_queue.empty())
+                return;
+
+            image = std::move(m_queue.front());
+            m_queue.pop_front();
+            ++m_encoding;
+        }
+        m_queueChanged.notify_all();
+
+        bool saved = encode(image);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_encoding;
+            if (!saved)
+                ++m_failures;
+        }
+        m_queueChanged.notify_all();
+    }
+}
+
+bool util::ReadbackPipeline::encode(Image &image)
+{
+    FIBITMAP* bitmap = FreeImage_ConvertFromRawBits(
+        image.pixels.data(),
+        image.width,
+        image.height,
+        3 * image.width,
+        24,
+        0x0000FF,
+        0x00FF00,
+        0xFF0000,
+        false);
+    bool saved = (nullptr != bitmap) &&
+        FreeImage_Save(image.type, bitmap, image.file.c_str(), 0);
+
+    if (nullptr != bitmap)
+        FreeImage_Unload(bitmap);
+    if (!saved)
+        std::cerr << "Error: could not save image " << image.file <<
+            std::endl;
+
+    return saved;
+}
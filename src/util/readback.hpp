@@ -0,0 +1,118 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+#include <GL/gl3w.h>
+
+#include <FreeImage.h>
+
+#include "util.hpp"
+
+namespace util
+{
+    //-------------------------------------------------------------------------
+    // Type definitions
+    //-------------------------------------------------------------------------
+    /**
+     * \brief saves framebuffer contents to image files without stalling the
+     *        rendering
+     *
+     * Each capture reads the framebuffer into the next pixel buffer object of
+     * a ring and places a fence behind the read. Readbacks whose fence has
+     * passed are copied out of their buffer and encoded by worker threads,
+     * so that rendering the next frames overlaps with the transfer and the
+     * encoding of the previous ones. A capture only waits if the ring is full
+     * of frames the GPU has not finished yet, or if the workers fall behind.
+     *
+     * The GL calls have to be made from the thread of the GL context. Buffers
+     * and workers are created on the first capture.
+     */
+    class ReadbackPipeline
+    {
+        public:
+        /**
+         * \param ringSize number of frames that can be in flight
+         * \param numWorkers encoding threads, 0 for one per core but one
+         */
+        ReadbackPipeline(size_t ringSize = 3, unsigned int numWorkers = 0);
+        ReadbackPipeline(const ReadbackPipeline& other) = delete;
+        ReadbackPipeline(ReadbackPipeline&& other) = delete;
+        ReadbackPipeline& operator=(const ReadbackPipeline& other) = delete;
+        ReadbackPipeline& operator=(ReadbackPipeline&& other) = delete;
+        ~ReadbackPipeline();
+
+        /**
+         * \brief starts reading the RGB values of a framebuffer into a file
+         *
+         * \param fbo object from which the pixel shall be read
+         * \param width horizontal size of the fbo object in pixel
+         * \param height vertical size of the fbo object in pixel
+         * \param file name and path of the target image file
+         * \param type FreeImage Image type (FIF_BMP, FIF_TIFF, ...)
+         */
+        void capture(
+            const FramebufferObject &fbo,
+            unsigned int width,
+            unsigned int height,
+            const std::string &file,
+            FREE_IMAGE_FORMAT type);
+
+        /**
+         * \brief hands finished readbacks to the workers without waiting
+         */
+        void poll();
+
+        /**
+         * \brief waits until all captured frames are saved
+         *
+         * \return false if an image could not be saved since the last flush
+         */
+        bool flush();
+
+        private:
+        struct Frame
+        {
+            GLuint buffer;
+            size_t size;
+            GLsync fence;           //!< set while the readback is in flight
+            unsigned int width;
+            unsigned int height;
+            std::string file;
+            FREE_IMAGE_FORMAT type;
+        };
+
+        struct Image
+        {
+            std::vector<uint8_t> pixels;
+            unsigned int width;
+            unsigned int height;
+            std::string file;
+            FREE_IMAGE_FORMAT type;
+        };
+
+        void retire(Frame &frame, bool wait);
+        void startWorkers();
+        void stopWorkers();
+        void work();
+        static bool encode(Image &image);
+
+        std::vector<Frame> m_frames;
+        size_t m_next;
+        unsigned int m_numWorkers;
+
+        std::vector<std::thread> m_workers;
+        std::deque<Image> m_queue;
+        std::mutex m_mutex;
+        std::condition_variable m_workAvailable;
+        std::condition_variable m_queueChanged;
+        size_t m_encoding;          //!< images taken by the workers
+        size_t m_failures;
+        bool m_stop;
+    };
+}
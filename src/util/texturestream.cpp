@@ -0,0 +1,275 @@
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+#include "texturestream.hpp"
+
+//-----------------------------------------------------------------------------
+// TextureStream3D Class Implementations
+//-----------------------------------------------------------------------------
+util::texture::TextureStream3D::TextureStream3D() :
+    m_texture(),
+    m_dim{ {0, 0, 0} },
+    m_buffers{ {0, 0} },
+    m_fences{ {nullptr, nullptr} },
+    m_bufferSize(0),
+    m_nextBuffer(0),
+    m_format(GL_RED),
+    m_type(GL_UNSIGNED_BYTE),
+    m_sliceSize(0),
+    m_slabDepth(1),
+    m_nextSlice(0),
+    m_texels(nullptr)
+{
+}
+
+util::texture::TextureStream3D::~TextureStream3D()
+{
+    deleteFences();
+    if (0 != m_buffers[0])
+        glDeleteBuffers(2, m_buffers.data());
+}
+
+/**
+ * A target texture left by exchange or cancel is reused if the driver
+ * reports the same internal format and size, so that playback does not
+ * reallocate the texture memory for every timestep.
+ */
+void util::texture::TextureStream3D::start(
+    GLenum internalFormat,
+    GLenum format,
+    GLenum type,
+    GLsizei width,
+    GLsizei height,
+    GLsizei depth,
+    size_t texelSize,
+    const void *texels,
+    size_t slabSize)
+{
+    GLint currentFormat = 0;
+    std::array<GLint, 3> currentDim = {{0, 0, 0}};
+
+    cancel();
+
+    if (0 != m_texture.getID())
+    {
+        m_texture.bind();
+        glGetTexLevelParameteriv(GL_TEXTURE_3D, 0,
+            GL_TEXTURE_INTERNAL_FORMAT, &currentFormat);
+        glGetTexLevelParameteriv(GL_TEXTURE_3D, 0,
+            GL_TEXTURE_WIDTH, &currentDim[0]);
+        glGetTexLevelParameteriv(GL_TEXTURE_3D, 0,
+            GL_TEXTURE_HEIGHT, &currentDim[1]);
+        glGetTexLevelParameteriv(GL_TEXTURE_3D, 0,
+            GL_TEXTURE_DEPTH, &currentDim[2]);
+        m_texture.unbind();
+    }
+
+    m_dim = {{width, height, depth}};
+    if ((static_cast<GLenum>(currentFormat) != internalFormat) ||
+        (currentDim[0] != width) ||
+        (currentDim[1] != height) ||
+        (currentDim[2] != depth))
+    {
+        m_texture = Texture3D(
+            internalFormat,
+            format,
+            0,
+            type,
+            GL_LINEAR,
+            GL_CLAMP_TO_EDGE,
+            width,
+            height,
+            depth);
+    }
+
+    m_format = format;
+    m_type = type;
+    m_sliceSize = static_cast<size_t>(width) * height * texelSize;
+    m_slabDepth = static_cast<GLsizei>(std::min(
+        std::max(slabSize / std::max(m_sliceSize, size_t(1)), size_t(1)),
+        static_cast<size_t>(std::max(depth, 1))));
+    m_nextSlice = 0;
+    m_texels = static_cast<const unsigned char*>(texels);
+
+    // buffers of another size are respecified, the driver orphans the old
+    // storage if the GPU still reads from it
+    if (0 == m_buffers[0])
+        glGenBuffers(2, m_buffers.data());
+    if (m_slabDepth * m_sliceSize != m_bufferSize)
+    {
+        m_bufferSize = m_slabDepth * m_sliceSize;
+        for (GLuint buffer : m_buffers)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+            glBufferData(
+                GL_PIXEL_UNPACK_BUFFER, m_bufferSize, nullptr, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+}
+
+bool util::texture::TextureStream3D::update()
+{
+    if (!isActive())
+        return false;
+
+    // all slabs are submitted, wait for the GPU without blocking
+    if (m_nextSlice >= m_dim[2])
+    {
+        for (GLsync &fence : m_fences)
+        {
+            GLenum status = pollFence(fence);
+            if (GL_TIMEOUT_EXPIRED == status)
+                return false;
+            if (GL_WAIT_FAILED == status)
+                return uploadSynchronous();
+        }
+        return true;
+    }
+
+    // the buffer may still be read by the upload of an earlier slab
+    GLsync &fence = m_fences[m_nextBuffer];
+    GLenum status = pollFence(fence);
+    if (GL_TIMEOUT_EXPIRED == status)
+        return false;
+    if (GL_WAIT_FAILED == status)
+        return uploadSynchronous();
+
+    GLsizei slices = std::min(m_slabDepth, m_dim[2] - m_nextSlice);
+    size_t bytes = slices * m_sliceSize;
+    bool copied = false;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffers[m_nextBuffer]);
+    void *dst = glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER,
+        0,
+        bytes,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+            GL_MAP_UNSYNCHRONIZED_BIT);
+    if (nullptr != dst)
+    {
+        std::memcpy(dst, m_texels + m_nextSlice * m_sliceSize, bytes);
+        // the contents are lost if the buffer memory has been evicted
+        copied = (GL_TRUE == glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+    }
+
+    if (copied)
+    {
+        m_texture.bind();
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage3D(
+            GL_TEXTURE_3D,
+            0,
+            0,
+            0,
+            m_nextSlice,
+            m_dim[0],
+            m_dim[1],
+            slices,
+            m_format,
+            m_type,
+            nullptr);
+        m_texture.unbind();
+
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_nextBuffer = (m_nextBuffer + 1) % m_buffers.size();
+        m_nextSlice += slices;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    return false;
+}
+
+/**
+ * The fences are kept, so that the buffers are not overwritten while the
+ * GPU still reads slabs of the cancelled upload.
+ */
+void util::texture::TextureStream3D::cancel()
+{
+    m_texels = nullptr;
+    m_nextSlice = 0;
+}
+
+void util::texture::TextureStream3D::exchange(Texture3D &front)
+{
+    std::swap(front, m_texture);
+    cancel();
+}
+
+float util::texture::TextureStream3D::getProgress() const
+{
+    if (!isActive() || (m_dim[2] <= 0))
+        return 0.f;
+
+    return static_cast<float>(m_nextSlice) / static_cast<float>(m_dim[2]);
+}
+
+/**
+ * A reached fence is deleted and reset. Fences that have not been reached
+ * or could not be waited for are kept.
+ *
+ * \return GL_ALREADY_SIGNALED for no fence, the status of glClientWaitSync
+ *         otherwise
+ */
+GLenum util::texture::TextureStream3D::pollFence(GLsync &fence)
+{
+    if (nullptr == fence)
+        return GL_ALREADY_SIGNALED;
+
+    GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if ((GL_ALREADY_SIGNALED == status) || (GL_CONDITION_SATISFIED == status))
+    {
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    return status;
+}
+
+/**
+ * Fallback if a fence cannot be waited for: glFinish makes sure that the
+ * pixel buffers are no longer read and the remaining slices are uploaded
+ * directly from the texels.
+ */
+bool util::texture::TextureStream3D::uploadSynchronous()
+{
+    std::cerr << "Error: waiting for a texture upload failed, the rest of " <<
+        "the texture is uploaded synchronously." << std::endl;
+
+    glFinish();
+    deleteFences();
+
+    if (m_nextSlice < m_dim[2])
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        m_texture.bind();
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage3D(
+            GL_TEXTURE_3D,
+            0,
+            0,
+            0,
+            m_nextSlice,
+            m_dim[0],
+            m_dim[1],
+            m_dim[2] - m_nextSlice,
+            m_format,
+            m_type,
+            m_texels + m_nextSlice * m_sliceSize);
+        m_texture.unbind();
+        m_nextSlice = m_dim[2];
+    }
+
+    return true;
+}
+
+void util::texture::TextureStream3D::deleteFences()
+{
+    for (GLsync &fence : m_fences)
+    {
+        if (nullptr != fence)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include <GL/gl3w.h>
+
+#include "texture.hpp"
+
+namespace util
+{
+    namespace texture
+    {
+        //---------------------------------------------------------------------
+        // Texture streaming classes
+        //---------------------------------------------------------------------
+        /**
+         * \brief uploads a 3D texture in slabs of z slices over several frames
+         *
+         * The slabs are copied into two pixel buffer objects in turn, from
+         * which the texture is updated asynchronously. A fence after each
+         * slab guards the buffer against being overwritten before the GPU
+         * has read it, so the CPU never waits for the driver. The texture is
+         * complete once the fences of all slabs have been passed.
+         *
+         * The completed texture is exchanged with the one shown so far,
+         * which is kept as target of the next upload if that has the same
+         * format and size (double buffering during time series playback).
+         */
+        class TextureStream3D
+        {
+            public:
+            TextureStream3D();
+            TextureStream3D(const TextureStream3D& other) = delete;
+            TextureStream3D& operator=(const TextureStream3D& other) = delete;
+            ~TextureStream3D();
+
+            /**
+             * \brief starts the upload of a texture, a running upload is
+             *        cancelled
+             *
+             * \param texels texels of the whole texture, which have to stay
+             *        valid until the upload is complete or cancelled
+             * \param texelSize size of a texel in byte
+             * \param slabSize upper limit of the bytes uploaded per update,
+             *        at least one z slice is uploaded
+             */
+            void start(
+                GLenum internalFormat,
+                GLenum format,
+                GLenum type,
+                GLsizei width,
+                GLsizei height,
+                GLsizei depth,
+                size_t texelSize,
+                const void *texels,
+                size_t slabSize);
+
+            /**
+             * \brief uploads the next slab if a pixel buffer is available
+             *
+             * \return true if the texture is complete
+             */
+            bool update();
+
+            /**
+             * \brief stops the upload, the partial texture is kept as target
+             *        of the next upload
+             */
+            void cancel();
+
+            /**
+             * \brief swaps a completed texture into front
+             *
+             * The previous front texture becomes the target of the next
+             * upload, which reuses it if format and size match.
+             */
+            void exchange(Texture3D &front);
+
+            bool isActive() const { return nullptr != m_texels; }
+            float getProgress() const;
+
+            private:
+            GLenum pollFence(GLsync &fence);
+            bool uploadSynchronous();
+            void deleteFences();
+
+            Texture3D m_texture;        //!< target of the upload
+            std::array<GLsizei, 3> m_dim;
+            std::array<GLuint, 2> m_buffers;
+            std::array<GLsync, 2> m_fences;
+            size_t m_bufferSize;
+            size_t m_nextBuffer;
+            GLenum m_format;
+            GLenum m_type;
+            size_t m_sliceSize;         //!< bytes of a z slice
+            GLsizei m_slabDepth;        //!< z slices per slab
+            GLsizei m_nextSlice;
+            const unsigned char *m_texels;
+        };
+    }
+}
@@ -183,13 +183,24 @@ util::tf::TransferFuncRGBA1D::TransferFuncRGBA1D()
 
     m_controlPoints = tf::controlPointSet1D_t(fn_pt);
     m_tfTex = util::texture::Texture2D();
+    m_texMin = 0.f;
+    m_texMax = 1.f;
+    m_texRes = 256;
+    m_preIntStepLength = 0.f;
+    m_revision = 0;
     m_controlPoints.emplace(0.f, glm::vec4(0.f));
     m_controlPoints.emplace(1.f, glm::vec4(1.f));
 }
 
 util::tf::TransferFuncRGBA1D::TransferFuncRGBA1D(TransferFuncRGBA1D&& other) :
     m_controlPoints(std::move(other.m_controlPoints)),
-    m_tfTex(std::move(other.m_tfTex))
+    m_tfTex(std::move(other.m_tfTex)),
+    m_texMin(other.m_texMin),
+    m_texMax(other.m_texMax),
+    m_texRes(other.m_texRes),
+    m_preIntTex(std::move(other.m_preIntTex)),
+    m_preIntStepLength(other.m_preIntStepLength),
+    m_revision(other.m_revision)
 {
 }
 
@@ -198,6 +209,12 @@ util::tf::TransferFuncRGBA1D& util::tf::TransferFuncRGBA1D::operator=(
 {
     m_controlPoints = std::move(other.m_controlPoints);
     m_tfTex = std::move(other.m_tfTex);
+    m_texMin = other.m_texMin;
+    m_texMax = other.m_texMax;
+    m_texRes = other.m_texRes;
+    m_preIntTex = std::move(other.m_preIntTex);
+    m_preIntStepLength = other.m_preIntStepLength;
+    m_revision = other.m_revision;
 
     return *this;
 }
@@ -401,6 +418,11 @@ void util::tf::TransferFuncRGBA1D::updateTexture(
         1,
         fx.data());
 
+    m_texMin = min;
+    m_texMax = max;
+    m_texRes = res;
+    m_preIntStepLength = 0.f;
+    ++m_revision;
 }
 
 void util::tf::TransferFuncRGBA1D::updateTexture(size_t res)
@@ -449,3 +471,104 @@ util::tf::discreteTf1D_t util::tf::TransferFuncRGBA1D::getDiscretized(
 
     return discreteTf;
 }
+
+std::vector<glm::vec4> util::tf::TransferFuncRGBA1D::getPreIntegrated(
+        float min, float max, float stepLength, size_t res)
+{
+    if (res < 2) res = 2;
+
+    discreteTf1D_t discreteTf = getDiscretized(min, max, res);
+
+    // extinction per unit length and prefix integrals of the extinction and
+    // of the extinction weighted color over the sample index. The transfer
+    // function is linear between the samples, so the integrals are exact up
+    // to the discretization.
+    std::vector<float> extinction(res, 0.f);
+    std::vector<double> prefixExt(res, 0.0);
+    std::vector<glm::dvec3> prefixCol(res, glm::dvec3(0.0));
+
+    for (size_t i = 0; i < res; ++i)
+    {
+        float alpha = glm::clamp(discreteTf[i][3], 0.f, 0.9999f);
+        extinction[i] = -std::log(1.f - alpha);
+    }
+
+    for (size_t i = 1; i < res; ++i)
+    {
+        glm::dvec3 c0(discreteTf[i - 1][0], discreteTf[i - 1][1],
+            discreteTf[i - 1][2]);
+        glm::dvec3 c1(discreteTf[i][0], discreteTf[i][1], discreteTf[i][2]);
+
+        prefixExt[i] = prefixExt[i - 1] +
+            0.5 * (extinction[i - 1] + extinction[i]);
+        prefixCol[i] = prefixCol[i - 1] +
+            0.5 * (static_cast<double>(extinction[i - 1]) * c0 +
+                static_cast<double>(extinction[i]) * c1);
+    }
+
+    std::vector<glm::vec4> table(res * res, glm::vec4(0.f));
+
+    #pragma omp parallel for
+    for (size_t b = 0; b < res; ++b)
+    {
+        for (size_t f = 0; f < res; ++f)
+        {
+            glm::vec4 &entry = table[f + b * res];
+            double ext = 0.0;
+            glm::dvec3 col(0.0);
+
+            if (f == b)
+            {
+                ext = extinction[f];
+                col = glm::dvec3(discreteTf[f][0], discreteTf[f][1],
+                    discreteTf[f][2]) * ext;
+            }
+            else
+            {
+                double width = std::abs(static_cast<double>(b) - f);
+                ext = std::abs(prefixExt[b] - prefixExt[f]) / width;
+                col = (f < b) ? prefixCol[b] - prefixCol[f] :
+                    prefixCol[f] - prefixCol[b];
+                col /= width;
+            }
+
+            if (ext > 0.0)
+                entry = glm::vec4(
+                    glm::vec3(col / ext),
+                    static_cast<float>(1.0 - std::exp(-ext * stepLength)));
+            else
+                entry = glm::vec4(
+                    0.5f * (discreteTf[f][0] + discreteTf[b][0]),
+                    0.5f * (discreteTf[f][1] + discreteTf[b][1]),
+                    0.5f * (discreteTf[f][2] + discreteTf[b][2]),
+                    0.f);
+        }
+    }
+
+    return table;
+}
+
+util::texture::Texture2D&
+    util::tf::TransferFuncRGBA1D::accessPreIntegrationTexture(
+        float stepLength)
+{
+    if ((m_preIntTex.getID() != 0) && (m_preIntStepLength == stepLength))
+        return m_preIntTex;
+
+    std::vector<glm::vec4> table = getPreIntegrated(
+        m_texMin, m_texMax, stepLength, m_texRes);
+
+    m_preIntTex = util::texture::Texture2D(
+        GL_RGBA32F,
+        GL_RGBA,
+        0,
+        GL_FLOAT,
+        GL_LINEAR,
+        GL_CLAMP_TO_EDGE,
+        m_texRes,
+        m_texRes,
+        table.data());
+    m_preIntStepLength = stepLength;
+
+    return m_preIntTex;
+}
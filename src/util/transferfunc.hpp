@@ -104,6 +104,12 @@ namespace util
             private:
             controlPointSet1D_t m_controlPoints;
             util::texture::Texture2D m_tfTex;
+            float m_texMin;             //!< interval of the last texture
+            float m_texMax;
+            size_t m_texRes;
+            util::texture::Texture2D m_preIntTex;
+            float m_preIntStepLength;   //!< <= 0 if the table is outdated
+            size_t m_revision;          //!< counts the texture updates
 
             public:
             TransferFuncRGBA1D();
@@ -256,6 +262,51 @@ namespace util
              */
             discreteTf1D_t getDiscretized(
                     float min=0.f, float max=255.f, size_t res = 256);
+
+            /**
+             * \brief returns the pre-integration table of the transfer
+             *        function
+             *
+             * Entry (f, b) at index f + b * res holds the color and opacity
+             * of a ray segment of the given length whose values change
+             * linearly from sample f to sample b of the discretized transfer
+             * function. The alpha values of the transfer function are
+             * treated as opacities per unit length. The color is the
+             * average color weighted by the extinction, so it is not
+             * premultiplied with the alpha value.
+             *
+             * The table is computed from prefix integrals of the extinction
+             * and the weighted color in O(res^2).
+             *
+             * \param min   lower limit of the discretization interval
+             * \param max   upper limit of the discretization interval
+             * \param stepLength length of the ray segments
+             * \param res   number of sample points for the discretization
+             */
+            std::vector<glm::vec4> getPreIntegrated(
+                    float min,
+                    float max,
+                    float stepLength,
+                    size_t res = 256);
+
+            /**
+             * \brief returns the pre-integration table as a texture of size
+             *        [res x res]
+             *
+             * The table uses the interval and resolution of the last
+             * updateTexture call and is recomputed after the transfer
+             * function texture was updated or if the step length changed.
+             *
+             * \param stepLength length of the ray segments
+             */
+            util::texture::Texture2D& accessPreIntegrationTexture(
+                    float stepLength);
+
+            /**
+             * \brief returns a number that changes with every update of the
+             *        transfer function texture
+             */
+            size_t getRevision() const { return m_revision; }
         };
     }
 }
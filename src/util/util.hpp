@@ -18,6 +18,9 @@
 #include "geometry.hpp"
 #include "texture.hpp"
 #include "transferfunc.hpp"
+#include "io.hpp"
+#include "histogram.hpp"
+#include "byteorder.hpp"
 
 //-----------------------------------------------------------------------------
 // Macros
@@ -40,6 +43,15 @@ namespace util
     // transferfunc.cpp
     // see transferfunction and control point class in transferfunc.hpp
 
+    // io.cpp
+    // see file mapping class and functions in io.hpp
+
+    // histogram.hpp
+    // see histogram type and binning functions in histogram.hpp
+
+    // byteorder.cpp
+    // see byte swapping functions in byteorder.hpp
+
     // util.cpp
     bool printOglError(const char *file, int line);
 
@@ -85,7 +97,6 @@ namespace util
 
     };
 
-    using bin_t = std::tuple<double, double, unsigned int>;
     //-------------------------------------------------------------------------
     // Templated functions
     //-------------------------------------------------------------------------
@@ -188,76 +199,6 @@ namespace util
             coords.x * glm::cos(coords.z) * glm::sin(coords.y));
     }
 
-    /**
-     * /brief create an vector of bins from the given data
-     *
-     * /param bins      number of bins
-     * /param min       minimum value
-     * /param max       maximum value
-     * /param values    pointer to data values
-     * /param numValues number of values in the vector pointed to by values.
-     *
-     * /return An vector of tuples which contain the limits and the count of
-     *         the corresponding bin.
-     *
-     * Creates an vector of bins/ tuples from the given data which can be used
-     * to create a histogram. Each bin is a tuple with three components where
-     * the first two components contain the limits of the covered interval
-     * [first, second) and the third components contains the count.
-     *
-     * Note: - the interval of the last bin includes the upper limit
-     *       [first, second] with second = max
-     *       - the calling function has to delete the bins to free the used
-     *       memory
-     */
-    template<class T>
-    std::vector<bin_t> binData(
-        size_t num_bins,
-        T min,
-        T max,
-        T* values,
-        size_t num_values)
-    {
-        if (num_bins == 0 || min > max || values == nullptr || num_values == 0)
-            return std::vector<bin_t>(0);
-
-        std::vector<bin_t> bins(num_bins);
-        double bin_size =
-            (static_cast<double>(max - min) + 1.0) /
-            static_cast<double>(num_bins);
-
-        // initialize the bins
-        for (size_t i = 0; i < num_bins; i++)
-        {
-            std::get<0>((bins)[i]) =
-                static_cast<double>(i) * bin_size -
-                0.5 * bin_size +
-                static_cast<double>(min);
-            std::get<1>((bins)[i]) =
-                static_cast<double>(i + 1) * bin_size -
-                0.5 * bin_size +
-                static_cast<double>(min);
-            std::get<2>((bins)[i]) = 0;
-        }
-
-        // walk through values and count them in bins
-        #pragma omp parallel for
-        for (size_t i = 0; i < num_values; i++)
-        {
-            T val = values[i];
-            // place in corresponding bin
-            if ((min <= val) && (val <= max))
-            {
-                size_t idx = static_cast<size_t>(
-                    std::round(static_cast<double>(val - min) / bin_size));
-                #pragma omp atomic
-                ++std::get<2>((bins)[idx]);
-            }
-        }
-
-        return bins;
-    }
-
     /**
      * /brief create an vector of bins from the given data
      *
@@ -0,0 +1,595 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <array>
+#include <map>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+#include <boost/filesystem.hpp>
+namespace bfs = boost::filesystem;
+
+#include "volumeheader.hpp"
+
+//-----------------------------------------------------------------------------
+// internal helpers
+//-----------------------------------------------------------------------------
+namespace
+{
+    std::string trim(const std::string &s)
+    {
+        const char *whitespace = " \t\r\n";
+        size_t first = s.find_first_not_of(whitespace);
+
+        if (std::string::npos == first)
+            return std::string();
+
+        return s.substr(first, s.find_last_not_of(whitespace) - first + 1);
+    }
+
+    std::string toLower(std::string s)
+    {
+        std::transform(s.begin(), s.end(), s.begin(),
+            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return s;
+    }
+
+    /**
+     * \brief reads a header line without the line break
+     *
+     * The stream has to be opened in binary mode so that its position can
+     * be used as offset of attached data.
+     */
+    bool readLine(std::ifstream &fs, std::string &line)
+    {
+        if (!std::getline(fs, line))
+            return false;
+        if (!line.empty() && ('\r' == line.back()))
+            line.pop_back();
+        return true;
+    }
+
+    bool reportError(const std::string &path, const std::string &message)
+    {
+        std::cerr << "Error while reading volume header " << path << ": " <<
+            message << std::endl;
+        return false;
+    }
+
+    /**
+     * \brief looks a type name up in a table of names
+     */
+    cr::Datatype findType(
+        const std::map<std::string, cr::Datatype> &names,
+        const std::string &name)
+    {
+        auto it = names.find(name);
+
+        return (names.end() == it) ? cr::Datatype::none : it->second;
+    }
+
+    /**
+     * \brief position of data that is stored at the end of a file
+     *
+     * Used for NRRD "byte skip: -1" and MetaImage "HeaderSize = -1".
+     */
+    bool offsetFromEnd(cr::VolumeHeader &header)
+    {
+        boost::system::error_code ec;
+        uintmax_t fileSize = bfs::file_size(header.dataFile, ec);
+        size_t dataSize = header.dim[0] * header.dim[1] * header.dim[2] *
+            cr::datatypeSize(header.type);
+
+        if (ec || (fileSize < dataSize) ||
+                (cr::FileFormat::raw != header.format))
+            return false;
+
+        header.dataOffset = static_cast<size_t>(fileSize) - dataSize;
+        return true;
+    }
+
+    /**
+     * \brief reads three positive spacings, keeps the old values otherwise
+     */
+    void readSpacing(const std::string &text, std::array<double, 3> &spacing)
+    {
+        std::istringstream values(text);
+        std::array<double, 3> s = {{0., 0., 0.}};
+
+        if (!(values >> s[0] >> s[1] >> s[2]))
+            return;
+        for (double v : s)
+            if (!std::isfinite(v) || (v <= 0.))
+                return;
+
+        spacing = s;
+    }
+
+    /**
+     * \brief spacing given by the lengths of NRRD space direction vectors
+     *
+     * The vectors are written as "(x,y,z)", axes without a direction as
+     * "none".
+     */
+    void readSpaceDirections(
+        const std::string &text, std::array<double, 3> &spacing)
+    {
+        std::string lengths;
+        size_t pos = 0;
+
+        for (size_t axis = 0; axis < 3; ++axis)
+        {
+            size_t open = text.find('(', pos);
+            size_t close = text.find(')', open);
+
+            if ((std::string::npos == open) || (std::string::npos == close))
+                return;
+
+            std::string vector = text.substr(open + 1, close - open - 1);
+            std::replace(vector.begin(), vector.end(), ',', ' ');
+            std::istringstream components(vector);
+            double x = 0., y = 0., z = 0.;
+
+            if (!(components >> x >> y >> z))
+                return;
+
+            lengths += std::to_string(std::sqrt(x * x + y * y + z * z)) + " ";
+            pos = close + 1;
+        }
+
+        readSpacing(lengths, spacing);
+    }
+
+    /**
+     * \brief detached data files are given relative to the header
+     */
+    std::string resolveDataFile(
+        const std::string &headerPath, const std::string &dataFile)
+    {
+        bfs::path p(dataFile);
+
+        if (p.is_absolute())
+            return p.string();
+
+        return (bfs::path(headerPath).parent_path() / p).string();
+    }
+
+    //-------------------------------------------------------------------------
+    // NRRD
+    //-------------------------------------------------------------------------
+    const std::map<std::string, cr::Datatype> NRRD_TYPES = {
+        {"signed char", cr::Datatype::signed_byte},
+        {"int8", cr::Datatype::signed_byte},
+        {"int8_t", cr::Datatype::signed_byte},
+        {"uchar", cr::Datatype::unsigned_byte},
+        {"unsigned char", cr::Datatype::unsigned_byte},
+        {"uint8", cr::Datatype::unsigned_byte},
+        {"uint8_t", cr::Datatype::unsigned_byte},
+        {"short", cr::Datatype::signed_halfword},
+        {"short int", cr::Datatype::signed_halfword},
+        {"signed short", cr::Datatype::signed_halfword},
+        {"signed short int", cr::Datatype::signed_halfword},
+        {"int16", cr::Datatype::signed_halfword},
+        {"int16_t", cr::Datatype::signed_halfword},
+        {"ushort", cr::Datatype::unsigned_halfword},
+        {"unsigned short", cr::Datatype::unsigned_halfword},
+        {"unsigned short int", cr::Datatype::unsigned_halfword},
+        {"uint16", cr::Datatype::unsigned_halfword},
+        {"uint16_t", cr::Datatype::unsigned_halfword},
+        {"int", cr::Datatype::signed_word},
+        {"signed int", cr::Datatype::signed_word},
+        {"int32", cr::Datatype::signed_word},
+        {"int32_t", cr::Datatype::signed_word},
+        {"uint", cr::Datatype::unsigned_word},
+        {"unsigned int", cr::Datatype::unsigned_word},
+        {"uint32", cr::Datatype::unsigned_word},
+        {"uint32_t", cr::Datatype::unsigned_word},
+        {"longlong", cr::Datatype::signed_longword},
+        {"long long", cr::Datatype::signed_longword},
+        {"long long int", cr::Datatype::signed_longword},
+        {"signed long long", cr::Datatype::signed_longword},
+        {"signed long long int", cr::Datatype::signed_longword},
+        {"int64", cr::Datatype::signed_longword},
+        {"int64_t", cr::Datatype::signed_longword},
+        {"ulonglong", cr::Datatype::unsigned_longword},
+        {"unsigned long long", cr::Datatype::unsigned_longword},
+        {"unsigned long long int", cr::Datatype::unsigned_longword},
+        {"uint64", cr::Datatype::unsigned_longword},
+        {"uint64_t", cr::Datatype::unsigned_longword},
+        {"float", cr::Datatype::single_precision_float},
+        {"double", cr::Datatype::double_precision_float},
+    };
+
+    /**
+     * \brief reads a NRRD header with attached or detached data
+     *
+     * Supported are 3 dimensional scalar volumes with raw or gzip encoding
+     * and a single data file.
+     */
+    bool readNrrdHeader(const std::string &path, cr::VolumeHeader &header)
+    {
+        std::ifstream fs(path.c_str(), std::ios::in | std::ios::binary);
+        std::map<std::string, std::string> fields;
+        std::string line;
+        long long byteSkip = 0;
+        size_t lineSkip = 0;
+
+        if (!readLine(fs, line) || (0 != line.compare(0, 4, "NRRD")))
+            return reportError(path, "no NRRD file");
+
+        // fields end with an empty line or with the end of the header file
+        while (readLine(fs, line) && !line.empty())
+        {
+            size_t sep = line.find(": ");
+
+            if (('#' == line[0]) || (std::string::npos == sep))
+                continue;
+
+            fields[toLower(trim(line.substr(0, sep)))] =
+                trim(line.substr(sep + 2));
+        }
+
+        if ((fields.count("dimension") == 0) || (fields["dimension"] != "3"))
+            return reportError(path,
+                "only 3 dimensional volumes are supported");
+
+        std::istringstream sizes(fields["sizes"]);
+        if (!(sizes >> header.dim[0] >> header.dim[1] >> header.dim[2]))
+            return reportError(path, "invalid sizes");
+
+        header.type = findType(NRRD_TYPES, toLower(fields["type"]));
+        if (cr::Datatype::none == header.type)
+            return reportError(path, "unsupported type " + fields["type"]);
+
+        std::string encoding = toLower(fields["encoding"]);
+        if ("raw" == encoding)
+            header.format = cr::FileFormat::raw;
+        else if (("gzip" == encoding) || ("gz" == encoding))
+            header.format = cr::FileFormat::gzip;
+        else
+            return reportError(path, "unsupported encoding " + encoding);
+
+        if (fields.count("endian"))
+            header.endianness = ("big" == toLower(fields["endian"])) ?
+                cr::Endianness::big : cr::Endianness::little;
+
+        if (fields.count("spacings"))
+            readSpacing(fields["spacings"], header.spacing);
+        else if (fields.count("space directions"))
+            readSpaceDirections(fields["space directions"], header.spacing);
+
+        if (fields.count("byte skip"))
+            byteSkip = std::stoll(fields["byte skip"]);
+        if (fields.count("line skip"))
+            lineSkip = std::stoul(fields["line skip"]);
+
+        std::string dataFile = fields.count("data file") ?
+            fields["data file"] : fields["datafile"];
+        if (dataFile.empty())
+        {
+            header.dataFile = path;
+            header.dataOffset = static_cast<size_t>(fs.tellg());
+            if (!fs.good())
+                return reportError(path, "missing attached data");
+        }
+        else
+        {
+            if ((std::string::npos != dataFile.find('%')) ||
+                    (0 == dataFile.compare(0, 4, "LIST")))
+                return reportError(path, "only a single data file is "
+                    "supported");
+
+            header.dataFile = resolveDataFile(path, dataFile);
+            header.dataOffset = 0;
+        }
+
+        if (0 < lineSkip)
+        {
+            std::ifstream data(
+                header.dataFile.c_str(), std::ios::in | std::ios::binary);
+
+            data.seekg(static_cast<std::streamoff>(header.dataOffset));
+            for (size_t i = 0; i < lineSkip; ++i)
+                if (!readLine(data, line))
+                    return reportError(path, "line skip beyond end of file");
+            header.dataOffset = static_cast<size_t>(data.tellg());
+        }
+
+        // the byte skip of encoded data applies to the decoded stream, -1
+        // is only defined for raw data
+        if (-1 == byteSkip)
+        {
+            if ((cr::FileFormat::raw != header.format) ||
+                    !offsetFromEnd(header))
+                return reportError(path, "invalid byte skip");
+        }
+        else if ((0 <= byteSkip) && (cr::FileFormat::gzip == header.format))
+        {
+            header.dataSkip = static_cast<size_t>(byteSkip);
+        }
+        else if (0 <= byteSkip)
+        {
+            header.dataOffset += static_cast<size_t>(byteSkip);
+        }
+
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // MetaImage
+    //-------------------------------------------------------------------------
+    const std::map<std::string, cr::Datatype> META_TYPES = {
+        {"MET_CHAR", cr::Datatype::signed_byte},
+        {"MET_UCHAR", cr::Datatype::unsigned_byte},
+        {"MET_SHORT", cr::Datatype::signed_halfword},
+        {"MET_USHORT", cr::Datatype::unsigned_halfword},
+        {"MET_INT", cr::Datatype::signed_word},
+        {"MET_UINT", cr::Datatype::unsigned_word},
+        {"MET_LONG", cr::Datatype::signed_word},
+        {"MET_ULONG", cr::Datatype::unsigned_word},
+        {"MET_LONG_LONG", cr::Datatype::signed_longword},
+        {"MET_ULONG_LONG", cr::Datatype::unsigned_longword},
+        {"MET_FLOAT", cr::Datatype::single_precision_float},
+        {"MET_DOUBLE", cr::Datatype::double_precision_float},
+    };
+
+    /**
+     * \brief reads a MetaImage header (.mhd with detached, .mha with local
+     *        data)
+     *
+     * ElementDataFile is the last field of the header, local data directly
+     * follows its line.
+     */
+    bool readMetaImageHeader(const std::string &path, cr::VolumeHeader &header)
+    {
+        std::ifstream fs(path.c_str(), std::ios::in | std::ios::binary);
+        std::map<std::string, std::string> fields;
+        std::string line;
+        long long headerSize = 0;
+
+        while (readLine(fs, line))
+        {
+            size_t sep = line.find('=');
+
+            if (std::string::npos == sep)
+                continue;
+
+            std::string key = trim(line.substr(0, sep));
+            fields[key] = trim(line.substr(sep + 1));
+
+            if ("ElementDataFile" == key)
+                break;
+        }
+
+        if (0 == fields.count("ElementDataFile"))
+            return reportError(path, "no MetaImage file");
+
+        if (fields["NDims"] != "3")
+            return reportError(path,
+                "only 3 dimensional volumes are supported");
+
+        if (fields.count("ElementNumberOfChannels") &&
+                (fields["ElementNumberOfChannels"] != "1"))
+            return reportError(path, "only scalar volumes are supported");
+
+        std::istringstream sizes(fields["DimSize"]);
+        if (!(sizes >> header.dim[0] >> header.dim[1] >> header.dim[2]))
+            return reportError(path, "invalid DimSize");
+
+        header.type = findType(META_TYPES, fields["ElementType"]);
+        if (cr::Datatype::none == header.type)
+            return reportError(path,
+                "unsupported ElementType " + fields["ElementType"]);
+
+        std::string msb = fields.count("ElementByteOrderMSB") ?
+            fields["ElementByteOrderMSB"] : fields["BinaryDataByteOrderMSB"];
+        if (!msb.empty())
+            header.endianness = ("true" == toLower(msb)) ?
+                cr::Endianness::big : cr::Endianness::little;
+
+        header.format = ("true" == toLower(fields["CompressedData"])) ?
+            cr::FileFormat::gzip : cr::FileFormat::raw;
+
+        if (fields.count("ElementSpacing"))
+            readSpacing(fields["ElementSpacing"], header.spacing);
+
+        if (fields.count("HeaderSize"))
+            headerSize = std::stoll(fields["HeaderSize"]);
+
+        std::string dataFile = fields["ElementDataFile"];
+        if ("LOCAL" == dataFile)
+        {
+            header.dataFile = path;
+            header.dataOffset = static_cast<size_t>(fs.tellg());
+            if (!fs.good())
+                return reportError(path, "missing local data");
+        }
+        else
+        {
+            if ((std::string::npos != dataFile.find('%')) ||
+                    (0 == dataFile.compare(0, 4, "LIST")))
+                return reportError(path, "only a single data file is "
+                    "supported");
+
+            header.dataFile = resolveDataFile(path, dataFile);
+            header.dataOffset = 0;
+        }
+
+        if (-1 == headerSize)
+        {
+            if (!offsetFromEnd(header))
+                return reportError(path, "invalid HeaderSize");
+        }
+        else if (0 < headerSize)
+        {
+            header.dataOffset += static_cast<size_t>(headerSize);
+        }
+
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // legacy VTK
+    //-------------------------------------------------------------------------
+    const std::map<std::string, cr::Datatype> VTK_TYPES = {
+        {"char", cr::Datatype::signed_byte},
+        {"unsigned_char", cr::Datatype::unsigned_byte},
+        {"short", cr::Datatype::signed_halfword},
+        {"unsigned_short", cr::Datatype::unsigned_halfword},
+        {"int", cr::Datatype::signed_word},
+        {"unsigned_int", cr::Datatype::unsigned_word},
+        {"long", cr::Datatype::signed_longword},
+        {"unsigned_long", cr::Datatype::unsigned_longword},
+        {"vtktypeint64", cr::Datatype::signed_longword},
+        {"vtktypeuint64", cr::Datatype::unsigned_longword},
+        {"float", cr::Datatype::single_precision_float},
+        {"double", cr::Datatype::double_precision_float},
+    };
+
+    /**
+     * \brief reads a binary legacy VTK file with structured points
+     *
+     * The scalars of the point data directly follow the LOOKUP_TABLE line
+     * and are always big endian.
+     */
+    bool readVtkHeader(const std::string &path, cr::VolumeHeader &header)
+    {
+        std::ifstream fs(path.c_str(), std::ios::in | std::ios::binary);
+        std::string line, keyword;
+        bool dimensions = false;
+
+        if (!readLine(fs, line) ||
+                (0 != line.compare(0, 22, "# vtk DataFile Version")))
+            return reportError(path, "no legacy VTK file");
+
+        // title and file type
+        readLine(fs, line);
+        if (!readLine(fs, line) || ("BINARY" != trim(line)))
+            return reportError(path, "only BINARY files are supported");
+
+        header.format = cr::FileFormat::raw;
+        header.endianness = cr::Endianness::big;
+        header.dataFile = path;
+
+        while (readLine(fs, line))
+        {
+            std::istringstream tokens(line);
+
+            if (!(tokens >> keyword))
+                continue;
+
+            if ("DATASET" == keyword)
+            {
+                tokens >> keyword;
+                if ("STRUCTURED_POINTS" != keyword)
+                    return reportError(path,
+                        "unsupported dataset " + keyword);
+            }
+            else if ("DIMENSIONS" == keyword)
+            {
+                dimensions = static_cast<bool>(
+                    tokens >> header.dim[0] >> header.dim[1] >> header.dim[2]);
+            }
+            else if (("SPACING" == keyword) || ("ASPECT_RATIO" == keyword))
+            {
+                std::string values;
+
+                std::getline(tokens, values);
+                readSpacing(values, header.spacing);
+            }
+            else if ("CELL_DATA" == keyword)
+            {
+                return reportError(path, "only point data is supported");
+            }
+            else if ("SCALARS" == keyword)
+            {
+                std::string name, type;
+                unsigned int components = 1;
+
+                tokens >> name >> type;
+                if ((tokens >> components) && (1 != components))
+                    return reportError(path,
+                        "only scalar volumes are supported");
+
+                header.type = findType(VTK_TYPES, toLower(type));
+                if (cr::Datatype::none == header.type)
+                    return reportError(path, "unsupported type " + type);
+            }
+            else if ("LOOKUP_TABLE" == keyword)
+            {
+                header.dataOffset = static_cast<size_t>(fs.tellg());
+
+                if (!dimensions || (cr::Datatype::none == header.type) ||
+                        !fs.good())
+                    return reportError(path, "incomplete header");
+
+                return true;
+            }
+        }
+
+        return reportError(path, "no scalars found");
+    }
+}
+
+//-----------------------------------------------------------------------------
+// volume header functions
+//-----------------------------------------------------------------------------
+/**
+ * \brief true if the file extension belongs to a supported header format
+ */
+bool cr::isVolumeHeaderFile(const std::string &path)
+{
+    std::string extension = toLower(bfs::path(path).extension().string());
+
+    return (".nrrd" == extension) || (".nhdr" == extension) ||
+        (".mhd" == extension) || (".mha" == extension) ||
+        (".vtk" == extension);
+}
+
+/**
+ * \brief reads the volume description from the header of a volume file
+ *
+ * \param path path to a .nrrd, .nhdr, .mhd, .mha or .vtk file
+ * \param header Out: description of the volume and its payload
+ *
+ * \return true if the header describes a volume mvr can load
+ */
+bool cr::readVolumeHeader(const std::string &path, VolumeHeader &header)
+{
+    std::string extension = toLower(bfs::path(path).extension().string());
+    bool success = false;
+
+    header.dim = {{0, 0, 0}};
+    header.spacing = {{1., 1., 1.}};
+    header.type = Datatype::none;
+    header.endianness = util::byteorder::isLittleEndianHost() ?
+        Endianness::little : Endianness::big;
+    header.format = FileFormat::raw;
+    header.dataFile.clear();
+    header.dataOffset = 0;
+    header.dataSkip = 0;
+
+    try
+    {
+        if ((".nrrd" == extension) || (".nhdr" == extension))
+            success = readNrrdHeader(path, header);
+        else if ((".mhd" == extension) || (".mha" == extension))
+            success = readMetaImageHeader(path, header);
+        else if (".vtk" == extension)
+            success = readVtkHeader(path, header);
+    }
+    catch(std::exception &e)
+    {
+        return reportError(path, e.what());
+    }
+
+    if (success &&
+            ((0 == header.dim[0]) || (0 == header.dim[1]) ||
+             (0 == header.dim[2])))
+        return reportError(path, "empty volume");
+
+    return success;
+}
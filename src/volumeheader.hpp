@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <array>
+#include <cstddef>
+
+#include "configraw.hpp"
+
+namespace cr
+{
+    // ------------------------------------------------------------------------
+    // type definitions
+    // ------------------------------------------------------------------------
+    /**
+     * \brief description of a volume read from the header of a volume file
+     *
+     * Covers the information mvr needs from NRRD (.nrrd, .nhdr), MetaImage
+     * (.mhd, .mha) and legacy VTK structured points (.vtk) headers. The
+     * payload is either stored raw or as a single gzip/zlib stream, starting
+     * at dataOffset in dataFile (which is the header file itself for
+     * attached data).
+     */
+    struct VolumeHeader
+    {
+        std::array<size_t, 3> dim;  //!< number of voxels along each axis
+        std::array<double, 3> spacing;  //!< distance of the voxel centers
+                                        //!< along each axis
+        Datatype type;              //!< voxel type
+        Endianness endianness;      //!< byte order of the payload
+        FileFormat format;          //!< raw or gzip encoded payload
+        std::string dataFile;       //!< path of the file with the payload
+        size_t dataOffset;          //!< position of the payload in byte
+        size_t dataSkip;            //!< bytes before the voxels in the
+                                    //!< inflated gzip payload
+    };
+
+    // ------------------------------------------------------------------------
+    // function declarations
+    // ------------------------------------------------------------------------
+    bool isVolumeHeaderFile(const std::string &path);
+    bool readVolumeHeader(const std::string &path, VolumeHeader &header);
+}